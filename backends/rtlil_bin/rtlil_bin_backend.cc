@@ -0,0 +1,87 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/rtlil_bin.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct RtlilBinBackend : public Backend {
+	RtlilBinBackend() : Backend("rtlil_bin", "write design to a binary RTLIL file") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    write_rtlil_bin [options] [filename]\n");
+		log("\n");
+		log("Write the current design to a file in a binary version of the RTLIL format.\n");
+		log("Such a file contains the same information as an ilang file, but is much smaller\n");
+		log("and much faster to write and to read back with 'read_rtlil_bin', which makes\n");
+		log("it suitable for checkpoints of a design. The design read from the file is\n");
+		log("exactly the same as the design that was written, including the order of all\n");
+		log("objects.\n");
+		log("\n");
+		log("    -selected\n");
+		log("        only write the selected modules. modules that are only partially\n");
+		log("        selected are an error.\n");
+		log("\n");
+	}
+	void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		bool selected = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-selected") {
+				selected = true;
+				continue;
+			}
+			break;
+		}
+
+		// lazy modules may still have to be decoded from the file that is about to be overwritten
+		if (RTLIL::Module::lazy_modules_count_ > 0) {
+			design->modules_.load_all();
+			for (auto &it : saved_designs)
+				it.second->modules_.load_all();
+			for (auto saved_design : pushed_designs)
+				saved_design->modules_.load_all();
+		}
+		extra_args(f, filename, args, argidx, true);
+
+		log_header(design, "Executing RTLIL_BIN backend.\n");
+		log("Output filename: %s\n", filename.c_str());
+
+		std::vector<RTLIL::Module*> modules;
+		for (auto &it : design->modules_) {
+			if (selected && !design->selected_module(it.first))
+				continue;
+			if (selected && !design->selected_whole_module(it.first))
+				log_cmd_error("Module %s is only partially selected.\n", log_id(it.first));
+			modules.push_back(it.second);
+		}
+
+		RtlilBinWriter writer;
+		writer.write(*f, design, modules);
+		log("Wrote %d modules.\n", GetSize(modules));
+	}
+} RtlilBinBackend;
+
+PRIVATE_NAMESPACE_END
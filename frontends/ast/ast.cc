@@ -28,6 +28,7 @@
  */
 
 #include "kernel/yosys.h"
+#include "kernel/rtlil_bin.h"
 #include "libs/sha1/sha1.h"
 #include "ast.h"
 
@@ -46,7 +47,7 @@ namespace AST {
 // instantiate global variables (private API)
 namespace AST_INTERNAL {
 	bool flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog, flag_dump_rtlil, flag_nolatches, flag_nomeminit;
-	bool flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire;
+	bool flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire, flag_noreprocess;
 	AstNode *current_ast, *current_ast_mod;
 	std::map<std::string, AstNode*> current_scope;
 	const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr = NULL;
@@ -54,6 +55,7 @@ namespace AST_INTERNAL {
 	AstNode *current_always, *current_top_block, *current_block, *current_block_child;
 	AstModule *current_module;
 	bool current_always_clocked;
+	dict<std::string, std::pair<RTLIL::Const, bool>> const_func_cache;
 }
 
 // convert node types to string
@@ -213,6 +215,115 @@ AstNode::AstNode(AstNodeType type, AstNode *child1, AstNode *child2, AstNode *ch
 		children.push_back(child3);
 }
 
+static bool ast_node_use_pool = (getenv("YOSYS_NOARENA") == nullptr);
+
+// Pool for the AST nodes. Unlike RTLIL::ObjArena, which keeps its chunks as long as the module
+// exists, a chunk is released as soon as all nodes in it are deleted, so the memory of the ASTs
+// that are dropped after reading a file or by simplify() can be reused for the netlist. Each node
+// is preceded by a pointer to its chunk.
+struct AstNodePool
+{
+	static const int chunk_nodes = 512;
+	static const size_t header_size = (sizeof(void*) + alignof(AstNode) - 1) / alignof(AstNode) * alignof(AstNode);
+	static const size_t slot_size = header_size + sizeof(AstNode);
+
+	struct chunk_t {
+		char *data;
+		void *free_list;
+		int used, next_slot;
+		int avail_index; // position in avail, or -1 if the chunk is full
+	};
+
+	// the chunks with free slots, new nodes come from the last one
+	std::vector<chunk_t*> avail;
+	// one empty chunk is kept, so that creating and deleting a node at a chunk boundary
+	// does not allocate and free a chunk every time
+	chunk_t *spare = nullptr;
+
+	void *allocate()
+	{
+		if (avail.empty()) {
+			chunk_t *chunk = spare;
+			spare = nullptr;
+			if (chunk == nullptr) {
+				chunk = new chunk_t;
+				chunk->data = new char[chunk_nodes * slot_size];
+				chunk->free_list = nullptr;
+				chunk->used = 0;
+				chunk->next_slot = 0;
+			}
+			chunk->avail_index = GetSize(avail);
+			avail.push_back(chunk);
+		}
+
+		chunk_t *chunk = avail.back();
+		void *p = chunk->free_list;
+		if (p != nullptr) {
+			chunk->free_list = *static_cast<void**>(p);
+		} else {
+			char *slot = chunk->data + chunk->next_slot++ * slot_size;
+			*reinterpret_cast<chunk_t**>(slot) = chunk;
+			p = slot + header_size;
+		}
+
+		if (++chunk->used == chunk_nodes) {
+			avail.pop_back();
+			chunk->avail_index = -1;
+		}
+		return p;
+	}
+
+	void deallocate(void *p)
+	{
+		chunk_t *chunk = *reinterpret_cast<chunk_t**>(static_cast<char*>(p) - header_size);
+		*static_cast<void**>(p) = chunk->free_list;
+		chunk->free_list = p;
+
+		if (chunk->avail_index < 0) {
+			chunk->avail_index = GetSize(avail);
+			avail.push_back(chunk);
+		}
+
+		if (--chunk->used == 0) {
+			avail[chunk->avail_index] = avail.back();
+			avail[chunk->avail_index]->avail_index = chunk->avail_index;
+			avail.pop_back();
+			if (spare != nullptr) {
+				delete[] spare->data;
+				delete spare;
+			}
+			chunk->free_list = nullptr;
+			chunk->next_slot = 0;
+			spare = chunk;
+		}
+	}
+};
+
+// never destroyed, nodes may still be deleted by static destructors
+static AstNodePool &ast_node_pool()
+{
+	static AstNodePool *pool = new AstNodePool;
+	return *pool;
+}
+
+void *AstNode::operator new(size_t size)
+{
+	log_assert(size == sizeof(AstNode));
+	if (!ast_node_use_pool)
+		return ::operator new(size);
+	return ast_node_pool().allocate();
+}
+
+void AstNode::operator delete(void *p)
+{
+	if (p == nullptr)
+		return;
+	if (!ast_node_use_pool)
+		::operator delete(p);
+	else
+		ast_node_pool().deallocate(p);
+}
+
 // create a (deep recursive) copy of a node
 AstNode *AstNode::clone() const
 {
@@ -914,16 +1025,27 @@ static AstModule* process_module(AstNode *ast, bool defer, AstNode *original_ast
 
 	current_module = new AstModule;
 	current_module->ast = NULL;
+	const_func_cache.clear();
 	current_module->name = ast->str;
 	current_module->attributes["\\src"] = stringf("%s:%d", ast->filename.c_str(), ast->linenum);
 	current_module->set_bool_attribute("\\cells_not_processed");
 
 	current_ast_mod = ast;
+
+	// with -noreprocess only the ASTs of modules that can still be derived with different
+	// parameters (and interfaces) are kept
+	bool keep_ast = !flag_noreprocess || defer || ast->type == AST_INTERFACE || original_ast != NULL;
+	for (auto child : ast->children)
+		if (child->type == AST_PARAMETER || child->type == AST_INTERFACEPORT)
+			keep_ast = true;
+
 	AstNode *ast_before_simplify;
 	if (original_ast != NULL)
 		ast_before_simplify = original_ast;
-	else
+	else if (keep_ast)
 		ast_before_simplify = ast->clone();
+	else
+		ast_before_simplify = NULL;
 
 	if (flag_dump_ast1) {
 		log("Dumping Verilog AST before simplification:\n");
@@ -1004,7 +1126,9 @@ static AstModule* process_module(AstNode *ast, bool defer, AstNode *original_ast
 	current_module->noopt = flag_noopt;
 	current_module->icells = flag_icells;
 	current_module->autowire = flag_autowire;
+	current_module->noreprocess = flag_noreprocess;
 	current_module->fixup_ports();
+	const_func_cache.clear();
 
 	if (flag_dump_rtlil) {
 		log("Dumping generated RTLIL:\n");
@@ -1017,7 +1141,8 @@ static AstModule* process_module(AstNode *ast, bool defer, AstNode *original_ast
 
 // create AstModule instances for all modules in the AST tree and add them to 'design'
 void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool no_dump_ptr, bool dump_vlog, bool dump_rtlil,
-		bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool nooverwrite, bool overwrite, bool defer, bool autowire)
+		bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool nooverwrite, bool overwrite, bool defer, bool autowire,
+		bool noreprocess)
 {
 	current_ast = ast;
 	flag_dump_ast1 = dump_ast1;
@@ -1033,6 +1158,7 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump
 	flag_noopt = noopt;
 	flag_icells = icells;
 	flag_autowire = autowire;
+	flag_noreprocess = noreprocess;
 
 	log_assert(current_ast->type == AST_DESIGN);
 	for (auto it = current_ast->children.begin(); it != current_ast->children.end(); it++)
@@ -1170,6 +1296,9 @@ void AST::explode_interface_port(AstNode *module_ast, RTLIL::Module * intfmodule
 // from AST. The interface members are copied into the AST module with the prefix of the interface.
 void AstModule::reprocess_module(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Module*> local_interfaces)
 {
+	if (ast == NULL)
+		log_error("Module `%s' uses interfaces, it can't be read with read_verilog -noreprocess or -incremental.\n", log_id(name));
+
 	bool is_top = false;
 	AstNode *new_ast = ast->clone();
 	for (auto &intf : local_interfaces) {
@@ -1256,25 +1385,24 @@ void AstModule::reprocess_module(RTLIL::Design *design, dict<RTLIL::IdString, RT
 // This method is used to explode the interface when the interface is a port of the module (not instantiated inside)
 RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, dict<RTLIL::IdString, RTLIL::Module*> interfaces, dict<RTLIL::IdString, RTLIL::IdString> modports, bool mayfail)
 {
-	AstNode *new_ast = NULL;
-	std::string modname = derive_common(design, parameters, &new_ast, mayfail);
+	if (interfaces.empty())
+		return derive(design, parameters, mayfail);
+
+	std::string modname = derive_common(design, parameters, NULL, mayfail);
 
 	// Since interfaces themselves may be instantiated with different parameters,
 	// "modname" must also take those into account, so that unique modules
 	// are derived for any variant of interface connections:
 	std::string interf_info = "";
 
-	bool has_interfaces = false;
-	for(auto &intf : interfaces) {
+	for(auto &intf : interfaces)
 		interf_info += log_id(intf.second->name);
-		has_interfaces = true;
-	}
 
-	if (has_interfaces)
-		modname += "$interfaces$" + interf_info;
+	modname += "$interfaces$" + interf_info;
 
 
 	if (!design->has(modname)) {
+		AstNode *new_ast = derive_ast(parameters);
 		new_ast->str = modname;
 
 		// Iterate over all interfaces which are ports in this module:
@@ -1314,37 +1442,71 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, R
 		}
 
 		// If any interfaces were replaced, set the attribute 'interfaces_replaced_in_module':
-		if (interfaces.size() > 0) {
-			mod->set_bool_attribute("\\interfaces_replaced_in_module");
-		}
+		mod->set_bool_attribute("\\interfaces_replaced_in_module");
 
+		delete new_ast;
 	} else {
 		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
 	}
 
-	delete new_ast;
 	return modname;
 }
 
 // create a new parametric module (when needed) and return the name of the generated module - without support for interfaces
 RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, bool mayfail)
 {
-	AstNode *new_ast = NULL;
-	std::string modname = derive_common(design, parameters, &new_ast, mayfail);
+	std::string modname = derive_common(design, parameters, NULL, mayfail);
 
 	if (!design->has(modname)) {
+		AstNode *new_ast = derive_ast(parameters);
 		new_ast->str = modname;
-		design->add(process_module(new_ast, false));
+		if (!load_derive_cache(design, new_ast)) {
+			design->add(process_module(new_ast, false));
+			save_derive_cache(design, new_ast);
+		}
 		design->module(modname)->check();
+		delete new_ast;
+
+		// derived modules are never derived again
+		AstModule *mod = (AstModule*)design->module(modname);
+		if (noreprocess && mod->ast != NULL) {
+			delete mod->ast;
+			mod->ast = NULL;
+		}
 	} else {
 		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
 	}
 
-	delete new_ast;
 	return modname;
 }
 
-// create a new parametric module (when needed) and return the name of the generated module
+// the parameter of the module AST that each entry of 'parameters' is assigned to, by name or
+// by position ("$1", "$2", ...). the entries that match no parameter are defparams.
+static dict<RTLIL::IdString, AstNode*> match_parameters(AstNode *ast, const dict<RTLIL::IdString, RTLIL::Const> &parameters)
+{
+	dict<RTLIL::IdString, AstNode*> matches;
+	int para_counter = 0;
+	for (auto child : ast->children) {
+		if (child->type != AST_PARAMETER)
+			continue;
+		para_counter++;
+		if (parameters.count(child->str) > 0 && matches.count(child->str) == 0)
+			matches[child->str] = child;
+		else if (parameters.count(stringf("$%d", para_counter)) > 0)
+			matches[stringf("$%d", para_counter)] = child;
+	}
+	return matches;
+}
+
+static AstNode *mkconst_parameter(const RTLIL::Const &value)
+{
+	if ((value.flags & RTLIL::CONST_FLAG_STRING) != 0)
+		return AstNode::mkconst_str(value.decode_string());
+	return AstNode::mkconst_bits(value.bits, (value.flags & RTLIL::CONST_FLAG_SIGNED) != 0);
+}
+
+// log the parameters and return the name of the parametric module. the AST of the module is
+// not copied here, so that deriving a module that already exists is cheap (see derive_ast()).
 std::string AstModule::derive_common(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, AstNode **new_ast_out, bool)
 {
 	std::string stripped_name = name.str();
@@ -1354,6 +1516,9 @@ std::string AstModule::derive_common(RTLIL::Design *design, dict<RTLIL::IdString
 
 	log_header(design, "Executing AST frontend in derive mode using pre-parsed AST for module `%s'.\n", stripped_name.c_str());
 
+	if (ast == NULL)
+		log_error("Module `%s' was read with read_verilog -noreprocess or -incremental and can't be derived.\n", stripped_name.c_str());
+
 	current_ast = NULL;
 	flag_dump_ast1 = false;
 	flag_dump_ast2 = false;
@@ -1366,69 +1531,177 @@ std::string AstModule::derive_common(RTLIL::Design *design, dict<RTLIL::IdString
 	flag_noopt = noopt;
 	flag_icells = icells;
 	flag_autowire = autowire;
+	flag_noreprocess = noreprocess;
 	use_internal_line_num();
 
 	std::string para_info;
-	AstNode *new_ast = ast->clone();
+	dict<RTLIL::IdString, AstNode*> matches = match_parameters(ast, parameters);
 
 	int para_counter = 0;
-	int orig_parameters_n = parameters.size();
-	for (auto it = new_ast->children.begin(); it != new_ast->children.end(); it++) {
-		AstNode *child = *it;
+	for (auto child : ast->children) {
 		if (child->type != AST_PARAMETER)
 			continue;
 		para_counter++;
-		std::string para_id = child->str;
-		if (parameters.count(para_id) > 0) {
-			log("Parameter %s = %s\n", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[child->str])));
-	rewrite_parameter:
-			para_info += stringf("%s=%s", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[para_id])));
-			delete child->children.at(0);
-			if ((parameters[para_id].flags & RTLIL::CONST_FLAG_STRING) != 0)
-				child->children[0] = AstNode::mkconst_str(parameters[para_id].decode_string());
+		for (auto &it : matches) {
+			if (it.second != child)
+				continue;
+			if (it.first == child->str)
+				log("Parameter %s = %s\n", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters.at(it.first))));
 			else
-				child->children[0] = AstNode::mkconst_bits(parameters[para_id].bits, (parameters[para_id].flags & RTLIL::CONST_FLAG_SIGNED) != 0);
-			parameters.erase(para_id);
-			continue;
+				log("Parameter %d (%s) = %s\n", para_counter, child->str.c_str(), log_signal(RTLIL::SigSpec(parameters.at(it.first))));
+			para_info += stringf("%s=%s", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters.at(it.first))));
 		}
-		para_id = stringf("$%d", para_counter);
-		if (parameters.count(para_id) > 0) {
-			log("Parameter %d (%s) = %s\n", para_counter, child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[para_id])));
-			goto rewrite_parameter;
+	}
+
+	std::string modname;
+
+	if (parameters.empty())
+		modname = stripped_name;
+	else if (para_info.size() > 60)
+		modname = "$paramod$" + sha1(para_info) + stripped_name;
+	else
+		modname = "$paramod" + stripped_name + para_info;
+
+	if (new_ast_out != NULL)
+		(*new_ast_out) = derive_ast(parameters);
+	return modname;
+}
+
+// create a copy of the module AST with the parameters set to the given values
+AstNode *AstModule::derive_ast(dict<RTLIL::IdString, RTLIL::Const> parameters)
+{
+	AstNode *new_ast = ast->clone();
+	dict<RTLIL::IdString, AstNode*> matches = match_parameters(ast, parameters);
+
+	for (int i = 0; i < GetSize(ast->children); i++) {
+		if (ast->children[i]->type != AST_PARAMETER)
+			continue;
+		for (auto &it : matches) {
+			if (it.second != ast->children[i])
+				continue;
+			AstNode *child = new_ast->children[i];
+			delete child->children.at(0);
+			child->children[0] = mkconst_parameter(parameters.at(it.first));
+			parameters.erase(it.first);
 		}
 	}
 
 	for (auto param : parameters) {
 		AstNode *defparam = new AstNode(AST_DEFPARAM, new AstNode(AST_IDENTIFIER));
 		defparam->children[0]->str = param.first.str();
-		if ((param.second.flags & RTLIL::CONST_FLAG_STRING) != 0)
-			defparam->children.push_back(AstNode::mkconst_str(param.second.decode_string()));
-		else
-			defparam->children.push_back(AstNode::mkconst_bits(param.second.bits, (param.second.flags & RTLIL::CONST_FLAG_SIGNED) != 0));
+		defparam->children.push_back(mkconst_parameter(param.second));
 		new_ast->children.push_back(defparam);
 	}
 
-	std::string modname;
+	return new_ast;
+}
 
-	if (orig_parameters_n == 0)
-		modname = stripped_name;
-	else if (para_info.size() > 60)
-		modname = "$paramod$" + sha1(para_info) + stripped_name;
-	else
-		modname = "$paramod" + stripped_name + para_info;
+void AST::ast_checksum_data(std::string &buf, const AstNode *node)
+{
+	buf += stringf("%d %d %d %d %d %d %d %d %d %d %d %u %a %zu:", node->type, node->is_input, node->is_output, node->is_reg,
+			node->is_logic, node->is_signed, node->is_string, node->range_valid, node->range_swapped, node->range_left,
+			node->range_right, node->integer, node->realvalue, node->str.size());
+	buf += node->str;
+	buf += stringf(" %d %s:%d %zu:", node->port_id, node->filename.c_str(), node->linenum, node->bits.size());
+	for (auto bit : node->bits)
+		buf += char('0' + bit);
+	for (auto dim : node->multirange_dimensions)
+		buf += stringf(" %d", dim);
+	buf += stringf(" %zu attributes:", node->attributes.size());
+	for (auto &it : node->attributes) {
+		buf += it.first.str() + " ";
+		ast_checksum_data(buf, it.second);
+	}
+	buf += stringf(" %zu children:", node->children.size());
+	for (auto child : node->children)
+		ast_checksum_data(buf, child);
+	buf += "\n";
+}
+
+// the RTLIL of a module with $readmem* also depends on the contents of the memory files
+bool AST::ast_cacheable(const AstNode *node)
+{
+	if (node->type == AST_INTERFACE || node->type == AST_INTERFACEPORT || node->type == AST_DPI_FUNCTION)
+		return false;
+	if (node->type == AST_TCALL && (node->str == "$readmemh" || node->str == "$readmemb"))
+		return false;
+	for (auto child : node->children)
+		if (!ast_cacheable(child))
+			return false;
+	return true;
+}
 
+// The RTLIL of derived modules can be cached on disk, in the directory of the script cache (see
+// 'help script_cache'). The key covers the yosys version, the options of the module and its AST
+// with the parameters set.
+//
+// Modules are derived one at a time, also with more than one thread: simplify() and genRTLIL()
+// keep their state in the AST_INTERNAL globals (current_module, current_scope, ...).
+std::string AstModule::derive_cache_filename(AstNode *new_ast)
+{
+	if (ScriptPass::cache_dir.empty() || !ast_cacheable(new_ast))
+		return std::string();
 
-	(*new_ast_out) = new_ast;
-	return modname;
+	std::string buf = stringf("%s\n%d %d %d %d %d %d %d %d\n", yosys_version_str, nolatches, nomeminit, nomem2reg, mem2reg,
+			lib, noopt, icells, autowire);
+	ast_checksum_data(buf, new_ast);
+	return stringf("%s/derive_%s.bin", ScriptPass::cache_dir.c_str(), sha1(buf).c_str());
 }
 
-RTLIL::Module *AstModule::clone() const
+bool AstModule::load_derive_cache(RTLIL::Design *design, AstNode *new_ast)
 {
-	AstModule *new_mod = new AstModule;
-	new_mod->name = name;
-	cloneInto(new_mod);
+	std::string filename = derive_cache_filename(new_ast);
+	if (filename.empty() || !check_file_exists(filename))
+		return false;
+
+	log("Loading RTLIL representation for module `%s' from derive cache `%s'.\n", new_ast->str.c_str(), filename.c_str());
+
+	RtlilBinReader reader;
+	reader.open(filename);
+	if (reader.num_modules() != 1)
+		log_error("Derive cache entry `%s' is corrupt.\n", filename.c_str());
+
+	// an AstModule like the one process_module() would have created
+	AstModule *mod = new AstModule;
+	reader.load_module(0, mod);
+	autoidx = std::max(autoidx, reader.file_autoidx);
+
+	mod->ast = noreprocess ? NULL : new_ast->clone();
+	mod->nolatches = nolatches;
+	mod->nomeminit = nomeminit;
+	mod->nomem2reg = nomem2reg;
+	mod->mem2reg = mem2reg;
+	mod->lib = lib;
+	mod->noopt = noopt;
+	mod->icells = icells;
+	mod->autowire = autowire;
+	mod->noreprocess = noreprocess;
+	design->add(mod);
+	return true;
+}
+
+void AstModule::save_derive_cache(RTLIL::Design *design, AstNode *new_ast)
+{
+	std::string filename = derive_cache_filename(new_ast);
+	if (filename.empty())
+		return;
+
+	// write to a temporary file first, so other processes never see partial entries
+	std::string temp_filename = make_temp_file(ScriptPass::cache_dir + "/.yosys_XXXXXX");
+	std::ofstream f(temp_filename.c_str(), std::ofstream::trunc | std::ofstream::binary);
+	RtlilBinWriter().write(f, design, std::vector<RTLIL::Module*>{design->module(new_ast->str)});
+	f.close();
 
-	new_mod->ast = ast->clone();
+	if (f.fail() || ::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+		log_warning("Can't write derive cache entry `%s': %s\n", filename.c_str(), strerror(errno));
+		::remove(temp_filename.c_str());
+	}
+}
+
+RTLIL::Module *AstModule::clone_empty() const
+{
+	AstModule *new_mod = new AstModule;
+	new_mod->ast = ast ? ast->clone() : NULL;
 	new_mod->nolatches = nolatches;
 	new_mod->nomeminit = nomeminit;
 	new_mod->nomem2reg = nomem2reg;
@@ -1437,6 +1710,7 @@ RTLIL::Module *AstModule::clone() const
 	new_mod->noopt = noopt;
 	new_mod->icells = icells;
 	new_mod->autowire = autowire;
+	new_mod->noreprocess = noreprocess;
 
 	return new_mod;
 }
@@ -195,6 +195,11 @@ namespace AST
 
 		// creating and deleting nodes
 		AstNode(AstNodeType type = AST_NONE, AstNode *child1 = NULL, AstNode *child2 = NULL, AstNode *child3 = NULL);
+
+		// nodes are allocated from a pool (unless YOSYS_NOARENA is set, see RTLIL::Module). AST nodes
+		// must only be created and deleted in the main thread.
+		static void *operator new(size_t size);
+		static void operator delete(void *p);
 		AstNode *clone() const;
 		void cloneInto(AstNode *other) const;
 		void delete_children();
@@ -280,19 +285,29 @@ namespace AST
 
 	// process an AST tree (ast must point to an AST_DESIGN node) and generate RTLIL code
 	void process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool no_dump_ptr, bool dump_vlog, bool dump_rtlil, bool nolatches, bool nomeminit,
-			bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool nooverwrite, bool overwrite, bool defer, bool autowire);
+			bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool nooverwrite, bool overwrite, bool defer, bool autowire,
+			bool noreprocess = false);
+
+	// everything the RTLIL generated from an AST depends on, including the source locations, and
+	// whether that RTLIL can be cached (not when it depends on the contents of other files)
+	void ast_checksum_data(std::string &buf, const AstNode *node);
+	bool ast_cacheable(const AstNode *node);
 
 	// parametric modules are supported directly by the AST library
 	// therefore we need our own derivate of RTLIL::Module with overloaded virtual functions
 	struct AstModule : RTLIL::Module {
 		AstNode *ast;
-		bool nolatches, nomeminit, nomem2reg, mem2reg, lib, noopt, icells, autowire;
+		bool nolatches, nomeminit, nomem2reg, mem2reg, lib, noopt, icells, autowire, noreprocess;
 		~AstModule() YS_OVERRIDE;
 		RTLIL::IdString derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, bool mayfail) YS_OVERRIDE;
 		RTLIL::IdString derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, dict<RTLIL::IdString, RTLIL::Module*> interfaces, dict<RTLIL::IdString, RTLIL::IdString> modports, bool mayfail) YS_OVERRIDE;
 		std::string derive_common(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters, AstNode **new_ast_out, bool mayfail);
+		AstNode *derive_ast(dict<RTLIL::IdString, RTLIL::Const> parameters);
+		std::string derive_cache_filename(AstNode *new_ast);
+		bool load_derive_cache(RTLIL::Design *design, AstNode *new_ast);
+		void save_derive_cache(RTLIL::Design *design, AstNode *new_ast);
 		void reprocess_module(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Module *> local_interfaces) YS_OVERRIDE;
-		RTLIL::Module *clone() const YS_OVERRIDE;
+		RTLIL::Module *clone_empty() const YS_OVERRIDE;
 	};
 
 	// this must be set by the language frontend before parsing the sources
@@ -319,7 +334,12 @@ namespace AST_INTERNAL
 {
 	// internal state variables
 	extern bool flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_rtlil, flag_nolatches, flag_nomeminit;
-	extern bool flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire;
+	extern bool flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire, flag_noreprocess;
+
+	// results of constant function calls in the module that is being processed, by function
+	// declaration and argument values. cleared for each module, because the functions of
+	// modules derived with different parameters share the same declaration nodes.
+	extern dict<std::string, std::pair<RTLIL::Const, bool>> const_func_cache;
 	extern AST::AstNode *current_ast, *current_ast_mod;
 	extern std::map<std::string, AST::AstNode*> current_scope;
 	extern const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr;
@@ -27,6 +27,7 @@
  */
 
 #include "kernel/log.h"
+#include "kernel/mapfile.h"
 #include "libs/sha1/sha1.h"
 #include "frontends/verilog/verilog_frontend.h"
 #include "ast.h"
@@ -2187,9 +2188,26 @@ skip_dynamic_range_lvalue_expansion:;
 			}
 
 			if (all_args_const) {
+				// the hashidx_ tells apart declarations that are allocated at the same address
+				std::string key = stringf("%p %u %s", decl, decl->hashidx_, decl->str.c_str());
+				for (auto child : children) {
+					key += stringf(" %d'", child->is_signed);
+					for (auto bit : child->bits)
+						key += char('0' + bit);
+				}
+
+				auto it = const_func_cache.find(key);
+				if (it != const_func_cache.end()) {
+					cover("frontends.ast.const_func.hit");
+					newNode = mkconst_bits(it->second.first.bits, it->second.second);
+					goto apply_newNode;
+				}
+
+				cover("frontends.ast.const_func.miss");
 				AstNode *func_workspace = current_scope[str]->clone();
 				newNode = func_workspace->eval_const_function(this);
 				delete func_workspace;
+				const_func_cache[key] = std::make_pair(RTLIL::Const(newNode->bits), bool(newNode->is_signed));
 				goto apply_newNode;
 			}
 
@@ -2687,7 +2705,60 @@ static void replace_result_wire_name_in_function(AstNode *node, std::string &fro
 		node->str = to;
 }
 
-// replace a readmem[bh] TCALL ast node with a block of memory assignments
+// decode a word of a $readmemh/$readmemb file and append it to 'bits', with the same result
+// as const2ast() for "<width>'h<word>" or "<width>'b<word>" (characters that are not digits
+// are ignored, short words are extended with their x or z msb)
+static void readmem_decode_word(std::vector<RTLIL::State> &bits, const char *begin, const char *end, int width, bool is_readmemh)
+{
+	int base = is_readmemh ? 16 : 2, bits_per_digit = is_readmemh ? 4 : 1;
+	size_t offset = bits.size();
+
+	for (const char *p = end; p != begin;)
+	{
+		char ch = *--p;
+		int digit;
+		if ('0' <= ch && ch <= '9')
+			digit = ch - '0';
+		else if ('a' <= ch && ch <= 'f')
+			digit = 10 + ch - 'a';
+		else if ('A' <= ch && ch <= 'F')
+			digit = 10 + ch - 'A';
+		else if (ch == 'x' || ch == 'X' || ch == 'z' || ch == 'Z' || ch == '?') {
+			RTLIL::State state = ch == '?' ? RTLIL::Sa : (ch == 'x' || ch == 'X') ? RTLIL::Sx : RTLIL::Sz;
+			bits.insert(bits.end(), bits_per_digit, state);
+			continue;
+		} else
+			continue;
+
+		if (digit > base-1)
+			log_file_error(current_filename, get_line_num(), "Digit larger than %d used in in base-%d constant.\n", base-1, base);
+		for (int i = 0; i < bits_per_digit; i++)
+			bits.push_back((digit & (1 << i)) ? RTLIL::S1 : RTLIL::S0);
+	}
+
+	int len = GetSize(bits) - offset;
+	RTLIL::State msb = len == 0 ? RTLIL::S0 : bits.back();
+
+	for (len = len - 1; len >= 0; len--)
+		if (bits[offset + len] == RTLIL::S1)
+			break;
+	if (msb == RTLIL::S0 || msb == RTLIL::S1) {
+		len += 1;
+		bits.resize(offset + width, RTLIL::S0);
+	} else {
+		len += 2;
+		bits.resize(offset + width, msb);
+	}
+
+	if (len > width)
+		log_warning("Literal has a width of %d bit, but value requires %d bit. (%s:%d)\n",
+			width, len, current_filename.c_str(), get_line_num());
+}
+
+// replace a readmem[bh] TCALL ast node with a block of memory assignments. the file is scanned
+// in place and the words are decoded directly into the data of the AST_MEMINIT nodes, one node
+// per range of consecutive addresses, so the size of the AST does not depend on the file size
+// for the usual unconditional $readmem* in an initial block.
 AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *memory, int start_addr, int finish_addr, bool unconditional_init)
 {
 	int mem_width, mem_size, addr_bits;
@@ -2700,12 +2771,15 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 	vector<State> meminit_bits;
 	int meminit_size=0;
 
-	std::ifstream f;
-	f.open(mem_filename.c_str());
+	MappedFile file;
 	yosys_input_files.insert(mem_filename);
 
-	if (f.fail())
-		log_file_error(filename, linenum, "Can not open file `%s` for %s.\n", mem_filename.c_str(), str.c_str());
+	if (!file.map(mem_filename)) {
+		std::ifstream f(mem_filename.c_str());
+		if (f.fail())
+			log_file_error(filename, linenum, "Can not open file `%s` for %s.\n", mem_filename.c_str(), str.c_str());
+		file.read(f);
+	}
 
 	log_assert(GetSize(memory->children) == 2 && memory->children[1]->type == AST_RANGE && memory->children[1]->range_valid);
 	int range_left =  memory->children[1]->range_left, range_right =  memory->children[1]->range_right;
@@ -2721,33 +2795,51 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 	int increment = start_addr <= finish_addr ? +1 : -1;
 	int cursor = start_addr;
 
-	while (!f.eof())
+	auto finish_meminit = [&]() {
+		meminit->children[1] = AstNode::mkconst_bits(meminit_bits, false);
+		meminit->children[2] = AstNode::mkconst_int(meminit_size, false);
+	};
+
+	std::string line;
+	std::vector<State> word_bits;
+	const char *ptr = file.data, *end = file.data + file.size;
+
+	while (ptr < end)
 	{
-		std::string line, token;
-		std::getline(f, line);
+		const char *line_end = (const char*)memchr(ptr, '\n', end - ptr);
+		if (line_end == nullptr)
+			line_end = end;
+		line.assign(ptr, line_end);
+		ptr = line_end + 1;
 
 		for (int i = 0; i < GetSize(line); i++) {
-			if (in_comment && line.substr(i, 2) == "*/") {
+			bool has_next = i+1 < GetSize(line);
+			if (in_comment && has_next && line[i] == '*' && line[i+1] == '/') {
 				line[i] = ' ';
 				line[i+1] = ' ';
 				in_comment = false;
 				continue;
 			}
-			if (!in_comment && line.substr(i, 2) == "/*")
+			if (!in_comment && has_next && line[i] == '/' && line[i+1] == '*')
 				in_comment = true;
 			if (in_comment)
 				line[i] = ' ';
 		}
 
+		const char *p = line.data(), *p_end = line.data() + line.size();
 		while (1)
 		{
-			token = next_token(line, " \t\r\n");
-			if (token.empty() || token.substr(0, 2) == "//")
+			while (p < p_end && (*p == ' ' || *p == '\t' || *p == '\r'))
+				p++;
+			const char *token = p;
+			while (p < p_end && *p != ' ' && *p != '\t' && *p != '\r')
+				p++;
+			if (token == p || (p - token >= 2 && token[0] == '/' && token[1] == '/'))
 				break;
 
 			if (token[0] == '@') {
-				token = token.substr(1);
-				const char *nptr = token.c_str();
+				std::string addr(token+1, p);
+				const char *nptr = addr.c_str();
 				char *endptr;
 				cursor = strtol(nptr, &endptr, 16);
 				if (!*nptr || *endptr)
@@ -2755,16 +2847,12 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 				continue;
 			}
 
-			AstNode *value = VERILOG_FRONTEND::const2ast(stringf("%d'%c", mem_width, is_readmemh ? 'h' : 'b') + token);
-
 			if (unconditional_init)
 			{
 				if (meminit == nullptr || cursor != next_meminit_cursor)
 				{
-					if (meminit != nullptr) {
-						meminit->children[1] = AstNode::mkconst_bits(meminit_bits, false);
-						meminit->children[2] = AstNode::mkconst_int(meminit_size, false);
-					}
+					if (meminit != nullptr)
+						finish_meminit();
 
 					meminit = new AstNode(AST_MEMINIT);
 					meminit->children.push_back(AstNode::mkconst_int(cursor, false));
@@ -2781,11 +2869,13 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 
 				meminit_size++;
 				next_meminit_cursor++;
-				meminit_bits.insert(meminit_bits.end(), value->bits.begin(), value->bits.end());
-				delete value;
+				readmem_decode_word(meminit_bits, token, p, mem_width, is_readmemh);
 			}
 			else
 			{
+				word_bits.clear();
+				readmem_decode_word(word_bits, token, p, mem_width, is_readmemh);
+				AstNode *value = AstNode::mkconst_bits(word_bits, false);
 				block->children.push_back(new AstNode(AST_ASSIGN_EQ, new AstNode(AST_IDENTIFIER, new AstNode(AST_RANGE, AstNode::mkconst_int(cursor, false))), value));
 				block->children.back()->children[0]->str = memory->str;
 				block->children.back()->children[0]->id2ast = memory;
@@ -2801,10 +2891,8 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 			break;
 	}
 
-	if (meminit != nullptr) {
-		meminit->children[1] = AstNode::mkconst_bits(meminit_bits, false);
-		meminit->children[2] = AstNode::mkconst_int(meminit_size, false);
-	}
+	if (meminit != nullptr)
+		finish_meminit();
 
 	return block;
 }
@@ -3288,7 +3376,7 @@ void AstNode::replace_variables(std::map<std::string, AstNode::varinfo_t> &varia
 			width = min(std::abs(children.at(0)->range_left - children.at(0)->range_right) + 1, width);
 		}
 		offset -= variables.at(str).offset;
-		std::vector<RTLIL::State> &var_bits = variables.at(str).val.bits;
+		const RTLIL::StateVector &var_bits = variables.at(str).val.bits;
 		std::vector<RTLIL::State> new_bits(var_bits.begin() + offset, var_bits.begin() + offset + width);
 		AstNode *newNode = mkconst_bits(new_bits, variables.at(str).is_signed);
 		newNode->cloneInto(this);
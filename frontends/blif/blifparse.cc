@@ -18,41 +18,180 @@
  */
 
 #include "blifparse.h"
+#include "kernel/mapfile.h"
+#include "kernel/threading.h"
 
 YOSYS_NAMESPACE_BEGIN
 
-static bool read_next_line(char *&buffer, size_t &buffer_size, int &line_count, std::istream &f)
+namespace {
+
+struct BlifToken
+{
+	const char *begin, *end;
+
+	bool is(const char *s) const {
+		size_t len = strlen(s);
+		return size_t(end - begin) == len && !memcmp(begin, s, len);
+	}
+
+	std::string str() const {
+		return std::string(begin, end);
+	}
+
+	int size() const {
+		return end - begin;
+	}
+};
+
+// A .names block whose cover is decoded into the LUT or TABLE parameter of its cell after the
+// module is parsed. The rows are stored in names_rows as the input characters followed by the
+// output character.
+struct BlifNames
+{
+	RTLIL::Const *table;
+	bool sop;
+	int width, num_rows;
+	size_t offset;
+};
+
+}
+
+// Returns the next non-empty line, with continuation lines joined. The line points into the
+// input data unless it is continued, then it points to line_buf.
+static bool read_next_line(const char *&ptr, const char *end, const char *&line, const char *&line_end,
+		std::string &line_buf, int &line_count)
+{
+	bool continued = false;
+
+	while (1)
+	{
+		if (ptr == end)
+			return false;
+
+		line_count++;
+		const char *b = ptr, *e = (const char*)memchr(ptr, '\n', end - ptr);
+		if (e == nullptr)
+			e = end;
+		ptr = e == end ? end : e+1;
+
+		while (e != b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r'))
+			e--;
+
+		if (!continued) {
+			if (b == e)
+				continue;
+			if (e[-1] != '\\') {
+				line = b, line_end = e;
+				return true;
+			}
+			line_buf.assign(b, e-1);
+			continued = true;
+			continue;
+		}
+
+		line_buf.append(b, e);
+		while (!line_buf.empty() && (line_buf.back() == ' ' || line_buf.back() == '\t' || line_buf.back() == '\r'))
+			line_buf.pop_back();
+
+		if (line_buf.empty()) {
+			continued = false;
+			continue;
+		}
+
+		if (line_buf.back() == '\\') {
+			line_buf.pop_back();
+			continue;
+		}
+
+		line = line_buf.data(), line_end = line_buf.data() + line_buf.size();
+		return true;
+	}
+}
+
+static void split_line(const char *p, const char *end, std::vector<BlifToken> &tokens)
 {
-	string strbuf;
-	int buffer_len = 0;
-	buffer[0] = 0;
+	tokens.clear();
 
 	while (1)
 	{
-		buffer_len += strlen(buffer + buffer_len);
-		while (buffer_len > 0 && (buffer[buffer_len-1] == ' ' || buffer[buffer_len-1] == '\t' ||
-				buffer[buffer_len-1] == '\r' || buffer[buffer_len-1] == '\n'))
-			buffer[--buffer_len] = 0;
-
-		if (buffer_size-buffer_len < 4096) {
-			buffer_size *= 2;
-			buffer = (char*)realloc(buffer, buffer_size);
+		while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+		if (p == end)
+			break;
+
+		BlifToken tok;
+		tok.begin = p;
+		while (p != end && *p != ' ' && *p != '\t' && *p != '\r')
+			p++;
+		tok.end = p;
+		tokens.push_back(tok);
+	}
+}
+
+static void decode_names(const BlifNames &names, const std::string &names_rows)
+{
+	const char *row = names_rows.data() + names.offset;
+	int width = names.width;
+
+	if (names.sop)
+	{
+		RTLIL::StateVector &bits = names.table->bits;
+		bits.reserve(2 * width * names.num_rows);
+
+		for (int k = 0; k < names.num_rows; k++, row += width+1)
+			for (int i = 0; i < width; i++)
+				switch (row[i]) {
+					case '0':
+						bits.push_back(State::S1);
+						bits.push_back(State::S0);
+						break;
+					case '1':
+						bits.push_back(State::S0);
+						bits.push_back(State::S1);
+						break;
+					default:
+						bits.push_back(State::S0);
+						bits.push_back(State::S0);
+						break;
+				}
+		return;
+	}
+
+	RTLIL::StateVector &bits = names.table->bits;
+	RTLIL::State default_state = RTLIL::State::Sx;
+
+	for (int k = 0; k < names.num_rows; k++, row += width+1)
+	{
+		RTLIL::State state = row[width] == '0' ? RTLIL::State::S0 : RTLIL::State::S1;
+		int care = 0, value = 0;
+		bool matches = true;
+
+		for (int j = 0; j < width; j++) {
+			if (row[j] == '-')
+				continue;
+			if (row[j] != '0' && row[j] != '1')
+				matches = false;
+			care |= 1 << j;
+			if (row[j] == '1')
+				value |= 1 << j;
 		}
 
-		if (buffer_len == 0 || buffer[buffer_len-1] == '\\') {
-			if (buffer_len > 0 && buffer[buffer_len-1] == '\\')
-				buffer[--buffer_len] = 0;
-			line_count++;
-			if (!std::getline(f, strbuf))
-				return false;
-			while (buffer_size-buffer_len < strbuf.size()+1) {
-				buffer_size *= 2;
-				buffer = (char*)realloc(buffer, buffer_size);
+		// set all entries that match the care bits, by enumerating the subsets of the don't care bits
+		if (matches) {
+			int free = ~care & ((1 << width) - 1);
+			for (int s = free;; s = (s - 1) & free) {
+				bits.set(value | s, state);
+				if (s == 0)
+					break;
 			}
-			strcpy(buffer+buffer_len, strbuf.c_str());
-		} else
-			return true;
+		}
+
+		default_state = row[width] == '0' ? RTLIL::State::S1 : RTLIL::State::S0;
 	}
+
+	for (int i = 0; i < GetSize(bits); i++)
+		if (bits.get(i) == RTLIL::State::Sx)
+			bits.set(i, default_state);
 }
 
 static std::pair<RTLIL::IdString, int> wideports_split(std::string name)
@@ -79,15 +218,24 @@ failed:
 }
 
 void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bool run_clean, bool sop_mode, bool wideports)
+{
+	MappedFile file;
+	file.read(f);
+	parse_blif(design, file.data, file.size, dff_name, run_clean, sop_mode, wideports);
+}
+
+void parse_blif(RTLIL::Design *design, const char *data, size_t size, std::string dff_name, bool run_clean, bool sop_mode, bool wideports)
 {
 	RTLIL::Module *module = nullptr;
-	RTLIL::Const *lutptr = NULL;
 	RTLIL::Cell *sopcell = NULL;
 	RTLIL::Cell *lastcell = nullptr;
-	RTLIL::State lut_default_state = RTLIL::State::Sx;
 	std::string err_reason;
 	int blif_maxnum = 0, sopmode = -1;
 
+	std::vector<BlifNames> names_list;
+	std::string names_rows;
+	int current_names = -1;
+
 	auto blif_wire = [&](const std::string &wire_name) -> Wire*
 	{
 		if (wire_name[0] == '$')
@@ -123,46 +271,42 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 
 	dict<RTLIL::IdString, std::pair<int, bool>> wideports_cache;
 
-	size_t buffer_size = 4096;
-	char *buffer = (char*)malloc(buffer_size);
+	const char *ptr = data, *end = data + size;
+	const char *line = nullptr, *line_end = nullptr;
+	std::string line_buf;
+	std::vector<BlifToken> tokens;
 	int line_count = 0;
 
 	while (1)
 	{
-		if (!read_next_line(buffer, buffer_size, line_count, f)) {
+		if (!read_next_line(ptr, end, line, line_end, line_buf, line_count)) {
 			if (module != nullptr)
 				goto error;
-			free(buffer);
 			return;
 		}
 
 	continue_without_read:
-		if (buffer[0] == '#')
+		if (line[0] == '#')
 			continue;
 
-		if (buffer[0] == '.')
+		if (line[0] == '.')
 		{
-			if (lutptr) {
-				for (auto &bit : lutptr->bits)
-					if (bit == RTLIL::State::Sx)
-						bit = lut_default_state;
-				lutptr = NULL;
-				lut_default_state = RTLIL::State::Sx;
-			}
+			current_names = -1;
 
 			if (sopcell) {
 				sopcell = NULL;
 				sopmode = -1;
 			}
 
-			char *cmd = strtok(buffer, " \t\r\n");
+			split_line(line, line_end, tokens);
+			const BlifToken &cmd = tokens[0];
 
-			if (!strcmp(cmd, ".model")) {
-				if (module != nullptr)
+			if (cmd.is(".model")) {
+				if (module != nullptr || GetSize(tokens) < 2)
 					goto error;
 				module = new RTLIL::Module;
 				lastcell = nullptr;
-				module->name = RTLIL::escape_id(strtok(NULL, " \t\r\n"));
+				module->name = RTLIL::escape_id(tokens[1].str());
 				obj_attributes = &module->attributes;
 				obj_parameters = nullptr;
 				if (design->module(module->name))
@@ -174,8 +318,18 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 			if (module == nullptr)
 				goto error;
 
-			if (!strcmp(cmd, ".end"))
+			if (cmd.is(".end"))
 			{
+				// the covers of the .names blocks do not depend on each other, decode them on the
+				// thread pool in chunks of blocks
+				int chunk_size = 64, num_chunks = (GetSize(names_list) + chunk_size - 1) / chunk_size;
+				ThreadPool::run(num_chunks, [&](int chunk) {
+					for (int i = chunk * chunk_size; i < std::min((chunk + 1) * chunk_size, GetSize(names_list)); i++)
+						decode_names(names_list[i], names_rows);
+				});
+				names_list.clear();
+				names_rows.clear();
+
 				for (auto &wp : wideports_cache)
 				{
 					auto name = wp.first;
@@ -241,16 +395,17 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 				continue;
 			}
 
-			if (!strcmp(cmd, ".inputs") || !strcmp(cmd, ".outputs"))
+			if (cmd.is(".inputs") || cmd.is(".outputs"))
 			{
-				char *p;
-				while ((p = strtok(NULL, " \t\r\n")) != NULL)
+				bool is_input = cmd.is(".inputs");
+				for (int i = 1; i < GetSize(tokens); i++)
 				{
-					RTLIL::IdString wire_name(stringf("\\%s", p));
+					std::string p = tokens[i].str();
+					RTLIL::IdString wire_name("\\" + p);
 					RTLIL::Wire *wire = module->wire(wire_name);
 					if (wire == nullptr)
 						wire = module->addWire(wire_name);
-					if (!strcmp(cmd, ".inputs"))
+					if (is_input)
 						wire->port_input = true;
 					else
 						wire->port_output = true;
@@ -259,7 +414,7 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 						std::pair<RTLIL::IdString, int> wp = wideports_split(p);
 						if (wp.second > 0) {
 							wideports_cache[wp.first].first = std::max(wideports_cache[wp.first].first, wp.second);
-							wideports_cache[wp.first].second = !strcmp(cmd, ".inputs");
+							wideports_cache[wp.first].second = is_input;
 						}
 					}
 				}
@@ -268,39 +423,40 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 				continue;
 			}
 
-			if (!strcmp(cmd, ".cname"))
+			if (cmd.is(".cname"))
 			{
-				char *p = strtok(NULL, " \t\r\n");
-				if (p == NULL)
+				if (GetSize(tokens) < 2)
 					goto error;
 
 				if(lastcell == nullptr || module == nullptr)
 				{
-					err_reason = stringf("No primitive object to attach .cname %s.", p);
+					err_reason = stringf("No primitive object to attach .cname %s.", tokens[1].str().c_str());
 					goto error_with_reason;
 				}
 
-				module->rename(lastcell, p);
+				module->rename(lastcell, tokens[1].str());
 				continue;
 			}
 
-			if (!strcmp(cmd, ".attr") || !strcmp(cmd, ".param")) {
-				char *n = strtok(NULL, " \t\r\n");
-				char *v = strtok(NULL, "\r\n");
-				IdString id_n = RTLIL::escape_id(n);
+			if (cmd.is(".attr") || cmd.is(".param")) {
+				// the value is the rest of the line after the name and its delimiter
+				if (GetSize(tokens) < 3)
+					goto error;
+				IdString id_n = RTLIL::escape_id(tokens[1].str());
+				std::string v(tokens[1].end + 1, line_end);
 				Const const_v;
 				if (v[0] == '"') {
-					std::string str(v+1);
+					std::string str(v.substr(1));
 					if (str.back() == '"')
 						str.resize(str.size()-1);
 					const_v = Const(str);
 				} else {
-					int n = strlen(v);
+					int n = GetSize(v);
 					const_v.bits.resize(n);
 					for (int i = 0; i < n; i++)
 						const_v.bits[i] = v[n-i-1] != '0' ? State::S1 : State::S0;
 				}
-				if (!strcmp(cmd, ".attr")) {
+				if (cmd.is(".attr")) {
 					if (obj_attributes == nullptr) {
 						err_reason = stringf("No object to attach .attr too.");
 						goto error_with_reason;
@@ -316,33 +472,36 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 				continue;
 			}
 
-			if (!strcmp(cmd, ".latch"))
+			if (cmd.is(".latch"))
 			{
-				char *d = strtok(NULL, " \t\r\n");
-				char *q = strtok(NULL, " \t\r\n");
-				char *edge = strtok(NULL, " \t\r\n");
-				char *clock = strtok(NULL, " \t\r\n");
-				char *init = strtok(NULL, " \t\r\n");
+				if (GetSize(tokens) < 3)
+					goto error;
+
+				std::string d = tokens[1].str();
+				std::string q = tokens[2].str();
+				std::string edge = GetSize(tokens) > 3 ? tokens[3].str() : "";
+				std::string clock = GetSize(tokens) > 4 ? tokens[4].str() : "";
+				std::string init = GetSize(tokens) > 5 ? tokens[5].str() : "";
 				RTLIL::Cell *cell = nullptr;
 
-				if (clock == nullptr && edge != nullptr) {
+				if (clock.empty() && !edge.empty()) {
 					init = edge;
-					edge = nullptr;
+					edge.clear();
 				}
 
-				if (init != nullptr && (init[0] == '0' || init[0] == '1'))
+				if (!init.empty() && (init[0] == '0' || init[0] == '1'))
 					blif_wire(q)->attributes["\\init"] = Const(init[0] == '1' ? 1 : 0, 1);
 
-				if (clock == nullptr)
+				if (clock.empty())
 					goto no_latch_clock;
 
-				if (!strcmp(edge, "re"))
+				if (edge == "re")
 					cell = module->addDff(NEW_ID, blif_wire(clock), blif_wire(d), blif_wire(q));
-				else if (!strcmp(edge, "fe"))
+				else if (edge == "fe")
 					cell = module->addDff(NEW_ID, blif_wire(clock), blif_wire(d), blif_wire(q), false);
-				else if (!strcmp(edge, "ah"))
+				else if (edge == "ah")
 					cell = module->addDlatch(NEW_ID, blif_wire(clock), blif_wire(d), blif_wire(q));
-				else if (!strcmp(edge, "al"))
+				else if (edge == "al")
 					cell = module->addDlatch(NEW_ID, blif_wire(clock), blif_wire(d), blif_wire(q), false);
 				else {
 			no_latch_clock:
@@ -361,32 +520,33 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 				continue;
 			}
 
-			if (!strcmp(cmd, ".gate") || !strcmp(cmd, ".subckt"))
+			if (cmd.is(".gate") || cmd.is(".subckt"))
 			{
-				char *p = strtok(NULL, " \t\r\n");
-				if (p == NULL)
+				if (GetSize(tokens) < 2)
 					goto error;
 
-				IdString celltype = RTLIL::escape_id(p);
+				IdString celltype = RTLIL::escape_id(tokens[1].str());
 				RTLIL::Cell *cell = module->addCell(NEW_ID, celltype);
 
 				dict<RTLIL::IdString, dict<int, SigBit>> cell_wideports_cache;
 
-				while ((p = strtok(NULL, " \t\r\n")) != NULL)
+				for (int i = 2; i < GetSize(tokens); i++)
 				{
-					char *q = strchr(p, '=');
-					if (q == NULL || !q[0])
+					const char *eq = (const char*)memchr(tokens[i].begin, '=', tokens[i].size());
+					if (eq == NULL)
 						goto error;
-					*(q++) = 0;
+
+					std::string p(tokens[i].begin, eq);
+					std::string q(eq+1, tokens[i].end);
 
 					if (wideports) {
 						std::pair<RTLIL::IdString, int> wp = wideports_split(p);
 						if (wp.second > 0)
 							cell_wideports_cache[wp.first][wp.second-1] = blif_wire(q);
 						else
-							cell->setPort(RTLIL::escape_id(p), *q ? blif_wire(q) : SigSpec());
+							cell->setPort(RTLIL::escape_id(p), !q.empty() ? blif_wire(q) : SigSpec());
 					} else {
-						cell->setPort(RTLIL::escape_id(p), *q ? blif_wire(q) : SigSpec());
+						cell->setPort(RTLIL::escape_id(p), !q.empty() ? blif_wire(q) : SigSpec());
 					}
 				}
 
@@ -417,26 +577,23 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 			obj_attributes = nullptr;
 			obj_parameters = nullptr;
 
-			if (!strcmp(cmd, ".barbuf") || !strcmp(cmd, ".conn"))
+			if (cmd.is(".barbuf") || cmd.is(".conn"))
 			{
-				char *p = strtok(NULL, " \t\r\n");
-				if (p == NULL)
-					goto error;
-
-				char *q = strtok(NULL, " \t\r\n");
-				if (q == NULL)
+				if (GetSize(tokens) < 3)
 					goto error;
 
-				module->connect(blif_wire(q), blif_wire(p));
+				module->connect(blif_wire(tokens[2].str()), blif_wire(tokens[1].str()));
 				continue;
 			}
 
-			if (!strcmp(cmd, ".names"))
+			if (cmd.is(".names"))
 			{
-				char *p;
+				if (GetSize(tokens) < 2)
+					goto error;
+
 				RTLIL::SigSpec input_sig, output_sig;
-				while ((p = strtok(NULL, " \t\r\n")) != NULL)
-					input_sig.append(blif_wire(p));
+				for (int i = 1; i < GetSize(tokens); i++)
+					input_sig.append(blif_wire(tokens[i].str()));
 				output_sig = input_sig.extract(input_sig.size()-1, 1);
 				input_sig = input_sig.extract(0, input_sig.size()-1);
 
@@ -444,20 +601,20 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 				{
 					RTLIL::State state = RTLIL::State::Sa;
 					while (1) {
-						if (!read_next_line(buffer, buffer_size, line_count, f))
+						if (!read_next_line(ptr, end, line, line_end, line_buf, line_count))
 							goto error;
-						for (int i = 0; buffer[i]; i++) {
-							if (buffer[i] == ' ' || buffer[i] == '\t')
+						for (int i = 0; line + i != line_end; i++) {
+							if (line[i] == ' ' || line[i] == '\t')
 								continue;
-							if (i == 0 && buffer[i] == '.')
+							if (i == 0 && line[i] == '.')
 								goto finished_parsing_constval;
-							if (buffer[i] == '0') {
+							if (line[i] == '0') {
 								if (state == RTLIL::State::S1)
 									goto error;
 								state = RTLIL::State::S0;
 								continue;
 							}
-							if (buffer[i] == '1') {
+							if (line[i] == '1') {
 								if (state == RTLIL::State::S0)
 									goto error;
 								state = RTLIL::State::S1;
@@ -476,6 +633,11 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 					goto continue_without_read;
 				}
 
+				BlifNames names;
+				names.width = input_sig.size();
+				names.num_rows = 0;
+				names.offset = names_rows.size();
+
 				if (sop_mode)
 				{
 					sopcell = module->addCell(NEW_ID, "$sop");
@@ -486,6 +648,8 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 					sopcell->setPort("\\Y", output_sig);
 					sopmode = -1;
 					lastcell = sopcell;
+					names.table = &sopcell->parameters.at("\\TABLE");
+					names.sop = true;
 				}
 				else
 				{
@@ -494,79 +658,57 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 					cell->parameters["\\LUT"] = RTLIL::Const(RTLIL::State::Sx, 1 << input_sig.size());
 					cell->setPort("\\A", input_sig);
 					cell->setPort("\\Y", output_sig);
-					lutptr = &cell->parameters.at("\\LUT");
-					lut_default_state = RTLIL::State::Sx;
 					lastcell = cell;
+					names.table = &cell->parameters.at("\\LUT");
+					names.sop = false;
 				}
+
+				current_names = GetSize(names_list);
+				names_list.push_back(names);
 				continue;
 			}
 
 			goto error;
 		}
 
-		if (lutptr == NULL && sopcell == NULL)
+		if (current_names < 0)
 			goto error;
 
-		char *input = strtok(buffer, " \t\r\n");
-		char *output = strtok(NULL, " \t\r\n");
+		split_line(line, line_end, tokens);
 
-		if (input == NULL || output == NULL || (strcmp(output, "0") && strcmp(output, "1")))
+		if (GetSize(tokens) < 2 || (!tokens[1].is("0") && !tokens[1].is("1")))
 			goto error;
 
-		int input_len = strlen(input);
-
-		if (sopcell)
-		{
-			log_assert(sopcell->parameters["\\WIDTH"].as_int() == input_len);
-			sopcell->parameters["\\DEPTH"] = sopcell->parameters["\\DEPTH"].as_int() + 1;
-
-			for (int i = 0; i < input_len; i++)
-				switch (input[i]) {
-					case '0':
-						sopcell->parameters["\\TABLE"].bits.push_back(State::S1);
-						sopcell->parameters["\\TABLE"].bits.push_back(State::S0);
-						break;
-					case '1':
-						sopcell->parameters["\\TABLE"].bits.push_back(State::S0);
-						sopcell->parameters["\\TABLE"].bits.push_back(State::S1);
-						break;
-					default:
-						sopcell->parameters["\\TABLE"].bits.push_back(State::S0);
-						sopcell->parameters["\\TABLE"].bits.push_back(State::S0);
-						break;
-				}
-
-			if (sopmode == -1) {
-				sopmode = (*output == '1');
-				if (!sopmode) {
-					SigSpec outnet = sopcell->getPort("\\Y");
-					SigSpec tempnet = module->addWire(NEW_ID);
-					module->addNotGate(NEW_ID, tempnet, outnet);
-					sopcell->setPort("\\Y", tempnet);
-				}
-			} else
-				log_assert(sopmode == (*output == '1'));
-		}
-
-		if (lutptr)
 		{
-			if (input_len > 12)
-				goto error;
+			BlifNames &names = names_list[current_names];
+			const BlifToken &input = tokens[0];
+			char output = *tokens[1].begin;
 
-			for (int i = 0; i < (1 << input_len); i++) {
-				for (int j = 0; j < input_len; j++) {
-					char c1 = input[j];
-					if (c1 != '-') {
-						char c2 = (i & (1 << j)) != 0 ? '1' : '0';
-						if (c1 != c2)
-							goto try_next_value;
+			if (sopcell)
+			{
+				log_assert(names.width == input.size());
+				sopcell->parameters["\\DEPTH"] = names.num_rows + 1;
+
+				if (sopmode == -1) {
+					sopmode = (output == '1');
+					if (!sopmode) {
+						SigSpec outnet = sopcell->getPort("\\Y");
+						SigSpec tempnet = module->addWire(NEW_ID);
+						module->addNotGate(NEW_ID, tempnet, outnet);
+						sopcell->setPort("\\Y", tempnet);
 					}
-				}
-				lutptr->bits.at(i) = !strcmp(output, "0") ? RTLIL::State::S0 : RTLIL::State::S1;
-			try_next_value:;
+				} else
+					log_assert(sopmode == (output == '1'));
+			}
+			else
+			{
+				if (input.size() > 12 || input.size() != names.width)
+					goto error;
 			}
 
-			lut_default_state = !strcmp(output, "0") ? RTLIL::State::S1 : RTLIL::State::S0;
+			names_rows.append(input.begin, input.end);
+			names_rows += output;
+			names.num_rows++;
 		}
 	}
 
@@ -618,7 +760,9 @@ struct BlifFrontend : public Frontend {
 		}
 		extra_args(f, filename, args, argidx);
 
-		parse_blif(design, *f, "", true, sop_mode, wideports);
+		MappedFile file;
+		file.open(f, filename);
+		parse_blif(design, file.data, file.size, "", true, sop_mode, wideports);
 	}
 } BlifFrontend;
 
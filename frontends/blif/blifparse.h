@@ -27,6 +27,10 @@ YOSYS_NAMESPACE_BEGIN
 extern void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name,
 		bool run_clean = false, bool sop_mode = false, bool wideports = false);
 
+// parse the BLIF text in the given buffer, e.g. a MappedFile
+extern void parse_blif(RTLIL::Design *design, const char *data, size_t size, std::string dff_name,
+		bool run_clean = false, bool sop_mode = false, bool wideports = false);
+
 YOSYS_NAMESPACE_END
 
 #endif
@@ -18,221 +18,193 @@
  */
 
 #include "kernel/yosys.h"
+#include "kernel/mapfile.h"
 
 YOSYS_NAMESPACE_BEGIN
 
-struct JsonNode
-{
-	char type; // S=String, N=Number, A=Array, D=Dict
-	string data_string;
-	int data_number;
-	vector<JsonNode*> data_array;
-	dict<string, JsonNode*> data_dict;
-	vector<string> data_dict_keys;
-
-	JsonNode(std::istream &f)
-	{
-		type = 0;
-		data_number = 0;
-
-		while (1)
-		{
-			int ch = f.get();
-
-			if (ch == EOF)
-				log_error("Unexpected EOF in JSON file.\n");
-
-			if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
-				continue;
-
-			if (ch == '"')
-			{
-				type = 'S';
-
-				while (1)
-				{
-					ch = f.get();
-
-					if (ch == EOF)
-						log_error("Unexpected EOF in JSON string.\n");
-
-					if (ch == '"')
-						break;
-
-					if (ch == '\\') {
-						int ch = f.get();
-
-						if (ch == EOF)
-							log_error("Unexpected EOF in JSON string.\n");
-					}
-
-					data_string += ch;
-				}
-
-				break;
-			}
+// A pull parser that tokenizes the JSON text in place. The frontend reads the values it
+// needs directly from the text and skips the rest, so no tree of the document is built.
+// Commas and colons are treated as whitespace.
 
-			if ('0' <= ch && ch <= '9')
-			{
-				type = 'N';
-				data_number = ch - '0';
-				data_string += ch;
-
-				while (1)
-				{
-					ch = f.get();
-
-					if (ch == EOF)
-						break;
-
-					if (ch == '.')
-						goto parse_real;
-
-					if (ch < '0' || '9' < ch) {
-						f.unget();
-						break;
-					}
-
-					data_number = data_number*10 + (ch - '0');
-					data_string += ch;
-				}
-
-				data_string = "";
-				break;
-
-			parse_real:
-				type = 'S';
-				data_number = 0;
-				data_string += ch;
-
-				while (1)
-				{
-					ch = f.get();
+struct JsonParser
+{
+	const char *ptr, *end;
 
-					if (ch == EOF)
-						break;
+	JsonParser(const char *data, size_t size) : ptr(data), end(data + size) { }
 
-					if (ch < '0' || '9' < ch) {
-						f.unget();
-						break;
-					}
+	void skip(char sep = 0)
+	{
+		while (ptr != end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n' || (sep != 0 && *ptr == sep)))
+			ptr++;
+	}
 
-					data_string += ch;
-				}
+	// the first character of the next value
+	char peek()
+	{
+		skip();
+		if (ptr == end)
+			log_error("Unexpected EOF in JSON file.\n");
+		return *ptr;
+	}
 
-				break;
-			}
+	bool begin_dict()
+	{
+		if (peek() != '{')
+			return false;
+		ptr++;
+		return true;
+	}
 
-			if (ch == '[')
-			{
-				type = 'A';
+	bool begin_array()
+	{
+		if (peek() != '[')
+			return false;
+		ptr++;
+		return true;
+	}
 
-				while (1)
-				{
-					ch = f.get();
+	// read the next key of a dict, returns false at the end of the dict
+	bool next_key(std::string &key)
+	{
+		skip(',');
+		if (ptr == end)
+			log_error("Unexpected EOF in JSON file.\n");
+		if (*ptr == '}') {
+			ptr++;
+			return false;
+		}
+		if (*ptr != '"')
+			log_error("Unexpected non-string key in JSON dict.\n");
+		parse_string(key);
+		skip(':');
+		return true;
+	}
 
-					if (ch == EOF)
-						log_error("Unexpected EOF in JSON file.\n");
+	// returns false at the end of an array
+	bool next_element()
+	{
+		skip(',');
+		if (ptr == end)
+			log_error("Unexpected EOF in JSON file.\n");
+		if (*ptr == ']') {
+			ptr++;
+			return false;
+		}
+		return true;
+	}
 
-					if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ',')
-						continue;
+	void parse_string(std::string &str)
+	{
+		str.clear();
+		ptr++;
 
-					if (ch == ']')
-						break;
+		while (1)
+		{
+			const char *p = ptr;
+			while (p != end && *p != '"' && *p != '\\')
+				p++;
+			str.append(ptr, p);
 
-					f.unget();
-					data_array.push_back(new JsonNode(f));
-				}
+			if (p == end || (p+1 == end && *p == '\\'))
+				log_error("Unexpected EOF in JSON string.\n");
 
-				break;
+			if (*p == '"') {
+				ptr = p+1;
+				return;
 			}
 
-			if (ch == '{')
-			{
-				type = 'D';
-
-				while (1)
-				{
-					ch = f.get();
-
-					if (ch == EOF)
-						log_error("Unexpected EOF in JSON file.\n");
-
-					if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ',')
-						continue;
-
-					if (ch == '}')
-						break;
-
-					f.unget();
-					JsonNode key(f);
-
-					while (1)
-					{
-						ch = f.get();
-
-						if (ch == EOF)
-							log_error("Unexpected EOF in JSON file.\n");
-
-						if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ':')
-							continue;
+			str += p[1];
+			ptr = p+2;
+		}
+	}
 
-						f.unget();
-						break;
-					}
+	// parse a string ('S') or a number ('N') value. the type of arrays ('A') and dicts ('D')
+	// is returned without consuming them. numbers with a fraction are returned as strings.
+	char parse_scalar(std::string &str, int &number)
+	{
+		char ch = peek();
 
-					JsonNode *value = new JsonNode(f);
+		if (ch == '"') {
+			parse_string(str);
+			return 'S';
+		}
 
-					if (key.type != 'S')
-						log_error("Unexpected non-string key in JSON dict.\n");
+		if ('0' <= ch && ch <= '9')
+		{
+			const char *start = ptr;
+			number = 0;
+			while (ptr != end && '0' <= *ptr && *ptr <= '9')
+				number = number*10 + (*ptr++ - '0');
+
+			if (ptr == end || *ptr != '.')
+				return 'N';
+
+			ptr++;
+			while (ptr != end && '0' <= *ptr && *ptr <= '9')
+				ptr++;
+			str.assign(start, ptr);
+			return 'S';
+		}
 
-					data_dict[key.data_string] = value;
-					data_dict_keys.push_back(key.data_string);
-				}
+		if (ch == '[')
+			return 'A';
 
-				break;
-			}
+		if (ch == '{')
+			return 'D';
 
-			log_error("Unexpected character in JSON file: '%c'\n", ch);
-		}
+		log_error("Unexpected character in JSON file: '%c'\n", ch);
 	}
 
-	~JsonNode()
+	void skip_value()
 	{
-		for (auto it : data_array)
-			delete it;
-		for (auto &it : data_dict)
-			delete it.second;
+		std::string str;
+		int number;
+
+		switch (parse_scalar(str, number))
+		{
+		case 'A':
+			ptr++;
+			while (next_element())
+				skip_value();
+			break;
+		case 'D':
+			ptr++;
+			while (next_key(str))
+				skip_value();
+			break;
+		}
 	}
 };
 
-void json_parse_attr_param(dict<IdString, Const> &results, JsonNode *node)
+void json_parse_attr_param(dict<IdString, Const> &results, JsonParser &parser)
 {
-	if (node->type != 'D')
+	if (!parser.begin_dict())
 		log_error("JSON attributes or parameters node is not a dictionary.\n");
 
-	for (auto it : node->data_dict)
+	std::string key_str, value_str;
+	int value_number;
+
+	while (parser.next_key(key_str))
 	{
-		IdString key = RTLIL::escape_id(it.first.c_str());
-		JsonNode *value_node = it.second;
+		IdString key = RTLIL::escape_id(key_str.c_str());
 		Const value;
 
-		if (value_node->type == 'S') {
-			string &s = value_node->data_string;
-			if (s.find_first_not_of("01xz") == string::npos)
-				value = Const::from_string(s);
+		switch (parser.parse_scalar(value_str, value_number))
+		{
+		case 'S':
+			if (value_str.find_first_not_of("01xz") == string::npos)
+				value = Const::from_string(value_str);
 			else
-				value = Const(s);
-		} else
-		if (value_node->type == 'N') {
-			value = Const(value_node->data_number, 32);
-		} else
-		if (value_node->type == 'A') {
+				value = Const(value_str);
+			break;
+		case 'N':
+			value = Const(value_number, 32);
+			break;
+		case 'A':
 			log_error("JSON attribute or parameter value is an array.\n");
-		} else
-		if (value_node->type == 'D') {
+		case 'D':
 			log_error("JSON attribute or parameter value is a dict.\n");
-		} else {
+		default:
 			log_abort();
 		}
 
@@ -240,256 +212,366 @@ void json_parse_attr_param(dict<IdString, Const> &results, JsonNode *node)
 	}
 }
 
-void json_import(Design *design, string &modname, JsonNode *node)
+// parse an array of signal bits into bit indices, with -1 .. -4 for the constants 0, 1, x
+// and z. what() describes the array for error messages.
+template<typename F>
+void json_parse_bits(std::vector<int> &bits, JsonParser &parser, F what)
 {
-	log("Importing module %s from JSON tree.\n", modname.c_str());
+	std::string str;
+	int number;
 
-	Module *module = new RTLIL::Module;
-	module->name = RTLIL::escape_id(modname.c_str());
+	bits.clear();
 
-	if (design->module(module->name))
-		log_error("Re-definition of module %s.\n", log_id(module->name));
+	for (int i = 0; parser.next_element(); i++)
+	{
+		char type = parser.parse_scalar(str, number);
+
+		if (type == 'S') {
+			if (str == "0")
+				bits.push_back(-1);
+			else if (str == "1")
+				bits.push_back(-2);
+			else if (str == "x")
+				bits.push_back(-3);
+			else if (str == "z")
+				bits.push_back(-4);
+			else
+				log_error("%s has invalid '%s' bit string value on bit %d.\n", what().c_str(), str.c_str(), i);
+		} else
+		if (type == 'N') {
+			bits.push_back(number);
+		} else
+			log_error("%s has invalid bit value on bit %d.\n", what().c_str(), i);
+	}
+}
 
-	design->add(module);
+static const State json_const_bits[4] = { State::S0, State::S1, State::Sx, State::Sz };
 
-	if (node->data_dict.count("attributes"))
-		json_parse_attr_param(module->attributes, node->data_dict.at("attributes"));
+// Creates a module from its JSON text. The meaning of the bit indices depends on the order
+// ports, netnames and cells are processed in (the ports define them first, the netnames
+// connect to them, the cells create wires for the remaining ones), so the netnames and cells
+// are kept with their connections as bit indices until the end of the module. The old tree
+// based parser created the netnames, cells, cell connections and attributes in reverse file
+// order, from the dicts of its tree. They are created in the same order here, so that the
+// names of the wires created for unnamed bits and the order of the objects do not change.
 
+struct JsonModuleImporter
+{
+	JsonParser &parser;
+	Module *module;
 	dict<int, SigBit> signal_bits;
 
-	if (node->data_dict.count("ports"))
+	struct netname_t {
+		IdString name;
+		std::vector<int> bits;
+		dict<IdString, Const> attributes;
+	};
+	std::vector<netname_t> pending_netnames;
+
+	struct connection_t {
+		IdString port;
+		size_t offset;
+		int width;
+	};
+
+	struct cell_t {
+		IdString name, type;
+		std::vector<connection_t> connections;
+		dict<IdString, Const> attributes, parameters;
+	};
+	std::vector<cell_t> pending_cells;
+	std::vector<int> pending_bits;
+
+	JsonModuleImporter(JsonParser &parser, Module *module) : parser(parser), module(module) { }
+
+	void parse_ports()
 	{
-		JsonNode *ports_node = node->data_dict.at("ports");
-
-		if (ports_node->type != 'D')
+		if (!parser.begin_dict())
 			log_error("JSON ports node is not a dictionary.\n");
 
-		for (int port_id = 1; port_id <= GetSize(ports_node->data_dict_keys); port_id++)
+		std::string port_str, key, direction;
+		std::vector<int> bits;
+		int number;
+
+		for (int port_id = 1; parser.next_key(port_str); port_id++)
 		{
-			IdString port_name = RTLIL::escape_id(ports_node->data_dict_keys[port_id-1].c_str());
-			JsonNode *port_node = ports_node->data_dict.at(ports_node->data_dict_keys[port_id-1]);
+			IdString port_name = RTLIL::escape_id(port_str.c_str());
+			bool have_direction = false, have_bits = false;
 
-			if (port_node->type != 'D')
+			if (!parser.begin_dict())
 				log_error("JSON port node '%s' is not a dictionary.\n", log_id(port_name));
 
-			if (port_node->data_dict.count("direction") == 0)
+			while (parser.next_key(key))
+			{
+				if (key == "direction") {
+					if (parser.parse_scalar(direction, number) != 'S')
+						log_error("JSON port node '%s' has non-string direction attribute.\n", log_id(port_name));
+					have_direction = true;
+				} else
+				if (key == "bits") {
+					if (!parser.begin_array())
+						log_error("JSON port node '%s' has non-array bits attribute.\n", log_id(port_name));
+					json_parse_bits(bits, parser, [&]() { return stringf("JSON port node '%s'", log_id(port_name)); });
+					have_bits = true;
+				} else
+					parser.skip_value();
+			}
+
+			if (!have_direction)
 				log_error("JSON port node '%s' has no direction attribute.\n", log_id(port_name));
 
-			if (port_node->data_dict.count("bits") == 0)
+			if (!have_bits)
 				log_error("JSON port node '%s' has no bits attribute.\n", log_id(port_name));
 
-			JsonNode *port_direction_node = port_node->data_dict.at("direction");
-			JsonNode *port_bits_node = port_node->data_dict.at("bits");
-
-			if (port_direction_node->type != 'S')
-				log_error("JSON port node '%s' has non-string direction attribute.\n", log_id(port_name));
-
-			if (port_bits_node->type != 'A')
-				log_error("JSON port node '%s' has non-array bits attribute.\n", log_id(port_name));
-
 			Wire *port_wire = module->wire(port_name);
 
 			if (port_wire == nullptr)
-				port_wire = module->addWire(port_name, GetSize(port_bits_node->data_array));
+				port_wire = module->addWire(port_name, GetSize(bits));
 
-			if (port_direction_node->data_string == "input") {
+			if (direction == "input") {
 				port_wire->port_input = true;
 			} else
-			if (port_direction_node->data_string == "output") {
+			if (direction == "output") {
 				port_wire->port_output = true;
 			} else
-			if (port_direction_node->data_string == "inout") {
+			if (direction == "inout") {
 				port_wire->port_input = true;
 				port_wire->port_output = true;
 			} else
-				log_error("JSON port node '%s' has invalid '%s' direction attribute.\n", log_id(port_name), port_direction_node->data_string.c_str());
+				log_error("JSON port node '%s' has invalid '%s' direction attribute.\n", log_id(port_name), direction.c_str());
 
 			port_wire->port_id = port_id;
 
-			for (int i = 0; i < GetSize(port_bits_node->data_array); i++)
+			for (int i = 0; i < GetSize(bits); i++)
 			{
-				JsonNode *bitval_node = port_bits_node->data_array.at(i);
 				SigBit sigbit(port_wire, i);
+				int bitidx = bits[i];
 
-				if (bitval_node->type == 'S') {
-					if (bitval_node->data_string == "0")
-						module->connect(sigbit, State::S0);
-					else if (bitval_node->data_string == "1")
-						module->connect(sigbit, State::S1);
-					else if (bitval_node->data_string == "x")
-						module->connect(sigbit, State::Sx);
-					else if (bitval_node->data_string == "z")
-						module->connect(sigbit, State::Sz);
-					else
-						log_error("JSON port node '%s' has invalid '%s' bit string value on bit %d.\n",
-								log_id(port_name), bitval_node->data_string.c_str(), i);
+				if (bitidx < 0) {
+					module->connect(sigbit, json_const_bits[-1-bitidx]);
 				} else
-				if (bitval_node->type == 'N') {
-					int bitidx = bitval_node->data_number;
-					if (signal_bits.count(bitidx)) {
-						if (port_wire->port_output) {
-							module->connect(sigbit, signal_bits.at(bitidx));
-						} else {
-							module->connect(signal_bits.at(bitidx), sigbit);
-							signal_bits[bitidx] = sigbit;
-						}
+				if (signal_bits.count(bitidx)) {
+					if (port_wire->port_output) {
+						module->connect(sigbit, signal_bits.at(bitidx));
 					} else {
+						module->connect(signal_bits.at(bitidx), sigbit);
 						signal_bits[bitidx] = sigbit;
 					}
-				} else
-					log_error("JSON port node '%s' has invalid bit value on bit %d.\n", log_id(port_name), i);
+				} else {
+					signal_bits[bitidx] = sigbit;
+				}
 			}
 		}
 
 		module->fixup_ports();
 	}
 
-	if (node->data_dict.count("netnames"))
+	void import_netname(const netname_t &net)
 	{
-		JsonNode *netnames_node = node->data_dict.at("netnames");
+		Wire *wire = module->wire(net.name);
 
-		if (netnames_node->type != 'D')
-			log_error("JSON netnames node is not a dictionary.\n");
+		if (wire == nullptr)
+			wire = module->addWire(net.name, GetSize(net.bits));
 
-		for (auto &net : netnames_node->data_dict)
+		for (int i = 0; i < GetSize(net.bits); i++)
 		{
-			IdString net_name = RTLIL::escape_id(net.first.c_str());
-			JsonNode *net_node = net.second;
+			SigBit sigbit(wire, i);
+			int bitidx = net.bits[i];
 
-			if (net_node->type != 'D')
-				log_error("JSON netname node '%s' is not a dictionary.\n", log_id(net_name));
+			if (bitidx < 0) {
+				module->connect(sigbit, json_const_bits[-1-bitidx]);
+			} else
+			if (signal_bits.count(bitidx)) {
+				if (sigbit != signal_bits.at(bitidx))
+					module->connect(sigbit, signal_bits.at(bitidx));
+			} else {
+				signal_bits[bitidx] = sigbit;
+			}
+		}
 
-			if (net_node->data_dict.count("bits") == 0)
-				log_error("JSON netname node '%s' has no bits attribute.\n", log_id(net_name));
+		for (auto &it : net.attributes)
+			wire->attributes[it.first] = it.second;
+	}
 
-			JsonNode *bits_node = net_node->data_dict.at("bits");
+	void parse_netnames()
+	{
+		if (!parser.begin_dict())
+			log_error("JSON netnames node is not a dictionary.\n");
 
-			if (bits_node->type != 'A')
-				log_error("JSON netname node '%s' has non-array bits attribute.\n", log_id(net_name));
+		std::string net_str, key;
 
-			Wire *wire = module->wire(net_name);
+		while (parser.next_key(net_str))
+		{
+			pending_netnames.push_back(netname_t());
+			netname_t &net = pending_netnames.back();
+			net.name = RTLIL::escape_id(net_str.c_str());
+			bool have_bits = false;
 
-			if (wire == nullptr)
-				wire = module->addWire(net_name, GetSize(bits_node->data_array));
+			if (!parser.begin_dict())
+				log_error("JSON netname node '%s' is not a dictionary.\n", log_id(net.name));
 
-			for (int i = 0; i < GetSize(bits_node->data_array); i++)
+			while (parser.next_key(key))
 			{
-				JsonNode *bitval_node = bits_node->data_array.at(i);
-				SigBit sigbit(wire, i);
-
-				if (bitval_node->type == 'S') {
-					if (bitval_node->data_string == "0")
-						module->connect(sigbit, State::S0);
-					else if (bitval_node->data_string == "1")
-						module->connect(sigbit, State::S1);
-					else if (bitval_node->data_string == "x")
-						module->connect(sigbit, State::Sx);
-					else if (bitval_node->data_string == "z")
-						module->connect(sigbit, State::Sz);
-					else
-						log_error("JSON netname node '%s' has invalid '%s' bit string value on bit %d.\n",
-								log_id(net_name), bitval_node->data_string.c_str(), i);
+				if (key == "bits") {
+					if (!parser.begin_array())
+						log_error("JSON netname node '%s' has non-array bits attribute.\n", log_id(net.name));
+					json_parse_bits(net.bits, parser, [&]() { return stringf("JSON netname node '%s'", log_id(net.name)); });
+					have_bits = true;
 				} else
-				if (bitval_node->type == 'N') {
-					int bitidx = bitval_node->data_number;
-					if (signal_bits.count(bitidx)) {
-						if (sigbit != signal_bits.at(bitidx))
-							module->connect(sigbit, signal_bits.at(bitidx));
-					} else {
-						signal_bits[bitidx] = sigbit;
-					}
+				if (key == "attributes") {
+					json_parse_attr_param(net.attributes, parser);
 				} else
-					log_error("JSON netname node '%s' has invalid bit value on bit %d.\n", log_id(net_name), i);
+					parser.skip_value();
 			}
 
-			if (net_node->data_dict.count("attributes"))
-				json_parse_attr_param(wire->attributes, net_node->data_dict.at("attributes"));
+			if (!have_bits)
+				log_error("JSON netname node '%s' has no bits attribute.\n", log_id(net.name));
+		}
+	}
+
+	SigSpec bits_to_sig(const int *bits, int width)
+	{
+		SigSpec sig;
+
+		for (int i = 0; i < width; i++) {
+			int bitidx = bits[i];
+			if (bitidx < 0) {
+				sig.append(json_const_bits[-1-bitidx]);
+				continue;
+			}
+			if (signal_bits.count(bitidx) == 0)
+				signal_bits[bitidx] = module->addWire(NEW_ID);
+			sig.append(signal_bits.at(bitidx));
 		}
+
+		return sig;
 	}
 
-	if (node->data_dict.count("cells"))
+	void import_cell(const cell_t &c)
 	{
-		JsonNode *cells_node = node->data_dict.at("cells");
+		Cell *cell = module->addCell(c.name, c.type);
 
-		if (cells_node->type != 'D')
+		for (auto it = c.connections.rbegin(); it != c.connections.rend(); ++it)
+			cell->setPort(it->port, bits_to_sig(pending_bits.data() + it->offset, it->width));
+
+		for (auto &it : c.attributes)
+			cell->attributes[it.first] = it.second;
+
+		for (auto &it : c.parameters)
+			cell->parameters[it.first] = it.second;
+	}
+
+	void parse_cells()
+	{
+		if (!parser.begin_dict())
 			log_error("JSON cells node is not a dictionary.\n");
 
-		for (auto &cell_node_it : cells_node->data_dict)
+		std::string cell_str, key, type_str, conn_str;
+		std::vector<int> bits;
+		int number;
+
+		while (parser.next_key(cell_str))
 		{
-			IdString cell_name = RTLIL::escape_id(cell_node_it.first.c_str());
-			JsonNode *cell_node = cell_node_it.second;
+			pending_cells.push_back(cell_t());
+			cell_t &cell = pending_cells.back();
+			cell.name = RTLIL::escape_id(cell_str.c_str());
+			bool have_type = false, have_connections = false;
 
-			if (cell_node->type != 'D')
-				log_error("JSON cells node '%s' is not a dictionary.\n", log_id(cell_name));
+			if (!parser.begin_dict())
+				log_error("JSON cells node '%s' is not a dictionary.\n", log_id(cell.name));
 
-			if (cell_node->data_dict.count("type") == 0)
-				log_error("JSON cells node '%s' has no type attribute.\n", log_id(cell_name));
+			while (parser.next_key(key))
+			{
+				if (key == "type") {
+					if (parser.parse_scalar(type_str, number) != 'S')
+						log_error("JSON cells node '%s' has a non-string type.\n", log_id(cell.name));
+					cell.type = RTLIL::escape_id(type_str.c_str());
+					have_type = true;
+				} else
+				if (key == "connections") {
+					if (!parser.begin_dict())
+						log_error("JSON cells node '%s' has non-dictionary connections attribute.\n", log_id(cell.name));
+					while (parser.next_key(conn_str)) {
+						IdString conn_name = RTLIL::escape_id(conn_str.c_str());
+						if (!parser.begin_array())
+							log_error("JSON cells node '%s' connection '%s' is not an array.\n", log_id(cell.name), log_id(conn_name));
+						json_parse_bits(bits, parser, [&]() {
+							return stringf("JSON cells node '%s' connection '%s'", log_id(cell.name), log_id(conn_name));
+						});
+						cell.connections.push_back(connection_t{conn_name, pending_bits.size(), GetSize(bits)});
+						pending_bits.insert(pending_bits.end(), bits.begin(), bits.end());
+					}
+					have_connections = true;
+				} else
+				if (key == "attributes") {
+					json_parse_attr_param(cell.attributes, parser);
+				} else
+				if (key == "parameters") {
+					json_parse_attr_param(cell.parameters, parser);
+				} else
+					parser.skip_value();
+			}
 
-			JsonNode *type_node = cell_node->data_dict.at("type");
+			if (!have_type)
+				log_error("JSON cells node '%s' has no type attribute.\n", log_id(cell.name));
 
-			if (type_node->type != 'S')
-				log_error("JSON cells node '%s' has a non-string type.\n", log_id(cell_name));
+			if (!have_connections)
+				log_error("JSON cells node '%s' has no connections attribute.\n", log_id(cell.name));
+		}
+	}
 
-			IdString cell_type = RTLIL::escape_id(type_node->data_string.c_str());
+	void finish()
+	{
+		for (auto it = pending_netnames.rbegin(); it != pending_netnames.rend(); ++it)
+			import_netname(*it);
 
-			Cell *cell = module->addCell(cell_name, cell_type);
+		for (auto it = pending_cells.rbegin(); it != pending_cells.rend(); ++it)
+			import_cell(*it);
 
-			if (cell_node->data_dict.count("connections") == 0)
-				log_error("JSON cells node '%s' has no connections attribute.\n", log_id(cell_name));
+		pending_netnames.clear();
+		pending_cells.clear();
+		pending_bits.clear();
+	}
+};
 
-			JsonNode *connections_node = cell_node->data_dict.at("connections");
+Module *json_import(Design *design, string &modname, JsonParser &parser)
+{
+	log("Importing module %s from JSON tree.\n", modname.c_str());
 
-			if (connections_node->type != 'D')
-				log_error("JSON cells node '%s' has non-dictionary connections attribute.\n", log_id(cell_name));
+	IdString name = RTLIL::escape_id(modname.c_str());
 
-			for (auto &conn_it : connections_node->data_dict)
-			{
-				IdString conn_name = RTLIL::escape_id(conn_it.first.c_str());
-				JsonNode *conn_node = conn_it.second;
-
-				if (conn_node->type != 'A')
-					log_error("JSON cells node '%s' connection '%s' is not an array.\n", log_id(cell_name), log_id(conn_name));
-
-				SigSpec sig;
-
-				for (int i = 0; i < GetSize(conn_node->data_array); i++)
-				{
-					JsonNode *bitval_node = conn_node->data_array.at(i);
-
-					if (bitval_node->type == 'S') {
-						if (bitval_node->data_string == "0")
-							sig.append(State::S0);
-						else if (bitval_node->data_string == "1")
-							sig.append(State::S1);
-						else if (bitval_node->data_string == "x")
-							sig.append(State::Sx);
-						else if (bitval_node->data_string == "z")
-							sig.append(State::Sz);
-						else
-							log_error("JSON cells node '%s' connection '%s' has invalid '%s' bit string value on bit %d.\n",
-									log_id(cell_name), log_id(conn_name), bitval_node->data_string.c_str(), i);
-					} else
-					if (bitval_node->type == 'N') {
-						int bitidx = bitval_node->data_number;
-						if (signal_bits.count(bitidx) == 0)
-							signal_bits[bitidx] = module->addWire(NEW_ID);
-						sig.append(signal_bits.at(bitidx));
-					} else
-						log_error("JSON cells node '%s' connection '%s' has invalid bit value on bit %d.\n",
-								log_id(cell_name), log_id(conn_name), i);
+	if (design->module(name))
+		log_error("Re-definition of module %s.\n", log_id(name));
 
-				}
+	Module *module = new RTLIL::Module;
+	module->name = name;
 
-				cell->setPort(conn_name, sig);
-			}
+	if (!parser.begin_dict())
+		log_error("JSON module node '%s' is not a dictionary.\n", log_id(module->name));
 
-			if (cell_node->data_dict.count("attributes"))
-				json_parse_attr_param(cell->attributes, cell_node->data_dict.at("attributes"));
+	JsonModuleImporter importer(parser, module);
+	dict<IdString, Const> attributes;
+	std::string key;
 
-			if (cell_node->data_dict.count("parameters"))
-				json_parse_attr_param(cell->parameters, cell_node->data_dict.at("parameters"));
-		}
+	while (parser.next_key(key))
+	{
+		if (key == "attributes")
+			json_parse_attr_param(attributes, parser);
+		else if (key == "ports")
+			importer.parse_ports();
+		else if (key == "netnames")
+			importer.parse_netnames();
+		else if (key == "cells")
+			importer.parse_cells();
+		else
+			parser.skip_value();
 	}
+
+	for (auto &it : attributes)
+		module->attributes[it.first] = it.second;
+
+	importer.finish();
+	return module;
 }
 
 struct JsonFrontend : public Frontend {
@@ -519,23 +601,43 @@ struct JsonFrontend : public Frontend {
 		}
 		extra_args(f, filename, args, argidx);
 
-		JsonNode root(*f);
+		MappedFile file;
+		file.open(f, filename);
 
-		if (root.type != 'D')
+		JsonParser parser(file.data, file.size);
+		std::string key;
+
+		if (!parser.begin_dict())
 			log_error("JSON root node is not a dictionary.\n");
 
-		if (root.data_dict.count("modules") != 0)
+		while (parser.next_key(key))
 		{
-			JsonNode *modules = root.data_dict.at("modules");
+			if (key != "modules") {
+				parser.skip_value();
+				continue;
+			}
 
-			if (modules->type != 'D')
+			if (!parser.begin_dict())
 				log_error("JSON modules node is not a dictionary.\n");
 
-			for (auto &it : modules->data_dict)
-				json_import(design, it.first, it.second);
+			// find the modules first and import them in reverse file order, like the old tree
+			// based parser did, so that the names of the wires created for unnamed bits and the
+			// order of the modules do not change
+			std::vector<std::pair<std::string, const char*>> modules;
+			std::string modname;
+			while (parser.next_key(modname)) {
+				modules.push_back(std::make_pair(modname, parser.ptr));
+				parser.skip_value();
+			}
+
+			const char *modules_end = parser.ptr;
+			for (auto it = modules.rbegin(); it != modules.rend(); ++it) {
+				parser.ptr = it->second;
+				design->add(json_import(design, it->first, parser));
+			}
+			parser.ptr = modules_end;
 		}
 	}
 } JsonFrontend;
 
 YOSYS_NAMESPACE_END
-
@@ -451,6 +451,15 @@ void parse_type_map(std::map<std::string, std::tuple<int, int, bool>> &type_map,
 	}
 }
 
+// the parts of the liberty file that are used by this frontend
+static const std::set<std::string> liberty_filter = {
+	"/library/type", "/library/type/*", "/library/cell", "/library/cell/type", "/library/cell/type/*",
+	"/library/cell/pin", "/library/cell/pin/direction", "/library/cell/pin/function",
+	"/library/cell/bus", "/library/cell/bus/direction", "/library/cell/bus/bus_type",
+	"/library/cell/bus/pin", "/library/cell/bus/pin/direction",
+	"/library/cell/ff", "/library/cell/ff/*", "/library/cell/latch", "/library/cell/latch/*"
+};
+
 struct LibertyFrontend : public Frontend {
 	LibertyFrontend() : Frontend("liberty", "read cells from liberty file") { }
 	void help() YS_OVERRIDE
@@ -535,13 +544,20 @@ struct LibertyFrontend : public Frontend {
 		}
 		extra_args(f, filename, args, argidx);
 
-		LibertyParser parser(*f);
+		std::shared_ptr<LibertyAst> ast;
+		if (dynamic_cast<std::ifstream*>(f) != nullptr) {
+			ast = LibertyStore::load(filename, liberty_filter);
+		} else {
+			LibertyParser parser(*f, &liberty_filter);
+			ast.reset(parser.ast);
+			parser.ast = nullptr;
+		}
 		int cell_count = 0;
 
 		std::map<std::string, std::tuple<int, int, bool>> global_type_map;
-		parse_type_map(global_type_map, parser.ast);
+		parse_type_map(global_type_map, ast.get());
 
-		for (auto cell : parser.ast->children)
+		for (auto cell : ast->children)
 		{
 			if (cell->id != "cell" || cell->args.size() != 1)
 				continue;
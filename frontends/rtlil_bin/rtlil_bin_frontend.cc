@@ -0,0 +1,167 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/rtlil_bin.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct RtlilBinFrontend : public Frontend {
+	RtlilBinFrontend() : Frontend("rtlil_bin", "read modules from a binary RTLIL file") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    read_rtlil_bin [options] [filename]\n");
+		log("\n");
+		log("Load modules from a file written by 'write_rtlil_bin' to the current design.\n");
+		log("The file is mapped into memory and only the modules that are loaded are\n");
+		log("decoded. Only the name and the attributes of a module are decoded right away,\n");
+		log("the rest when a command first uses the module. The file must not be changed\n");
+		log("until then, except by 'write_rtlil_bin', which decodes all modules first.\n");
+		log("\n");
+		log("    -module <name>\n");
+		log("        only load the module with this name. this option can be used\n");
+		log("        multiple times.\n");
+		log("\n");
+		log("    -nolazy\n");
+		log("        decode the modules completely while reading the file.\n");
+		log("\n");
+		log("    -list\n");
+		log("        only print the names of the modules in the file.\n");
+		log("\n");
+		log("    -nooverwrite\n");
+		log("        ignore re-definitions of modules. (the default behavior is to\n");
+		log("        create an error message if the existing module is not a blackbox\n");
+		log("        module, and overwrite the existing module if it is  a blackbox module.)\n");
+		log("\n");
+		log("    -overwrite\n");
+		log("        overwrite existing modules with the same name\n");
+		log("\n");
+	}
+	void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		bool flag_nooverwrite = false;
+		bool flag_overwrite = false;
+		bool flag_list = false;
+		bool flag_nolazy = false;
+		pool<RTLIL::IdString> only_modules;
+
+		log_header(design, "Executing RTLIL_BIN frontend.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			std::string arg = args[argidx];
+			if (arg == "-module" && argidx+1 < args.size()) {
+				only_modules.insert(RTLIL::escape_id(args[++argidx]));
+				continue;
+			}
+			if (arg == "-nolazy") {
+				flag_nolazy = true;
+				continue;
+			}
+			if (arg == "-list") {
+				flag_list = true;
+				continue;
+			}
+			if (arg == "-nooverwrite") {
+				flag_nooverwrite = true;
+				flag_overwrite = false;
+				continue;
+			}
+			if (arg == "-overwrite") {
+				flag_nooverwrite = false;
+				flag_overwrite = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx, true);
+
+		log("Input filename: %s\n", filename.c_str());
+
+		// map regular files instead of reading them through the stream
+		// the lazy loaders of the modules share the reader
+		std::shared_ptr<RtlilBinReader> reader(new RtlilBinReader);
+		if (dynamic_cast<std::ifstream*>(f) != nullptr)
+			reader->open(filename);
+		else
+			reader->open(*f, filename);
+
+		if (flag_list) {
+			for (int i = 0; i < reader->num_modules(); i++)
+				log("  %s\n", log_id(reader->module_name(i)));
+			return;
+		}
+
+		pool<RTLIL::IdString> found_modules;
+		int count = 0;
+
+		for (int i = 0; i < reader->num_modules(); i++)
+		{
+			RTLIL::IdString name = reader->module_name(i);
+			if (!only_modules.empty() && !only_modules.count(name))
+				continue;
+			found_modules.insert(name);
+
+			RTLIL::Module *module = new RTLIL::Module;
+			if (flag_nolazy)
+				reader->load_module(i, module);
+			else {
+				reader->load_module_header(i, module);
+				module->set_lazy_loader([reader, i](RTLIL::Module *module) {
+					reader->load_module_body(i, module);
+				});
+			}
+			RTLIL::Module *existing = design->module(name);
+
+			// the same rules as in read_ilang
+			if (existing != nullptr) {
+				if (!flag_overwrite && module->get_bool_attribute("\\blackbox")) {
+					log("Ignoring blackbox re-definition of module %s.\n", log_id(name));
+					delete module;
+					continue;
+				} else if (!flag_nooverwrite && !flag_overwrite && !existing->get_bool_attribute("\\blackbox")) {
+					delete module;
+					log_error("Re-definition of module %s in `%s'.\n", log_id(name), filename.c_str());
+				} else if (flag_nooverwrite) {
+					log("Ignoring re-definition of module %s.\n", log_id(name));
+					delete module;
+					continue;
+				} else {
+					log("Replacing existing%s module %s.\n", existing->get_bool_attribute("\\blackbox") ? " blackbox" : "", log_id(name));
+					design->remove(existing);
+				}
+			}
+
+			design->add(module);
+			count++;
+		}
+
+		for (auto name : only_modules)
+			if (!found_modules.count(name))
+				log_error("Module %s not found in `%s'.\n", log_id(name), filename.c_str());
+
+		autoidx = std::max(autoidx, reader->file_autoidx);
+		log("Read %d modules.\n", count);
+	}
+} RtlilBinFrontend;
+
+PRIVATE_NAMESPACE_END
@@ -41,41 +41,101 @@
 YOSYS_NAMESPACE_BEGIN
 using namespace VERILOG_FRONTEND;
 
-static std::list<std::string> output_code;
-static std::list<std::string> input_buffer;
-static size_t input_buffer_charp;
+// The input is a stack of buffers. The contents of a file are one contiguous buffer,
+// macro expansions and characters that have been returned are pushed on top of it.
+struct InputBuffer {
+	std::string data;
+	size_t pos;
+	InputBuffer(std::string data) : data(std::move(data)), pos(0) { }
+};
+
+// read_verilog runs the preprocessor on worker threads, see PreprocRecord
+static thread_local PreprocOutput output_code;
+static thread_local std::vector<InputBuffer> input_buffer;
+
+static thread_local PreprocRecord *record;
+static thread_local const dict<std::string, std::pair<std::string, bool>> *record_cache;
+static thread_local pool<std::string> record_written;
+static thread_local bool record_resetall;
+
+// note a lookup of a define, the result only depends on the cache if this run did not
+// set the define itself
+static bool is_defined(const std::map<std::string, std::string> &defines_map, const std::string &name)
+{
+	if (record && !record_resetall && !record_written.count(name)) {
+		if (record_cache->count(name))
+			record->used_defines[name] = record_cache->at(name);
+		else
+			record->used_undefined.insert(name);
+	}
+	return defines_map.count(name) != 0;
+}
 
-static void return_char(char ch)
+static void note_written(const std::string &name)
+{
+	if (record)
+		record_written.insert(name);
+}
+
+static void note_change(const PreprocRecord::change_t &change)
 {
-	if (input_buffer_charp == 0)
-		input_buffer.push_front(std::string() + ch);
+	if (record == nullptr)
+		return;
+	if (change.name.empty())
+		record_resetall = true;
 	else
-		input_buffer.front()[--input_buffer_charp] = ch;
+		record_written.insert(change.name);
+	record->changes.push_back(change);
 }
 
-static void insert_input(std::string str)
+static void return_char(char ch)
 {
-	if (input_buffer_charp != 0) {
-		input_buffer.front() = input_buffer.front().substr(input_buffer_charp);
-		input_buffer_charp = 0;
+	if (input_buffer.empty() || input_buffer.back().pos == 0)
+		input_buffer.push_back(InputBuffer(std::string(1, ch)));
+	else {
+		InputBuffer &buf = input_buffer.back();
+		buf.data[--buf.pos] = ch;
 	}
-	input_buffer.push_front(str);
+}
+
+static void insert_input(std::string str)
+{
+	if (!str.empty())
+		input_buffer.push_back(InputBuffer(std::move(str)));
 }
 
 static char next_char()
 {
-	if (input_buffer.empty())
-		return 0;
+	while (!input_buffer.empty())
+	{
+		InputBuffer &buf = input_buffer.back();
+		if (buf.pos == buf.data.size()) {
+			input_buffer.pop_back();
+			continue;
+		}
 
-	log_assert(input_buffer_charp <= input_buffer.front().size());
-	if (input_buffer_charp == input_buffer.front().size()) {
-		input_buffer_charp = 0;
-		input_buffer.pop_front();
-		return next_char();
+		char ch = buf.data[buf.pos++];
+		if (ch != '\r')
+			return ch;
 	}
+	return 0;
+}
 
-	char ch = input_buffer.front()[input_buffer_charp++];
-	return ch == '\r' ? next_char() : ch;
+// Copy (or skip, when copy is false) the characters up to the next character that
+// can start a token the preprocessor must look at: a directive or macro, a string or a
+// comment. The remaining characters are only passed through by next_token() anyway.
+static void skip_plain(bool copy)
+{
+	if (input_buffer.empty())
+		return;
+
+	InputBuffer &buf = input_buffer.back();
+	const char *p = buf.data.c_str() + buf.pos;
+	size_t len = copy ? strcspn(p, "`\"/\r") : strcspn(p, "`\"/\r\n");
+
+	if (copy)
+		output_code.append(p, len);
+	buf.pos += len;
 }
 
 static std::string skip_spaces()
@@ -105,7 +165,7 @@ static std::string next_token(bool pass_newline = false)
 	token += ch;
 	if (ch == '\n') {
 		if (pass_newline) {
-			output_code.push_back(token);
+			output_code.append(token);
 			return "";
 		}
 		return token;
@@ -201,18 +261,10 @@ static std::string next_token(bool pass_newline = false)
 
 static void input_file(std::istream &f, std::string filename)
 {
-	char buffer[513];
-	int rc;
-
-	insert_input("");
-	auto it = input_buffer.begin();
-
-	input_buffer.insert(it, "`file_push \"" + filename + "\"\n");
-	while ((rc = readsome(f, buffer, sizeof(buffer)-1)) > 0) {
-		buffer[rc] = 0;
-		input_buffer.insert(it, buffer);
-	}
-	input_buffer.insert(it, "\n`file_pop\n");
+	std::string buffer = "`file_push \"" + filename + "\"\n";
+	buffer.append(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	buffer += "\n`file_pop\n";
+	insert_input(std::move(buffer));
 }
 
 
@@ -234,7 +286,7 @@ static bool try_expand_macro(std::set<std::string> &defines_with_args,
 			}
 		}
 		return false; // error - unmatched `"
-	} else if (tok.size() > 1 && tok[0] == '`' && defines_map.count(tok.substr(1)) > 0) {
+	} else if (tok.size() > 1 && tok[0] == '`' && is_defined(defines_map, tok.substr(1))) {
 			std::string name = tok.substr(1);
 			// printf("expand: >>%s<< -> >>%s<<\n", name.c_str(), defines_map[name].c_str());
 			std::string skipped_spaces = skip_spaces();
@@ -258,8 +310,11 @@ static bool try_expand_macro(std::set<std::string> &defines_with_args,
 					if (tok == "(" || tok == "{" || tok == "[")
 						level++;
 				}
-				for (int i = 0; i < GetSize(args); i++)
-					defines_map[stringf("macro_%s_arg%d", name.c_str(), i+1)] = args[i];
+				for (int i = 0; i < GetSize(args); i++) {
+					std::string arg_name = stringf("macro_%s_arg%d", name.c_str(), i+1);
+					note_written(arg_name);
+					defines_map[arg_name] = args[i];
+				}
 			} else {
 				insert_input(tok);
 				insert_input(skipped_spaces);
@@ -272,8 +327,45 @@ static bool try_expand_macro(std::set<std::string> &defines_with_args,
 	} else return false;
 }
 
-std::string frontend_verilog_preproc(std::istream &f, std::string filename, const std::map<std::string, std::string> &pre_defines_map,
-		dict<std::string, std::pair<std::string, bool>> &global_defines_cache, const std::list<std::string> &include_dirs)
+void PreprocOutput::append(const char *data, size_t len)
+{
+	if (chunks.empty() || (chunks.back().size() + len > chunk_size && !chunks.back().empty())) {
+		chunks.push_back(std::string());
+		// the first chunk grows as needed, so that small files do not take a whole chunk
+		if (chunks.size() > 1)
+			chunks.back().reserve(std::max(chunk_size, len));
+	}
+	chunks.back().append(data, len);
+}
+
+std::string PreprocOutput::str() const
+{
+	size_t size = 0;
+	for (auto &chunk : chunks)
+		size += chunk.size();
+
+	std::string result;
+	result.reserve(size);
+	for (auto &chunk : chunks)
+		result += chunk;
+	return result;
+}
+
+PreprocOutput::ReadBuf::int_type PreprocOutput::ReadBuf::underflow()
+{
+	while (index < chunks.size()) {
+		std::string &chunk = chunks[index++];
+		if (chunk.empty())
+			continue;
+		setg(&chunk[0], &chunk[0], &chunk[0] + chunk.size());
+		return traits_type::to_int_type(chunk[0]);
+	}
+	return traits_type::eof();
+}
+
+PreprocOutput frontend_verilog_preproc(std::istream &f, std::string filename, const std::map<std::string, std::string> &pre_defines_map,
+		dict<std::string, std::pair<std::string, bool>> &global_defines_cache, const std::list<std::string> &include_dirs,
+		PreprocRecord *preproc_record)
 {
 	std::set<std::string> defines_with_args;
 	std::map<std::string, std::string> defines_map(pre_defines_map);
@@ -283,7 +375,11 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 
 	output_code.clear();
 	input_buffer.clear();
-	input_buffer_charp = 0;
+
+	record = preproc_record;
+	record_cache = &global_defines_cache;
+	record_written.clear();
+	record_resetall = false;
 
 	input_file(f, filename);
 
@@ -301,6 +397,8 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 
 	while (!input_buffer.empty())
 	{
+		skip_plain(ifdef_fail_level == 0);
+
 		std::string tok = next_token();
 		// printf("token: >>%s<<\n", tok != "\n" ? tok.c_str() : "NEWLINE");
 
@@ -325,7 +423,7 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 			std::string name = next_token(true);
 			if (ifdef_fail_level == 0)
 				ifdef_fail_level = 1, in_elseif = true;
-			else if (ifdef_fail_level == 1 && defines_map.count(name) != 0)
+			else if (ifdef_fail_level == 1 && is_defined(defines_map, name))
 				ifdef_fail_level = 0, in_elseif = true;
 			continue;
 		}
@@ -333,7 +431,7 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 		if (tok == "`ifdef") {
 			skip_spaces();
 			std::string name = next_token(true);
-			if (ifdef_fail_level > 0 || defines_map.count(name) == 0)
+			if (ifdef_fail_level > 0 || !is_defined(defines_map, name))
 				ifdef_fail_level++;
 			continue;
 		}
@@ -341,14 +439,14 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 		if (tok == "`ifndef") {
 			skip_spaces();
 			std::string name = next_token(true);
-			if (ifdef_fail_level > 0 || defines_map.count(name) != 0)
+			if (ifdef_fail_level > 0 || is_defined(defines_map, name))
 				ifdef_fail_level++;
 			continue;
 		}
 
 		if (ifdef_fail_level > 0) {
 			if (tok == "\n")
-				output_code.push_back(tok);
+				output_code.append(tok);
 			continue;
 		}
 
@@ -406,10 +504,13 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 				}
 			}
 			if (ff.fail()) {
-				output_code.push_back("`file_notfound " + fn);
+				output_code.append("`file_notfound " + fn);
 			} else {
 				input_file(ff, fixed_fn);
-				yosys_input_files.insert(fixed_fn);
+				if (record)
+					record->include_files.push_back(fixed_fn);
+				else
+					yosys_input_files.insert(fixed_fn);
 			}
 			continue;
 		}
@@ -419,14 +520,14 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 			std::string fn = next_token(true);
 			if (!fn.empty() && fn.front() == '"' && fn.back() == '"')
 				fn = fn.substr(1, fn.size()-2);
-			output_code.push_back(tok + " \"" + fn + "\"");
+			output_code.append(tok + " \"" + fn + "\"");
 			filename_stack.push_back(filename);
 			filename = fn;
 			continue;
 		}
 
 		if (tok == "`file_pop") {
-			output_code.push_back(tok);
+			output_code.append(tok);
 			filename = filename_stack.back();
 			filename_stack.pop_back();
 			continue;
@@ -497,6 +598,7 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 			else
 				defines_with_args.erase(name);
 			global_defines_cache[name] = std::pair<std::string, bool>(value, state == 2);
+			note_change({name, false, value, state == 2});
 			continue;
 		}
 
@@ -508,6 +610,7 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 			defines_map.erase(name);
 			defines_with_args.erase(name);
 			global_defines_cache.erase(name);
+			note_change({name, true, std::string(), false});
 			continue;
 		}
 
@@ -524,24 +627,47 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 			defines_map.clear();
 			defines_with_args.clear();
 			global_defines_cache.clear();
+			note_change({std::string(), false, std::string(), false});
 			continue;
 		}
 
 		if (try_expand_macro(defines_with_args, defines_map, tok))
 			continue;
 
-		output_code.push_back(tok);
+		output_code.append(tok);
 	}
 
-	std::string output;
-	for (auto &str : output_code)
-		output += str;
-
-	output_code.clear();
+	PreprocOutput output;
+	output.chunks.swap(output_code.chunks);
 	input_buffer.clear();
-	input_buffer_charp = 0;
+	record = nullptr;
 
 	return output;
 }
 
+bool PreprocRecord::check(const dict<std::string, std::pair<std::string, bool>> &global_defines_cache) const
+{
+	for (auto &it : used_defines)
+		if (!global_defines_cache.count(it.first) || global_defines_cache.at(it.first) != it.second)
+			return false;
+	for (auto &name : used_undefined)
+		if (global_defines_cache.count(name))
+			return false;
+	return true;
+}
+
+void PreprocRecord::apply(dict<std::string, std::pair<std::string, bool>> &global_defines_cache) const
+{
+	for (auto &change : changes) {
+		if (change.name.empty())
+			global_defines_cache.clear();
+		else if (change.undef)
+			global_defines_cache.erase(change.name);
+		else
+			global_defines_cache[change.name] = std::pair<std::string, bool>(change.value, change.with_args);
+	}
+	for (auto &fn : include_files)
+		yosys_input_files.insert(fn);
+}
+
 YOSYS_NAMESPACE_END
@@ -28,8 +28,16 @@
 
 #include "verilog_frontend.h"
 #include "kernel/yosys.h"
+#include "kernel/threading.h"
+#include "kernel/rtlil_bin.h"
 #include "libs/sha1/sha1.h"
 #include <stdarg.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#  include <direct.h>
+#endif
 
 YOSYS_NAMESPACE_BEGIN
 using namespace VERILOG_FRONTEND;
@@ -47,8 +55,343 @@ static void error_on_dpi_function(AST::AstNode *node)
 		error_on_dpi_function(child);
 }
 
+static const char incremental_magic[] = "YSVLOGINC2\n";
+
+// An entry of the cache of read_verilog -incremental, for one version of a file read with one set
+// of options. It holds the RTLIL of the modules of the file (in write_rtlil_bin format) and the
+// other things that RTLIL depends on: the contents of the included files and the defines the
+// file used. When the entry is complete, the file is not parsed again and the changes the file
+// made to the defines are applied again. Otherwise the file has other modules or other top-level
+// items (e.g. modules with parameters), it is parsed again and only the modules in the entry are
+// not processed again.
+struct IncrementalEntry
+{
+	std::vector<std::pair<std::string, std::string>> includes;
+	PreprocRecord record;
+	bool complete;
+	// AstModule::autowire of the modules in rtlil, in the same order
+	std::vector<bool> autowire;
+	std::string rtlil;
+
+	static void put_int(std::string &buf, int value) {
+		buf += stringf("%d ", value);
+	}
+
+	static void put_str(std::string &buf, const std::string &str) {
+		buf += stringf("%zu:", str.size());
+		buf += str;
+	}
+
+	std::string encode() const
+	{
+		std::string buf = incremental_magic;
+		put_int(buf, GetSize(includes));
+		for (auto &it : includes) {
+			put_str(buf, it.first);
+			put_str(buf, it.second);
+		}
+		put_int(buf, GetSize(record.used_defines));
+		for (auto &it : record.used_defines) {
+			put_str(buf, it.first);
+			put_str(buf, it.second.first);
+			put_int(buf, it.second.second);
+		}
+		put_int(buf, GetSize(record.used_undefined));
+		for (auto &name : record.used_undefined)
+			put_str(buf, name);
+		put_int(buf, GetSize(record.changes));
+		for (auto &change : record.changes) {
+			put_str(buf, change.name);
+			put_int(buf, change.undef);
+			put_str(buf, change.value);
+			put_int(buf, change.with_args);
+		}
+		put_int(buf, complete);
+		put_int(buf, GetSize(autowire));
+		for (bool value : autowire)
+			put_int(buf, value);
+		buf += rtlil;
+		return buf;
+	}
+
+	// returns false if the data is not a valid entry
+	bool decode(const char *ptr, const char *end)
+	{
+		auto get_number = [&](char sep, size_t &value) {
+			value = 0;
+			const char *start = ptr;
+			while (ptr < end && '0' <= *ptr && *ptr <= '9')
+				value = value*10 + (*ptr++ - '0');
+			if (ptr == start || ptr == end || *ptr != sep)
+				return false;
+			ptr++;
+			return true;
+		};
+		auto get_int = [&](int &value) {
+			size_t n;
+			if (!get_number(' ', n))
+				return false;
+			value = n;
+			return true;
+		};
+		auto get_str = [&](std::string &str) {
+			size_t n;
+			if (!get_number(':', n) || size_t(end - ptr) < n)
+				return false;
+			str = std::string(ptr, n);
+			ptr += n;
+			return true;
+		};
+
+		size_t magic_size = strlen(incremental_magic);
+		if (size_t(end - ptr) < magic_size || memcmp(ptr, incremental_magic, magic_size) != 0)
+			return false;
+		ptr += magic_size;
+
+		int count;
+		if (!get_int(count))
+			return false;
+		includes.resize(count);
+		for (auto &it : includes) {
+			if (!get_str(it.first) || !get_str(it.second))
+				return false;
+			record.include_files.push_back(it.first);
+		}
+
+		if (!get_int(count))
+			return false;
+		for (int i = 0; i < count; i++) {
+			std::string name, value;
+			int with_args;
+			if (!get_str(name) || !get_str(value) || !get_int(with_args))
+				return false;
+			record.used_defines[name] = std::pair<std::string, bool>(value, with_args != 0);
+		}
+
+		if (!get_int(count))
+			return false;
+		for (int i = 0; i < count; i++) {
+			std::string name;
+			if (!get_str(name))
+				return false;
+			record.used_undefined.insert(name);
+		}
+
+		if (!get_int(count))
+			return false;
+		record.changes.resize(count);
+		for (auto &change : record.changes) {
+			int undef, with_args;
+			if (!get_str(change.name) || !get_int(undef) || !get_str(change.value) || !get_int(with_args))
+				return false;
+			change.undef = undef != 0;
+			change.with_args = with_args != 0;
+		}
+
+		int value;
+		if (!get_int(value))
+			return false;
+		complete = value != 0;
+		if (!get_int(count))
+			return false;
+		for (int i = 0; i < count; i++) {
+			if (!get_int(value))
+				return false;
+			autowire.push_back(value != 0);
+		}
+
+		rtlil = std::string(ptr, end);
+		return true;
+	}
+
+	// true if the included files and the defines the file used are the same as when the entry
+	// was written (the hash of the file itself is part of the key)
+	bool check(RTLIL::Design *design) const
+	{
+		for (auto &it : includes)
+			if (SHA1::from_file(it.first) != it.second)
+				return false;
+		return record.check(design->verilog_defines);
+	}
+};
+
+// the RTLIL of a module can be cached if the module can't be derived again with other
+// parameters or interfaces, i.e. if its AST is not needed later
+static bool incremental_cacheable(const AST::AstNode *node)
+{
+	if (node->type != AST::AST_MODULE || !AST::ast_cacheable(node))
+		return false;
+	for (auto child : node->children)
+		if (child->type == AST::AST_PARAMETER || child->type == AST::AST_INTERFACEPORT)
+			return false;
+	return true;
+}
+
 struct VerilogFrontend : public Frontend {
+	// files that were pre-processed ahead of time on the worker threads
+	struct Preprocessed {
+		std::string context;
+		PreprocOutput code;
+		PreprocRecord record;
+		bool ok;
+	};
+	dict<std::string, Preprocessed> preprocessed;
+
 	VerilogFrontend() : Frontend("verilog", "read modules from Verilog file") { }
+
+	// the options that change the output of the pre-processor
+	static std::string preproc_context(const std::map<std::string, std::string> &defines_map, const std::list<std::string> &include_dirs)
+	{
+		std::string context = formal_mode ? "formal\n" : "\n";
+		for (auto &it : defines_map)
+			context += stringf("-D %s=%s\n", it.first.c_str(), it.second.c_str());
+		for (auto &dir : include_dirs)
+			context += stringf("-I %s\n", dir.c_str());
+		return context;
+	}
+
+	// pre-process the current file and some of the following files given in next_args on
+	// the worker threads, each with a copy of the current defines cache
+	void preprocess_ahead(std::string filename, size_t argidx, const std::map<std::string, std::string> &defines_map,
+			const std::list<std::string> &include_dirs, RTLIL::Design *design)
+	{
+		std::vector<std::string> filenames;
+		filenames.push_back(filename);
+
+		for (size_t i = argidx; i < next_args.size() && GetSize(filenames) < 2*ThreadPool::size(); i++) {
+			std::string fn = next_args[i];
+			if (fn.compare(0, 2, "<<") == 0)
+				break;
+			rewrite_filename(fn);
+			for (auto &it : glob_filename(fn))
+				filenames.push_back(it);
+		}
+
+		std::string context = preproc_context(defines_map, include_dirs);
+		std::vector<Preprocessed> results(filenames.size());
+
+		ThreadPool::run(GetSize(filenames), [&](int i) {
+			Preprocessed &result = results[i];
+			result.context = context;
+			result.ok = false;
+
+			LogCapture capture;
+			log_capture = &capture;
+			try {
+				std::ifstream ff(filenames[i].c_str());
+				if (!ff.fail()) {
+					dict<std::string, std::pair<std::string, bool>> defines_cache = design->verilog_defines;
+					result.code = frontend_verilog_preproc(ff, filenames[i], defines_map, defines_cache, include_dirs, &result.record);
+					// anything that would have been logged is logged when the file is pre-processed again
+					result.ok = capture.entries.empty();
+				}
+			} catch (...) {
+			}
+			log_capture = nullptr;
+		});
+
+		preprocessed.clear();
+		for (int i = 0; i < GetSize(filenames); i++)
+			preprocessed[filenames[i]] = std::move(results[i]);
+	}
+
+	// the entry of the incremental cache for the current file, the key covers the yosys version,
+	// the name and contents of the file, the options and the packages and globals of the design
+	static std::string incremental_filename(const std::string &dir, const std::string &filename, const std::string &options,
+			RTLIL::Design *design)
+	{
+		std::string key = stringf("%s\n%s\n%s\n", yosys_version_str, filename.c_str(), SHA1::from_file(filename).c_str());
+		key += options;
+		for (auto node : design->verilog_packages)
+			AST::ast_checksum_data(key, node);
+		key += "\n";
+		for (auto node : design->verilog_globals)
+			AST::ast_checksum_data(key, node);
+		return stringf("%s/verilog_%s.bin", dir.c_str(), sha1(key).c_str());
+	}
+
+	// load the modules of the current file from its entry in the incremental cache, returns false
+	// if there is no valid entry. when the entry is complete, the changes of the file to the defines
+	// are made as well.
+	static bool incremental_load(const std::string &cache_filename, RTLIL::Design *design, std::vector<AST::AstModule*> &modules,
+			bool &complete)
+	{
+		if (!check_file_exists(cache_filename))
+			return false;
+
+		IncrementalEntry entry;
+		{
+			MappedFile file;
+			if (!file.map(cache_filename)) {
+				std::ifstream f(cache_filename.c_str(), std::ifstream::binary);
+				if (f.fail())
+					return false;
+				file.read(f);
+			}
+			if (!entry.decode(file.data, file.data + file.size)) {
+				log_warning("Ignoring corrupt incremental cache entry `%s'.\n", cache_filename.c_str());
+				return false;
+			}
+		}
+
+		if (!entry.check(design))
+			return false;
+
+		std::istringstream rtlil(entry.rtlil);
+		RtlilBinReader reader;
+		reader.open(rtlil, cache_filename);
+		if (reader.num_modules() != GetSize(entry.autowire)) {
+			log_warning("Ignoring corrupt incremental cache entry `%s'.\n", cache_filename.c_str());
+			return false;
+		}
+		for (int i = 0; i < reader.num_modules(); i++) {
+			log("Loading RTLIL representation for module `%s' from incremental cache `%s'.\n",
+					log_id(reader.module_name(i)), cache_filename.c_str());
+			AST::AstModule *mod = new AST::AstModule;
+			reader.load_module(i, mod);
+			mod->autowire = entry.autowire[i];
+			modules.push_back(mod);
+		}
+		autoidx = std::max(autoidx, reader.file_autoidx);
+
+		complete = entry.complete;
+		if (complete)
+			entry.record.apply(design->verilog_defines);
+		return true;
+	}
+
+	static void incremental_save(const std::string &cache_filename, RTLIL::Design *design, const PreprocRecord &record,
+			const std::vector<RTLIL::Module*> &modules, bool complete)
+	{
+		IncrementalEntry entry;
+		entry.record = record;
+		entry.complete = complete;
+		for (auto mod : modules) {
+			AST::AstModule *ast_mod = dynamic_cast<AST::AstModule*>(mod);
+			log_assert(ast_mod != nullptr);
+			entry.autowire.push_back(ast_mod->autowire);
+		}
+		for (auto &fn : record.include_files)
+			entry.includes.push_back(std::make_pair(fn, SHA1::from_file(fn)));
+
+		std::ostringstream rtlil;
+		RtlilBinWriter().write(rtlil, design, modules);
+		entry.rtlil = rtlil.str();
+
+		// write to a temporary file first, so other processes never see partial entries
+		std::string buf = entry.encode();
+		std::string dir = cache_filename.substr(0, cache_filename.rfind('/'));
+		std::string temp_filename = make_temp_file(dir + "/.yosys_XXXXXX");
+		std::ofstream f(temp_filename.c_str(), std::ofstream::trunc | std::ofstream::binary);
+		f.write(buf.data(), buf.size());
+		f.close();
+
+		if (f.fail() || rename(temp_filename.c_str(), cache_filename.c_str()) != 0) {
+			log_warning("Can't write incremental cache entry `%s': %s\n", cache_filename.c_str(), strerror(errno));
+			remove(temp_filename.c_str());
+		}
+	}
+
 	void help() YS_OVERRIDE
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -139,6 +482,13 @@ struct VerilogFrontend : public Frontend {
 		log("    -nodpi\n");
 		log("        disable DPI-C support\n");
 		log("\n");
+		log("    -noreprocess\n");
+		log("        free the AST of each module right after its RTLIL has been generated,\n");
+		log("        unless the module has parameters or interface ports. this reduces the\n");
+		log("        memory used for large designs, but modules that instantiate interfaces\n");
+		log("        can't be processed by 'hierarchy' then. the ASTs of modules derived\n");
+		log("        from parametric modules are freed as well.\n");
+		log("\n");
 		log("    -lib\n");
 		log("        only create empty blackbox modules. This implies -DBLACKBOX.\n");
 		log("\n");
@@ -168,6 +518,19 @@ struct VerilogFrontend : public Frontend {
 		log("    -setattr <attribute_name>\n");
 		log("        set the specified attribute (to the value 1) on all loaded modules\n");
 		log("\n");
+		log("    -incremental <directory>\n");
+		log("        store the RTLIL of the modules of each file in the specified directory\n");
+		log("        and load it from there when the same version of the file is read again\n");
+		log("        with the same options. the directory is created if it does not exist.\n");
+		log("        an entry is only used if the files included by the file and the macros\n");
+		log("        it uses are unchanged as well, the macros the file defines are defined\n");
+		log("        again when the entry is used. files with packages, interfaces, modules\n");
+		log("        with parameters or $readmemh/$readmemb are parsed again, only their\n");
+		log("        other modules are loaded from the cache. like with -noreprocess,\n");
+		log("        modules loaded from the cache have no AST, so modules that instantiate\n");
+		log("        interfaces can't be processed by 'hierarchy'. the log messages and\n");
+		log("        warnings of modules loaded from the cache are not repeated.\n");
+		log("\n");
 		log("    -Dname[=definition]\n");
 		log("        define the preprocessor symbol 'name' and set its optional value\n");
 		log("        'definition'\n");
@@ -188,12 +551,30 @@ struct VerilogFrontend : public Frontend {
 		log("SYNTHESIS or FORMAL is defined automatically. In addition, read_verilog\n");
 		log("always defines the macro YOSYS.\n");
 		log("\n");
+		log("When yosys runs with more than one thread (see the -j option of the yosys\n");
+		log("executable) and several files are given, only the pre-processing is done in\n");
+		log("parallel: the current file and some of the following files are pre-processed\n");
+		log("together on the worker threads before the current file is parsed. A file is\n");
+		log("pre-processed again if an earlier file changed a macro it uses. Parsing and\n");
+		log("the conversion to RTLIL are done one file after the other in the main thread,\n");
+		log("the result is the same for any number of threads.\n");
+		log("\n");
 		log("See the Yosys README file for a list of non-standard Verilog features\n");
 		log("supported by the Yosys Verilog front-end.\n");
 		log("\n");
 	}
 	void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
 	{
+		// the files pre-processed ahead are only used by the same command, forget them after
+		// the last file or an error
+		struct ClearPreprocessed {
+			dict<std::string, Preprocessed> &preprocessed;
+			~ClearPreprocessed() {
+				if (next_args.empty() || std::uncaught_exception())
+					preprocessed.clear();
+			}
+		} clear_preprocessed = {preprocessed};
+
 		bool flag_dump_ast1 = false;
 		bool flag_dump_ast2 = false;
 		bool flag_no_dump_ptr = false;
@@ -206,11 +587,13 @@ struct VerilogFrontend : public Frontend {
 		bool flag_ppdump = false;
 		bool flag_nopp = false;
 		bool flag_nodpi = false;
+		bool flag_noreprocess = false;
 		bool flag_noopt = false;
 		bool flag_icells = false;
 		bool flag_nooverwrite = false;
 		bool flag_overwrite = false;
 		bool flag_defer = false;
+		std::string incremental_dir;
 		std::map<std::string, std::string> defines_map;
 		std::list<std::string> include_dirs;
 		std::list<std::string> attributes;
@@ -310,6 +693,10 @@ struct VerilogFrontend : public Frontend {
 				flag_nodpi = true;
 				continue;
 			}
+			if (arg == "-noreprocess") {
+				flag_noreprocess = true;
+				continue;
+			}
 			if (arg == "-lib") {
 				lib_mode = true;
 				defines_map["BLACKBOX"] = string();
@@ -345,6 +732,12 @@ struct VerilogFrontend : public Frontend {
 				attributes.push_back(RTLIL::escape_id(args[++argidx]));
 				continue;
 			}
+			if (arg == "-incremental" && argidx+1 < args.size()) {
+				incremental_dir = args[++argidx];
+				while (GetSize(incremental_dir) > 1 && incremental_dir.back() == '/')
+					incremental_dir.pop_back();
+				continue;
+			}
 			if (arg == "-D" && argidx+1 < args.size()) {
 				std::string name = args[++argidx], value;
 				size_t equal = name.find('=');
@@ -374,11 +767,80 @@ struct VerilogFrontend : public Frontend {
 			}
 			break;
 		}
+		bool from_file = f == nullptr;
 		extra_args(f, filename, args, argidx);
 
 		log("Parsing %s%s input from `%s' to AST representation.\n",
 				formal_mode ? "formal " : "", sv_mode ? "SystemVerilog" : "Verilog", filename.c_str());
 
+		// add a module loaded from the incremental cache to the design, like AST::process() would
+		auto add_cached_module = [&](AST::AstModule *mod)
+		{
+			if (design->has(mod->name)) {
+				RTLIL::Module *existing_mod = design->module(mod->name);
+				if (!flag_nooverwrite && !flag_overwrite && !existing_mod->get_bool_attribute("\\blackbox")) {
+					std::string src = mod->get_src_attribute();
+					RTLIL::IdString name = mod->name;
+					delete mod;
+					log_error("Re-definition of module `%s' at %s!\n", log_id(name), src.c_str());
+				} else if (flag_nooverwrite) {
+					log("Ignoring re-definition of module `%s' at %s.\n", log_id(mod->name), mod->get_src_attribute().c_str());
+					delete mod;
+					return;
+				} else {
+					log("Replacing existing%s module `%s' at %s.\n", existing_mod->get_bool_attribute("\\blackbox") ? " blackbox" : "",
+							log_id(mod->name), mod->get_src_attribute().c_str());
+					design->remove(existing_mod);
+				}
+			}
+
+			// an AstModule like the ones read with -noreprocess, autowire was set from the entry
+			mod->ast = NULL;
+			mod->nolatches = flag_nolatches;
+			mod->nomeminit = flag_nomeminit;
+			mod->nomem2reg = flag_nomem2reg;
+			mod->mem2reg = flag_mem2reg;
+			mod->lib = lib_mode;
+			mod->noopt = flag_noopt;
+			mod->icells = flag_icells;
+			mod->noreprocess = flag_noreprocess;
+			design->add(mod);
+		};
+
+		std::string incremental_entry;
+		std::vector<AST::AstModule*> cached_modules;
+		bool cached_complete = false;
+
+		if (!incremental_dir.empty() && from_file && filename.compare(0, 2, "<<") != 0 && !flag_defer && !flag_ppdump &&
+				!flag_dump_ast1 && !flag_dump_ast2 && !flag_dump_vlog && !flag_dump_rtlil)
+		{
+#ifdef _WIN32
+			int ret = _mkdir(incremental_dir.c_str());
+#else
+			int ret = mkdir(incremental_dir.c_str(), 0777);
+#endif
+			if (ret != 0 && errno != EEXIST)
+				log_cmd_error("Can't create cache directory `%s': %s\n", incremental_dir.c_str(), strerror(errno));
+
+			// all options that change the result of parsing and processing the file
+			std::string options = stringf("%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d\n", sv_mode, formal_mode, noassert_mode,
+					noassume_mode, norestrict_mode, assume_asserts_mode, assert_assumes_mode, lib_mode, flag_nolatches, flag_nomeminit,
+					flag_nomem2reg, flag_mem2reg, flag_nopp, flag_nodpi, flag_noreprocess, flag_noopt, flag_icells, default_nettype_wire);
+			options += preproc_context(defines_map, include_dirs);
+			for (auto &attr : attributes)
+				options += attr + "\n";
+			incremental_entry = incremental_filename(incremental_dir, filename, options, design);
+
+			if (incremental_load(incremental_entry, design, cached_modules, cached_complete) && cached_complete)
+			{
+				for (auto mod : cached_modules)
+					add_cached_module(mod);
+
+				log("Successfully finished Verilog frontend.\n");
+				return;
+			}
+		}
+
 		AST::current_filename = filename;
 		AST::set_line_num = &frontend_verilog_yyset_lineno;
 		AST::get_line_num = &frontend_verilog_yyget_lineno;
@@ -386,13 +848,40 @@ struct VerilogFrontend : public Frontend {
 		current_ast = new AST::AstNode(AST::AST_DESIGN);
 
 		lexin = f;
-		std::string code_after_preproc;
+		PreprocOutput code_after_preproc;
+		std::unique_ptr<PreprocOutput::ReadBuf> code_after_preproc_buf;
+		PreprocRecord incremental_record;
 
 		if (!flag_nopp) {
-			code_after_preproc = frontend_verilog_preproc(*f, filename, defines_map, design->verilog_defines, include_dirs);
+			bool found = false;
+			if (from_file && filename.compare(0, 2, "<<") != 0 && ThreadPool::size() > 1)
+			{
+				if (!preprocessed.count(filename))
+					preprocess_ahead(filename, argidx, defines_map, include_dirs, design);
+
+				auto it = preprocessed.find(filename);
+				if (it != preprocessed.end()) {
+					if (it->second.ok && it->second.context == preproc_context(defines_map, include_dirs) && it->second.record.check(design->verilog_defines)) {
+						code_after_preproc = std::move(it->second.code);
+						it->second.record.apply(design->verilog_defines);
+						if (!incremental_entry.empty())
+							incremental_record = it->second.record;
+						found = true;
+					}
+					preprocessed.erase(it);
+				}
+			}
+			if (!found && !incremental_entry.empty()) {
+				code_after_preproc = frontend_verilog_preproc(*f, filename, defines_map, design->verilog_defines, include_dirs, &incremental_record);
+				for (auto &fn : incremental_record.include_files)
+					yosys_input_files.insert(fn);
+			} else if (!found)
+				code_after_preproc = frontend_verilog_preproc(*f, filename, defines_map, design->verilog_defines, include_dirs);
 			if (flag_ppdump)
-				log("-- Verilog code after preprocessor --\n%s-- END OF DUMP --\n", code_after_preproc.c_str());
-			lexin = new std::istringstream(code_after_preproc);
+				log("-- Verilog code after preprocessor --\n%s-- END OF DUMP --\n", code_after_preproc.str().c_str());
+			// the lexer reads the chunks of the output in place
+			code_after_preproc_buf.reset(new PreprocOutput::ReadBuf(code_after_preproc));
+			lexin = new std::istream(code_after_preproc_buf.get());
 		}
 
 		frontend_verilog_yyset_lineno(1);
@@ -410,7 +899,67 @@ struct VerilogFrontend : public Frontend {
 		if (flag_nodpi)
 			error_on_dpi_function(current_ast);
 
-		AST::process(design, current_ast, flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog, flag_dump_rtlil, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, lib_mode, flag_noopt, flag_icells, flag_nooverwrite, flag_overwrite, flag_defer, default_nettype_wire);
+		// the name of a module of the current AST, as it is added to the design
+		auto module_name = [&](const AST::AstNode *node) {
+			std::string name = node->str;
+			if (flag_icells && name.compare(0, 2, "\\$") == 0)
+				name = name.substr(1);
+			return name;
+		};
+
+		// modules of an incomplete entry of the incremental cache replace their AST
+		if (!cached_modules.empty())
+		{
+			pool<std::string> cached_names;
+			for (auto mod : cached_modules)
+				cached_names.insert(mod->name.str());
+
+			std::vector<AST::AstNode*> children;
+			for (auto child : current_ast->children)
+				if (child->type == AST::AST_MODULE && cached_names.count(module_name(child)))
+					delete child;
+				else
+					children.push_back(child);
+			current_ast->children.swap(children);
+
+			for (auto mod : cached_modules)
+				add_cached_module(mod);
+		}
+
+		// the names of the modules of the file whose RTLIL can be cached, when there is no entry
+		// for the file yet. the entry is complete if these are all top-level items of the file.
+		std::vector<RTLIL::IdString> incremental_modules;
+		bool incremental_save_entry = !incremental_entry.empty() && cached_modules.empty();
+		bool incremental_complete = true;
+		if (incremental_save_entry) {
+			for (auto child : current_ast->children) {
+				// the module would not be replaced
+				if (!incremental_cacheable(child) || (flag_nooverwrite && design->has(module_name(child))))
+					incremental_complete = false;
+				else
+					incremental_modules.push_back(module_name(child));
+			}
+		}
+
+		AST::process(design, current_ast, flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog, flag_dump_rtlil, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, lib_mode, flag_noopt, flag_icells, flag_nooverwrite, flag_overwrite, flag_defer, default_nettype_wire, flag_noreprocess);
+
+		if (incremental_save_entry)
+		{
+			std::vector<RTLIL::Module*> modules;
+			for (auto name : incremental_modules) {
+				RTLIL::Module *mod = design->module(name);
+				bool has_interface = false;
+				for (auto wire : mod->wires())
+					if (wire->get_bool_attribute("\\is_interface"))
+						has_interface = true;
+				if (has_interface)
+					incremental_complete = false;
+				else
+					modules.push_back(mod);
+			}
+			if (incremental_complete || !modules.empty())
+				incremental_save(incremental_entry, design, incremental_record, modules, incremental_complete);
+		}
 
 		if (!flag_nopp)
 			delete lexin;
@@ -76,9 +76,63 @@ namespace VERILOG_FRONTEND
 	extern std::istream *lexin;
 }
 
+// how a run of the pre-processor depended on and changed the global defines cache. this
+// is used to pre-process files ahead of time on worker threads, with a copy of the cache,
+// and to check later that the result is the same as with the actual cache.
+struct PreprocRecord
+{
+	// the defines that were looked up before the run changed them: their entries in
+	// the cache, or the names of those that were not in the cache
+	dict<std::string, std::pair<std::string, bool>> used_defines;
+	pool<std::string> used_undefined;
+
+	// the changes to the cache, in order. an empty name stands for `resetall
+	struct change_t {
+		std::string name;
+		bool undef;
+		std::string value;
+		bool with_args;
+	};
+	std::vector<change_t> changes;
+
+	// the files that were included (not added to yosys_input_files)
+	std::vector<std::string> include_files;
+
+	// true if the run would have given the same result with this cache
+	bool check(const dict<std::string, std::pair<std::string, bool>> &global_defines_cache) const;
+
+	// make the changes to the cache and add the included files to yosys_input_files
+	void apply(dict<std::string, std::pair<std::string, bool>> &global_defines_cache) const;
+};
+
+// The output of the pre-processor. It is kept in chunks of about chunk_size bytes, so that
+// a large output is not copied again each time it grows and is never joined into one string.
+// The lexer reads the chunks in place through a ReadBuf.
+struct PreprocOutput
+{
+	static const size_t chunk_size = 1 << 20;
+	std::vector<std::string> chunks;
+
+	void append(const char *data, size_t len);
+	void append(const std::string &str) { append(str.data(), str.size()); }
+	void clear() { chunks.clear(); }
+
+	// the whole output as one string, for read_verilog -ppdump
+	std::string str() const;
+
+	struct ReadBuf : public std::streambuf
+	{
+		std::vector<std::string> &chunks;
+		size_t index;
+		ReadBuf(PreprocOutput &output) : chunks(output.chunks), index(0) { }
+		int_type underflow() YS_OVERRIDE;
+	};
+};
+
 // the pre-processor
-std::string frontend_verilog_preproc(std::istream &f, std::string filename, const std::map<std::string, std::string> &pre_defines_map,
-		dict<std::string, std::pair<std::string, bool>> &global_defines_cache, const std::list<std::string> &include_dirs);
+PreprocOutput frontend_verilog_preproc(std::istream &f, std::string filename, const std::map<std::string, std::string> &pre_defines_map,
+		dict<std::string, std::pair<std::string, bool>> &global_defines_cache, const std::list<std::string> &include_dirs,
+		PreprocRecord *preproc_record = nullptr);
 
 YOSYS_NAMESPACE_END
 
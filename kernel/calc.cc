@@ -33,10 +33,7 @@ static void extend_u0(RTLIL::Const &arg, int width, bool is_signed)
 	if (arg.bits.size() > 0 && is_signed)
 		padding = arg.bits.back();
 
-	while (int(arg.bits.size()) < width)
-		arg.bits.push_back(padding);
-
-	arg.bits.resize(width);
+	arg.bits.resize(width, padding);
 }
 
 static BigInteger const2big(const RTLIL::Const &val, bool as_signed, int &undef_bit_pos)
@@ -97,6 +94,57 @@ static RTLIL::Const big2const(const BigInteger &val, int result_len, int undef_b
 	return result;
 }
 
+// Fast path for fully defined operands of up to 64 bits. The value of such an operand is kept
+// as the low 64 bits of its two's complement representation plus a flag for negative values,
+// i.e. it is exactly representable as a 65 bit signed integer. Results are computed modulo
+// 2^64, so the fast path is only used when the result is not wider than 64 bits. Everything
+// else (wider operands or results and undefined bits) is handled by BigInteger.
+
+static bool const2native(const RTLIL::Const &val, bool as_signed, uint64_t &value, bool &negative)
+{
+	int width = GetSize(val.bits);
+
+	value = 0;
+	negative = false;
+
+	if (width > 64)
+		return false;
+	if (width == 0)
+		return true;
+
+	if (val.bits.get_word(1, 0) != 0 || val.bits.get_word(2, 0) != 0)
+		return false;
+
+	value = val.bits.get_word(0, 0);
+	if (as_signed && ((value >> (width - 1)) & 1) != 0) {
+		negative = true;
+		if (width < 64)
+			value |= ~uint64_t(0) << width;
+	}
+	return true;
+}
+
+static RTLIL::Const native2const(uint64_t value, int result_len)
+{
+	RTLIL::Const result(RTLIL::State::S0, result_len);
+	if (result_len > 0)
+		result.bits.set_word(0, 0, value);
+	return result;
+}
+
+// magnitude of a value returned by const2native (never overflows as operands are at most 64 bits)
+static inline uint64_t native_abs(uint64_t value, bool negative)
+{
+	return negative ? ~value + 1 : value;
+}
+
+static bool native_lt(uint64_t a, bool a_neg, uint64_t b, bool b_neg)
+{
+	if (a_neg != b_neg)
+		return a_neg;
+	return a < b;
+}
+
 static RTLIL::State logic_and(RTLIL::State a, RTLIL::State b)
 {
 	if (a == RTLIL::State::S0) return RTLIL::State::S0;
@@ -115,18 +163,24 @@ static RTLIL::State logic_or(RTLIL::State a, RTLIL::State b)
 	return RTLIL::State::S0;
 }
 
-static RTLIL::State logic_xor(RTLIL::State a, RTLIL::State b)
+// The bitwise and reduce operations below work on 64 bits at a time, using masks of the bits
+// that are 0 and 1 in each word of the packed RTLIL::Const::bits. All other states are treated
+// as undefined and result in x.
+
+static inline uint64_t word_zeros(const RTLIL::StateVector &bits, int index)
+{
+	return ~(bits.get_word(0, index) | bits.get_word(1, index) | bits.get_word(2, index)) & bits.word_mask(index);
+}
+
+static inline uint64_t word_ones(const RTLIL::StateVector &bits, int index)
 {
-	if (a != RTLIL::State::S0 && a != RTLIL::State::S1) return RTLIL::State::Sx;
-	if (b != RTLIL::State::S0 && b != RTLIL::State::S1) return RTLIL::State::Sx;
-	return a != b ? RTLIL::State::S1 : RTLIL::State::S0;
+	return bits.get_word(0, index) & ~bits.get_word(1, index) & ~bits.get_word(2, index);
 }
 
-static RTLIL::State logic_xnor(RTLIL::State a, RTLIL::State b)
+static inline void set_result_word(RTLIL::StateVector &bits, int index, uint64_t zeros, uint64_t ones)
 {
-	if (a != RTLIL::State::S0 && a != RTLIL::State::S1) return RTLIL::State::Sx;
-	if (b != RTLIL::State::S0 && b != RTLIL::State::S1) return RTLIL::State::Sx;
-	return a == b ? RTLIL::State::S1 : RTLIL::State::S0;
+	bits.set_word(0, index, ones);
+	bits.set_word(1, index, ~(zeros | ones));
 }
 
 RTLIL::Const RTLIL::const_not(const RTLIL::Const &arg1, const RTLIL::Const&, bool signed1, bool, int result_len)
@@ -137,20 +191,40 @@ RTLIL::Const RTLIL::const_not(const RTLIL::Const &arg1, const RTLIL::Const&, boo
 	RTLIL::Const arg1_ext = arg1;
 	extend_u0(arg1_ext, result_len, signed1);
 
-	RTLIL::Const result(RTLIL::State::Sx, result_len);
-	for (size_t i = 0; i < size_t(result_len); i++) {
-		if (i >= arg1_ext.bits.size())
-			result.bits[i] = RTLIL::State::S0;
-		else if (arg1_ext.bits[i] == RTLIL::State::S0)
-			result.bits[i] = RTLIL::State::S1;
-		else if (arg1_ext.bits[i] == RTLIL::State::S1)
-			result.bits[i] = RTLIL::State::S0;
-	}
+	RTLIL::Const result(RTLIL::State::S0, result_len);
+	for (int i = 0; i < result.bits.num_words(); i++)
+		set_result_word(result.bits, i, word_ones(arg1_ext.bits, i), word_zeros(arg1_ext.bits, i));
 
 	return result;
 }
 
-static RTLIL::Const logic_wrapper(RTLIL::State(*logic_func)(RTLIL::State, RTLIL::State),
+static void word_and(uint64_t a0, uint64_t a1, uint64_t b0, uint64_t b1, uint64_t &y0, uint64_t &y1)
+{
+	y0 = a0 | b0;
+	y1 = a1 & b1;
+}
+
+static void word_or(uint64_t a0, uint64_t a1, uint64_t b0, uint64_t b1, uint64_t &y0, uint64_t &y1)
+{
+	y0 = a0 & b0;
+	y1 = a1 | b1;
+}
+
+static void word_xor(uint64_t a0, uint64_t a1, uint64_t b0, uint64_t b1, uint64_t &y0, uint64_t &y1)
+{
+	uint64_t def = (a0 | a1) & (b0 | b1);
+	y1 = (a1 ^ b1) & def;
+	y0 = def & ~y1;
+}
+
+static void word_xnor(uint64_t a0, uint64_t a1, uint64_t b0, uint64_t b1, uint64_t &y0, uint64_t &y1)
+{
+	uint64_t def = (a0 | a1) & (b0 | b1);
+	y0 = (a1 ^ b1) & def;
+	y1 = def & ~y0;
+}
+
+static RTLIL::Const logic_wrapper(void(*word_func)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t&, uint64_t&),
 		RTLIL::Const arg1, RTLIL::Const arg2, bool signed1, bool signed2, int result_len = -1)
 {
 	if (result_len < 0)
@@ -159,11 +233,11 @@ static RTLIL::Const logic_wrapper(RTLIL::State(*logic_func)(RTLIL::State, RTLIL:
 	extend_u0(arg1, result_len, signed1);
 	extend_u0(arg2, result_len, signed2);
 
-	RTLIL::Const result(RTLIL::State::Sx, result_len);
-	for (size_t i = 0; i < size_t(result_len); i++) {
-		RTLIL::State a = i < arg1.bits.size() ? arg1.bits[i] : RTLIL::State::S0;
-		RTLIL::State b = i < arg2.bits.size() ? arg2.bits[i] : RTLIL::State::S0;
-		result.bits[i] = logic_func(a, b);
+	RTLIL::Const result(RTLIL::State::S0, result_len);
+	for (int i = 0; i < result.bits.num_words(); i++) {
+		uint64_t y0, y1;
+		word_func(word_zeros(arg1.bits, i), word_ones(arg1.bits, i), word_zeros(arg2.bits, i), word_ones(arg2.bits, i), y0, y1);
+		set_result_word(result.bits, i, y0, y1);
 	}
 
 	return result;
@@ -171,55 +245,80 @@ static RTLIL::Const logic_wrapper(RTLIL::State(*logic_func)(RTLIL::State, RTLIL:
 
 RTLIL::Const RTLIL::const_and(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_and, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper(word_and, arg1, arg2, signed1, signed2, result_len);
 }
 
 RTLIL::Const RTLIL::const_or(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_or, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper(word_or, arg1, arg2, signed1, signed2, result_len);
 }
 
 RTLIL::Const RTLIL::const_xor(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_xor, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper(word_xor, arg1, arg2, signed1, signed2, result_len);
 }
 
 RTLIL::Const RTLIL::const_xnor(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_xnor, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper(word_xnor, arg1, arg2, signed1, signed2, result_len);
 }
 
-static RTLIL::Const logic_reduce_wrapper(RTLIL::State initial, RTLIL::State(*logic_func)(RTLIL::State, RTLIL::State), const RTLIL::Const &arg1, int result_len)
+static RTLIL::Const logic_reduce_result(RTLIL::State bit, int result_len)
 {
-	RTLIL::State temp = initial;
-
-	for (size_t i = 0; i < arg1.bits.size(); i++)
-		temp = logic_func(temp, arg1.bits[i]);
-
-	RTLIL::Const result(temp);
-	while (int(result.bits.size()) < result_len)
-		result.bits.push_back(RTLIL::State::S0);
+	RTLIL::Const result(bit);
+	if (int(result.bits.size()) < result_len)
+		result.bits.resize(result_len, RTLIL::State::S0);
 	return result;
 }
 
 RTLIL::Const RTLIL::const_reduce_and(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S1, logic_and, arg1, result_len);
+	bool all_ones = true;
+
+	for (int i = 0; i < arg1.bits.num_words(); i++) {
+		if (word_zeros(arg1.bits, i) != 0)
+			return logic_reduce_result(RTLIL::State::S0, result_len);
+		if (word_ones(arg1.bits, i) != arg1.bits.word_mask(i))
+			all_ones = false;
+	}
+
+	return logic_reduce_result(all_ones ? RTLIL::State::S1 : RTLIL::State::Sx, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_or(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_or, arg1, result_len);
+	bool all_zeros = true;
+
+	for (int i = 0; i < arg1.bits.num_words(); i++) {
+		if (word_ones(arg1.bits, i) != 0)
+			return logic_reduce_result(RTLIL::State::S1, result_len);
+		if (word_zeros(arg1.bits, i) != arg1.bits.word_mask(i))
+			all_zeros = false;
+	}
+
+	return logic_reduce_result(all_zeros ? RTLIL::State::S0 : RTLIL::State::Sx, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_xor(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_xor, arg1, result_len);
+	uint64_t parity = 0;
+
+	for (int i = 0; i < arg1.bits.num_words(); i++) {
+		uint64_t ones = word_ones(arg1.bits, i);
+		if ((ones | word_zeros(arg1.bits, i)) != arg1.bits.word_mask(i))
+			return logic_reduce_result(RTLIL::State::Sx, result_len);
+		parity ^= ones;
+	}
+
+	for (int shift = 32; shift > 0; shift >>= 1)
+		parity ^= parity >> shift;
+
+	return logic_reduce_result((parity & 1) ? RTLIL::State::S1 : RTLIL::State::S0, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_xnor(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	RTLIL::Const buffer = logic_reduce_wrapper(RTLIL::State::S0, logic_xor, arg1, result_len);
+	RTLIL::Const buffer = const_reduce_xor(arg1, RTLIL::Const(), false, false, result_len);
 	if (!buffer.bits.empty()) {
 		if (buffer.bits.front() == RTLIL::State::S0)
 			buffer.bits.front() = RTLIL::State::S1;
@@ -229,13 +328,21 @@ RTLIL::Const RTLIL::const_reduce_xnor(const RTLIL::Const &arg1, const RTLIL::Con
 	return buffer;
 }
 
-RTLIL::Const RTLIL::const_reduce_bool(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
+RTLIL::Const RTLIL::const_reduce_bool(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_or, arg1, result_len);
+	return const_reduce_or(arg1, arg2, signed1, signed2, result_len);
 }
 
 RTLIL::Const RTLIL::const_logic_not(const RTLIL::Const &arg1, const RTLIL::Const&, bool signed1, bool, int result_len)
 {
+	uint64_t native_a;
+	bool neg_a;
+	if (const2native(arg1, signed1, native_a, neg_a)) {
+		RTLIL::Const result(native_a == 0 ? RTLIL::State::S1 : RTLIL::State::S0);
+		result.bits.resize(max(result_len, 1), RTLIL::State::S0);
+		return result;
+	}
+
 	int undef_bit_pos_a = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos_a);
 	RTLIL::Const result(a.isZero() ? undef_bit_pos_a >= 0 ? RTLIL::State::Sx : RTLIL::State::S1 : RTLIL::State::S0);
@@ -247,6 +354,14 @@ RTLIL::Const RTLIL::const_logic_not(const RTLIL::Const &arg1, const RTLIL::Const
 
 RTLIL::Const RTLIL::const_logic_and(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		RTLIL::Const result((native_a != 0) && (native_b != 0) ? RTLIL::State::S1 : RTLIL::State::S0);
+		result.bits.resize(max(result_len, 1), RTLIL::State::S0);
+		return result;
+	}
+
 	int undef_bit_pos_a = -1, undef_bit_pos_b = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos_a);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos_b);
@@ -262,6 +377,14 @@ RTLIL::Const RTLIL::const_logic_and(const RTLIL::Const &arg1, const RTLIL::Const
 
 RTLIL::Const RTLIL::const_logic_or(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		RTLIL::Const result((native_a != 0) || (native_b != 0) ? RTLIL::State::S1 : RTLIL::State::S0);
+		result.bits.resize(max(result_len, 1), RTLIL::State::S0);
+		return result;
+	}
+
 	int undef_bit_pos_a = -1, undef_bit_pos_b = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos_a);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos_b);
@@ -277,13 +400,34 @@ RTLIL::Const RTLIL::const_logic_or(const RTLIL::Const &arg1, const RTLIL::Const
 
 static RTLIL::Const const_shift_worker(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool sign_ext, int direction, int result_len)
 {
-	int undef_bit_pos = -1;
-	BigInteger offset = const2big(arg2, false, undef_bit_pos) * direction;
-
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
+	RTLIL::State ext_bit = sign_ext && !arg1.bits.empty() ? arg1.bits.back() : RTLIL::State::S0;
+
+	uint64_t native_offset;
+	bool neg_offset;
+	if (const2native(arg2, false, native_offset, neg_offset))
+	{
+		// clamp the shift amount, anything larger shifts all bits out anyway
+		int64_t offset = int64_t(min(native_offset, uint64_t(1) << 40)) * direction;
+
+		for (int i = 0; i < result_len; i++) {
+			int64_t pos = i + offset;
+			if (pos < 0)
+				result.bits[i] = RTLIL::State::S0;
+			else if (pos >= GetSize(arg1.bits))
+				result.bits[i] = ext_bit;
+			else
+				result.bits[i] = arg1.bits[pos];
+		}
+		return result;
+	}
+
+	int undef_bit_pos = -1;
+	BigInteger offset = const2big(arg2, false, undef_bit_pos) * direction;
+
 	if (undef_bit_pos >= 0)
 		return result;
 
@@ -292,7 +436,7 @@ static RTLIL::Const const_shift_worker(const RTLIL::Const &arg1, const RTLIL::Co
 		if (pos < 0)
 			result.bits[i] = RTLIL::State::S0;
 		else if (pos >= BigInteger(int(arg1.bits.size())))
-			result.bits[i] = sign_ext ? arg1.bits.back() : RTLIL::State::S0;
+			result.bits[i] = ext_bit;
 		else
 			result.bits[i] = arg1.bits[pos.toInt()];
 	}
@@ -330,13 +474,33 @@ RTLIL::Const RTLIL::const_sshr(const RTLIL::Const &arg1, const RTLIL::Const &arg
 
 static RTLIL::Const const_shift_shiftx(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool, bool signed2, int result_len, RTLIL::State other_bits)
 {
-	int undef_bit_pos = -1;
-	BigInteger offset = const2big(arg2, signed2, undef_bit_pos);
-
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
+
+	uint64_t native_offset;
+	bool neg_offset;
+	if (const2native(arg2, signed2, native_offset, neg_offset))
+	{
+		// clamp the shift amount, anything larger shifts all bits out anyway
+		int64_t offset = int64_t(min(native_abs(native_offset, neg_offset), uint64_t(1) << 40));
+		if (neg_offset)
+			offset = -offset;
+
+		for (int i = 0; i < result_len; i++) {
+			int64_t pos = i + offset;
+			if (pos < 0 || pos >= GetSize(arg1.bits))
+				result.bits[i] = other_bits;
+			else
+				result.bits[i] = arg1.bits[pos];
+		}
+		return result;
+	}
+
+	int undef_bit_pos = -1;
+	BigInteger offset = const2big(arg2, signed2, undef_bit_pos);
+
 	if (undef_bit_pos >= 0)
 		return result;
 
@@ -363,6 +527,14 @@ RTLIL::Const RTLIL::const_shiftx(const RTLIL::Const &arg1, const RTLIL::Const &a
 
 RTLIL::Const RTLIL::const_lt(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		RTLIL::Const result(native_lt(native_a, neg_a, native_b, neg_b) ? RTLIL::State::S1 : RTLIL::State::S0);
+		result.bits.resize(max(result_len, 1), RTLIL::State::S0);
+		return result;
+	}
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) < const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
@@ -374,6 +546,14 @@ RTLIL::Const RTLIL::const_lt(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 
 RTLIL::Const RTLIL::const_le(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		RTLIL::Const result(!native_lt(native_b, neg_b, native_a, neg_a) ? RTLIL::State::S1 : RTLIL::State::S0);
+		result.bits.resize(max(result_len, 1), RTLIL::State::S0);
+		return result;
+	}
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) <= const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
@@ -448,6 +628,14 @@ RTLIL::Const RTLIL::const_nex(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_ge(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		RTLIL::Const result(!native_lt(native_a, neg_a, native_b, neg_b) ? RTLIL::State::S1 : RTLIL::State::S0);
+		result.bits.resize(max(result_len, 1), RTLIL::State::S0);
+		return result;
+	}
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) >= const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
@@ -459,6 +647,14 @@ RTLIL::Const RTLIL::const_ge(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 
 RTLIL::Const RTLIL::const_gt(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		RTLIL::Const result(native_lt(native_b, neg_b, native_a, neg_a) ? RTLIL::State::S1 : RTLIL::State::S0);
+		result.bits.resize(max(result_len, 1), RTLIL::State::S0);
+		return result;
+	}
+
 	int undef_bit_pos = -1;
 	bool y = const2big(arg1, signed1, undef_bit_pos) > const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
@@ -470,6 +666,12 @@ RTLIL::Const RTLIL::const_gt(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 
 RTLIL::Const RTLIL::const_add(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int y_len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (y_len <= 64 && const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b))
+		return native2const(native_a + native_b, y_len);
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) + const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), undef_bit_pos);
@@ -477,6 +679,12 @@ RTLIL::Const RTLIL::const_add(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_sub(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int y_len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (y_len <= 64 && const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b))
+		return native2const(native_a - native_b, y_len);
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) - const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), undef_bit_pos);
@@ -484,6 +692,12 @@ RTLIL::Const RTLIL::const_sub(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_mul(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int y_len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (y_len <= 64 && const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b))
+		return native2const(native_a * native_b, y_len);
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) * const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), min(undef_bit_pos, 0));
@@ -491,6 +705,16 @@ RTLIL::Const RTLIL::const_mul(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_div(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int y_len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (y_len <= 64 && const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		if (native_b == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		uint64_t y = native_abs(native_a, neg_a) / native_abs(native_b, neg_b);
+		return native2const(neg_a != neg_b ? ~y + 1 : y, y_len);
+	}
+
 	int undef_bit_pos = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos);
@@ -504,6 +728,16 @@ RTLIL::Const RTLIL::const_div(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_mod(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int y_len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (y_len <= 64 && const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b)) {
+		if (native_b == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		uint64_t y = native_abs(native_a, neg_a) % native_abs(native_b, neg_b);
+		return native2const(neg_a ? ~y + 1 : y, y_len);
+	}
+
 	int undef_bit_pos = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos);
@@ -517,6 +751,33 @@ RTLIL::Const RTLIL::const_mod(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_pow(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int y_len = result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size());
+	uint64_t native_a, native_b;
+	bool neg_a, neg_b;
+	if (y_len <= 64 && const2native(arg1, signed1, native_a, neg_a) && const2native(arg2, signed2, native_b, neg_b))
+	{
+		if (native_a == 0 && native_b != 0)
+			return RTLIL::Const(neg_b ? RTLIL::State::Sx : RTLIL::State::S0, result_len);
+
+		uint64_t y = 1;
+		if (neg_b) {
+			// a^b with b < 0 is only non-zero for a = 1 and a = -1
+			if (native_a == ~uint64_t(0) && neg_a)
+				y = (native_b & 1) ? ~uint64_t(0) : 1;
+			else if (native_a != 1)
+				y = 0;
+		} else {
+			// square-and-multiply modulo 2^64, for negative a this gives
+			// the same result as computing (-a)^b and negating for odd b
+			for (uint64_t a = native_a, b = native_b; b != 0; b >>= 1) {
+				if (b & 1)
+					y *= a;
+				a *= a;
+			}
+		}
+		return native2const(y, y_len);
+	}
+
 	int undef_bit_pos = -1;
 
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos);
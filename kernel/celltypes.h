@@ -76,8 +76,10 @@ struct CellTypes
 
 	void setup_design(RTLIL::Design *design)
 	{
-		for (auto module : design->modules())
-			setup_module(module);
+		// read only, does not copy modules shared with saved designs
+		const RTLIL::ModuleDict &modules = design->modules_;
+		for (auto &it : modules)
+			setup_module(it.second);
 	}
 
 	void setup_internals()
@@ -251,9 +253,9 @@ struct CellTypes
 
 	static RTLIL::Const eval_not(RTLIL::Const v)
 	{
-		for (auto &bit : v.bits)
-			if (bit == RTLIL::S0) bit = RTLIL::S1;
-			else if (bit == RTLIL::S1) bit = RTLIL::S0;
+		for (int i = 0; i < GetSize(v.bits); i++)
+			if (v.bits[i] == RTLIL::S0) v.bits[i] = RTLIL::S1;
+			else if (v.bits[i] == RTLIL::S1) v.bits[i] = RTLIL::S0;
 		return v;
 	}
 
@@ -183,7 +183,7 @@ struct ConstEval
 				std::vector<RTLIL::State> master_bits = y_values.at(0).bits;
 
 				for (size_t i = 1; i < y_values.size(); i++) {
-					std::vector<RTLIL::State> &slave_bits = y_values.at(i).bits;
+					const RTLIL::StateVector &slave_bits = y_values.at(i).bits;
 					log_assert(master_bits.size() == slave_bits.size());
 					for (size_t j = 0; j < master_bits.size(); j++)
 						if (master_bits[j] != slave_bits[j])
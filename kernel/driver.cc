@@ -18,6 +18,8 @@
  */
 
 #include "kernel/yosys.h"
+#include "kernel/threading.h"
+#include "kernel/profiler.h"
 #include "libs/sha1/sha1.h"
 
 #ifdef YOSYS_ENABLE_READLINE
@@ -153,6 +155,8 @@ std::string yosys_history_file;
 
 void yosys_atexit()
 {
+	Profiler::close_all();
+
 #if defined(YOSYS_ENABLE_READLINE) || defined(YOSYS_ENABLE_EDITLINE)
 	if (!yosys_history_file.empty()) {
 #if defined(YOSYS_ENABLE_READLINE)
@@ -184,6 +188,7 @@ int main(int argc, char **argv)
 	std::string output_filename = "";
 	std::string scriptfile = "";
 	std::string depsfile = "";
+	std::string trace_filename = "";
 	bool scriptfile_tcl = false;
 	bool got_output_filename = false;
 	bool print_banner = true;
@@ -192,6 +197,7 @@ int main(int argc, char **argv)
 	bool timing_details = false;
 	bool mode_v = false;
 	bool mode_q = false;
+	int num_threads = 1;
 
 #if defined(YOSYS_ENABLE_READLINE) || defined(YOSYS_ENABLE_EDITLINE)
 	if (getenv("HOME") != NULL) {
@@ -224,7 +230,18 @@ int main(int argc, char **argv)
 		printf("        annotate all log messages with a time stamp\n");
 		printf("\n");
 		printf("    -d\n");
-		printf("        print more detailed timing stats at exit\n");
+		printf("        print more detailed timing and memory stats at exit, and the memory\n");
+		printf("        usage after each top-level command\n");
+		printf("\n");
+		printf("    -P <tracefile>\n");
+		printf("        write a trace of the executed commands, with the spans of the commands\n");
+		printf("        they call, to the given file in the Chrome trace event format. see\n");
+		printf("        'help profile' for details.\n");
+		printf("\n");
+		printf("    -j <num_threads>\n");
+		printf("        use the given number of threads for passes that can process several\n");
+		printf("        modules in parallel. the log output is the same for any number of\n");
+		printf("        threads. (default: 1)\n");
 		printf("\n");
 		printf("    -l logfile\n");
 		printf("        write log messages to the specified file\n");
@@ -307,7 +324,7 @@ int main(int argc, char **argv)
 	}
 
 	int opt;
-	while ((opt = getopt(argc, argv, "MXAQTVSm:f:Hh:b:o:p:l:L:qv:tds:c:W:w:e:D:E:")) != -1)
+	while ((opt = getopt(argc, argv, "MXAQTVSm:f:Hh:b:o:p:l:L:qv:tdP:j:s:c:W:w:e:D:E:")) != -1)
 	{
 		switch (opt)
 		{
@@ -380,6 +397,17 @@ int main(int argc, char **argv)
 			break;
 		case 'd':
 			timing_details = true;
+			log_mem_stats = true;
+			break;
+		case 'P':
+			trace_filename = optarg;
+			break;
+		case 'j':
+			num_threads = atoi(optarg);
+			if (num_threads < 1) {
+				fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+				exit(1);
+			}
 			break;
 		case 's':
 			scriptfile = optarg;
@@ -464,6 +492,12 @@ int main(int argc, char **argv)
 	yosys_setup();
 	log_error_atexit = yosys_atexit;
 
+	if (num_threads > 1)
+		ThreadPool::setup(num_threads);
+
+	if (!trace_filename.empty())
+		Profiler::start(trace_filename);
+
 	for (auto &fn : plugin_filenames)
 		load_plugin(fn, {});
 
@@ -579,8 +613,9 @@ int main(int argc, char **argv)
 		{
 			log("Time spent:\n");
 			for (auto it = timedat.rbegin(); it != timedat.rend(); it++) {
-				log("%5d%% %5d calls %8.3f sec %s\n", int(100*std::get<0>(*it) / total_ns),
-						std::get<1>(*it), std::get<0>(*it) / 1000000000.0, std::get<2>(*it).c_str());
+				log("%5d%% %5d calls %8.3f sec %+9.1f MB peak %s\n", int(100*std::get<0>(*it) / total_ns),
+						std::get<1>(*it), std::get<0>(*it) / 1000000000.0,
+						pass_register.at(std::get<2>(*it))->peak_rss_growth_kb / 1024.0, std::get<2>(*it).c_str());
 			}
 		}
 		else
@@ -13,10 +13,15 @@
 #define HASHLIB_H
 
 #include <stdexcept>
+#include <limits>
 #include <algorithm>
 #include <string>
 #include <vector>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 namespace hashlib {
 
 const int hashtable_size_trigger = 2;
@@ -195,6 +200,8 @@ template<typename K, typename T, typename OPS = hash_ops<K>> class dict;
 template<typename K, int offset = 0, typename OPS = hash_ops<K>> class idict;
 template<typename K, typename OPS = hash_ops<K>> class pool;
 template<typename K, typename OPS = hash_ops<K>> class mfp;
+template<typename K, typename T, typename OPS = hash_ops<K>> class flat_dict;
+template<typename K, typename OPS = hash_ops<K>> class flat_pool;
 
 template<typename K, typename T, typename OPS>
 class dict
@@ -381,8 +388,8 @@ public:
 
 	dict(const dict &other)
 	{
+		hashtable = other.hashtable;
 		entries = other.entries;
-		do_rehash();
 	}
 
 	dict(dict &&other)
@@ -391,8 +398,8 @@ public:
 	}
 
 	dict &operator=(const dict &other) {
+		hashtable = other.hashtable;
 		entries = other.entries;
-		do_rehash();
 		return *this;
 	}
 
@@ -731,8 +738,8 @@ public:
 
 	pool(const pool &other)
 	{
+		hashtable = other.hashtable;
 		entries = other.entries;
-		do_rehash();
 	}
 
 	pool(pool &&other)
@@ -741,8 +748,8 @@ public:
 	}
 
 	pool &operator=(const pool &other) {
+		hashtable = other.hashtable;
 		entries = other.entries;
-		do_rehash();
 		return *this;
 	}
 
@@ -1054,6 +1061,799 @@ public:
 	const_iterator end() const { return database.end(); }
 };
 
+// flat_dict and flat_pool have the same interface and iteration order as dict and pool
+// (the entries are kept in the same kind of dense vector), but they find the entries
+// with an open addressing table instead of chaining them through a table of bucket
+// heads. Each slot of the table holds a control byte (empty, deleted or 7 bits of the
+// hash) and an entry index. The control bytes of a group of slots are compared with
+// the key at once (with SSE2 if available), so a lookup touches the cache line of one
+// group and the matching entry, and a failed lookup usually only the group. Unlike dict
+// and pool they never rehash in a lookup. Building with ENABLE_FLAT_HASHLIB=1 makes them
+// the dict and pool of the yosys namespace.
+//
+// This is a trade-off, not a plain speedup (see "test_hashlib -bench"): lookups are about
+// as fast as with dict and pool, iteration is faster, but erase is about a third slower,
+// as it has to find the slot of the moved last entry. The index also takes more memory
+// than the bucket heads and next links of dict and pool (a slot is an int and a control
+// byte, and at most 7/8 of the slots are used), a synthesis flow peaks at about 5% higher
+// RSS.
+
+// std::allocator only guarantees the alignment of the fundamental types before C++17
+template<typename T, int alignment>
+struct aligned_allocator
+{
+	typedef T value_type;
+
+	aligned_allocator() { }
+	template<typename U> aligned_allocator(const aligned_allocator<U, alignment>&) { }
+	template<typename U> struct rebind { typedef aligned_allocator<U, alignment> other; };
+
+	T *allocate(size_t n) {
+		char *base = (char*)::operator new(n * sizeof(T) + alignment);
+		char *ptr = base + alignment - (uintptr_t)base % alignment;
+		((char**)ptr)[-1] = base;
+		return (T*)ptr;
+	}
+
+	void deallocate(T *ptr, size_t) {
+		::operator delete(((char**)ptr)[-1]);
+	}
+
+	bool operator==(const aligned_allocator&) const { return true; }
+	bool operator!=(const aligned_allocator&) const { return false; }
+};
+
+class flat_index
+{
+public:
+	enum { group_size = 12, group_mask_bits = (1 << group_size) - 1 };
+	enum : signed char { ctrl_empty = -128, ctrl_deleted = -2, ctrl_padding = -1 };
+
+	// a group of control bytes and the entry indices of its slots fill one cache
+	// line, so that a match does not need another cache miss to find its entry
+	struct group_t {
+		signed char ctrl[16];
+		int slots[group_size];
+	};
+
+	std::vector<group_t, aligned_allocator<group_t, 64>> groups;
+	int used = 0;
+
+	// the hash_ops hashes are often just the value of an int or pointer. the multiply
+	// spreads the low bits over the high bits and the shift brings them back down to the
+	// tag and group bits. with a full finalizer (two multiplies) the lookups in a table
+	// that fits in the cache were about a third slower.
+	static inline unsigned int mix(unsigned int h) {
+		h *= 0x9e3779b9;
+		return h ^ (h >> 15);
+	}
+
+	static inline unsigned int match_tag(const group_t &group, signed char tag) {
+#ifdef __SSE2__
+		__m128i g = _mm_loadu_si128((const __m128i*)group.ctrl);
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(tag))) & group_mask_bits;
+#else
+		unsigned int mask = 0;
+		for (int i = 0; i < group_size; i++)
+			if (group.ctrl[i] == tag)
+				mask |= 1 << i;
+		return mask;
+#endif
+	}
+
+	// empty and deleted slots are the ones with the sign bit set
+	static inline unsigned int match_free(const group_t &group) {
+#ifdef __SSE2__
+		return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group.ctrl)) & group_mask_bits;
+#else
+		unsigned int mask = 0;
+		for (int i = 0; i < group_size; i++)
+			if (group.ctrl[i] < 0)
+				mask |= 1 << i;
+		return mask;
+#endif
+	}
+
+	static inline int lowest_bit(unsigned int mask) {
+#ifdef __GNUC__
+		return __builtin_ctz(mask);
+#else
+		int i = 0;
+		while ((mask & 1) == 0)
+			mask >>= 1, i++;
+		return i;
+#endif
+	}
+
+	// number of slots for n entries (at most 7/8 of the slots are used)
+	static int capacity_for(size_t n) {
+		size_t capacity = group_size;
+		while (capacity - capacity / 8 < n)
+			capacity *= 2;
+		if (capacity > size_t(std::numeric_limits<int>::max()))
+			throw std::length_error("hash table exceeded maximum size.");
+		return capacity;
+	}
+
+	int capacity() const {
+		return groups.size() * group_size;
+	}
+
+	bool full() const {
+		return used >= capacity() - capacity() / 8;
+	}
+
+	int &entry(int slot) {
+		return groups[slot / group_size].slots[slot % group_size];
+	}
+
+	int entry(int slot) const {
+		return groups[slot / group_size].slots[slot % group_size];
+	}
+
+	void reset(int capacity) {
+		group_t empty_group;
+		std::fill(empty_group.ctrl, empty_group.ctrl + 16, ctrl_padding);
+		std::fill(empty_group.ctrl, empty_group.ctrl + group_size, ctrl_empty);
+		std::fill(empty_group.slots, empty_group.slots + group_size, -1);
+		groups.clear();
+		groups.resize(capacity / group_size, empty_group);
+		used = 0;
+	}
+
+	void clear() {
+		groups.clear();
+		used = 0;
+	}
+
+	void swap(flat_index &other) {
+		groups.swap(other.groups);
+		std::swap(used, other.used);
+	}
+
+	// returns the index of the first entry for which match(entry_index) is true, or -1.
+	// the groups are probed in triangular order, which visits all of them.
+	template<typename Match>
+	int find(unsigned int hash, Match match) const
+	{
+		if (groups.empty())
+			return -1;
+
+		signed char tag = hash & 0x7f;
+		unsigned int group_mask = groups.size() - 1;
+		unsigned int g = (hash >> 7) & group_mask;
+
+		for (unsigned int step = 1;; step++) {
+			const group_t &group = groups[g];
+			for (unsigned int m = match_tag(group, tag); m != 0; m &= m - 1) {
+				int i = group.slots[lowest_bit(m)];
+				if (match(i))
+					return i;
+			}
+			if (match_tag(group, ctrl_empty) != 0)
+				return -1;
+			g = (g + step) & group_mask;
+		}
+	}
+
+	// the same as find(), but returns the slot of the entry, for erase(). lookups use
+	// find(), getting the entry index back from the slot is a division by group_size.
+	template<typename Match>
+	int find_slot(unsigned int hash, Match match) const
+	{
+		if (groups.empty())
+			return -1;
+
+		signed char tag = hash & 0x7f;
+		unsigned int group_mask = groups.size() - 1;
+		unsigned int g = (hash >> 7) & group_mask;
+
+		for (unsigned int step = 1;; step++) {
+			const group_t &group = groups[g];
+			for (unsigned int m = match_tag(group, tag); m != 0; m &= m - 1) {
+				int i = lowest_bit(m);
+				if (match(group.slots[i]))
+					return g * group_size + i;
+			}
+			if (match_tag(group, ctrl_empty) != 0)
+				return -1;
+			g = (g + step) & group_mask;
+		}
+	}
+
+	// the caller makes sure that the table is not full
+	void insert(unsigned int hash, int index)
+	{
+		signed char tag = hash & 0x7f;
+		unsigned int group_mask = groups.size() - 1;
+		unsigned int g = (hash >> 7) & group_mask;
+
+		for (unsigned int step = 1;; step++) {
+			group_t &group = groups[g];
+			unsigned int m = match_free(group);
+			if (m != 0) {
+				int i = lowest_bit(m);
+				if (group.ctrl[i] == ctrl_empty)
+					used++;
+				group.ctrl[i] = tag;
+				group.slots[i] = index;
+				return;
+			}
+			g = (g + step) & group_mask;
+		}
+	}
+
+	void erase(int slot)
+	{
+		group_t &group = groups[slot / group_size];
+		int i = slot % group_size;
+
+		// a probe never continues past a group with an empty slot, so in such a
+		// group the slot can be marked empty instead of deleted
+		if (match_tag(group, ctrl_empty) != 0) {
+			group.ctrl[i] = ctrl_empty;
+			used--;
+		} else
+			group.ctrl[i] = ctrl_deleted;
+		group.slots[i] = -1;
+	}
+};
+
+template<typename K, typename T, typename OPS>
+class flat_dict
+{
+	std::vector<std::pair<K, T>> entries;
+	flat_index index;
+	OPS ops;
+
+#ifdef NDEBUG
+	static inline void do_assert(bool) { }
+#else
+	static inline void do_assert(bool cond) {
+		if (!cond) throw std::runtime_error("flat_dict<> assert failed.");
+	}
+#endif
+
+	unsigned int do_hash(const K &key) const
+	{
+		return flat_index::mix(ops.hash(key));
+	}
+
+	void do_rehash(int capacity)
+	{
+		index.reset(capacity);
+		for (int i = 0; i < int(entries.size()); i++)
+			index.insert(do_hash(entries[i].first), i);
+	}
+
+	int do_lookup_slot(const K &key, unsigned int hash) const
+	{
+		return index.find_slot(hash, [&](int i) { return ops.cmp(entries[i].first, key); });
+	}
+
+	int do_lookup(const K &key, unsigned int hash) const
+	{
+		return index.find(hash, [&](int i) { return ops.cmp(entries[i].first, key); });
+	}
+
+	int do_insert(std::pair<K, T> &&value, unsigned int hash)
+	{
+		if (index.full())
+			do_rehash(flat_index::capacity_for(2 * (entries.size() + 1)));
+		entries.push_back(std::move(value));
+		index.insert(hash, entries.size() - 1);
+		return entries.size() - 1;
+	}
+
+	int do_erase(int slot)
+	{
+		if (slot < 0)
+			return 0;
+
+		int i = index.entry(slot);
+		index.erase(slot);
+
+		int back_idx = entries.size() - 1;
+
+		if (i != back_idx) {
+			slot = index.find_slot(do_hash(entries[back_idx].first), [&](int k) { return k == back_idx; });
+			do_assert(slot >= 0);
+			index.entry(slot) = i;
+			entries[i] = std::move(entries[back_idx]);
+		}
+
+		entries.pop_back();
+
+		if (entries.empty())
+			index.clear();
+
+		return 1;
+	}
+
+public:
+	class const_iterator : public std::iterator<std::forward_iterator_tag, std::pair<K, T>>
+	{
+		friend class flat_dict;
+	protected:
+		const flat_dict *ptr;
+		int index;
+		const_iterator(const flat_dict *ptr, int index) : ptr(ptr), index(index) { }
+	public:
+		const_iterator() { }
+		const_iterator operator++() { index--; return *this; }
+		bool operator<(const const_iterator &other) const { return index > other.index; }
+		bool operator==(const const_iterator &other) const { return index == other.index; }
+		bool operator!=(const const_iterator &other) const { return index != other.index; }
+		const std::pair<K, T> &operator*() const { return ptr->entries[index]; }
+		const std::pair<K, T> *operator->() const { return &ptr->entries[index]; }
+	};
+
+	class iterator : public std::iterator<std::forward_iterator_tag, std::pair<K, T>>
+	{
+		friend class flat_dict;
+	protected:
+		flat_dict *ptr;
+		int index;
+		iterator(flat_dict *ptr, int index) : ptr(ptr), index(index) { }
+	public:
+		iterator() { }
+		iterator operator++() { index--; return *this; }
+		bool operator<(const iterator &other) const { return index > other.index; }
+		bool operator==(const iterator &other) const { return index == other.index; }
+		bool operator!=(const iterator &other) const { return index != other.index; }
+		std::pair<K, T> &operator*() { return ptr->entries[index]; }
+		std::pair<K, T> *operator->() { return &ptr->entries[index]; }
+		const std::pair<K, T> &operator*() const { return ptr->entries[index]; }
+		const std::pair<K, T> *operator->() const { return &ptr->entries[index]; }
+		operator const_iterator() const { return const_iterator(ptr, index); }
+	};
+
+	flat_dict()
+	{
+	}
+
+	flat_dict(const flat_dict &other) : entries(other.entries), index(other.index)
+	{
+	}
+
+	flat_dict(flat_dict &&other)
+	{
+		swap(other);
+	}
+
+	flat_dict &operator=(const flat_dict &other) {
+		entries = other.entries;
+		index = other.index;
+		return *this;
+	}
+
+	flat_dict &operator=(flat_dict &&other) {
+		clear();
+		swap(other);
+		return *this;
+	}
+
+	flat_dict(const std::initializer_list<std::pair<K, T>> &list)
+	{
+		for (auto &it : list)
+			insert(it);
+	}
+
+	template<class InputIterator>
+	flat_dict(InputIterator first, InputIterator last)
+	{
+		insert(first, last);
+	}
+
+	template<class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	std::pair<iterator, bool> insert(const K &key)
+	{
+		unsigned int hash = do_hash(key);
+		int i = do_lookup(key, hash);
+		if (i >= 0)
+			return std::pair<iterator, bool>(iterator(this, i), false);
+		i = do_insert(std::pair<K, T>(key, T()), hash);
+		return std::pair<iterator, bool>(iterator(this, i), true);
+	}
+
+	std::pair<iterator, bool> insert(const std::pair<K, T> &value)
+	{
+		unsigned int hash = do_hash(value.first);
+		int i = do_lookup(value.first, hash);
+		if (i >= 0)
+			return std::pair<iterator, bool>(iterator(this, i), false);
+		i = do_insert(std::pair<K, T>(value), hash);
+		return std::pair<iterator, bool>(iterator(this, i), true);
+	}
+
+	int erase(const K &key)
+	{
+		return do_erase(do_lookup_slot(key, do_hash(key)));
+	}
+
+	iterator erase(iterator it)
+	{
+		int i = it.index;
+		do_erase(index.find_slot(do_hash(it->first), [&](int k) { return k == i; }));
+		return ++it;
+	}
+
+	int count(const K &key) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		return i < 0 ? 0 : 1;
+	}
+
+	int count(const K &key, const_iterator it) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		return i < 0 || i > it.index ? 0 : 1;
+	}
+
+	iterator find(const K &key)
+	{
+		int i = do_lookup(key, do_hash(key));
+		if (i < 0)
+			return end();
+		return iterator(this, i);
+	}
+
+	const_iterator find(const K &key) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		if (i < 0)
+			return end();
+		return const_iterator(this, i);
+	}
+
+	T& at(const K &key)
+	{
+		int i = do_lookup(key, do_hash(key));
+		if (i < 0)
+			throw std::out_of_range("flat_dict::at()");
+		return entries[i].second;
+	}
+
+	const T& at(const K &key) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		if (i < 0)
+			throw std::out_of_range("flat_dict::at()");
+		return entries[i].second;
+	}
+
+	T at(const K &key, const T &defval) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		if (i < 0)
+			return defval;
+		return entries[i].second;
+	}
+
+	T& operator[](const K &key)
+	{
+		unsigned int hash = do_hash(key);
+		int i = do_lookup(key, hash);
+		if (i < 0)
+			i = do_insert(std::pair<K, T>(key, T()), hash);
+		return entries[i].second;
+	}
+
+	template<typename Compare = std::less<K>>
+	void sort(Compare comp = Compare())
+	{
+		std::sort(entries.begin(), entries.end(), [comp](const std::pair<K, T> &a, const std::pair<K, T> &b){ return comp(b.first, a.first); });
+		do_rehash(index.capacity());
+	}
+
+	void swap(flat_dict &other)
+	{
+		entries.swap(other.entries);
+		index.swap(other.index);
+	}
+
+	bool operator==(const flat_dict &other) const {
+		if (size() != other.size())
+			return false;
+		for (auto &it : entries) {
+			auto oit = other.find(it.first);
+			if (oit == other.end() || !(oit->second == it.second))
+				return false;
+		}
+		return true;
+	}
+
+	bool operator!=(const flat_dict &other) const {
+		return !operator==(other);
+	}
+
+	void reserve(size_t n) {
+		entries.reserve(n);
+		if (index.capacity() < flat_index::capacity_for(n))
+			do_rehash(flat_index::capacity_for(n));
+	}
+
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+	void clear() { index.clear(); entries.clear(); }
+
+	iterator begin() { return iterator(this, int(entries.size())-1); }
+	iterator end() { return iterator(nullptr, -1); }
+
+	const_iterator begin() const { return const_iterator(this, int(entries.size())-1); }
+	const_iterator end() const { return const_iterator(nullptr, -1); }
+};
+
+template<typename K, typename OPS>
+class flat_pool
+{
+	std::vector<K> entries;
+	flat_index index;
+	OPS ops;
+
+#ifdef NDEBUG
+	static inline void do_assert(bool) { }
+#else
+	static inline void do_assert(bool cond) {
+		if (!cond) throw std::runtime_error("flat_pool<> assert failed.");
+	}
+#endif
+
+	unsigned int do_hash(const K &key) const
+	{
+		return flat_index::mix(ops.hash(key));
+	}
+
+	void do_rehash(int capacity)
+	{
+		index.reset(capacity);
+		for (int i = 0; i < int(entries.size()); i++)
+			index.insert(do_hash(entries[i]), i);
+	}
+
+	int do_lookup_slot(const K &key, unsigned int hash) const
+	{
+		return index.find_slot(hash, [&](int i) { return ops.cmp(entries[i], key); });
+	}
+
+	int do_lookup(const K &key, unsigned int hash) const
+	{
+		return index.find(hash, [&](int i) { return ops.cmp(entries[i], key); });
+	}
+
+	int do_insert(const K &value, unsigned int hash)
+	{
+		if (index.full())
+			do_rehash(flat_index::capacity_for(2 * (entries.size() + 1)));
+		entries.push_back(value);
+		index.insert(hash, entries.size() - 1);
+		return entries.size() - 1;
+	}
+
+	int do_erase(int slot)
+	{
+		if (slot < 0)
+			return 0;
+
+		int i = index.entry(slot);
+		index.erase(slot);
+
+		int back_idx = entries.size() - 1;
+
+		if (i != back_idx) {
+			slot = index.find_slot(do_hash(entries[back_idx]), [&](int k) { return k == back_idx; });
+			do_assert(slot >= 0);
+			index.entry(slot) = i;
+			entries[i] = std::move(entries[back_idx]);
+		}
+
+		entries.pop_back();
+
+		if (entries.empty())
+			index.clear();
+
+		return 1;
+	}
+
+public:
+	class const_iterator : public std::iterator<std::forward_iterator_tag, K>
+	{
+		friend class flat_pool;
+	protected:
+		const flat_pool *ptr;
+		int index;
+		const_iterator(const flat_pool *ptr, int index) : ptr(ptr), index(index) { }
+	public:
+		const_iterator() { }
+		const_iterator operator++() { index--; return *this; }
+		bool operator==(const const_iterator &other) const { return index == other.index; }
+		bool operator!=(const const_iterator &other) const { return index != other.index; }
+		const K &operator*() const { return ptr->entries[index]; }
+		const K *operator->() const { return &ptr->entries[index]; }
+	};
+
+	class iterator : public std::iterator<std::forward_iterator_tag, K>
+	{
+		friend class flat_pool;
+	protected:
+		flat_pool *ptr;
+		int index;
+		iterator(flat_pool *ptr, int index) : ptr(ptr), index(index) { }
+	public:
+		iterator() { }
+		iterator operator++() { index--; return *this; }
+		bool operator==(const iterator &other) const { return index == other.index; }
+		bool operator!=(const iterator &other) const { return index != other.index; }
+		K &operator*() { return ptr->entries[index]; }
+		K *operator->() { return &ptr->entries[index]; }
+		const K &operator*() const { return ptr->entries[index]; }
+		const K *operator->() const { return &ptr->entries[index]; }
+		operator const_iterator() const { return const_iterator(ptr, index); }
+	};
+
+	flat_pool()
+	{
+	}
+
+	flat_pool(const flat_pool &other) : entries(other.entries), index(other.index)
+	{
+	}
+
+	flat_pool(flat_pool &&other)
+	{
+		swap(other);
+	}
+
+	flat_pool &operator=(const flat_pool &other) {
+		entries = other.entries;
+		index = other.index;
+		return *this;
+	}
+
+	flat_pool &operator=(flat_pool &&other) {
+		clear();
+		swap(other);
+		return *this;
+	}
+
+	flat_pool(const std::initializer_list<K> &list)
+	{
+		for (auto &it : list)
+			insert(it);
+	}
+
+	template<class InputIterator>
+	flat_pool(InputIterator first, InputIterator last)
+	{
+		insert(first, last);
+	}
+
+	template<class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	std::pair<iterator, bool> insert(const K &value)
+	{
+		unsigned int hash = do_hash(value);
+		int i = do_lookup(value, hash);
+		if (i >= 0)
+			return std::pair<iterator, bool>(iterator(this, i), false);
+		i = do_insert(value, hash);
+		return std::pair<iterator, bool>(iterator(this, i), true);
+	}
+
+	int erase(const K &key)
+	{
+		return do_erase(do_lookup_slot(key, do_hash(key)));
+	}
+
+	iterator erase(iterator it)
+	{
+		int i = it.index;
+		do_erase(index.find_slot(do_hash(*it), [&](int k) { return k == i; }));
+		return ++it;
+	}
+
+	int count(const K &key) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		return i < 0 ? 0 : 1;
+	}
+
+	int count(const K &key, const_iterator it) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		return i < 0 || i > it.index ? 0 : 1;
+	}
+
+	iterator find(const K &key)
+	{
+		int i = do_lookup(key, do_hash(key));
+		if (i < 0)
+			return end();
+		return iterator(this, i);
+	}
+
+	const_iterator find(const K &key) const
+	{
+		int i = do_lookup(key, do_hash(key));
+		if (i < 0)
+			return end();
+		return const_iterator(this, i);
+	}
+
+	bool operator[](const K &key)
+	{
+		return do_lookup(key, do_hash(key)) >= 0;
+	}
+
+	template<typename Compare = std::less<K>>
+	void sort(Compare comp = Compare())
+	{
+		std::sort(entries.begin(), entries.end(), [comp](const K &a, const K &b){ return comp(b, a); });
+		do_rehash(index.capacity());
+	}
+
+	K pop()
+	{
+		iterator it = begin();
+		K ret = *it;
+		erase(it);
+		return ret;
+	}
+
+	void swap(flat_pool &other)
+	{
+		entries.swap(other.entries);
+		index.swap(other.index);
+	}
+
+	bool operator==(const flat_pool &other) const {
+		if (size() != other.size())
+			return false;
+		for (auto &it : entries)
+			if (!other.count(it))
+				return false;
+		return true;
+	}
+
+	bool operator!=(const flat_pool &other) const {
+		return !operator==(other);
+	}
+
+	unsigned int hash() const {
+		unsigned int hashval = mkhash_init;
+		for (auto &it : entries)
+			hashval ^= ops.hash(it);
+		return hashval;
+	}
+
+	void reserve(size_t n) {
+		entries.reserve(n);
+		if (index.capacity() < flat_index::capacity_for(n))
+			do_rehash(flat_index::capacity_for(n));
+	}
+
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+	void clear() { index.clear(); entries.clear(); }
+
+	iterator begin() { return iterator(this, int(entries.size())-1); }
+	iterator end() { return iterator(nullptr, -1); }
+
+	const_iterator begin() const { return const_iterator(this, int(entries.size())-1); }
+	const_iterator end() const { return const_iterator(nullptr, -1); }
+};
+
 } /* namespace hashlib */
 
 #endif
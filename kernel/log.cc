@@ -18,6 +18,7 @@
  */
 
 #include "kernel/yosys.h"
+#include "kernel/threading.h"
 #include "libs/sha1/sha1.h"
 #include "backends/ilang/ilang_backend.h"
 
@@ -49,6 +50,7 @@ FILE *log_errfile = NULL;
 SHA1 *log_hasher = NULL;
 
 bool log_time = false;
+bool log_mem_stats = false;
 bool log_error_stderr = false;
 bool log_cmd_error_throw = false;
 bool log_quiet_warnings = false;
@@ -60,6 +62,7 @@ vector<int> header_count;
 pool<RTLIL::IdString> log_id_cache;
 vector<shared_str> string_buf;
 int string_buf_index = -1;
+thread_local LogCapture *log_capture = nullptr;
 
 static struct timeval initial_tv = { 0, 0 };
 static bool next_print_log = false;
@@ -97,6 +100,11 @@ void logv(const char *format, va_list ap)
 	if (str.empty())
 		return;
 
+	if (log_capture) {
+		log_capture->entries.push_back({LogCapture::Message, "", str});
+		return;
+	}
+
 	size_t nnl_pos = str.find_last_not_of('\n');
 	if (nnl_pos == std::string::npos)
 		log_newline_count += GetSize(str);
@@ -209,6 +217,11 @@ static void logv_warning_with_prefix(const char *prefix,
 	std::string message = vstringf(format, ap);
 	bool suppressed = false;
 
+	if (log_capture) {
+		log_capture->entries.push_back({LogCapture::Warning, prefix, message});
+		return;
+	}
+
 	for (auto &re : log_nowarn_regexes)
 		if (std::regex_search(message, re))
 			suppressed = true;
@@ -271,6 +284,11 @@ YS_ATTRIBUTE(noreturn)
 static void logv_error_with_prefix(const char *prefix,
                                    const char *format, va_list ap)
 {
+	if (log_capture) {
+		log_capture->entries.push_back({LogCapture::Error, prefix, vstringf(format, ap)});
+		throw log_capture_error_exception();
+	}
+
 #ifdef EMSCRIPTEN
 	auto backup_log_files = log_files;
 #endif
@@ -359,6 +377,11 @@ void log_cmd_error(const char *format, ...)
 	va_list ap;
 	va_start(ap, format);
 
+	if (log_capture) {
+		log_capture->entries.push_back({LogCapture::CmdError, "", vstringf(format, ap)});
+		throw log_capture_error_exception();
+	}
+
 	if (log_cmd_error_throw) {
 		log_last_error = vstringf(format, ap);
 		log("ERROR: %s", log_last_error.c_str());
@@ -369,8 +392,56 @@ void log_cmd_error(const char *format, ...)
 	logv_error(format, ap);
 }
 
+static void log_warning_with_prefix(const char *prefix, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	logv_warning_with_prefix(prefix, format, ap);
+	va_end(ap);
+}
+
+YS_ATTRIBUTE(noreturn)
+static void log_error_with_prefix(const char *prefix, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	logv_error_with_prefix(prefix, format, ap);
+}
+
+void LogCapture::replay(const std::function<std::string(const std::string&)> &filter) const
+{
+	log_assert(log_capture != this);
+
+	for (auto &entry : entries)
+	{
+		std::string text = filter ? filter(entry.text) : entry.text;
+
+		switch (entry.kind)
+		{
+		case Message:
+			log("%s", text.c_str());
+			break;
+		case Spacer:
+			log_spacer();
+			break;
+		case Warning:
+			log_warning_with_prefix(entry.prefix.c_str(), "%s", text.c_str());
+			break;
+		case Error:
+			log_error_with_prefix(entry.prefix.c_str(), "%s", text.c_str());
+		case CmdError:
+			log_cmd_error("%s", text.c_str());
+		}
+	}
+}
+
 void log_spacer()
 {
+	if (log_capture) {
+		log_capture->entries.push_back({LogCapture::Spacer, "", ""});
+		return;
+	}
+
 	if (log_newline_count < 2) log("\n");
 	if (log_newline_count < 2) log("\n");
 }
@@ -498,6 +569,9 @@ void log_reset_stack()
 
 void log_flush()
 {
+	if (log_capture)
+		return;
+
 	for (auto f : log_files)
 		fflush(f);
 
@@ -513,20 +587,31 @@ void log_dump_val_worker(RTLIL::SigSpec v) {
 	log("%s", log_signal(v));
 }
 
+static const char *log_string_buf(vector<shared_str> &buf, int &buf_index, const std::string &str)
+{
+	if (buf.size() < 100) {
+		buf.push_back(str);
+		return buf.back().c_str();
+	} else {
+		if (++buf_index == 100)
+			buf_index = 0;
+		buf[buf_index] = str;
+		return buf[buf_index].c_str();
+	}
+}
+
+static const char *log_string_buf(const std::string &str)
+{
+	if (log_capture)
+		return log_string_buf(log_capture->string_buf, log_capture->string_buf_index, str);
+	return log_string_buf(string_buf, string_buf_index, str);
+}
+
 const char *log_signal(const RTLIL::SigSpec &sig, bool autoint)
 {
 	std::stringstream buf;
 	ILANG_BACKEND::dump_sigspec(buf, sig, autoint);
-
-	if (string_buf.size() < 100) {
-		string_buf.push_back(buf.str());
-		return string_buf.back().c_str();
-	} else {
-		if (++string_buf_index == 100)
-			string_buf_index = 0;
-		string_buf[string_buf_index] = buf.str();
-		return string_buf[string_buf_index].c_str();
-	}
+	return log_string_buf(buf.str());
 }
 
 const char *log_const(const RTLIL::Const &value, bool autoint)
@@ -534,22 +619,15 @@ const char *log_const(const RTLIL::Const &value, bool autoint)
 	if ((value.flags & RTLIL::CONST_FLAG_STRING) == 0)
 		return log_signal(value, autoint);
 
-	std::string str = "\"" + value.decode_string() + "\"";
-
-	if (string_buf.size() < 100) {
-		string_buf.push_back(str);
-		return string_buf.back().c_str();
-	} else {
-		if (++string_buf_index == 100)
-			string_buf_index = 0;
-		string_buf[string_buf_index] = str;
-		return string_buf[string_buf_index].c_str();
-	}
+	return log_string_buf("\"" + value.decode_string() + "\"");
 }
 
 const char *log_id(RTLIL::IdString str)
 {
-	log_id_cache.insert(str);
+	if (log_capture)
+		log_capture->id_cache.insert(str);
+	else
+		log_id_cache.insert(str);
 	const char *p = str.c_str();
 	if (p[0] != '\\')
 		return p;
@@ -588,7 +666,11 @@ void log_wire(RTLIL::Wire *wire, std::string indent)
 
 dict<std::string, std::pair<std::string, int>> extra_coverage_data;
 
+// cover_list() is also used in the workers of parallel_for_modules()
+static std::mutex extra_coverage_mutex;
+
 void cover_extra(std::string parent, std::string id, bool increment) {
+	std::lock_guard<std::mutex> lock(extra_coverage_mutex);
 	if (extra_coverage_data.count(id) == 0) {
 		for (CoverData *p = __start_yosys_cover_list; p != __stop_yosys_cover_list; p++)
 			if (p->id == parent)
@@ -57,6 +57,7 @@ extern FILE *log_errfile;
 extern SHA1 *log_hasher;
 
 extern bool log_time;
+extern bool log_mem_stats;
 extern bool log_error_stderr;
 extern bool log_cmd_error_throw;
 extern bool log_quiet_warnings;
@@ -86,6 +87,12 @@ void log_spacer();
 void log_push();
 void log_pop();
 
+// While a capture is installed for the current thread, all log output of that thread
+// is stored in the capture instead of being written to the log (see kernel/threading.h).
+struct LogCapture;
+struct log_capture_error_exception { };
+extern thread_local LogCapture *log_capture;
+
 void log_backtrace(const char *prefix, int levels);
 void log_reset_stack();
 void log_flush();
@@ -125,7 +132,7 @@ static inline void log_assert_worker(bool cond, const char *expr, const char *fi
 
 #define cover(_id) do { \
     static CoverData __d __attribute__((section("yosys_cover_list"), aligned(1), used)) = { __FILE__, __FUNCTION__, _id, __LINE__, 0 }; \
-    __d.counter++; \
+    __atomic_fetch_add(&__d.counter, 1, __ATOMIC_RELAXED); \
 } while (0)
 
 struct CoverData {
@@ -201,8 +201,7 @@ struct Macc
 
 	bool eval(RTLIL::Const &result) const
 	{
-		for (auto &bit : result.bits)
-			bit = RTLIL::S0;
+		result.bits.assign(GetSize(result.bits), RTLIL::S0);
 
 		for (auto &port : ports)
 		{
@@ -0,0 +1,96 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/mapfile.h"
+
+#include <iterator>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+MappedFile::MappedFile() : data(nullptr), size(0), mapping(nullptr)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+void MappedFile::close()
+{
+#ifndef _WIN32
+	if (mapping != nullptr)
+		munmap(mapping, size);
+#endif
+	mapping = nullptr;
+	buffer.clear();
+	data = nullptr;
+	size = 0;
+}
+
+bool MappedFile::map(const std::string &filename)
+{
+	close();
+
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			::close(fd);
+			mapping = p;
+			data = (const char*)p;
+			size = st.st_size;
+			return true;
+		}
+	}
+	::close(fd);
+#endif
+
+	return false;
+}
+
+void MappedFile::read(std::istream &f)
+{
+	close();
+
+	buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	data = buffer.data();
+	size = buffer.size();
+}
+
+void MappedFile::open(std::istream *f, const std::string &filename)
+{
+	if (dynamic_cast<std::ifstream*>(f) != nullptr && map(filename))
+		return;
+	read(*f);
+}
+
+YOSYS_NAMESPACE_END
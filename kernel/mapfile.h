@@ -0,0 +1,61 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+YOSYS_NAMESPACE_BEGIN
+
+// The contents of an input file in one contiguous buffer, for frontends that tokenize
+// their input in place. Regular files are mapped into memory, everything else (here
+// documents, stdin, systems without mmap) is read into a buffer.
+
+struct MappedFile
+{
+	const char *data;
+	size_t size;
+
+	MappedFile();
+	~MappedFile();
+
+	// map the file, returns false if it can't be mapped
+	bool map(const std::string &filename);
+
+	// read the whole stream into memory
+	void read(std::istream &f);
+
+	// map the file if the stream was opened from it by Frontend::extra_args(), read the
+	// stream otherwise
+	void open(std::istream *f, const std::string &filename);
+
+	void close();
+
+private:
+	void *mapping;
+	std::string buffer;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile &operator=(const MappedFile&) = delete;
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/modtools.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+size_t ModIndex::cache_limit = getenv("YOSYS_MODINDEX_CACHE") ? atol(getenv("YOSYS_MODINDEX_CACHE")) : 4 << 20;
+
+namespace {
+	// the modules with a cached index. cached() may be called from the workers of
+	// parallel_for_modules(), each for its own module.
+	std::mutex cache_mutex;
+	pool<RTLIL::Module*> cached_modules;
+	std::atomic<int> cache_clock(0);
+}
+
+ModIndex &ModIndex::cached(RTLIL::Module *module)
+{
+	if (module->modindex_ == nullptr) {
+		module->modindex_ = new ModIndex(module);
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		cached_modules.insert(module);
+	}
+
+	// callers may use the sigmap member directly, so bring it up to date now
+	// instead of waiting for the next query()
+	ModIndex *index = module->modindex_;
+	if (index->auto_reload_module)
+		index->reload_module();
+	index->auto_reload_counter = 0;
+	index->cache_stamp = ++cache_clock;
+	index->cache_pin_depth = std::min(index->cache_pin_depth, Pass::running_depth);
+	return *index;
+}
+
+void ModIndex::free_cached(RTLIL::Module *module)
+{
+	delete module->modindex_;
+	module->modindex_ = nullptr;
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	cached_modules.erase(module);
+}
+
+void ModIndex::trim_cache()
+{
+	size_t total = 0;
+	std::vector<std::pair<int, RTLIL::Module*>> by_age;
+
+	for (auto module : cached_modules) {
+		ModIndex *index = module->modindex_;
+		total += index->database.size();
+		// a pass that requested the index and its callers may still use it
+		if (index->cache_pin_depth <= Pass::running_depth)
+			continue;
+		index->cache_pin_depth = INT_MAX;
+		by_age.push_back(std::make_pair(index->cache_stamp, module));
+	}
+
+	if (total <= cache_limit)
+		return;
+
+	std::sort(by_age.begin(), by_age.end());
+
+	for (auto &it : by_age) {
+		if (total <= cache_limit)
+			break;
+		total -= it.second->modindex_->database.size();
+		free_cached(it.second);
+	}
+}
+
+YOSYS_NAMESPACE_END
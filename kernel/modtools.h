@@ -77,6 +77,10 @@ struct ModIndex : public RTLIL::Monitor
 	std::map<RTLIL::SigBit, SigBitInfo> database;
 	int auto_reload_counter;
 	bool auto_reload_module;
+	int cache_stamp;
+	// the lowest Pass::running_depth at which cached() returned the index since it was last
+	// unpinned. the passes at this depth and the passes that called them may still use it.
+	int cache_pin_depth;
 
 	void port_add(RTLIL::Cell *cell, RTLIL::IdString port, const RTLIL::SigSpec &sig)
 	{
@@ -176,20 +180,26 @@ struct ModIndex : public RTLIL::Monitor
 		if (auto_reload_module)
 			return;
 
+		// Module::connect() drops constant lhs bits and reports the remaining bits again
+		if (sigsig.first.has_const())
+			return;
+
 		for (int i = 0; i < GetSize(sigsig.first); i++)
 		{
-			RTLIL::SigBit lhs = sigmap(sigsig.first[i]);
-			RTLIL::SigBit rhs = sigmap(sigsig.second[i]);
+			// add the original bits so that sigmap stays identical to SigMap(module)
+			RTLIL::SigBit lhs_orig = sigsig.first[i], rhs_orig = sigsig.second[i];
+			RTLIL::SigBit lhs = sigmap(lhs_orig);
+			RTLIL::SigBit rhs = sigmap(rhs_orig);
 			bool has_lhs = database.count(lhs) != 0;
 			bool has_rhs = database.count(rhs) != 0;
 
 			if (!has_lhs && !has_rhs) {
-				sigmap.add(lhs, rhs);
+				sigmap.add(lhs_orig, rhs_orig);
 			} else
 			if (!has_rhs) {
 				SigBitInfo new_info = database.at(lhs);
 				database.erase(lhs);
-				sigmap.add(lhs, rhs);
+				sigmap.add(lhs_orig, rhs_orig);
 				lhs = sigmap(lhs);
 				if (lhs.wire)
 					database[lhs] = new_info;
@@ -197,7 +207,7 @@ struct ModIndex : public RTLIL::Monitor
 			if (!has_lhs) {
 				SigBitInfo new_info = database.at(rhs);
 				database.erase(rhs);
-				sigmap.add(lhs, rhs);
+				sigmap.add(lhs_orig, rhs_orig);
 				rhs = sigmap(rhs);
 				if (rhs.wire)
 					database[rhs] = new_info;
@@ -206,7 +216,7 @@ struct ModIndex : public RTLIL::Monitor
 				new_info.merge(database.at(rhs));
 				database.erase(lhs);
 				database.erase(rhs);
-				sigmap.add(lhs, rhs);
+				sigmap.add(lhs_orig, rhs_orig);
 				rhs = sigmap(rhs);
 				if (rhs.wire)
 					database[rhs] = new_info;
@@ -230,6 +240,8 @@ struct ModIndex : public RTLIL::Monitor
 	{
 		auto_reload_counter = 0;
 		auto_reload_module = true;
+		cache_stamp = 0;
+		cache_pin_depth = INT_MAX;
 		module->monitors.insert(this);
 	}
 
@@ -238,6 +250,20 @@ struct ModIndex : public RTLIL::Monitor
 		module->monitors.erase(this);
 	}
 
+	// Returns the index owned by the module, creating it on first use. It is kept up to
+	// date through the monitor interface and reused by later passes, so a pass does not
+	// need to index the module again if nothing changed. It is reloaded after changes it
+	// can not track (see RTLIL::Module::invalidate_caches()). Do not keep the reference
+	// beyond the pass that requested it: after each pass trim_cache() frees the least
+	// recently used indices when all cached indices together exceed cache_limit bits,
+	// except the indices requested by passes that are still running.
+	static ModIndex &cached(RTLIL::Module *module);
+	static void free_cached(RTLIL::Module *module);
+	static void trim_cache();
+
+	// set with the environment variable YOSYS_MODINDEX_CACHE, default 4M bits
+	static size_t cache_limit;
+
 	SigBitInfo *query(RTLIL::SigBit bit)
 	{
 		if (auto_reload_module)
@@ -0,0 +1,327 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/profiler.h"
+#include "kernel/threading.h"
+#include "kernel/sigtools.h"
+#include "kernel/modtools.h"
+
+#include <chrono>
+#include <errno.h>
+
+#ifndef _WIN32
+#  include <sys/resource.h>
+#  include <unistd.h>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+std::vector<Profiler::Trace> Profiler::traces;
+
+namespace {
+	std::mutex file_mutex;
+	std::chrono::steady_clock::time_point start_time;
+
+	// the main thread is 0, the threads of the ThreadPool get the following numbers
+	std::atomic<int> next_tid(1);
+	thread_local int tid = -1;
+
+	int get_tid()
+	{
+		if (tid < 0)
+			tid = next_tid++;
+		return tid;
+	}
+
+	std::string json_string(const std::string &str)
+	{
+		std::string res = "\"";
+		for (char c : str) {
+			if (c == '"' || c == '\\')
+				res += std::string("\\") + c;
+			else if ((unsigned char)c < 0x20)
+				res += stringf("\\u%04x", c);
+			else
+				res += c;
+		}
+		return res + "\"";
+	}
+
+	// hash table entries need the key/value pair, a next link and a bucket
+	template<typename T>
+	size_t hashtable_bytes(const T &table)
+	{
+		return table.size() * (sizeof(*table.begin()) + 2 * sizeof(int));
+	}
+
+	size_t sigmap_bytes(const SigMap &sigmap)
+	{
+		// the key, a next link, a bucket and the parent link of each bit
+		return sigmap.database.size() * (sizeof(RTLIL::SigBit) + 3 * sizeof(int));
+	}
+
+	void count_design(RTLIL::Design *design, int &modules, int &cells)
+	{
+		const RTLIL::ModuleDict::base &design_modules = design->modules_;
+		modules = GetSize(design_modules);
+		cells = 0;
+		for (auto &it : design_modules)
+			cells += GetSize(it.second->cells_);
+	}
+}
+
+void Profiler::write_event(const std::string &event)
+{
+	std::lock_guard<std::mutex> lock(file_mutex);
+	for (auto &trace : traces) {
+		fprintf(trace.file, "%s\n%s", trace.first_event ? "" : ",", event.c_str());
+		trace.first_event = false;
+	}
+}
+
+int64_t Profiler::now_us()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+int64_t Profiler::peak_rss_kb()
+{
+#ifdef _WIN32
+	return 0;
+#else
+	struct rusage ru_buffer;
+	if (getrusage(RUSAGE_SELF, &ru_buffer) == -1)
+		return 0;
+#  ifdef __APPLE__
+	return ru_buffer.ru_maxrss / 1024;
+#  else
+	return ru_buffer.ru_maxrss;
+#  endif
+#endif
+}
+
+int64_t Profiler::current_rss_kb()
+{
+#ifdef __linux__
+	long long sz_total = 0, sz_resident = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f == nullptr)
+		return 0;
+	if (fscanf(f, "%lld %lld", &sz_total, &sz_resident) != 2)
+		sz_resident = 0;
+	fclose(f);
+	return sz_resident * (getpagesize() / 1024);
+#else
+	return 0;
+#endif
+}
+
+void Profiler::open_trace(const std::string &filename, bool main)
+{
+	FILE *f = fopen(filename.c_str(), "w");
+	if (f == nullptr)
+		log_cmd_error("Can't open profile file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+
+	std::lock_guard<std::mutex> lock(file_mutex);
+	fprintf(f, "[");
+	// all open traces use the same time base, from the first one that was opened
+	if (traces.empty())
+		start_time = std::chrono::steady_clock::now();
+	if (tid < 0)
+		tid = 0;
+
+	Trace trace;
+	trace.file = f;
+	trace.main = main;
+	trace.first_event = true;
+	traces.push_back(trace);
+}
+
+void Profiler::close_trace(int index)
+{
+	std::lock_guard<std::mutex> lock(file_mutex);
+	fprintf(traces[index].file, "\n]\n");
+	fclose(traces[index].file);
+	traces.erase(traces.begin() + index);
+}
+
+void Profiler::start(const std::string &filename)
+{
+	stop();
+	open_trace(filename, true);
+}
+
+void Profiler::stop()
+{
+	for (int i = 0; i < GetSize(traces); i++)
+		if (traces[i].main) {
+			close_trace(i);
+			return;
+		}
+}
+
+void Profiler::push_trace(const std::string &filename)
+{
+	open_trace(filename, false);
+}
+
+void Profiler::pop_trace()
+{
+	for (int i = GetSize(traces)-1; i >= 0; i--)
+		if (!traces[i].main) {
+			close_trace(i);
+			return;
+		}
+}
+
+void Profiler::close_all()
+{
+	while (!traces.empty())
+		close_trace(GetSize(traces)-1);
+}
+
+Profiler::Span::Span(RTLIL::Design *design, const std::vector<std::string> &args) : design(design)
+{
+	// the other modules may change while a worker of parallel_for_modules() runs,
+	// so commands called by a worker are only covered by the span of its module
+	if (!active() || args.empty() || in_parallel_worker())
+		return;
+
+	name = args[0];
+	this->args = args;
+	module = design->selected_active_module;
+	count_design(design, modules, cells);
+	begin_us = now_us();
+}
+
+Profiler::Span::~Span()
+{
+	if (!active() || name.empty())
+		return;
+
+	int64_t end_us = now_us();
+	int modules_after, cells_after;
+	count_design(design, modules_after, cells_after);
+	int64_t peak_rss = peak_rss_kb(), rss = current_rss_kb();
+
+	std::string command;
+	for (auto &arg : args)
+		command += (command.empty() ? "" : " ") + arg;
+
+	int pid = 1, t = get_tid();
+	std::string event = stringf("{\"name\":%s,\"cat\":\"pass\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,\"args\":{",
+			json_string(name).c_str(), pid, t, (long long)begin_us, (long long)(end_us - begin_us));
+	event += stringf("\"command\":%s,", json_string(command).c_str());
+	if (!module.empty())
+		event += stringf("\"module\":%s,", json_string(RTLIL::unescape_id(module)).c_str());
+	event += stringf("\"modules_before\":%d,\"modules_after\":%d,\"cells_before\":%d,\"cells_after\":%d,"
+			"\"peak_rss_kb\":%lld,\"rss_kb\":%lld}}", modules, modules_after, cells, cells_after,
+			(long long)peak_rss, (long long)rss);
+	write_event(event);
+
+	write_event(stringf("{\"name\":\"memory\",\"ph\":\"C\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"args\":{\"rss_kb\":%lld,\"peak_rss_kb\":%lld}}",
+			pid, t, (long long)end_us, (long long)rss, (long long)peak_rss));
+}
+
+void Profiler::module_span(RTLIL::Module *module, int64_t begin_us)
+{
+	if (!active())
+		return;
+
+	int64_t end_us = now_us();
+	write_event(stringf("{\"name\":%s,\"cat\":\"module\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,\"args\":{\"cells\":%d}}",
+			json_string(RTLIL::unescape_id(module->name.str())).c_str(), get_tid(), (long long)begin_us, (long long)(end_us - begin_us),
+			GetSize(module->cells_)));
+}
+
+MemoryUsage::MemoryUsage() : wires(0), cells(0), connections(0), attributes(0), consts(0), idstrings(0), caches(0)
+{
+}
+
+void MemoryUsage::add_attributes(const RTLIL::AttrObject *object)
+{
+	attributes += hashtable_bytes(object->attributes);
+	for (auto &it : object->attributes)
+		consts += it.second.bits.mem_usage();
+}
+
+void MemoryUsage::add_module(RTLIL::Module *module)
+{
+	add_attributes(module);
+
+	wires += hashtable_bytes(module->wires_) + GetSize(module->wires_) * sizeof(RTLIL::Wire);
+	for (auto &it : module->wires_)
+		add_attributes(it.second);
+
+	cells += hashtable_bytes(module->cells_) + GetSize(module->cells_) * sizeof(RTLIL::Cell);
+	for (auto &it : module->cells_) {
+		RTLIL::Cell *cell = it.second;
+		add_attributes(cell);
+		cells += hashtable_bytes(cell->parameters);
+		for (auto &param : cell->parameters)
+			consts += param.second.bits.mem_usage();
+		connections += hashtable_bytes(cell->connections_);
+		for (auto &conn : cell->connections_)
+			connections += conn.second.mem_usage();
+	}
+
+	connections += module->connections_.capacity() * sizeof(RTLIL::SigSig);
+	for (auto &conn : module->connections_)
+		connections += conn.first.mem_usage() + conn.second.mem_usage();
+
+	for (auto &it : module->memories)
+		add_attributes(it.second);
+	for (auto &it : module->processes)
+		add_attributes(it.second);
+
+	if (module->cached_sigmap() != nullptr)
+		caches += sigmap_bytes(*module->cached_sigmap());
+
+	if (module->modindex_ != nullptr) {
+		ModIndex *index = module->modindex_;
+		caches += sizeof(ModIndex) + sigmap_bytes(index->sigmap);
+		// std::map nodes have three links and a color next to the value
+		caches += index->database.size() * (4 * sizeof(void*) + sizeof(std::pair<RTLIL::SigBit, ModIndex::SigBitInfo>));
+		for (auto &it : index->database)
+			caches += hashtable_bytes(it.second.ports);
+	}
+}
+
+void MemoryUsage::add_design(RTLIL::Design *design)
+{
+	const RTLIL::ModuleDict::base &modules = design->modules_;
+	for (auto &it : modules)
+		add_module(it.second);
+	idstrings += RTLIL::IdString::mem_usage();
+}
+
+size_t MemoryUsage::total() const
+{
+	return wires + cells + connections + attributes + consts + idstrings + caches;
+}
+
+std::string MemoryUsage::summary() const
+{
+	const double mb = 1024.0 * 1024.0;
+	return stringf("wires %.1f MB, cells %.1f MB, connections %.1f MB, attributes %.1f MB, consts %.1f MB, "
+			"idstrings %.1f MB, caches %.1f MB", wires / mb, cells / mb, connections / mb,
+			attributes / mb, consts / mb, idstrings / mb, caches / mb);
+}
+
+YOSYS_NAMESPACE_END
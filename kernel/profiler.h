@@ -0,0 +1,119 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+YOSYS_NAMESPACE_BEGIN
+
+// The profiler writes a file in the Chrome trace event format that can be opened in
+// chrome://tracing or https://ui.perfetto.dev. Each command is a span that contains
+// the spans of the commands it calls, with the number of modules and cells before and
+// after the command and the peak RSS at its end. The calls of the worker for each module
+// in parallel_for_modules() are spans on the thread that ran them. The events are
+// written as soon as a span ends, so the file of an aborted run can still be opened.
+//
+// Started with the -P option of the yosys executable or the `profile` command. A trace of
+// a single command ("profile -o file cmd") is written in addition to the main trace, which
+// stays open and also gets the events of the command.
+
+struct Profiler
+{
+	// a command or module that is being profiled
+	struct Span
+	{
+		int64_t begin_us;
+		int modules, cells;
+		std::string name, module;
+		std::vector<std::string> args;
+
+		Span(RTLIL::Design *design, const std::vector<std::string> &args);
+		~Span();
+
+	private:
+		RTLIL::Design *design;
+	};
+
+	static bool active() { return !traces.empty(); }
+
+	// open and close the main trace
+	static void start(const std::string &filename);
+	static void stop();
+
+	// open and close the trace of a single command
+	static void push_trace(const std::string &filename);
+	static void pop_trace();
+
+	// close all traces, when yosys exits
+	static void close_all();
+
+	// a call of a parallel_for_modules() worker, from begin_us to now
+	static void module_span(RTLIL::Module *module, int64_t begin_us);
+
+	// microseconds since the start of the profile
+	static int64_t now_us();
+
+	// peak and current resident set size of the process in kB, or 0 if unknown
+	static int64_t peak_rss_kb();
+	static int64_t current_rss_kb();
+
+private:
+	struct Trace
+	{
+		FILE *file;
+		bool main, first_event;
+	};
+
+	// the main trace and the traces of the commands, in the order they were opened
+	static std::vector<Trace> traces;
+
+	static void open_trace(const std::string &filename, bool main);
+	static void close_trace(int index);
+	static void write_event(const std::string &event);
+};
+
+// An estimate of the heap memory held by the objects of a design, in bytes. The objects
+// are counted with their hash table entries. The Const payloads are the values of the
+// attributes and parameters, the caches are the SigMap and ModIndex kept by the modules.
+
+struct MemoryUsage
+{
+	size_t wires, cells, connections, attributes, consts, idstrings, caches;
+
+	MemoryUsage();
+
+	void add_module(RTLIL::Module *module);
+
+	// all modules of the design and the IdString cache
+	void add_design(RTLIL::Design *design);
+
+	size_t total() const;
+
+	// e.g. "wires 1.2 MB, cells 3.4 MB, ..."
+	std::string summary() const;
+
+private:
+	void add_attributes(const RTLIL::AttrObject *object);
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
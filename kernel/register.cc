@@ -19,6 +19,10 @@
 
 #include "kernel/yosys.h"
 #include "kernel/satgen.h"
+#include "kernel/modtools.h"
+#include "kernel/profiler.h"
+#include "kernel/rtlil_bin.h"
+#include "libs/sha1/sha1.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -32,6 +36,7 @@ YOSYS_NAMESPACE_BEGIN
 bool echo_mode = false;
 Pass *first_queued_pass;
 Pass *current_pass;
+int Pass::running_depth = 0;
 
 std::map<std::string, Frontend*> frontend_register;
 std::map<std::string, Pass*> pass_register;
@@ -45,6 +50,7 @@ Pass::Pass(std::string name, std::string short_help) : pass_name(name), short_he
 	first_queued_pass = this;
 	call_counter = 0;
 	runtime_ns = 0;
+	peak_rss_growth_kb = 0;
 }
 
 void Pass::run_register()
@@ -78,8 +84,10 @@ Pass::pre_post_exec_state_t Pass::pre_execute()
 	pre_post_exec_state_t state;
 	call_counter++;
 	state.begin_ns = PerformanceTimer::query();
+	state.begin_peak_rss_kb = Profiler::peak_rss_kb();
 	state.parent_pass = current_pass;
 	current_pass = this;
+	running_depth++;
 	clear_flags();
 	return state;
 }
@@ -87,10 +95,15 @@ Pass::pre_post_exec_state_t Pass::pre_execute()
 void Pass::post_execute(Pass::pre_post_exec_state_t state)
 {
 	int64_t time_ns = PerformanceTimer::query() - state.begin_ns;
+	int64_t growth_kb = Profiler::peak_rss_kb() - state.begin_peak_rss_kb;
 	runtime_ns += time_ns;
+	peak_rss_growth_kb += growth_kb;
 	current_pass = state.parent_pass;
-	if (current_pass)
+	running_depth--;
+	if (current_pass) {
 		current_pass->runtime_ns -= time_ns;
+		current_pass->peak_rss_growth_kb -= growth_kb;
+	}
 }
 
 void Pass::help()
@@ -227,6 +240,7 @@ void Pass::call(RTLIL::Design *design, std::vector<std::string> args)
 	if (pass_register.count(args[0]) == 0)
 		log_cmd_error("No such command: %s (type 'help' for a command overview)\n", args[0].c_str());
 
+	Profiler::Span span(design, args);
 	size_t orig_sel_stack_pos = design->selection_stack.size();
 	auto state = pass_register[args[0]]->pre_execute();
 	pass_register[args[0]]->execute(args, design);
@@ -234,6 +248,17 @@ void Pass::call(RTLIL::Design *design, std::vector<std::string> args)
 	while (design->selection_stack.size() > orig_sel_stack_pos)
 		design->selection_stack.pop_back();
 
+	ModIndex::trim_cache();
+
+	if (log_mem_stats && current_pass == nullptr) {
+		MemoryUsage usage;
+		usage.add_design(design);
+		int64_t peak_rss = Profiler::peak_rss_kb();
+		log("Memory after %s: RSS %.1f MB, peak %.1f MB (%+.1f MB), design ~%.1f MB (%s)\n", args[0].c_str(),
+				Profiler::current_rss_kb() / 1024.0, peak_rss / 1024.0, (peak_rss - state.begin_peak_rss_kb) / 1024.0,
+				usage.total() / 1024.0 / 1024.0, usage.summary().c_str());
+	}
+
 	design->check();
 }
 
@@ -287,6 +312,8 @@ void Pass::call_on_module(RTLIL::Design *design, RTLIL::Module *module, std::vec
 	design->selected_active_module = backup_selected_active_module;
 }
 
+std::string ScriptPass::cache_dir;
+
 bool ScriptPass::check_label(std::string label, std::string info)
 {
 	if (active_design == nullptr) {
@@ -305,7 +332,16 @@ bool ScriptPass::check_label(std::string label, std::string info)
 			if (label == active_run_to)
 				block_active = false;
 		}
-		return block_active;
+		if (cache_enabled && label != cache_label) {
+			if (cache_collect)
+				cache_label = label;
+			else {
+				cache_end_label();
+				if (block_active)
+					cache_begin_label(label);
+			}
+		}
+		return block_active && !cache_skip;
 	}
 }
 
@@ -316,7 +352,9 @@ void ScriptPass::run(std::string command, std::string info)
 			log("        %s\n", command.c_str());
 		else
 			log("        %s    %s\n", command.c_str(), info.c_str());
-	} else
+	} else if (cache_collect)
+		cache_commands[cache_label].push_back(command);
+	else if (!cache_skip)
 		Pass::call(active_design, command);
 }
 
@@ -324,10 +362,141 @@ void ScriptPass::run_script(RTLIL::Design *design, std::string run_from, std::st
 {
 	help_mode = false;
 	active_design = design;
-	block_active = run_from.empty();
 	active_run_from = run_from;
 	active_run_to = run_to;
+
+	cache_enabled = !cache_dir.empty() && design->full_selection();
+	cache_skip = false;
+	cache_label.clear();
+	cache_key.clear();
+	cache_state.clear();
+	cache_pending.clear();
+	cache_commands.clear();
+
+	// a dry run of the script collects the commands of each label
+	if (cache_enabled) {
+		cache_collect = true;
+		block_active = run_from.empty();
+		script();
+		cache_collect = false;
+		cache_label.clear();
+	}
+
+	block_active = run_from.empty();
 	script();
+
+	if (cache_enabled) {
+		cache_end_label();
+		cache_restore();
+		cache_enabled = false;
+	}
+}
+
+void ScriptPass::cache_begin_label(std::string label)
+{
+	cache_label = label;
+
+	std::vector<std::string> &commands = cache_commands[label];
+	if (commands.empty())
+		return;
+
+	// the key covers everything the result of the label depends on: the yosys version, the
+	// commands, the files named in their arguments and the design
+	SHA1 sha1;
+	sha1.update(stringf("%s\n", yosys_version_str));
+	for (auto &command : commands)
+	{
+		std::vector<std::string> args = split_tokens(command);
+		if (args.empty())
+			continue;
+
+		if (args[0].compare(0, 6, "write_") == 0 || args[0][0] == '!' || args[0] == "design" || args[0] == "tee" ||
+				args[0] == "shell" || args[0] == "cd" || args[0] == "script" || args[0] == "plugin") {
+			log("\nNot caching label `%s', command `%s' has effects outside the design.\n", label.c_str(), args[0].c_str());
+			cache_restore();
+			cache_state.clear();
+			return;
+		}
+
+		sha1.update(command + "\n");
+
+		// files in the share directory ("+/...") are covered by the version
+		for (int i = 1; i < GetSize(args); i++) {
+			std::string filename = args[i];
+			if (filename.compare(0, 2, "+/") == 0)
+				continue;
+			rewrite_filename(filename);
+			if (filename[0] != '-' && check_file_exists(filename))
+				sha1.update(stringf("%s %s\n", filename.c_str(), SHA1::from_file(filename).c_str()));
+		}
+	}
+
+	// after a label that was saved or restored, the key of that label stands for the
+	// design, so a chain of hits does not need to look at the design in between
+	if (cache_state.empty()) {
+		std::stringstream buffer;
+		RtlilBinWriter().write(buffer, active_design);
+		sha1.update(buffer.str());
+	} else
+		sha1.update(stringf("state %s\n", cache_state.c_str()));
+	cache_key = sha1.final();
+	cache_state = cache_key;
+
+	std::string filename = stringf("%s/%s.bin", cache_dir.c_str(), cache_key.c_str());
+	if (!check_file_exists(filename)) {
+		cache_restore();
+		return;
+	}
+
+	log("\nSkipping label `%s', the result is in script cache `%s'.\n", label.c_str(), filename.c_str());
+	cache_pending = filename;
+	cache_skip = true;
+}
+
+void ScriptPass::cache_end_label()
+{
+	if (!cache_key.empty() && !cache_skip)
+	{
+		// write to a temporary file first, so other processes never see partial entries
+		std::string filename = stringf("%s/%s.bin", cache_dir.c_str(), cache_key.c_str());
+		std::string temp_filename = make_temp_file(cache_dir + "/.yosys_XXXXXX");
+
+		std::ofstream f(temp_filename.c_str(), std::ofstream::trunc | std::ofstream::binary);
+		RtlilBinWriter().write(f, active_design);
+		f.close();
+
+		if (f.fail() || rename(temp_filename.c_str(), filename.c_str()) != 0) {
+			log_warning("Can't write script cache entry `%s': %s\n", filename.c_str(), strerror(errno));
+			remove(temp_filename.c_str());
+		} else
+			log("\nSaved the design after label `%s' to script cache `%s'.\n", cache_label.c_str(), filename.c_str());
+	}
+
+	cache_label.clear();
+	cache_key.clear();
+	cache_skip = false;
+}
+
+void ScriptPass::cache_restore()
+{
+	if (cache_pending.empty())
+		return;
+
+	log("\nRestoring the design from script cache `%s'.\n", cache_pending.c_str());
+
+	RtlilBinReader reader;
+	reader.open(cache_pending);
+	const RTLIL::ModuleDict::base &modules = active_design->modules_;
+	std::vector<RTLIL::Module*> old_modules;
+	for (auto &it : modules)
+		old_modules.push_back(it.second);
+	for (auto module : old_modules)
+		active_design->remove(module);
+	for (int i = 0; i < reader.num_modules(); i++)
+		active_design->add(reader.load_module(i));
+	autoidx = std::max(autoidx, reader.file_autoidx);
+
+	cache_pending.clear();
 }
 
 void ScriptPass::help_script()
@@ -377,7 +546,7 @@ void Frontend::execute(std::vector<std::string> args, RTLIL::Design *design)
 FILE *Frontend::current_script_file = NULL;
 std::string Frontend::last_here_document;
 
-void Frontend::extra_args(std::istream *&f, std::string &filename, std::vector<std::string> args, size_t argidx)
+void Frontend::extra_args(std::istream *&f, std::string &filename, std::vector<std::string> args, size_t argidx, bool bin_input)
 {
 	bool called_with_fp = f != NULL;
 
@@ -427,7 +596,7 @@ void Frontend::extra_args(std::istream *&f, std::string &filename, std::vector<s
 				next_args.insert(next_args.end(), filenames.begin()+1, filenames.end());
 			}
 			std::ifstream *ff = new std::ifstream;
-			ff->open(filename.c_str());
+			ff->open(filename.c_str(), bin_input ? std::ifstream::binary : std::ifstream::in);
 			yosys_input_files.insert(filename);
 			if (ff->fail())
 				delete ff;
@@ -475,6 +644,7 @@ void Frontend::frontend_call(RTLIL::Design *design, std::istream *f, std::string
 	if (frontend_register.count(args[0]) == 0)
 		log_cmd_error("No such frontend: %s\n", args[0].c_str());
 
+	Profiler::Span span(design, args);
 	if (f != NULL) {
 		auto state = frontend_register[args[0]]->pre_execute();
 		frontend_register[args[0]]->execute(f, filename, args, design);
@@ -522,7 +692,7 @@ void Backend::execute(std::vector<std::string> args, RTLIL::Design *design)
 		delete f;
 }
 
-void Backend::extra_args(std::ostream *&f, std::string &filename, std::vector<std::string> args, size_t argidx)
+void Backend::extra_args(std::ostream *&f, std::string &filename, std::vector<std::string> args, size_t argidx, bool bin_output)
 {
 	bool called_with_fp = f != NULL;
 
@@ -543,7 +713,7 @@ void Backend::extra_args(std::ostream *&f, std::string &filename, std::vector<st
 
 		filename = arg;
 		std::ofstream *ff = new std::ofstream;
-		ff->open(filename.c_str(), std::ofstream::trunc);
+		ff->open(filename.c_str(), bin_output ? (std::ofstream::trunc | std::ofstream::binary) : std::ofstream::trunc);
 		yosys_output_files.insert(filename);
 		if (ff->fail()) {
 			delete ff;
@@ -580,6 +750,7 @@ void Backend::backend_call(RTLIL::Design *design, std::ostream *f, std::string f
 	if (backend_register.count(args[0]) == 0)
 		log_cmd_error("No such backend: %s\n", args[0].c_str());
 
+	Profiler::Span span(design, args);
 	size_t orig_sel_stack_pos = design->selection_stack.size();
 
 	if (f != NULL) {
@@ -37,9 +37,16 @@ struct Pass
 	int call_counter;
 	int64_t runtime_ns;
 
+	// growth of the peak RSS of the process while this pass (and not a pass called by it) ran
+	int64_t peak_rss_growth_kb;
+
+	// number of passes that are running, including the passes that called them
+	static int running_depth;
+
 	struct pre_post_exec_state_t {
 		Pass *parent_pass;
 		int64_t begin_ns;
+		int64_t begin_peak_rss_kb;
 	};
 
 	pre_post_exec_state_t pre_execute();
@@ -70,7 +77,11 @@ struct ScriptPass : Pass
 	RTLIL::Design *active_design;
 	std::string active_run_from, active_run_to;
 
-	ScriptPass(std::string name, std::string short_help = "** document me **") : Pass(name, short_help) { }
+	// directory of the cache for the results of labels, or empty (see 'help script_cache')
+	static std::string cache_dir;
+
+	ScriptPass(std::string name, std::string short_help = "** document me **") : Pass(name, short_help),
+			cache_enabled(false), cache_collect(false), cache_skip(false) { }
 
 	virtual void script() = 0;
 
@@ -78,6 +89,19 @@ struct ScriptPass : Pass
 	void run(std::string command, std::string info = std::string());
 	void run_script(RTLIL::Design *design, std::string run_from = std::string(), std::string run_to = std::string());
 	void help_script();
+
+private:
+	bool cache_enabled, cache_collect, cache_skip;
+	std::string cache_label, cache_key;
+	dict<std::string, std::vector<std::string>> cache_commands;
+
+	// the key the current design was saved or restored under, and the entry that still
+	// needs to be loaded into the design when the following labels are hits as well
+	std::string cache_state, cache_pending;
+
+	void cache_begin_label(std::string label);
+	void cache_end_label();
+	void cache_restore();
 };
 
 struct Frontend : Pass
@@ -94,7 +118,7 @@ struct Frontend : Pass
 	virtual void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) = 0;
 
 	static std::vector<std::string> next_args;
-	void extra_args(std::istream *&f, std::string &filename, std::vector<std::string> args, size_t argidx);
+	void extra_args(std::istream *&f, std::string &filename, std::vector<std::string> args, size_t argidx, bool bin_input = false);
 
 	static void frontend_call(RTLIL::Design *design, std::istream *f, std::string filename, std::string command);
 	static void frontend_call(RTLIL::Design *design, std::istream *f, std::string filename, std::vector<std::string> args);
@@ -109,7 +133,7 @@ struct Backend : Pass
 	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE YS_FINAL;
 	virtual void execute(std::ostream *&f, std::string filename,  std::vector<std::string> args, RTLIL::Design *design) = 0;
 
-	void extra_args(std::ostream *&f, std::string &filename, std::vector<std::string> args, size_t argidx);
+	void extra_args(std::ostream *&f, std::string &filename, std::vector<std::string> args, size_t argidx, bool bin_output = false);
 
 	static void backend_call(RTLIL::Design *design, std::ostream *f, std::string filename, std::string command);
 	static void backend_call(RTLIL::Design *design, std::ostream *f, std::string filename, std::vector<std::string> args);
@@ -20,6 +20,10 @@
 #include "kernel/yosys.h"
 #include "kernel/macc.h"
 #include "kernel/celltypes.h"
+#include "kernel/sigtools.h"
+#include "kernel/modtools.h"
+#include "kernel/threading.h"
+#include "kernel/rtlil_bin.h"
 #include "frontends/verilog/verilog_frontend.h"
 #include "backends/ilang/ilang_backend.h"
 
@@ -29,10 +33,520 @@
 YOSYS_NAMESPACE_BEGIN
 
 RTLIL::IdString::destruct_guard_t RTLIL::IdString::destruct_guard;
-std::vector<int> RTLIL::IdString::global_refcount_storage_;
-std::vector<char*> RTLIL::IdString::global_id_storage_;
-dict<char*, int, hash_cstr_ops> RTLIL::IdString::global_id_index_;
-std::vector<int> RTLIL::IdString::global_free_idx_list_;
+std::atomic<RTLIL::IdString::storage_t*> RTLIL::IdString::global_id_storage_[RTLIL::IdString::storage_max_chunks];
+int RTLIL::IdString::global_immortal_ids_;
+
+// The index of the id string cache is split into shards by hash. Each shard is an open
+// addressing hash table of ids. Readers probe the table without locking, all changes to a
+// shard are made with its mutex held. Removed ids and replaced tables are only freed when
+// no reader is active in the shard, so a reader never sees a freed string or table.
+
+namespace {
+	const int id_num_shards = 64;
+	const int id_slot_empty = -1;
+	const int id_slot_removed = -2;
+
+	struct IdTable {
+		int mask;
+		std::atomic<int> *slots;
+
+		IdTable(int size) : mask(size-1), slots(new std::atomic<int>[size]) {
+			for (int i = 0; i < size; i++)
+				slots[i].store(id_slot_empty, std::memory_order_relaxed);
+		}
+		~IdTable() {
+			delete[] slots;
+		}
+	};
+
+	struct IdShard {
+		std::mutex mutex;
+		std::atomic<int> readers;
+		std::atomic<IdTable*> table;
+		int used = 0, removed = 0;
+		int last_created = -1;
+		std::vector<int> free_idx, retired_idx, deferred_idx;
+		std::vector<IdTable*> retired_tables;
+
+		IdShard() : readers(0), table(new IdTable(64)) { }
+	};
+
+	// never destroyed, ids may still be released by destructors of other static objects
+	IdShard *id_shards = new IdShard[id_num_shards];
+	std::atomic<int> id_next_idx(0);
+	std::mutex id_chunk_mutex;
+
+	// only changed while no other thread uses the cache
+	bool id_defer_frees = false;
+	int id_defer_first_idx = 0;
+
+	inline IdShard &id_shard(unsigned int hash) {
+		return id_shards[mkhash_xorshift(hash) % id_num_shards];
+	}
+
+	// look up an id without locking the shard, returns -1 if not found or if the id is being removed
+	int id_lookup_unlocked(IdShard &shard, const char *p, unsigned int hash)
+	{
+		int found = -1;
+		shard.readers.fetch_add(1);
+
+		IdTable *table = shard.table.load(std::memory_order_acquire);
+		for (int i = hash & table->mask;; i = (i+1) & table->mask) {
+			int idx = table->slots[i].load();
+			if (idx == id_slot_empty)
+				break;
+			if (idx < 0)
+				continue;
+			RTLIL::IdString::storage_t &entry = RTLIL::IdString::storage(idx);
+			if (entry.hash.load(std::memory_order_relaxed) != hash || strcmp(entry.str.load(std::memory_order_relaxed), p) != 0)
+				continue;
+			if (idx < RTLIL::IdString::global_immortal_ids_) {
+				found = idx;
+				break;
+			}
+			int refcount = entry.refcount.load(std::memory_order_relaxed);
+			while (refcount > 0 && !entry.refcount.compare_exchange_weak(refcount, refcount+1, std::memory_order_relaxed)) { }
+			if (refcount > 0)
+				found = idx;
+			break;
+		}
+
+		shard.readers.fetch_sub(1);
+		return found;
+	}
+
+	// find the slot of an id in the current table, must be called with the shard mutex held
+	int id_find_slot(IdShard &shard, const char *p, unsigned int hash, int *insert_slot)
+	{
+		IdTable *table = shard.table.load(std::memory_order_relaxed);
+		for (int i = hash & table->mask;; i = (i+1) & table->mask) {
+			int idx = table->slots[i].load(std::memory_order_relaxed);
+			if (idx == id_slot_removed && insert_slot != nullptr && *insert_slot < 0)
+				*insert_slot = i;
+			if (idx == id_slot_empty) {
+				if (insert_slot != nullptr && *insert_slot < 0)
+					*insert_slot = i;
+				return -1;
+			}
+			if (idx < 0)
+				continue;
+			RTLIL::IdString::storage_t &entry = RTLIL::IdString::storage(idx);
+			if (entry.hash.load(std::memory_order_relaxed) == hash && strcmp(entry.str.load(std::memory_order_relaxed), p) == 0)
+				return i;
+		}
+	}
+
+	// free retired ids and tables if no reader is active, must be called with the shard mutex held
+	void id_collect_retired(IdShard &shard)
+	{
+		if (shard.readers.load() != 0)
+			return;
+
+		for (int idx : shard.retired_idx) {
+			RTLIL::IdString::storage_t &entry = RTLIL::IdString::storage(idx);
+			free(entry.str.load(std::memory_order_relaxed));
+			entry.str.store(nullptr, std::memory_order_relaxed);
+			shard.free_idx.push_back(idx);
+		}
+		shard.retired_idx.clear();
+
+		for (auto table : shard.retired_tables)
+			delete table;
+		shard.retired_tables.clear();
+	}
+
+	// remove an unused id from its shard, must be called with the shard mutex held
+	void id_remove(IdShard &shard, int idx)
+	{
+		RTLIL::IdString::storage_t &entry = RTLIL::IdString::storage(idx);
+		unsigned int hash = entry.hash.load(std::memory_order_relaxed);
+
+		IdTable *table = shard.table.load(std::memory_order_relaxed);
+		int slot = hash & table->mask;
+		while (table->slots[slot].load(std::memory_order_relaxed) != idx) {
+			if (table->slots[slot].load(std::memory_order_relaxed) == id_slot_empty)
+				return;
+			slot = (slot+1) & table->mask;
+		}
+
+		if (yosys_xtrace) {
+			log("#X# Removed IdString '%s' with index %d.\n", entry.str.load(std::memory_order_relaxed), idx);
+			log_backtrace("-X- ", yosys_xtrace-1);
+		}
+
+		table->slots[slot].store(id_slot_removed);
+		shard.used--;
+		shard.removed++;
+		shard.retired_idx.push_back(idx);
+	}
+
+	// rehash the shard into a table with room for at least one more id, must be called with the shard mutex held
+	void id_grow_table(IdShard &shard)
+	{
+		IdTable *old_table = shard.table.load(std::memory_order_relaxed);
+		int size = old_table->mask + 1;
+
+		while (4 * (shard.used + 1) > size)
+			size *= 2;
+
+		IdTable *new_table = new IdTable(size);
+		for (int i = 0; i <= old_table->mask; i++) {
+			int idx = old_table->slots[i].load(std::memory_order_relaxed);
+			if (idx < 0)
+				continue;
+			int j = RTLIL::IdString::storage(idx).hash.load(std::memory_order_relaxed) & new_table->mask;
+			while (new_table->slots[j].load(std::memory_order_relaxed) != id_slot_empty)
+				j = (j+1) & new_table->mask;
+			new_table->slots[j].store(idx, std::memory_order_relaxed);
+		}
+
+		shard.table.store(new_table, std::memory_order_release);
+		shard.retired_tables.push_back(old_table);
+		shard.removed = 0;
+	}
+
+	int id_new_index()
+	{
+		int idx = id_next_idx.fetch_add(1, std::memory_order_relaxed);
+		log_assert(idx < 0x40000000);
+
+		int chunk = idx >> RTLIL::IdString::storage_chunk_bits;
+		if (RTLIL::IdString::global_id_storage_[chunk].load(std::memory_order_acquire) == nullptr) {
+			std::lock_guard<std::mutex> lock(id_chunk_mutex);
+			if (RTLIL::IdString::global_id_storage_[chunk].load(std::memory_order_relaxed) == nullptr)
+				RTLIL::IdString::global_id_storage_[chunk].store(new RTLIL::IdString::storage_t[1 << RTLIL::IdString::storage_chunk_bits](),
+						std::memory_order_release);
+		}
+		return idx;
+	}
+}
+
+int RTLIL::IdString::get_reference(const char *p)
+{
+	log_assert(destruct_guard.ok);
+
+	if (p[0]) {
+		log_assert(p[1] != 0);
+		log_assert(p[0] == '$' || p[0] == '\\');
+	}
+
+	unsigned int hash = hash_cstr_ops::hash(p);
+	IdShard &shard = id_shard(hash);
+
+	int idx = id_lookup_unlocked(shard, p, hash);
+	if (idx >= 0)
+		return idx;
+
+	int last_created = -1;
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		// the id may have been created by another thread or may be in the process of being removed
+		int insert_slot = -1;
+		int slot = id_find_slot(shard, p, hash, &insert_slot);
+		if (slot >= 0) {
+			idx = shard.table.load(std::memory_order_relaxed)->slots[slot].load(std::memory_order_relaxed);
+			get_reference(idx);
+			return idx;
+		}
+
+		id_collect_retired(shard);
+
+		if (id_defer_frees || shard.free_idx.empty()) {
+			idx = id_new_index();
+		} else {
+			idx = shard.free_idx.back();
+			shard.free_idx.pop_back();
+		}
+
+		storage_t &entry = storage(idx);
+		entry.str.store(strdup(p), std::memory_order_relaxed);
+		entry.hash.store(hash, std::memory_order_relaxed);
+
+		if (id_defer_frees) {
+			entry.refcount.store(1, std::memory_order_relaxed);
+		} else {
+			// Avoid Create->Delete->Create pattern
+			entry.refcount.store(2, std::memory_order_relaxed);
+			last_created = shard.last_created;
+			shard.last_created = idx;
+		}
+
+		IdTable *table = shard.table.load(std::memory_order_relaxed);
+		if (table->slots[insert_slot].load(std::memory_order_relaxed) == id_slot_removed) {
+			shard.removed--;
+		} else if (4 * (shard.used + shard.removed + 1) > 3 * (table->mask + 1)) {
+			id_grow_table(shard);
+			insert_slot = -1;
+			id_find_slot(shard, p, hash, &insert_slot);
+			table = shard.table.load(std::memory_order_relaxed);
+		}
+		table->slots[insert_slot].store(idx, std::memory_order_release);
+		shard.used++;
+	}
+
+	if (last_created >= 0)
+		put_reference(last_created);
+
+	if (yosys_xtrace) {
+		log("#X# New IdString '%s' with index %d.\n", p, idx);
+		log_backtrace("-X- ", yosys_xtrace-1);
+	}
+
+	return idx;
+}
+
+void RTLIL::IdString::free_reference(int idx)
+{
+	// the hash of a reused index always maps to the same shard, because free indices are per shard
+	storage_t &entry = storage(idx);
+	IdShard &shard = id_shard(entry.hash.load(std::memory_order_relaxed));
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	// another thread may have picked up a new reference in the meantime,
+	// or may have already removed the id after doing so
+	if (entry.refcount.load() != 0)
+		return;
+
+	if (id_defer_frees) {
+		shard.deferred_idx.push_back(idx);
+		return;
+	}
+
+	id_remove(shard, idx);
+	id_collect_retired(shard);
+}
+
+void RTLIL::IdString::make_immortal()
+{
+	for (int i = 0; i < id_num_shards; i++) {
+		std::lock_guard<std::mutex> lock(id_shards[i].mutex);
+		id_collect_retired(id_shards[i]);
+		id_shards[i].free_idx.clear();
+		id_shards[i].last_created = -1;
+	}
+	global_immortal_ids_ = id_next_idx.load();
+}
+
+void RTLIL::IdString::set_defer_frees(bool enable)
+{
+	log_assert(id_defer_frees != enable);
+
+	if (enable) {
+		id_defer_frees = true;
+		id_defer_first_idx = id_next_idx.load();
+		return;
+	}
+
+	id_defer_frees = false;
+
+	// Indices that were created while frees were deferred have been handed out in a
+	// schedule dependent order. Redistribute them over the shards by index value, so
+	// that later allocations don't depend on the schedule either. This is safe here
+	// because no other thread holds a reference to any of these ids.
+	std::vector<int> new_free_idx;
+
+	for (int i = 0; i < id_num_shards; i++)
+	{
+		IdShard &shard = id_shards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		std::sort(shard.deferred_idx.begin(), shard.deferred_idx.end());
+		shard.deferred_idx.erase(std::unique(shard.deferred_idx.begin(), shard.deferred_idx.end()), shard.deferred_idx.end());
+
+		for (int idx : shard.deferred_idx)
+			if (storage(idx).refcount.load() == 0)
+				id_remove(shard, idx);
+		shard.deferred_idx.clear();
+
+		size_t old_free = shard.free_idx.size();
+		id_collect_retired(shard);
+		log_assert(shard.retired_idx.empty());
+
+		auto it = std::stable_partition(shard.free_idx.begin() + old_free, shard.free_idx.end(),
+				[](int idx) { return idx < id_defer_first_idx; });
+		new_free_idx.insert(new_free_idx.end(), it, shard.free_idx.end());
+		shard.free_idx.erase(it, shard.free_idx.end());
+	}
+
+	std::sort(new_free_idx.begin(), new_free_idx.end());
+	for (int idx : new_free_idx)
+		id_shards[idx % id_num_shards].free_idx.push_back(idx);
+}
+
+int RTLIL::IdString::count_ids()
+{
+	int count = 0;
+	for (int i = 0; i < id_num_shards; i++) {
+		std::lock_guard<std::mutex> lock(id_shards[i].mutex);
+		count += id_shards[i].used;
+	}
+	return count;
+}
+
+size_t RTLIL::IdString::mem_usage()
+{
+	size_t bytes = size_t(id_next_idx.load() + (1 << storage_chunk_bits) - 1) / (1 << storage_chunk_bits) *
+			(1 << storage_chunk_bits) * sizeof(storage_t);
+
+	for (int i = 0; i < id_num_shards; i++) {
+		IdShard &shard = id_shards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		IdTable *table = shard.table.load(std::memory_order_relaxed);
+		bytes += (table->mask + 1) * sizeof(int);
+		bytes += (shard.free_idx.capacity() + shard.retired_idx.capacity() + shard.deferred_idx.capacity()) * sizeof(int);
+		for (int k = 0; k <= table->mask; k++) {
+			int idx = table->slots[k].load(std::memory_order_relaxed);
+			if (idx >= 0)
+				bytes += strlen(storage(idx).str.load(std::memory_order_relaxed)) + 1;
+		}
+	}
+
+	return bytes;
+}
+
+void RTLIL::StateVector::add_special_plane()
+{
+	log_assert(stride_ == 2);
+
+	int n = GetSize(words_) / 2;
+	std::vector<uint64_t> new_words(n * 3);
+
+	for (int i = 0; i < n; i++) {
+		new_words[3*i] = words_[2*i];
+		new_words[3*i+1] = words_[2*i+1];
+	}
+
+	words_.swap(new_words);
+	stride_ = 3;
+}
+
+void RTLIL::StateVector::append(const RTLIL::State *states, int n)
+{
+	if (stride_ == 2)
+		for (int i = 0; i < n; i++)
+			if ((states[i] & 4) != 0) {
+				add_special_plane();
+				break;
+			}
+
+	// bits past the old end are zero, so the new states can simply be or-ed in
+	words_.resize(num_words(size_ + n) * stride_);
+
+	for (int i = 0; i < n; i++) {
+		uint64_t *w = &words_[((size_ + i) >> 6) * stride_];
+		int b = (size_ + i) & 63, s = states[i];
+		w[0] |= uint64_t(s & 1) << b;
+		w[1] |= uint64_t((s >> 1) & 1) << b;
+		if (stride_ == 3)
+			w[2] |= uint64_t((s >> 2) & 1) << b;
+	}
+
+	size_ += n;
+}
+
+void RTLIL::StateVector::splice(int pos, int n_remove, const RTLIL::State *states, int n_insert)
+{
+	std::vector<RTLIL::State> tail;
+	tail.reserve(size_ - pos - n_remove);
+	for (int i = pos + n_remove; i < size_; i++)
+		tail.push_back(get(i));
+
+	resize(pos);
+	append(states, n_insert);
+	append(tail.data(), GetSize(tail));
+}
+
+void RTLIL::StateVector::resize(size_t n, RTLIL::State state)
+{
+	int new_size = n;
+	log_assert(new_size >= 0);
+
+	if (new_size <= size_) {
+		size_ = new_size;
+		words_.resize(num_words(new_size) * stride_);
+		if (num_words() > 0 && (new_size & 63) != 0)
+			for (int p = 0; p < stride_; p++)
+				words_[(num_words() - 1) * stride_ + p] &= word_mask(num_words() - 1);
+		return;
+	}
+
+	if ((state & 4) != 0 && stride_ == 2)
+		add_special_plane();
+
+	words_.resize(num_words(new_size) * stride_);
+
+	for (int p = 0; p < stride_; p++) {
+		if (((state >> p) & 1) == 0)
+			continue;
+		for (int i = size_; i < new_size;) {
+			int b = i & 63, cnt = std::min(64 - b, new_size - i);
+			uint64_t m = cnt == 64 ? ~uint64_t(0) : (uint64_t(1) << cnt) - 1;
+			words_[(i >> 6) * stride_ + p] |= m << b;
+			i += cnt;
+		}
+	}
+
+	size_ = new_size;
+}
+
+RTLIL::StateVector::operator std::vector<RTLIL::State>() const
+{
+	std::vector<RTLIL::State> result(size_);
+	for (int i = 0; i < size_; i++)
+		result[i] = get(i);
+	return result;
+}
+
+bool RTLIL::StateVector::operator==(const RTLIL::StateVector &other) const
+{
+	if (size_ != other.size_)
+		return false;
+
+	if (stride_ == other.stride_)
+		return words_ == other.words_;
+
+	for (int i = 0; i < num_words(); i++)
+		for (int p = 0; p < 3; p++)
+			if (get_word(p, i) != other.get_word(p, i))
+				return false;
+
+	return true;
+}
+
+bool RTLIL::StateVector::operator<(const RTLIL::StateVector &other) const
+{
+	if (size_ != other.size_)
+		return size_ < other.size_;
+
+	for (int i = 0; i < num_words(); i++)
+	{
+		uint64_t diff = 0;
+		for (int p = 0; p < 3; p++)
+			diff |= get_word(p, i) ^ other.get_word(p, i);
+
+		if (diff != 0) {
+			int index = i * 64;
+			while ((diff & 1) == 0)
+				diff >>= 1, index++;
+			return get(index) < other.get(index);
+		}
+	}
+
+	return false;
+}
+
+unsigned int RTLIL::StateVector::hash() const
+{
+	unsigned int h = mkhash(mkhash_init, size_);
+	for (int i = 0; i < num_words(); i++)
+		for (int p = 0; p < 3; p++) {
+			uint64_t w = get_word(p, i);
+			h = mkhash(h, (unsigned int)w);
+			h = mkhash(h, (unsigned int)(w >> 32));
+		}
+	return h;
+}
 
 RTLIL::Const::Const()
 {
@@ -63,8 +577,8 @@ RTLIL::Const::Const(int val, int width)
 RTLIL::Const::Const(RTLIL::State bit, int width)
 {
 	flags = RTLIL::CONST_FLAG_NONE;
-	for (int i = 0; i < width; i++)
-		bits.push_back(bit);
+	// a negative width gives an empty constant, as it did before the bits were packed
+	bits.resize(std::max(width, 0), bit);
 }
 
 RTLIL::Const::Const(const std::vector<bool> &bits)
@@ -76,12 +590,7 @@ RTLIL::Const::Const(const std::vector<bool> &bits)
 
 bool RTLIL::Const::operator <(const RTLIL::Const &other) const
 {
-	if (bits.size() != other.bits.size())
-		return bits.size() < other.bits.size();
-	for (size_t i = 0; i < bits.size(); i++)
-		if (bits[i] != other.bits[i])
-			return bits[i] < other.bits[i];
-	return false;
+	return bits < other.bits;
 }
 
 bool RTLIL::Const::operator ==(const RTLIL::Const &other) const
@@ -94,10 +603,16 @@ bool RTLIL::Const::operator !=(const RTLIL::Const &other) const
 	return bits != other.bits;
 }
 
+// bit mask of the S1 states in one word of a RTLIL::StateVector
+static inline uint64_t const_word_ones(const RTLIL::StateVector &bits, int index)
+{
+	return bits.get_word(0, index) & ~bits.get_word(1, index) & ~bits.get_word(2, index);
+}
+
 bool RTLIL::Const::as_bool() const
 {
-	for (size_t i = 0; i < bits.size(); i++)
-		if (bits[i] == RTLIL::S1)
+	for (int i = 0; i < bits.num_words(); i++)
+		if (const_word_ones(bits, i) != 0)
 			return true;
 	return false;
 }
@@ -105,10 +620,9 @@ bool RTLIL::Const::as_bool() const
 int RTLIL::Const::as_int(bool is_signed) const
 {
 	int32_t ret = 0;
-	for (size_t i = 0; i < bits.size() && i < 32; i++)
-		if (bits[i] == RTLIL::S1)
-			ret |= 1 << i;
-	if (is_signed && bits.back() == RTLIL::S1)
+	if (!bits.empty())
+		ret = uint32_t(const_word_ones(bits, 0));
+	if (is_signed && !bits.empty() && bits.back() == RTLIL::S1)
 		for (size_t i = bits.size(); i < 32; i++)
 			ret |= 1 << i;
 	return ret;
@@ -165,8 +679,8 @@ bool RTLIL::Const::is_fully_zero() const
 {
 	cover("kernel.rtlil.const.is_fully_zero");
 
-	for (auto bit : bits)
-		if (bit != RTLIL::State::S0)
+	for (int i = 0; i < bits.num_words(); i++)
+		if ((bits.get_word(0, i) | bits.get_word(1, i) | bits.get_word(2, i)) != 0)
 			return false;
 
 	return true;
@@ -176,8 +690,8 @@ bool RTLIL::Const::is_fully_ones() const
 {
 	cover("kernel.rtlil.const.is_fully_ones");
 
-	for (auto bit : bits)
-		if (bit != RTLIL::State::S1)
+	for (int i = 0; i < bits.num_words(); i++)
+		if (const_word_ones(bits, i) != bits.word_mask(i))
 			return false;
 
 	return true;
@@ -187,8 +701,8 @@ bool RTLIL::Const::is_fully_def() const
 {
 	cover("kernel.rtlil.const.is_fully_def");
 
-	for (auto bit : bits)
-		if (bit != RTLIL::State::S0 && bit != RTLIL::State::S1)
+	for (int i = 0; i < bits.num_words(); i++)
+		if ((bits.get_word(1, i) | bits.get_word(2, i)) != 0)
 			return false;
 
 	return true;
@@ -198,8 +712,8 @@ bool RTLIL::Const::is_fully_undef() const
 {
 	cover("kernel.rtlil.const.is_fully_undef");
 
-	for (auto bit : bits)
-		if (bit != RTLIL::State::Sx && bit != RTLIL::State::Sz)
+	for (int i = 0; i < bits.num_words(); i++)
+		if ((bits.get_word(1, i) & ~bits.get_word(2, i)) != bits.word_mask(i))
 			return false;
 
 	return true;
@@ -302,10 +816,11 @@ void RTLIL::Selection::optimize(RTLIL::Design *design)
 	}
 
 	std::vector<RTLIL::IdString> del_list, add_list;
+	const RTLIL::ModuleDict &modules = design->modules_;
 
 	del_list.clear();
 	for (auto mod_name : selected_modules) {
-		if (design->modules_.count(mod_name) == 0)
+		if (modules.count(mod_name) == 0)
 			del_list.push_back(mod_name);
 		selected_members.erase(mod_name);
 	}
@@ -314,7 +829,7 @@ void RTLIL::Selection::optimize(RTLIL::Design *design)
 
 	del_list.clear();
 	for (auto &it : selected_members)
-		if (design->modules_.count(it.first) == 0)
+		if (modules.count(it.first) == 0)
 			del_list.push_back(it.first);
 	for (auto mod_name : del_list)
 		selected_members.erase(mod_name);
@@ -322,7 +837,7 @@ void RTLIL::Selection::optimize(RTLIL::Design *design)
 	for (auto &it : selected_members) {
 		del_list.clear();
 		for (auto memb_name : it.second)
-			if (design->modules_[it.first]->count_id(memb_name) == 0)
+			if (modules.at(it.first)->count_id(memb_name) == 0)
 				del_list.push_back(memb_name);
 		for (auto memb_name : del_list)
 			it.second.erase(memb_name);
@@ -333,8 +848,8 @@ void RTLIL::Selection::optimize(RTLIL::Design *design)
 	for (auto &it : selected_members)
 		if (it.second.size() == 0)
 			del_list.push_back(it.first);
-		else if (it.second.size() == design->modules_[it.first]->wires_.size() + design->modules_[it.first]->memories.size() +
-				design->modules_[it.first]->cells_.size() + design->modules_[it.first]->processes.size())
+		else if (it.second.size() == modules.at(it.first)->wires_.size() + modules.at(it.first)->memories.size() +
+				modules.at(it.first)->cells_.size() + modules.at(it.first)->processes.size())
 			add_list.push_back(it.first);
 	for (auto mod_name : del_list)
 		selected_members.erase(mod_name);
@@ -343,27 +858,29 @@ void RTLIL::Selection::optimize(RTLIL::Design *design)
 		selected_modules.insert(mod_name);
 	}
 
-	if (selected_modules.size() == design->modules_.size()) {
+	if (selected_modules.size() == modules.size()) {
 		full_selection = true;
 		selected_modules.clear();
 		selected_members.clear();
 	}
 }
 
-RTLIL::Design::Design()
+RTLIL::Design::Design() : modules_(this)
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static std::atomic<unsigned int> hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	refcount_modules_ = 0;
+	saved_ = false;
 	selection_stack.push_back(RTLIL::Selection());
 }
 
 RTLIL::Design::~Design()
 {
-	for (auto it = modules_.begin(); it != modules_.end(); ++it)
-		delete it->second;
+	const RTLIL::ModuleDict::base &modules = modules_;
+	for (auto &it : modules)
+		if (!it.second->remove_shared_ref())
+			delete it.second;
 	for (auto n : verilog_packages)
 		delete n;
 	for (auto n : verilog_globals)
@@ -372,6 +889,7 @@ RTLIL::Design::~Design()
 
 RTLIL::ObjRange<RTLIL::Module*> RTLIL::Design::modules()
 {
+	modules_.load_all();
 	return RTLIL::ObjRange<RTLIL::Module*>(&modules_, &refcount_modules_);
 }
 
@@ -503,13 +1021,17 @@ void RTLIL::Design::remove(RTLIL::Module *module)
 		log_backtrace("-X- ", yosys_xtrace-1);
 	}
 
-	log_assert(modules_.at(module->name) == module);
+	const RTLIL::ModuleDict::base &modules = modules_;
+	log_assert(modules.at(module->name) == module);
+	module->unshare();
 	modules_.erase(module->name);
-	delete module;
+	if (!module->remove_shared_ref())
+		delete module;
 }
 
 void RTLIL::Design::rename(RTLIL::Module *module, RTLIL::IdString new_name)
 {
+	module->unshare();
 	modules_.erase(module->name);
 	module->name = new_name;
 	add(module);
@@ -526,7 +1048,8 @@ void RTLIL::Design::sort()
 void RTLIL::Design::check()
 {
 #ifndef NDEBUG
-	for (auto &it : modules_) {
+	const RTLIL::ModuleDict::base &modules = modules_;
+	for (auto &it : modules) {
 		log_assert(this == it.second->design);
 		log_assert(it.first == it.second->name);
 		log_assert(!it.first.empty());
@@ -587,8 +1110,10 @@ std::vector<RTLIL::Module*> RTLIL::Design::selected_modules() const
 	std::vector<RTLIL::Module*> result;
 	result.reserve(modules_.size());
 	for (auto &it : modules_)
-		if (selected_module(it.first) && !it.second->get_bool_attribute("\\blackbox"))
+		if (selected_module(it.first) && !it.second->get_bool_attribute("\\blackbox")) {
+			modules_.load(it.second);
 			result.push_back(it.second);
+		}
 	return result;
 }
 
@@ -597,8 +1122,10 @@ std::vector<RTLIL::Module*> RTLIL::Design::selected_whole_modules() const
 	std::vector<RTLIL::Module*> result;
 	result.reserve(modules_.size());
 	for (auto &it : modules_)
-		if (selected_whole_module(it.first) && !it.second->get_bool_attribute("\\blackbox"))
+		if (selected_whole_module(it.first) && !it.second->get_bool_attribute("\\blackbox")) {
+			modules_.load(it.second);
 			result.push_back(it.second);
+		}
 	return result;
 }
 
@@ -609,34 +1136,195 @@ std::vector<RTLIL::Module*> RTLIL::Design::selected_whole_modules_warn() const
 	for (auto &it : modules_)
 		if (it.second->get_bool_attribute("\\blackbox"))
 			continue;
-		else if (selected_whole_module(it.first))
+		else if (selected_whole_module(it.first)) {
+			modules_.load(it.second);
 			result.push_back(it.second);
-		else if (selected_module(it.first))
+		} else if (selected_module(it.first))
 			log_warning("Ignoring partially selected module %s.\n", log_id(it.first));
 	return result;
 }
 
+void RTLIL::ModuleDict::load_all() const
+{
+	if (RTLIL::Module::lazy_modules_count_ == 0 && (RTLIL::Module::shared_modules_count_ == 0 || !design->saved_))
+		return;
+	const base &modules = *this;
+	for (auto &it : modules)
+		load(it.second);
+}
+
+bool RTLIL::Module::default_use_arena = (getenv("YOSYS_NOARENA") == nullptr);
+int RTLIL::Module::shared_modules_count_ = 0;
+int RTLIL::Module::lazy_modules_count_ = 0;
+bool RTLIL::Module::use_sigmap_cache = (getenv("YOSYS_NOSIGMAPCACHE") == nullptr);
+
 RTLIL::Module::Module()
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static std::atomic<unsigned int> hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
+	use_arena_ = default_use_arena;
 	design = nullptr;
 	refcount_wires_ = 0;
 	refcount_cells_ = 0;
+	shared_refs_ = 0;
+	loading_lazy_ = false;
+	sigmap_ = nullptr;
+	modindex_ = nullptr;
 }
 
 RTLIL::Module::~Module()
 {
+	if (modindex_ != nullptr)
+		ModIndex::free_cached(this);
 	for (auto it = wires_.begin(); it != wires_.end(); ++it)
-		delete it->second;
+		free_wire(it->second);
 	for (auto it = memories.begin(); it != memories.end(); ++it)
 		delete it->second;
 	for (auto it = cells_.begin(); it != cells_.end(); ++it)
-		delete it->second;
+		free_cell(it->second);
 	for (auto it = processes.begin(); it != processes.end(); ++it)
 		delete it->second;
+	delete sigmap_;
+	if (lazy_loader_)
+		lazy_modules_count_--;
+}
+
+void RTLIL::Module::add_shared_ref()
+{
+	if (shared_refs_++ != 0)
+		return;
+	shared_modules_count_++;
+	// a lazy module gets its image when it is loaded, an unchanged copy made by unshare() has one
+	if (shared_image_ == nullptr && !lazy_loader_)
+		shared_image_ = std::make_shared<std::string>(RtlilBinWriter().image(this));
+}
+
+bool RTLIL::Module::remove_shared_ref()
+{
+	if (shared_refs_ == 0)
+		return false;
+	if (--shared_refs_ == 0) {
+		shared_modules_count_--;
+		shared_image_.reset();
+	}
+	return true;
+}
+
+void RTLIL::Module::unshare()
+{
+	// the workers of parallel_for_modules() only modify their own module. check_shared()
+	// catches their changes before the saved designs are used.
+	if (shared_refs_ == 0 || loading_lazy_ || in_parallel_worker())
+		return;
+
+	load_lazy();
+	log_assert(shared_image_ != nullptr);
+
+	RTLIL::Module *copy = nullptr;
+
+	auto unshare_design = [&](RTLIL::Design *saved_design) {
+		RTLIL::ModuleDict::base &modules = saved_design->modules_;
+		auto it = modules.find(name);
+		if (it == modules.end() || it->second != this)
+			return;
+		if (copy == nullptr) {
+			// the module may already have been modified, so the copy is made from the image
+			std::shared_ptr<RtlilBinReader> reader(new RtlilBinReader);
+			reader->open(shared_image_, log_id(name));
+			copy = clone_empty();
+			copy->design = saved_design;
+			copy->shared_image_ = shared_image_;
+			reader->load_module_header(0, copy);
+			copy->set_lazy_loader([reader](RTLIL::Module *module) {
+				reader->load_module_body(0, module);
+			});
+		} else
+			copy->add_shared_ref();
+		remove_shared_ref();
+		it->second = copy;
+	};
+
+	for (auto &it : saved_designs)
+		unshare_design(it.second);
+	for (auto saved_design : pushed_designs)
+		unshare_design(saved_design);
+
+	log_assert(shared_refs_ == 0);
+}
+
+void RTLIL::ModuleDict::check_shared(RTLIL::Module *module) const
+{
+	if (yosys_design != nullptr)
+		module->check_shared(yosys_design);
+}
+
+void RTLIL::Module::check_shared(RTLIL::Design *current_design)
+{
+	if (shared_refs_ == 0 || lazy_loader_ || in_parallel_worker())
+		return;
+
+	// a module that the current design does not hold is only held by saved designs
+	const RTLIL::ModuleDict::base &modules = current_design->modules_;
+	auto it = modules.find(name);
+	if (it == modules.end() || it->second != this)
+		return;
+	if (RtlilBinWriter().image(this) != *shared_image_)
+		unshare();
+}
+
+void RTLIL::Module::check_shared_modules(RTLIL::Design *current_design)
+{
+	if (shared_modules_count_ == 0)
+		return;
+
+	// check_shared() changes the saved designs, not the current one
+	const RTLIL::ModuleDict::base &modules = current_design->modules_;
+	for (auto &it : modules)
+		it.second->check_shared(current_design);
+}
+
+void RTLIL::Module::set_lazy_loader(const std::function<void(RTLIL::Module*)> &loader)
+{
+	if (!lazy_loader_)
+		lazy_modules_count_++;
+	lazy_loader_ = loader;
+}
+
+void RTLIL::Module::load_lazy()
+{
+	// parallel_for_modules() loads all modules of the design before it starts the workers
+	if (!lazy_loader_)
+		return;
+
+	std::function<void(RTLIL::Module*)> loader;
+	loader.swap(lazy_loader_);
+	lazy_modules_count_--;
+
+	loading_lazy_ = true;
+	loader(this);
+	loading_lazy_ = false;
+
+	if (shared_refs_ > 0 && shared_image_ == nullptr)
+		shared_image_ = std::make_shared<std::string>(RtlilBinWriter().image(this));
+}
+
+void RTLIL::Module::free_wire(RTLIL::Wire *wire)
+{
+	if (use_arena_) {
+		wire->~Wire();
+		wire_arena_.deallocate(wire);
+	} else
+		delete wire;
+}
+
+void RTLIL::Module::free_cell(RTLIL::Cell *cell)
+{
+	if (use_arena_) {
+		cell->~Cell();
+		cell_arena_.deallocate(cell);
+	} else
+		delete cell;
 }
 
 void RTLIL::Module::reprocess_module(RTLIL::Design *, dict<RTLIL::IdString, RTLIL::Module *>)
@@ -1292,6 +1980,8 @@ void RTLIL::Module::optimize()
 
 void RTLIL::Module::cloneInto(RTLIL::Module *new_mod) const
 {
+	const_cast<RTLIL::Module*>(this)->load_lazy();
+
 	log_assert(new_mod->refcount_wires_ == 0);
 	log_assert(new_mod->refcount_cells_ == 0);
 
@@ -1336,12 +2026,17 @@ void RTLIL::Module::cloneInto(RTLIL::Module *new_mod) const
 
 RTLIL::Module *RTLIL::Module::clone() const
 {
-	RTLIL::Module *new_mod = new RTLIL::Module;
+	RTLIL::Module *new_mod = clone_empty();
 	new_mod->name = name;
 	cloneInto(new_mod);
 	return new_mod;
 }
 
+RTLIL::Module *RTLIL::Module::clone_empty() const
+{
+	return new RTLIL::Module;
+}
+
 bool RTLIL::Module::has_memories() const
 {
 	return !memories.empty();
@@ -1388,6 +2083,9 @@ std::vector<RTLIL::Cell*> RTLIL::Module::selected_cells() const
 
 void RTLIL::Module::add(RTLIL::Wire *wire)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(!wire->name.empty());
 	log_assert(count_id(wire->name) == 0);
 	log_assert(refcount_wires_ == 0);
@@ -1397,6 +2095,9 @@ void RTLIL::Module::add(RTLIL::Wire *wire)
 
 void RTLIL::Module::add(RTLIL::Cell *cell)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(!cell->name.empty());
 	log_assert(count_id(cell->name) == 0);
 	log_assert(refcount_cells_ == 0);
@@ -1424,6 +2125,9 @@ namespace {
 
 void RTLIL::Module::remove(const pool<RTLIL::Wire*> &wires)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(refcount_wires_ == 0);
 
 	DeleteWireWorker delete_wire_worker;
@@ -1434,41 +2138,60 @@ void RTLIL::Module::remove(const pool<RTLIL::Wire*> &wires)
 	for (auto &it : wires) {
 		log_assert(wires_.count(it->name) != 0);
 		wires_.erase(it->name);
-		delete it;
+		free_wire(it);
 	}
 }
 
 void RTLIL::Module::remove(RTLIL::Cell *cell)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	while (!cell->connections_.empty())
 		cell->unsetPort(cell->connections_.begin()->first);
 
 	log_assert(cells_.count(cell->name) != 0);
 	log_assert(refcount_cells_ == 0);
 	cells_.erase(cell->name);
-	delete cell;
+	free_cell(cell);
 }
 
 void RTLIL::Module::rename(RTLIL::Wire *wire, RTLIL::IdString new_name)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(wires_[wire->name] == wire);
 	log_assert(refcount_wires_ == 0);
 	wires_.erase(wire->name);
 	wire->name = new_name;
 	add(wire);
+
+	// the hashes of the bits of the wire have changed
+	invalidate_caches();
 }
 
 void RTLIL::Module::rename(RTLIL::Cell *cell, RTLIL::IdString new_name)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(cells_[cell->name] == cell);
 	log_assert(refcount_wires_ == 0);
 	cells_.erase(cell->name);
 	cell->name = new_name;
 	add(cell);
+
+	// the hashes of ModIndex::PortInfo include the cell name
+	if (modindex_ != nullptr)
+		modindex_->auto_reload_module = true;
 }
 
 void RTLIL::Module::rename(RTLIL::IdString old_name, RTLIL::IdString new_name)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(count_id(old_name) != 0);
 	if (wires_.count(old_name))
 		rename(wires_.at(old_name), new_name);
@@ -1480,6 +2203,9 @@ void RTLIL::Module::rename(RTLIL::IdString old_name, RTLIL::IdString new_name)
 
 void RTLIL::Module::swap_names(RTLIL::Wire *w1, RTLIL::Wire *w2)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(wires_[w1->name] == w1);
 	log_assert(wires_[w2->name] == w2);
 	log_assert(refcount_wires_ == 0);
@@ -1491,10 +2217,15 @@ void RTLIL::Module::swap_names(RTLIL::Wire *w1, RTLIL::Wire *w2)
 
 	wires_[w1->name] = w1;
 	wires_[w2->name] = w2;
+
+	invalidate_caches();
 }
 
 void RTLIL::Module::swap_names(RTLIL::Cell *c1, RTLIL::Cell *c2)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	log_assert(cells_[c1->name] == c1);
 	log_assert(cells_[c2->name] == c2);
 	log_assert(refcount_cells_ == 0);
@@ -1506,6 +2237,9 @@ void RTLIL::Module::swap_names(RTLIL::Cell *c1, RTLIL::Cell *c2)
 
 	cells_[c1->name] = c1;
 	cells_[c2->name] = c2;
+
+	if (modindex_ != nullptr)
+		modindex_->auto_reload_module = true;
 }
 
 RTLIL::IdString RTLIL::Module::uniquify(RTLIL::IdString name)
@@ -1544,6 +2278,9 @@ static bool fixup_ports_compare(const RTLIL::Wire *a, const RTLIL::Wire *b)
 
 void RTLIL::Module::connect(const RTLIL::SigSig &conn)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	for (auto mon : monitors)
 		mon->notify_connect(this, conn);
 
@@ -1571,6 +2308,11 @@ void RTLIL::Module::connect(const RTLIL::SigSig &conn)
 
 	log_assert(GetSize(conn.first) == GetSize(conn.second));
 	connections_.push_back(conn);
+
+	if (sigmap_ != nullptr) {
+		cover("kernel.rtlil.module.sigmap.update");
+		sigmap_->add(conn.first, conn.second);
+	}
 }
 
 void RTLIL::Module::connect(const RTLIL::SigSpec &lhs, const RTLIL::SigSpec &rhs)
@@ -1580,6 +2322,9 @@ void RTLIL::Module::connect(const RTLIL::SigSpec &lhs, const RTLIL::SigSpec &rhs
 
 void RTLIL::Module::new_connections(const std::vector<RTLIL::SigSig> &new_conn)
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	for (auto mon : monitors)
 		mon->notify_connect(this, new_conn);
 
@@ -1595,6 +2340,7 @@ void RTLIL::Module::new_connections(const std::vector<RTLIL::SigSig> &new_conn)
 	}
 
 	connections_ = new_conn;
+	invalidate_caches();
 }
 
 const std::vector<RTLIL::SigSig> &RTLIL::Module::connections() const
@@ -1602,8 +2348,32 @@ const std::vector<RTLIL::SigSig> &RTLIL::Module::connections() const
 	return connections_;
 }
 
+const SigMap &RTLIL::Module::sigmap()
+{
+	if (sigmap_ == nullptr) {
+		cover("kernel.rtlil.module.sigmap.build");
+		sigmap_ = new SigMap;
+		sigmap_->set(connections_);
+	}
+	return *sigmap_;
+}
+
+void RTLIL::Module::invalidate_caches()
+{
+	if (sigmap_ != nullptr)
+		cover("kernel.rtlil.module.sigmap.invalidate");
+	delete sigmap_;
+	sigmap_ = nullptr;
+
+	if (modindex_ != nullptr)
+		modindex_->auto_reload_module = true;
+}
+
 void RTLIL::Module::fixup_ports()
 {
+	if (shared_refs_ > 0)
+		unshare();
+
 	std::vector<RTLIL::Wire*> all_ports;
 
 	for (auto &w : wires_)
@@ -1619,11 +2389,15 @@ void RTLIL::Module::fixup_ports()
 		ports.push_back(all_ports[i]->name);
 		all_ports[i]->port_id = i+1;
 	}
+
+	// the port directions are part of the ModIndex
+	if (modindex_ != nullptr)
+		modindex_->auto_reload_module = true;
 }
 
 RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, int width)
 {
-	RTLIL::Wire *wire = new RTLIL::Wire;
+	RTLIL::Wire *wire = use_arena_ ? new (wire_arena_.allocate()) RTLIL::Wire : new RTLIL::Wire;
 	wire->name = name;
 	wire->width = width;
 	add(wire);
@@ -1645,7 +2419,7 @@ RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, const RTLIL::Wire *oth
 
 RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, RTLIL::IdString type)
 {
-	RTLIL::Cell *cell = new RTLIL::Cell;
+	RTLIL::Cell *cell = use_arena_ ? new (cell_arena_.allocate()) RTLIL::Cell : new RTLIL::Cell;
 	cell->name = name;
 	cell->type = type;
 	add(cell);
@@ -1658,6 +2432,10 @@ RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, const RTLIL::Cell *oth
 	cell->connections_ = other->connections_;
 	cell->parameters = other->parameters;
 	cell->attributes = other->attributes;
+
+	// the connections are not reported to the monitors
+	if (modindex_ != nullptr)
+		modindex_->auto_reload_module = true;
 	return cell;
 }
 
@@ -2189,9 +2967,8 @@ RTLIL::SigSpec RTLIL::Module::Initstate(RTLIL::IdString name, const std::string
 
 RTLIL::Wire::Wire()
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static std::atomic<unsigned int> hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	module = nullptr;
 	width = 1;
@@ -2204,9 +2981,8 @@ RTLIL::Wire::Wire()
 
 RTLIL::Memory::Memory()
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static std::atomic<unsigned int> hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	width = 1;
 	start_offset = 0;
@@ -2215,9 +2991,8 @@ RTLIL::Memory::Memory()
 
 RTLIL::Cell::Cell() : module(nullptr)
 {
-	static unsigned int hashidx_count = 123456789;
-	hashidx_count = mkhash_xorshift(hashidx_count);
-	hashidx_ = hashidx_count;
+	static std::atomic<unsigned int> hashidx_count(123456789);
+	hashidx_ = next_hashidx(hashidx_count);
 
 	// log("#memtrace# %p\n", this);
 	memhasher();
@@ -2230,6 +3005,9 @@ bool RTLIL::Cell::hasPort(RTLIL::IdString portname) const
 
 void RTLIL::Cell::unsetPort(RTLIL::IdString portname)
 {
+	if (module != nullptr && module->shared_refs_ > 0)
+		module->unshare();
+
 	RTLIL::SigSpec signal;
 	auto conn_it = connections_.find(portname);
 
@@ -2253,6 +3031,9 @@ void RTLIL::Cell::unsetPort(RTLIL::IdString portname)
 
 void RTLIL::Cell::setPort(RTLIL::IdString portname, RTLIL::SigSpec signal)
 {
+	if (module != nullptr && module->shared_refs_ > 0)
+		module->unshare();
+
 	auto conn_it = connections_.find(portname);
 
 	if (conn_it == connections_.end()) {
@@ -2328,11 +3109,17 @@ bool RTLIL::Cell::hasParam(RTLIL::IdString paramname) const
 
 void RTLIL::Cell::unsetParam(RTLIL::IdString paramname)
 {
+	if (module != nullptr && module->shared_refs_ > 0)
+		module->unshare();
+
 	parameters.erase(paramname);
 }
 
 void RTLIL::Cell::setParam(RTLIL::IdString paramname, RTLIL::Const value)
 {
+	if (module != nullptr && module->shared_refs_ > 0)
+		module->unshare();
+
 	parameters[paramname] = value;
 }
 
@@ -2530,6 +3317,30 @@ RTLIL::SigSpec::SigSpec()
 	hash_ = 0;
 }
 
+RTLIL::SigChunk RTLIL::SigSpec::inline_chunk() const
+{
+	log_assert(is_inline());
+	if (inline_.wire == NULL)
+		return RTLIL::SigChunk(inline_.data);
+	return RTLIL::SigChunk(inline_.wire, inline_.offset, width_);
+}
+
+void RTLIL::SigSpec::init_chunk(const RTLIL::SigChunk &chunk)
+{
+	width_ = chunk.width;
+	hash_ = 0;
+
+	if (chunk.wire != NULL ? chunk.width > 0 : chunk.width == 1) {
+		cover("kernel.rtlil.sigspec.init.inline");
+		inline_ = RTLIL::SigBit(chunk, 0);
+	} else {
+		cover("kernel.rtlil.sigspec.alloc.chunks.init");
+		chunks_.push_back(chunk);
+	}
+
+	check();
+}
+
 RTLIL::SigSpec::SigSpec(const RTLIL::SigSpec &other)
 {
 	*this = other;
@@ -2553,11 +3364,21 @@ const RTLIL::SigSpec &RTLIL::SigSpec::operator=(const RTLIL::SigSpec &other)
 
 	width_ = other.width_;
 	hash_ = other.hash_;
+	inline_ = other.inline_;
+	if (!other.chunks_.empty())
+		cover("kernel.rtlil.sigspec.alloc.chunks.assign");
 	chunks_ = other.chunks_;
 	bits_.clear();
 
-	if (!other.bits_.empty())
+	if (GetSize(other.bits_) == 1)
+	{
+		cover("kernel.rtlil.sigspec.assign.inline");
+		inline_ = other.bits_.front();
+	}
+	else if (!other.bits_.empty())
 	{
+		cover("kernel.rtlil.sigspec.alloc.chunks.assign_bits");
+
 		RTLIL::SigChunk *last = NULL;
 		int last_end_offset = 0;
 
@@ -2587,82 +3408,59 @@ const RTLIL::SigSpec &RTLIL::SigSpec::operator=(const RTLIL::SigSpec &other)
 RTLIL::SigSpec::SigSpec(const RTLIL::Const &value)
 {
 	cover("kernel.rtlil.sigspec.init.const");
-
-	chunks_.push_back(RTLIL::SigChunk(value));
-	width_ = chunks_.back().width;
-	hash_ = 0;
-	check();
+	init_chunk(RTLIL::SigChunk(value));
 }
 
 RTLIL::SigSpec::SigSpec(const RTLIL::SigChunk &chunk)
 {
 	cover("kernel.rtlil.sigspec.init.chunk");
-
-	chunks_.push_back(chunk);
-	width_ = chunks_.back().width;
-	hash_ = 0;
-	check();
+	init_chunk(chunk);
 }
 
 RTLIL::SigSpec::SigSpec(RTLIL::Wire *wire)
 {
 	cover("kernel.rtlil.sigspec.init.wire");
-
-	chunks_.push_back(RTLIL::SigChunk(wire));
-	width_ = chunks_.back().width;
-	hash_ = 0;
-	check();
+	init_chunk(RTLIL::SigChunk(wire));
 }
 
 RTLIL::SigSpec::SigSpec(RTLIL::Wire *wire, int offset, int width)
 {
 	cover("kernel.rtlil.sigspec.init.wire_part");
-
-	chunks_.push_back(RTLIL::SigChunk(wire, offset, width));
-	width_ = chunks_.back().width;
-	hash_ = 0;
-	check();
+	init_chunk(RTLIL::SigChunk(wire, offset, width));
 }
 
 RTLIL::SigSpec::SigSpec(const std::string &str)
 {
 	cover("kernel.rtlil.sigspec.init.str");
-
-	chunks_.push_back(RTLIL::SigChunk(str));
-	width_ = chunks_.back().width;
-	hash_ = 0;
-	check();
+	init_chunk(RTLIL::SigChunk(str));
 }
 
 RTLIL::SigSpec::SigSpec(int val, int width)
 {
 	cover("kernel.rtlil.sigspec.init.int");
-
-	chunks_.push_back(RTLIL::SigChunk(val, width));
-	width_ = width;
-	hash_ = 0;
-	check();
+	init_chunk(RTLIL::SigChunk(val, width));
 }
 
 RTLIL::SigSpec::SigSpec(RTLIL::State bit, int width)
 {
 	cover("kernel.rtlil.sigspec.init.state");
-
-	chunks_.push_back(RTLIL::SigChunk(bit, width));
-	width_ = width;
-	hash_ = 0;
-	check();
+	init_chunk(RTLIL::SigChunk(bit, width));
 }
 
 RTLIL::SigSpec::SigSpec(RTLIL::SigBit bit, int width)
 {
 	cover("kernel.rtlil.sigspec.init.bit");
 
-	if (bit.wire == NULL)
-		chunks_.push_back(RTLIL::SigChunk(bit.data, width));
-	else
-		for (int i = 0; i < width; i++)
-			chunks_.push_back(bit);
+	if (width == 1) {
+		inline_ = bit;
+	} else {
+		cover("kernel.rtlil.sigspec.alloc.chunks.init_bit");
+		if (bit.wire == NULL)
+			chunks_.push_back(RTLIL::SigChunk(bit.data, width));
+		else
+			for (int i = 0; i < width; i++)
+				chunks_.push_back(bit);
+	}
 	width_ = width;
 	hash_ = 0;
 	check();
@@ -2725,11 +3523,20 @@ RTLIL::SigSpec::SigSpec(bool bit)
 void RTLIL::SigSpec::pack() const
 {
 	RTLIL::SigSpec *that = (RTLIL::SigSpec*)this;
+	cover("kernel.rtlil.sigspec.pack");
+
+	if (that->is_inline()) {
+		cover("kernel.rtlil.sigspec.convert.pack_inline");
+		cover("kernel.rtlil.sigspec.alloc.chunks.pack_inline");
+		that->chunks_.push_back(inline_chunk());
+		return;
+	}
 
 	if (that->bits_.empty())
 		return;
 
 	cover("kernel.rtlil.sigspec.convert.pack");
+	cover("kernel.rtlil.sigspec.alloc.chunks.pack");
 	log_assert(that->chunks_.empty());
 
 	std::vector<RTLIL::SigBit> old_bits;
@@ -2761,11 +3568,23 @@ void RTLIL::SigSpec::pack() const
 void RTLIL::SigSpec::unpack() const
 {
 	RTLIL::SigSpec *that = (RTLIL::SigSpec*)this;
+	cover("kernel.rtlil.sigspec.unpack");
+
+	if (that->is_inline()) {
+		cover("kernel.rtlil.sigspec.convert.unpack_inline");
+		cover("kernel.rtlil.sigspec.alloc.bits.unpack_inline");
+		that->bits_.reserve(that->width_);
+		for (int i = 0; i < that->width_; i++)
+			that->bits_.push_back(inline_bit(i));
+		that->hash_ = 0;
+		return;
+	}
 
 	if (that->chunks_.empty())
 		return;
 
 	cover("kernel.rtlil.sigspec.convert.unpack");
+	cover("kernel.rtlil.sigspec.alloc.bits.unpack");
 	log_assert(that->bits_.empty());
 
 	that->bits_.reserve(that->width_);
@@ -2777,6 +3596,14 @@ void RTLIL::SigSpec::unpack() const
 	that->hash_ = 0;
 }
 
+size_t RTLIL::SigSpec::mem_usage() const
+{
+	size_t bytes = chunks_.capacity() * sizeof(RTLIL::SigChunk) + bits_.capacity() * sizeof(RTLIL::SigBit);
+	for (auto &c : chunks_)
+		bytes += c.data.capacity() * sizeof(RTLIL::State);
+	return bytes;
+}
+
 void RTLIL::SigSpec::updhash() const
 {
 	RTLIL::SigSpec *that = (RTLIL::SigSpec*)this;
@@ -2785,6 +3612,21 @@ void RTLIL::SigSpec::updhash() const
 		return;
 
 	cover("kernel.rtlil.sigspec.hash");
+
+	if (that->is_inline()) {
+		that->hash_ = mkhash_init;
+		if (inline_.wire == NULL) {
+			that->hash_ = mkhash(that->hash_, inline_.data);
+		} else {
+			that->hash_ = mkhash(that->hash_, inline_.wire->name.index_);
+			that->hash_ = mkhash(that->hash_, inline_.offset);
+			that->hash_ = mkhash(that->hash_, width_);
+		}
+		if (that->hash_ == 0)
+			that->hash_ = 1;
+		return;
+	}
+
 	that->pack();
 
 	that->hash_ = mkhash_init;
@@ -3095,7 +3937,14 @@ void RTLIL::SigSpec::replace(int offset, const RTLIL::SigSpec &with)
 
 void RTLIL::SigSpec::remove_const()
 {
-	if (packed())
+	if (is_inline())
+	{
+		cover("kernel.rtlil.sigspec.remove_const.inline");
+
+		if (inline_.wire == NULL)
+			width_ = 0;
+	}
+	else if (packed())
 	{
 		cover("kernel.rtlil.sigspec.remove_const.packed");
 
@@ -3147,6 +3996,14 @@ void RTLIL::SigSpec::remove(int offset, int length)
 
 RTLIL::SigSpec RTLIL::SigSpec::extract(int offset, int length) const
 {
+	if (is_inline() && length > 0) {
+		cover("kernel.rtlil.sigspec.extract_pos.inline");
+		log_assert(offset >= 0 && offset + length <= width_);
+		if (inline_.wire == NULL)
+			return *this;
+		return RTLIL::SigSpec(inline_.wire, inline_.offset + offset, length);
+	}
+
 	unpack();
 	cover("kernel.rtlil.sigspec.extract_pos");
 	return std::vector<RTLIL::SigBit>(bits_.begin() + offset, bits_.begin() + offset + length);
@@ -3163,27 +4020,49 @@ void RTLIL::SigSpec::append(const RTLIL::SigSpec &signal)
 	}
 
 	cover("kernel.rtlil.sigspec.append");
+	hash_ = 0;
+
+	if (is_inline() && signal.is_inline() && inline_.wire != NULL && inline_.wire == signal.inline_.wire &&
+			inline_.offset + width_ == signal.inline_.offset) {
+		cover("kernel.rtlil.sigspec.append.inline");
+		width_ += signal.width_;
+		check();
+		return;
+	}
+
+	if (is_inline())
+		pack();
 
-	if (packed() != signal.packed()) {
+	if (!signal.is_inline() && packed() != signal.packed()) {
 		pack();
 		signal.pack();
 	}
 
+	auto append_chunk = [this](const RTLIL::SigChunk &other_c)
+	{
+		auto &my_last_c = chunks_.back();
+		if (my_last_c.wire == NULL && other_c.wire == NULL) {
+			auto &this_data = my_last_c.data;
+			auto &other_data = other_c.data;
+			this_data.insert(this_data.end(), other_data.begin(), other_data.end());
+			my_last_c.width += other_c.width;
+		} else
+		if (my_last_c.wire == other_c.wire && my_last_c.offset + my_last_c.width == other_c.offset) {
+			my_last_c.width += other_c.width;
+		} else
+			chunks_.push_back(other_c);
+	};
+
+	if (signal.is_inline()) {
+		if (packed())
+			append_chunk(signal.inline_chunk());
+		else
+			for (int i = 0; i < signal.width_; i++)
+				bits_.push_back(signal.inline_bit(i));
+	} else
 	if (packed())
 		for (auto &other_c : signal.chunks_)
-		{
-			auto &my_last_c = chunks_.back();
-			if (my_last_c.wire == NULL && other_c.wire == NULL) {
-				auto &this_data = my_last_c.data;
-				auto &other_data = other_c.data;
-				this_data.insert(this_data.end(), other_data.begin(), other_data.end());
-				my_last_c.width += other_c.width;
-			} else
-			if (my_last_c.wire == other_c.wire && my_last_c.offset + my_last_c.width == other_c.offset) {
-				my_last_c.width += other_c.width;
-			} else
-				chunks_.push_back(other_c);
-		}
+			append_chunk(other_c);
 	else
 		bits_.insert(bits_.end(), signal.bits_.begin(), signal.bits_.end());
 
@@ -3193,8 +4072,22 @@ void RTLIL::SigSpec::append(const RTLIL::SigSpec &signal)
 
 void RTLIL::SigSpec::append_bit(const RTLIL::SigBit &bit)
 {
-	if (packed())
+	hash_ = 0;
+
+	if (width_ == 0)
+	{
+		cover("kernel.rtlil.sigspec.append_bit.first");
+		chunks_.clear();
+		bits_.clear();
+		inline_ = bit;
+	}
+	else if (is_inline() && bit.wire != NULL && bit.wire == inline_.wire && inline_.offset + width_ == bit.offset)
 	{
+		cover("kernel.rtlil.sigspec.append_bit.inline");
+	}
+	else if (packed())
+	{
+		pack();
 		cover("kernel.rtlil.sigspec.append_bit.packed");
 
 		if (chunks_.size() == 0)
@@ -3226,7 +4119,8 @@ void RTLIL::SigSpec::extend_u0(int width, bool is_signed)
 {
 	cover("kernel.rtlil.sigspec.extend_u0");
 
-	pack();
+	if (!is_inline())
+		pack();
 
 	if (width_ > width)
 		remove(width, width_ - width);
@@ -3254,7 +4148,19 @@ RTLIL::SigSpec RTLIL::SigSpec::repeat(int num) const
 #ifndef NDEBUG
 void RTLIL::SigSpec::check() const
 {
-	if (width_ > 64)
+	if (is_inline())
+	{
+		cover("kernel.rtlil.sigspec.check.inline");
+
+		if (inline_.wire == NULL) {
+			log_assert(width_ == 1);
+		} else {
+			log_assert(inline_.offset >= 0);
+			log_assert(width_ > 0);
+			log_assert(inline_.offset + width_ <= inline_.wire->width);
+		}
+	}
+	else if (width_ > 64)
 	{
 		cover("kernel.rtlil.sigspec.check.skip");
 	}
@@ -3303,6 +4209,31 @@ bool RTLIL::SigSpec::operator <(const RTLIL::SigSpec &other) const
 	if (width_ != other.width_)
 		return width_ < other.width_;
 
+	if (is_inline() || other.is_inline())
+	{
+		int num_chunks = is_inline() ? 1 : (pack(), GetSize(chunks_));
+		int other_num_chunks = other.is_inline() ? 1 : (other.pack(), GetSize(other.chunks_));
+
+		if (num_chunks != other_num_chunks)
+			return num_chunks < other_num_chunks;
+
+		updhash();
+		other.updhash();
+
+		if (hash_ != other.hash_)
+			return hash_ < other.hash_;
+
+		RTLIL::SigChunk chunk = is_inline() ? inline_chunk() : chunks_[0];
+		RTLIL::SigChunk other_chunk = other.is_inline() ? other.inline_chunk() : other.chunks_[0];
+		if (chunk != other_chunk) {
+			cover("kernel.rtlil.sigspec.comp_lt.inline_hash_collision");
+			return chunk < other_chunk;
+		}
+
+		cover("kernel.rtlil.sigspec.comp_lt.inline_equal");
+		return false;
+	}
+
 	pack();
 	other.pack();
 
@@ -3335,10 +4266,40 @@ bool RTLIL::SigSpec::operator ==(const RTLIL::SigSpec &other) const
 	if (width_ != other.width_)
 		return false;
 
+	if (is_inline() || other.is_inline())
+	{
+		if (!is_inline() || !other.is_inline()) {
+			int num_chunks = is_inline() ? 1 : (pack(), GetSize(chunks_));
+			int other_num_chunks = other.is_inline() ? 1 : (other.pack(), GetSize(other.chunks_));
+			if (num_chunks != other_num_chunks)
+				return false;
+		}
+
+		updhash();
+		other.updhash();
+
+		if (hash_ != other.hash_)
+			return false;
+
+		bool equal;
+		if (is_inline() && other.is_inline())
+			equal = inline_.wire == other.inline_.wire && (inline_.wire ? inline_.offset == other.inline_.offset : inline_.data == other.inline_.data);
+		else
+			equal = (is_inline() ? inline_chunk() : chunks_[0]) == (other.is_inline() ? other.inline_chunk() : other.chunks_[0]);
+
+		if (!equal) {
+			cover("kernel.rtlil.sigspec.comp_eq.inline_hash_collision");
+			return false;
+		}
+
+		cover("kernel.rtlil.sigspec.comp_eq.inline_equal");
+		return true;
+	}
+
 	pack();
 	other.pack();
 
-	if (chunks_.size() != chunks_.size())
+	if (chunks_.size() != other.chunks_.size())
 		return false;
 
 	updhash();
@@ -3361,6 +4322,9 @@ bool RTLIL::SigSpec::is_wire() const
 {
 	cover("kernel.rtlil.sigspec.is_wire");
 
+	if (is_inline())
+		return inline_.wire && inline_.offset == 0 && inline_.wire->width == width_;
+
 	pack();
 	return GetSize(chunks_) == 1 && chunks_[0].wire && chunks_[0].wire->width == width_;
 }
@@ -3369,6 +4333,9 @@ bool RTLIL::SigSpec::is_chunk() const
 {
 	cover("kernel.rtlil.sigspec.is_chunk");
 
+	if (is_inline())
+		return true;
+
 	pack();
 	return GetSize(chunks_) == 1;
 }
@@ -3377,6 +4344,9 @@ bool RTLIL::SigSpec::is_fully_const() const
 {
 	cover("kernel.rtlil.sigspec.is_fully_const");
 
+	if (is_inline())
+		return inline_.wire == NULL;
+
 	pack();
 	for (auto it = chunks_.begin(); it != chunks_.end(); it++)
 		if (it->width > 0 && it->wire != NULL)
@@ -3388,6 +4358,9 @@ bool RTLIL::SigSpec::is_fully_zero() const
 {
 	cover("kernel.rtlil.sigspec.is_fully_zero");
 
+	if (is_inline())
+		return inline_.wire == NULL && inline_.data == RTLIL::State::S0;
+
 	pack();
 	for (auto it = chunks_.begin(); it != chunks_.end(); it++) {
 		if (it->width > 0 && it->wire != NULL)
@@ -3403,6 +4376,9 @@ bool RTLIL::SigSpec::is_fully_ones() const
 {
 	cover("kernel.rtlil.sigspec.is_fully_ones");
 
+	if (is_inline())
+		return inline_.wire == NULL && inline_.data == RTLIL::State::S1;
+
 	pack();
 	for (auto it = chunks_.begin(); it != chunks_.end(); it++) {
 		if (it->width > 0 && it->wire != NULL)
@@ -3418,6 +4394,9 @@ bool RTLIL::SigSpec::is_fully_def() const
 {
 	cover("kernel.rtlil.sigspec.is_fully_def");
 
+	if (is_inline())
+		return inline_.wire == NULL && (inline_.data == RTLIL::State::S0 || inline_.data == RTLIL::State::S1);
+
 	pack();
 	for (auto it = chunks_.begin(); it != chunks_.end(); it++) {
 		if (it->width > 0 && it->wire != NULL)
@@ -3433,6 +4412,9 @@ bool RTLIL::SigSpec::is_fully_undef() const
 {
 	cover("kernel.rtlil.sigspec.is_fully_undef");
 
+	if (is_inline())
+		return inline_.wire == NULL && (inline_.data == RTLIL::State::Sx || inline_.data == RTLIL::State::Sz);
+
 	pack();
 	for (auto it = chunks_.begin(); it != chunks_.end(); it++) {
 		if (it->width > 0 && it->wire != NULL)
@@ -3448,6 +4430,9 @@ bool RTLIL::SigSpec::has_const() const
 {
 	cover("kernel.rtlil.sigspec.has_const");
 
+	if (is_inline())
+		return inline_.wire == NULL;
+
 	pack();
 	for (auto it = chunks_.begin(); it != chunks_.end(); it++)
 		if (it->width > 0 && it->wire == NULL)
@@ -3459,6 +4444,9 @@ bool RTLIL::SigSpec::has_marked_bits() const
 {
 	cover("kernel.rtlil.sigspec.has_marked_bits");
 
+	if (is_inline())
+		return inline_.wire == NULL && inline_.data == RTLIL::State::Sm;
+
 	pack();
 	for (auto it = chunks_.begin(); it != chunks_.end(); it++)
 		if (it->width > 0 && it->wire == NULL) {
@@ -3473,6 +4461,9 @@ bool RTLIL::SigSpec::as_bool() const
 {
 	cover("kernel.rtlil.sigspec.as_bool");
 
+	if (is_inline())
+		return as_const().as_bool();
+
 	pack();
 	log_assert(is_fully_const() && GetSize(chunks_) <= 1);
 	if (width_)
@@ -3484,6 +4475,9 @@ int RTLIL::SigSpec::as_int(bool is_signed) const
 {
 	cover("kernel.rtlil.sigspec.as_int");
 
+	if (is_inline())
+		return as_const().as_int(is_signed);
+
 	pack();
 	log_assert(is_fully_const() && GetSize(chunks_) <= 1);
 	if (width_)
@@ -3495,6 +4489,9 @@ std::string RTLIL::SigSpec::as_string() const
 {
 	cover("kernel.rtlil.sigspec.as_string");
 
+	if (is_inline())
+		return inline_.wire ? std::string(width_, '?') : RTLIL::Const(inline_.data).as_string();
+
 	pack();
 	std::string str;
 	for (size_t i = chunks_.size(); i > 0; i--) {
@@ -3512,6 +4509,11 @@ RTLIL::Const RTLIL::SigSpec::as_const() const
 {
 	cover("kernel.rtlil.sigspec.as_const");
 
+	if (is_inline()) {
+		log_assert(inline_.wire == NULL);
+		return RTLIL::Const(inline_.data);
+	}
+
 	pack();
 	log_assert(is_fully_const() && GetSize(chunks_) <= 1);
 	if (width_)
@@ -3523,6 +4525,11 @@ RTLIL::Wire *RTLIL::SigSpec::as_wire() const
 {
 	cover("kernel.rtlil.sigspec.as_wire");
 
+	if (is_inline()) {
+		log_assert(is_wire());
+		return inline_.wire;
+	}
+
 	pack();
 	log_assert(is_wire());
 	return chunks_[0].wire;
@@ -3532,6 +4539,9 @@ RTLIL::SigChunk RTLIL::SigSpec::as_chunk() const
 {
 	cover("kernel.rtlil.sigspec.as_chunk");
 
+	if (is_inline())
+		return inline_chunk();
+
 	pack();
 	log_assert(is_chunk());
 	return chunks_[0];
@@ -3542,6 +4552,8 @@ RTLIL::SigBit RTLIL::SigSpec::as_bit() const
 	cover("kernel.rtlil.sigspec.as_bit");
 
 	log_assert(width_ == 1);
+	if (is_inline())
+		return inline_;
 	if (packed())
 		return RTLIL::SigBit(*chunks_.begin());
 	else
@@ -3575,8 +4587,14 @@ std::set<RTLIL::SigBit> RTLIL::SigSpec::to_sigbit_set() const
 {
 	cover("kernel.rtlil.sigspec.to_sigbit_set");
 
-	pack();
 	std::set<RTLIL::SigBit> sigbits;
+	if (is_inline()) {
+		for (int i = 0; i < width_; i++)
+			sigbits.insert(inline_bit(i));
+		return sigbits;
+	}
+
+	pack();
 	for (auto &c : chunks_)
 		for (int i = 0; i < c.width; i++)
 			sigbits.insert(RTLIL::SigBit(c, i));
@@ -3587,8 +4605,14 @@ pool<RTLIL::SigBit> RTLIL::SigSpec::to_sigbit_pool() const
 {
 	cover("kernel.rtlil.sigspec.to_sigbit_pool");
 
-	pack();
 	pool<RTLIL::SigBit> sigbits;
+	if (is_inline()) {
+		for (int i = 0; i < width_; i++)
+			sigbits.insert(inline_bit(i));
+		return sigbits;
+	}
+
+	pack();
 	for (auto &c : chunks_)
 		for (int i = 0; i < c.width; i++)
 			sigbits.insert(RTLIL::SigBit(c, i));
@@ -3599,6 +4623,14 @@ std::vector<RTLIL::SigBit> RTLIL::SigSpec::to_sigbit_vector() const
 {
 	cover("kernel.rtlil.sigspec.to_sigbit_vector");
 
+	if (is_inline()) {
+		std::vector<RTLIL::SigBit> sigbits;
+		sigbits.reserve(width_);
+		for (int i = 0; i < width_; i++)
+			sigbits.push_back(inline_bit(i));
+		return sigbits;
+	}
+
 	unpack();
 	return bits_;
 }
@@ -3774,7 +4806,7 @@ bool RTLIL::SigSpec::parse_rhs(const RTLIL::SigSpec &lhs, RTLIL::SigSpec &sig, R
 		return true;
 	}
 
-	if (lhs.chunks_.size() == 1) {
+	if (lhs.is_inline() || lhs.chunks_.size() == 1) {
 		char *p = (char*)str.c_str(), *endptr;
 		long int val = strtol(p, &endptr, 10);
 		if (endptr && endptr != p && *endptr == 0) {
@@ -24,6 +24,9 @@
 
 YOSYS_NAMESPACE_BEGIN
 
+struct SigMap;
+struct ModIndex;
+
 namespace RTLIL
 {
 	enum State : unsigned char {
@@ -53,10 +56,12 @@ namespace RTLIL
 		CONST_FLAG_REAL   = 4   // unused -- to be used for parameters
 	};
 
+	struct StateVector;
 	struct Const;
 	struct AttrObject;
 	struct Selection;
 	struct Monitor;
+	struct ModuleDict;
 	struct Design;
 	struct Module;
 	struct Wire;
@@ -74,9 +79,25 @@ namespace RTLIL
 
 	typedef std::pair<SigSpec, SigSpec> SigSig;
 
+	// step the xorshift sequence used for the hashidx_ of new objects. objects may
+	// be created from several threads, so the sequence is updated atomically.
+	static inline unsigned int next_hashidx(std::atomic<unsigned int> &counter)
+	{
+		unsigned int value = counter.load(std::memory_order_relaxed);
+		while (!counter.compare_exchange_weak(value, mkhash_xorshift(value), std::memory_order_relaxed)) { }
+		return mkhash_xorshift(value);
+	}
+
 	struct IdString
 	{
 		// the global id string cache
+		//
+		// The cache can be used from many threads at once: Entries live in chunks that are never
+		// moved or freed, so c_str() and reference counting of existing ids don't need any locks.
+		// The index from strings to ids is sharded by hash. Looking up an existing id does not
+		// lock the shard, only creating and removing ids does. Ids that are created before
+		// yosys_setup() finishes (all internal cell types and their ports and parameters) are
+		// immortal: they are never freed and get_reference()/put_reference() skip the refcount.
 
 		static struct destruct_guard_t {
 			bool ok; // POD, will be initialized to zero
@@ -84,81 +105,60 @@ namespace RTLIL
 			~destruct_guard_t() { ok = false; }
 		} destruct_guard;
 
-		static std::vector<int> global_refcount_storage_;
-		static std::vector<char*> global_id_storage_;
-		static dict<char*, int, hash_cstr_ops> global_id_index_;
-		static std::vector<int> global_free_idx_list_;
-
-		static inline int get_reference(int idx)
-		{
-			global_refcount_storage_.at(idx)++;
-			return idx;
-		}
-
-		static inline int get_reference(const char *p)
-		{
-			log_assert(destruct_guard.ok);
+		struct storage_t {
+			std::atomic<char*> str;
+			std::atomic<int> refcount;
+			std::atomic<unsigned int> hash;
+		};
 
-			if (p[0]) {
-				log_assert(p[1] != 0);
-				log_assert(p[0] == '$' || p[0] == '\\');
-			}
+		static const int storage_chunk_bits = 16;
+		static const int storage_max_chunks = 1 << (30 - storage_chunk_bits);
 
-			auto it = global_id_index_.find((char*)p);
-			if (it != global_id_index_.end()) {
-				global_refcount_storage_.at(it->second)++;
-				return it->second;
-			}
+		static std::atomic<storage_t*> global_id_storage_[storage_max_chunks];
+		static int global_immortal_ids_;
 
-			if (global_free_idx_list_.empty()) {
-				log_assert(global_id_storage_.size() < 0x40000000);
-				global_free_idx_list_.push_back(global_id_storage_.size());
-				global_id_storage_.push_back(nullptr);
-				global_refcount_storage_.push_back(0);
-			}
-
-			int idx = global_free_idx_list_.back();
-			global_free_idx_list_.pop_back();
-			global_id_storage_.at(idx) = strdup(p);
-			global_id_index_[global_id_storage_.at(idx)] = idx;
-			global_refcount_storage_.at(idx)++;
-
-			// Avoid Create->Delete->Create pattern
-			static IdString last_created_id;
-			put_reference(last_created_id.index_);
-			last_created_id.index_ = idx;
-			get_reference(last_created_id.index_);
-
-			if (yosys_xtrace) {
-				log("#X# New IdString '%s' with index %d.\n", p, idx);
-				log_backtrace("-X- ", yosys_xtrace-1);
-			}
+		static inline storage_t &storage(int idx) {
+			return global_id_storage_[idx >> storage_chunk_bits].load(std::memory_order_acquire)[idx & ((1 << storage_chunk_bits) - 1)];
+		}
 
+		static inline int get_reference(int idx)
+		{
+			if (idx >= global_immortal_ids_)
+				storage(idx).refcount.fetch_add(1, std::memory_order_relaxed);
 			return idx;
 		}
 
+		static int get_reference(const char *p);
+
 		static inline void put_reference(int idx)
 		{
 			// put_reference() may be called from destructors after the destructor of
-			// global_refcount_storage_ has been run. in this case we simply do nothing.
-			if (!destruct_guard.ok)
+			// the global id cache has been run. in this case we simply do nothing.
+			if (!destruct_guard.ok || idx < global_immortal_ids_)
 				return;
 
-			log_assert(global_refcount_storage_.at(idx) > 0);
+			int refcount = storage(idx).refcount.fetch_sub(1, std::memory_order_acq_rel);
+			log_assert(refcount > 0);
 
-			if (--global_refcount_storage_.at(idx) != 0)
-				return;
+			if (refcount == 1)
+				free_reference(idx);
+		}
 
-			if (yosys_xtrace) {
-				log("#X# Removed IdString '%s' with index %d.\n", global_id_storage_.at(idx), idx);
-				log_backtrace("-X- ", yosys_xtrace-1);
-			}
+		static void free_reference(int idx);
 
-			global_id_index_.erase(global_id_storage_.at(idx));
-			free(global_id_storage_.at(idx));
-			global_id_storage_.at(idx) = nullptr;
-			global_free_idx_list_.push_back(idx);
-		}
+		// make all ids that currently exist immortal (called by yosys_setup())
+		static void make_immortal();
+
+		// number of ids in the cache, including immortal ids
+		static int count_ids();
+
+		// bytes of heap memory used by the cache (strings, entries and index)
+		static size_t mem_usage();
+
+		// While frees are deferred (see parallel_for_modules()), new ids always get fresh indices
+		// in increasing order and released ids stay in the cache until set_defer_frees(false) is
+		// called. This makes the order of ids created by a thread independent of other threads.
+		static void set_defer_frees(bool enable);
 
 		// the actual IdString object is just is a single int
 
@@ -186,11 +186,11 @@ namespace RTLIL
 		}
 
 		const char *c_str() const {
-			return global_id_storage_.at(index_);
+			return storage(index_).str.load(std::memory_order_relaxed);
 		}
 
 		std::string str() const {
-			return std::string(global_id_storage_.at(index_));
+			return std::string(c_str());
 		}
 
 		bool operator<(const IdString &rhs) const {
@@ -450,18 +450,303 @@ namespace RTLIL
 		pool<T> to_pool() const { return *this; }
 		std::vector<T> to_vector() const { return *this; }
 	};
+
+	// Slab allocator for the wires and cells of a module. Objects are carved out of chunks
+	// of growing size, freed objects go on a free list and are reused by the next allocation.
+	// The chunks are only released when the arena is destroyed, i.e. with the module.
+	template<typename T>
+	struct ObjArena
+	{
+		static const int min_chunk_objs = 16;
+		static const int max_chunk_objs = 4096;
+
+		std::vector<char*> chunks;
+		void *free_list = nullptr;
+		char *next_p = nullptr, *end_p = nullptr;
+		int next_chunk_objs = min_chunk_objs;
+
+		ObjArena() { }
+		ObjArena(const ObjArena&) = delete;
+		void operator=(const ObjArena&) = delete;
+
+		~ObjArena() {
+			for (auto chunk : chunks)
+				delete[] chunk;
+		}
+
+		void *allocate()
+		{
+			static_assert(sizeof(T) >= sizeof(void*), "ObjArena<T> needs room for the free list");
+			if (free_list != nullptr) {
+				void *p = free_list;
+				free_list = *static_cast<void**>(p);
+				return p;
+			}
+			if (next_p == end_p) {
+				chunks.push_back(new char[next_chunk_objs * sizeof(T)]);
+				next_p = chunks.back();
+				end_p = next_p + next_chunk_objs * sizeof(T);
+				next_chunk_objs = std::min(2*next_chunk_objs, int(max_chunk_objs));
+			}
+			void *p = next_p;
+			next_p += sizeof(T);
+			return p;
+		}
+
+		void deallocate(void *p) {
+			*static_cast<void**>(p) = free_list;
+			free_list = p;
+		}
+	};
+};
+
+// RTLIL::StateVector is the container used for RTLIL::Const::bits. It has the interface of
+// std::vector<RTLIL::State>, but stores the states packed into 64-bit words: each state uses one
+// bit in each of two bit-planes, plane 0 holding bit 0 of the state (the value) and plane 1
+// holding bit 1 (set for the undefined states Sx and Sz). A third plane for bit 2 (Sa and Sm) is
+// only allocated when such a state is actually stored. Bits past the end of the vector are always
+// zero in all planes, so the words can be processed directly (see calc.cc).
+//
+// Elements are accessed through a proxy reference type. Code that needs an RTLIL::State& must work
+// on a copy of the state and write it back.
+
+struct RTLIL::StateVector
+{
+	struct reference
+	{
+		RTLIL::StateVector *vec;
+		int index;
+
+		reference(RTLIL::StateVector *vec, int index) : vec(vec), index(index) { }
+		reference(const reference &other) = default;
+		operator RTLIL::State() const { return vec->get(index); }
+		reference &operator=(RTLIL::State state) { vec->set(index, state); return *this; }
+		reference &operator=(const reference &other) { vec->set(index, other); return *this; }
+
+		friend void swap(reference a, reference b) {
+			RTLIL::State tmp = a;
+			a = RTLIL::State(b);
+			b = tmp;
+		}
+	};
+
+	template<typename V, typename R>
+	struct iterator_base
+	{
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef RTLIL::State value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef R reference;
+		typedef void pointer;
+
+		V *vec;
+		int index;
+
+		iterator_base() : vec(nullptr), index(0) { }
+		iterator_base(V *vec, int index) : vec(vec), index(index) { }
+		template<typename V2, typename R2> iterator_base(const iterator_base<V2, R2> &other) : vec(other.vec), index(other.index) { }
+
+		R operator*() const { return RTLIL::StateVector::deref(vec, index); }
+		R operator[](difference_type n) const { return RTLIL::StateVector::deref(vec, index + n); }
+
+		iterator_base &operator++() { index++; return *this; }
+		iterator_base &operator--() { index--; return *this; }
+		iterator_base operator++(int) { iterator_base tmp = *this; index++; return tmp; }
+		iterator_base operator--(int) { iterator_base tmp = *this; index--; return tmp; }
+		iterator_base &operator+=(difference_type n) { index += n; return *this; }
+		iterator_base &operator-=(difference_type n) { index -= n; return *this; }
+		iterator_base operator+(difference_type n) const { return iterator_base(vec, index + n); }
+		iterator_base operator-(difference_type n) const { return iterator_base(vec, index - n); }
+		friend iterator_base operator+(difference_type n, const iterator_base &it) { return it + n; }
+		difference_type operator-(const iterator_base &other) const { return index - other.index; }
+
+		bool operator==(const iterator_base &other) const { return index == other.index; }
+		bool operator!=(const iterator_base &other) const { return index != other.index; }
+		bool operator<(const iterator_base &other) const { return index < other.index; }
+		bool operator>(const iterator_base &other) const { return index > other.index; }
+		bool operator<=(const iterator_base &other) const { return index <= other.index; }
+		bool operator>=(const iterator_base &other) const { return index >= other.index; }
+	};
+
+	typedef RTLIL::State value_type;
+	typedef RTLIL::State const_reference;
+	typedef iterator_base<RTLIL::StateVector, reference> iterator;
+	typedef iterator_base<const RTLIL::StateVector, RTLIL::State> const_iterator;
+
+	StateVector() : size_(0), stride_(2) { }
+	explicit StateVector(int width, RTLIL::State state = RTLIL::State::S0) : size_(0), stride_(2) { resize(width, state); }
+	StateVector(const std::vector<RTLIL::State> &states) : size_(0), stride_(2) { append(states.data(), GetSize(states)); }
+
+	template<typename It>
+	StateVector(It first, It last) : size_(0), stride_(2) { assign(first, last); }
+
+	StateVector &operator=(const std::vector<RTLIL::State> &states) {
+		clear();
+		append(states.data(), GetSize(states));
+		return *this;
+	}
+
+	operator std::vector<RTLIL::State>() const;
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+	void clear() { words_.clear(); size_ = 0; stride_ = 2; }
+	void reserve(size_t n) { words_.reserve(num_words(n) * stride_); }
+	void shrink_to_fit() { words_.shrink_to_fit(); }
+	void resize(size_t n, RTLIL::State state = RTLIL::State::S0);
+
+	inline RTLIL::State get(int index) const {
+		const uint64_t *w = &words_[(index >> 6) * stride_];
+		int b = index & 63, s = ((w[0] >> b) & 1) | (((w[1] >> b) & 1) << 1);
+		if (stride_ == 3)
+			s |= ((w[2] >> b) & 1) << 2;
+		return RTLIL::State(s);
+	}
+
+	inline void set(int index, RTLIL::State state) {
+		if ((state & 4) != 0 && stride_ == 2)
+			add_special_plane();
+		uint64_t *w = &words_[(index >> 6) * stride_];
+		uint64_t m = uint64_t(1) << (index & 63);
+		w[0] = (state & 1) ? w[0] | m : w[0] & ~m;
+		w[1] = (state & 2) ? w[1] | m : w[1] & ~m;
+		if (stride_ == 3)
+			w[2] = (state & 4) ? w[2] | m : w[2] & ~m;
+	}
+
+	inline void push_back(RTLIL::State state) {
+		if ((size_ & 63) == 0)
+			words_.resize(words_.size() + stride_);
+		set(size_++, state);
+	}
+
+	inline void pop_back() {
+		set(--size_, RTLIL::State::S0);
+		if ((size_ & 63) == 0)
+			words_.resize(words_.size() - stride_);
+	}
+
+	reference operator[](int index) { return reference(this, index); }
+	RTLIL::State operator[](int index) const { return get(index); }
+
+	reference at(int index) {
+		if (index < 0 || index >= size_)
+			throw std::out_of_range("RTLIL::StateVector::at");
+		return reference(this, index);
+	}
+
+	RTLIL::State at(int index) const {
+		if (index < 0 || index >= size_)
+			throw std::out_of_range("RTLIL::StateVector::at");
+		return get(index);
+	}
+
+	reference front() { return reference(this, 0); }
+	reference back() { return reference(this, size_-1); }
+	RTLIL::State front() const { return get(0); }
+	RTLIL::State back() const { return get(size_-1); }
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, size_); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size_); }
+
+	iterator insert(const_iterator pos, RTLIL::State state) { return insert(pos, 1, state); }
+	iterator insert(const_iterator pos, int n, RTLIL::State state) {
+		std::vector<RTLIL::State> states(n, state);
+		splice(pos.index, 0, states.data(), n);
+		return iterator(this, pos.index);
+	}
+
+	template<typename It>
+	iterator insert(const_iterator pos, It first, It last) {
+		std::vector<RTLIL::State> states(first, last);
+		splice(pos.index, 0, states.data(), GetSize(states));
+		return iterator(this, pos.index);
+	}
+
+	iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+	iterator erase(const_iterator first, const_iterator last) {
+		splice(first.index, last.index - first.index, nullptr, 0);
+		return iterator(this, first.index);
+	}
+
+	void assign(int n, RTLIL::State state) {
+		clear();
+		resize(n, state);
+	}
+
+	template<typename It>
+	void assign(It first, It last) {
+		std::vector<RTLIL::State> states(first, last);
+		clear();
+		append(states.data(), GetSize(states));
+	}
+
+	void swap(RTLIL::StateVector &other) {
+		words_.swap(other.words_);
+		std::swap(size_, other.size_);
+		std::swap(stride_, other.stride_);
+	}
+
+	bool operator==(const RTLIL::StateVector &other) const;
+	bool operator!=(const RTLIL::StateVector &other) const { return !(*this == other); }
+	bool operator<(const RTLIL::StateVector &other) const;
+
+	unsigned int hash() const;
+
+	// Word-level access. Plane 0 holds the value bits, plane 1 the undefined bits and plane 2 the
+	// Sa/Sm bits (always zero if has_special_plane() is false). set_word() masks off bits past the end.
+
+	static inline int num_words(int width) { return (width + 63) >> 6; }
+	int num_words() const { return num_words(size_); }
+	bool has_special_plane() const { return stride_ == 3; }
+
+	uint64_t word_mask(int index) const {
+		int rem = size_ - index * 64;
+		return rem >= 64 ? ~uint64_t(0) : (uint64_t(1) << rem) - 1;
+	}
+
+	uint64_t get_word(int plane, int index) const {
+		return plane < stride_ ? words_[index * stride_ + plane] : 0;
+	}
+
+	void set_word(int plane, int index, uint64_t word) {
+		if (plane == 2 && stride_ == 2) {
+			if ((word & word_mask(index)) == 0)
+				return;
+			add_special_plane();
+		}
+		words_[index * stride_ + plane] = word & word_mask(index);
+	}
+
+	// Bytes of heap memory used for the packed storage
+	size_t mem_usage() const { return words_.capacity() * sizeof(uint64_t); }
+
+private:
+	std::vector<uint64_t> words_;
+	int size_, stride_;
+
+	static reference deref(RTLIL::StateVector *vec, int index) { return reference(vec, index); }
+	static RTLIL::State deref(const RTLIL::StateVector *vec, int index) { return vec->get(index); }
+
+	void add_special_plane();
+	void append(const RTLIL::State *states, int n);
+	void splice(int pos, int n_remove, const RTLIL::State *states, int n_insert);
 };
 
 struct RTLIL::Const
 {
 	int flags;
-	std::vector<RTLIL::State> bits;
+	RTLIL::StateVector bits;
 
 	Const();
 	Const(std::string str);
 	Const(int val, int width = 32);
 	Const(RTLIL::State bit, int width = 1);
 	Const(const std::vector<RTLIL::State> &bits) : bits(bits) { flags = CONST_FLAG_NONE; }
+	Const(const RTLIL::StateVector &bits) : bits(bits) { flags = CONST_FLAG_NONE; }
 	Const(const std::vector<bool> &bits);
 
 	bool operator <(const RTLIL::Const &other) const;
@@ -476,8 +761,8 @@ struct RTLIL::Const
 	std::string decode_string() const;
 
 	inline int size() const { return bits.size(); }
-	inline RTLIL::State &operator[](int index) { return bits.at(index); }
-	inline const RTLIL::State &operator[](int index) const { return bits.at(index); }
+	inline RTLIL::StateVector::reference operator[](int index) { return bits.at(index); }
+	inline RTLIL::State operator[](int index) const { return bits.at(index); }
 
 	bool is_fully_zero() const;
 	bool is_fully_ones() const;
@@ -493,10 +778,7 @@ struct RTLIL::Const
 	}
 
 	inline unsigned int hash() const {
-		unsigned int h = mkhash_init;
-		for (auto b : bits)
-			mkhash(h, b);
-		return h;
+		return bits.hash();
 	}
 };
 
@@ -547,6 +829,7 @@ struct RTLIL::SigBit
 
 	SigBit();
 	SigBit(RTLIL::State bit);
+	SigBit(const RTLIL::StateVector::reference &bit);
 	SigBit(bool bit);
 	SigBit(RTLIL::Wire *wire);
 	SigBit(RTLIL::Wire *wire, int offset);
@@ -587,6 +870,7 @@ struct RTLIL::SigSpec
 private:
 	int width_;
 	unsigned long hash_;
+	RTLIL::SigBit inline_; // see is_inline()
 	std::vector<RTLIL::SigChunk> chunks_; // LSB at index 0
 	std::vector<RTLIL::SigBit> bits_; // LSB at index 0
 
@@ -594,12 +878,25 @@ private:
 	void unpack() const;
 	void updhash() const;
 
+	// A signal that is a single wire chunk or a single constant bit is stored without heap
+	// allocation: chunks_ and bits_ are empty and inline_ holds the first bit. pack() and
+	// unpack() convert it to the other representations when chunks() or bits() are needed.
+	inline bool is_inline() const {
+		return width_ != 0 && chunks_.empty() && bits_.empty();
+	}
+
+	RTLIL::SigChunk inline_chunk() const;
+	RTLIL::SigBit inline_bit(int index) const {
+		return inline_.wire ? RTLIL::SigBit(inline_.wire, inline_.offset + index) : inline_;
+	}
+	void init_chunk(const RTLIL::SigChunk &chunk);
+
 	inline bool packed() const {
 		return bits_.empty();
 	}
 
 	inline void inline_unpack() const {
-		if (!chunks_.empty())
+		if (!chunks_.empty() || is_inline())
 			unpack();
 	}
 
@@ -626,15 +923,21 @@ public:
 	SigSpec(RTLIL::SigSpec &&other) {
 		width_ = other.width_;
 		hash_ = other.hash_;
+		inline_ = other.inline_;
 		chunks_ = std::move(other.chunks_);
 		bits_ = std::move(other.bits_);
+		other.width_ = 0;
+		other.hash_ = 0;
 	}
 
 	const RTLIL::SigSpec &operator=(RTLIL::SigSpec &&other) {
 		width_ = other.width_;
 		hash_ = other.hash_;
+		inline_ = other.inline_;
 		chunks_ = std::move(other.chunks_);
 		bits_ = std::move(other.bits_);
+		other.width_ = 0;
+		other.hash_ = 0;
 		return *this;
 	}
 
@@ -646,11 +949,20 @@ public:
 	inline const std::vector<RTLIL::SigChunk> &chunks() const { pack(); return chunks_; }
 	inline const std::vector<RTLIL::SigBit> &bits() const { inline_unpack(); return bits_; }
 
+	// Bytes of heap memory used for the chunks and bits
+	size_t mem_usage() const;
+
 	inline int size() const { return width_; }
 	inline bool empty() const { return width_ == 0; }
 
-	inline RTLIL::SigBit &operator[](int index) { inline_unpack(); return bits_.at(index); }
-	inline const RTLIL::SigBit &operator[](int index) const { inline_unpack(); return bits_.at(index); }
+	inline RTLIL::SigBit &operator[](int index) {
+		if (width_ == 1 && index == 0 && is_inline()) { hash_ = 0; return inline_; }
+		inline_unpack(); return bits_.at(index);
+	}
+	inline const RTLIL::SigBit &operator[](int index) const {
+		if (width_ == 1 && index == 0 && is_inline()) return inline_;
+		inline_unpack(); return bits_.at(index);
+	}
 
 	inline RTLIL::SigSpecIterator begin() { RTLIL::SigSpecIterator it; it.sig_p = this; it.index = 0; return it; }
 	inline RTLIL::SigSpecIterator end() { RTLIL::SigSpecIterator it; it.sig_p = this; it.index = width_; return it; }
@@ -779,9 +1091,8 @@ struct RTLIL::Monitor
 	unsigned int hash() const { return hashidx_; }
 
 	Monitor() {
-		static unsigned int hashidx_count = 123456789;
-		hashidx_count = mkhash_xorshift(hashidx_count);
-		hashidx_ = hashidx_count;
+		static std::atomic<unsigned int> hashidx_count(123456789);
+		hashidx_ = next_hashidx(hashidx_count);
 	}
 
 	virtual ~Monitor() { }
@@ -793,6 +1104,71 @@ struct RTLIL::Monitor
 	virtual void notify_blackout(RTLIL::Module*) { }
 };
 
+// The modules of a design. A module can be shared with the designs saved by "design -save"
+// (see RTLIL::Module::shared_refs_). A shared module is copied for the saved designs when it is
+// first modified, see RTLIL::Module::unshare(). Code may also modify a module directly (e.g.
+// cell->type or wire->attributes), so the accessors of a saved design compare the shared modules
+// they return with their image first, see RTLIL::Module::check_shared().
+//
+// A module can also be lazy (see RTLIL::Module::lazy_loader_). Both the const and the non-const
+// accessors load a lazy module before they return it, and iterating loads all lazy modules.
+// Code that only needs the names of the modules can iterate over the base dict instead.
+
+struct RTLIL::ModuleDict : public dict<RTLIL::IdString, RTLIL::Module*>
+{
+	typedef dict<RTLIL::IdString, RTLIL::Module*> base;
+	RTLIL::Design *design;
+
+	ModuleDict(RTLIL::Design *design) : design(design) { }
+
+	const_iterator begin() const {
+		load_all();
+		return base::begin();
+	}
+
+	const_iterator find(const RTLIL::IdString &key) const {
+		const_iterator it = base::find(key);
+		if (it != end())
+			load(it->second);
+		return it;
+	}
+
+	RTLIL::Module *const &at(const RTLIL::IdString &key) const {
+		RTLIL::Module *const &module = base::at(key);
+		load(module);
+		return module;
+	}
+
+	iterator begin() {
+		load_all();
+		return base::begin();
+	}
+
+	iterator find(const RTLIL::IdString &key) {
+		iterator it = base::find(key);
+		if (it != end())
+			load(it->second);
+		return it;
+	}
+
+	RTLIL::Module *&at(const RTLIL::IdString &key) {
+		RTLIL::Module *&module = base::at(key);
+		load(module);
+		return module;
+	}
+
+	RTLIL::Module *&operator[](const RTLIL::IdString &key) {
+		RTLIL::Module *&module = base::operator[](key);
+		if (module != nullptr)
+			load(module);
+		return module;
+	}
+
+	inline void load(RTLIL::Module *module) const;
+	void load_all() const;
+	void check_shared(RTLIL::Module *module) const;
+};
+
 struct RTLIL::Design
 {
 	unsigned int hashidx_;
@@ -802,7 +1178,7 @@ struct RTLIL::Design
 	dict<std::string, std::string> scratchpad;
 
 	int refcount_modules_;
-	dict<RTLIL::IdString, RTLIL::Module*> modules_;
+	RTLIL::ModuleDict modules_;
 	std::vector<AST::AstNode*> verilog_packages, verilog_globals;
 	dict<std::string, std::pair<std::string, bool>> verilog_defines;
 
@@ -810,6 +1186,9 @@ struct RTLIL::Design
 	dict<RTLIL::IdString, RTLIL::Selection> selection_vars;
 	std::string selected_active_module;
 
+	// true for the designs saved by "design -save" and "design -push", see RTLIL::ModuleDict
+	bool saved_;
+
 	Design();
 	~Design();
 
@@ -888,13 +1267,77 @@ protected:
 	void add(RTLIL::Wire *wire);
 	void add(RTLIL::Cell *cell);
 
+	// storage for the wires and cells of the module (unless use_arena_ is false)
+	bool use_arena_;
+	RTLIL::ObjArena<RTLIL::Wire> wire_arena_;
+	RTLIL::ObjArena<RTLIL::Cell> cell_arena_;
+	void free_wire(RTLIL::Wire *wire);
+	void free_cell(RTLIL::Cell *cell);
+
+	// see sigmap()
+	SigMap *sigmap_;
+
 public:
+	// initial value of use_arena_ for new modules. set the environment variable
+	// YOSYS_NOARENA to allocate each wire and cell on the heap instead.
+	static bool default_use_arena;
+
+	// SigMap(module) copies sigmap() instead of building a new SigMap from the module
+	// connections. set the environment variable YOSYS_NOSIGMAPCACHE to disable this.
+	static bool use_sigmap_cache;
+
 	RTLIL::Design *design;
 	pool<RTLIL::Monitor*> monitors;
 
 	int refcount_wires_;
 	int refcount_cells_;
 
+	// number of designs holding this module in addition to the first one (see "design
+	// -save"). a shared module is only deleted with its last design. use add_shared_ref()
+	// and remove_shared_ref() to change it.
+	int shared_refs_;
+
+	// the module in write_rtlil_bin format as it was when it was shared. it is created by
+	// add_shared_ref(), or when a shared lazy module is loaded.
+	std::shared_ptr<const std::string> shared_image_;
+
+	// number of modules with shared_refs_ > 0
+	static int shared_modules_count_;
+
+	void add_shared_ref();
+	// returns false if no other design holds the module, it must then be deleted
+	bool remove_shared_ref();
+
+	// give all saved and pushed designs that hold this module their own copy of it, decoded
+	// lazily from shared_image_. the current design keeps this module, so pointers to it
+	// stay valid. the methods below that modify the module call this first.
+	void unshare();
+
+	// unshare the module if current_design holds it and it differs from shared_image_, i.e.
+	// if it was modified without the methods that call unshare(). RTLIL::ModuleDict calls
+	// this for the modules of the saved designs, with yosys_design.
+	void check_shared(RTLIL::Design *current_design);
+	// check_shared() for all modules of current_design. the design command calls this
+	// before it uses the saved designs.
+	static void check_shared_modules(RTLIL::Design *current_design);
+
+	// set by read_rtlil_bin: the module only has its name and attributes, the loader adds
+	// the rest when the module is first returned by the design (see RTLIL::ModuleDict)
+	std::function<void(RTLIL::Module*)> lazy_loader_;
+
+	// set while the lazy_loader_ runs, the loader adds the contents without unsharing
+	bool loading_lazy_;
+
+	// number of modules with a lazy_loader_
+	static int lazy_modules_count_;
+
+	void set_lazy_loader(const std::function<void(RTLIL::Module*)> &loader);
+	// run and clear the lazy_loader_, if there is one
+	void load_lazy();
+
+	// the index returned by ModIndex::cached(), see kernel/modtools.h
+	ModIndex *modindex_;
+
 	dict<RTLIL::IdString, RTLIL::Wire*> wires_;
 	dict<RTLIL::IdString, RTLIL::Cell*> cells_;
 	std::vector<RTLIL::SigSig> connections_;
@@ -920,12 +1363,28 @@ public:
 	void new_connections(const std::vector<RTLIL::SigSig> &new_conn);
 	const std::vector<RTLIL::SigSig> &connections() const;
 
+	// SigMap of the module connections. it is created on first use and then kept up
+	// to date by connect(). changes it can not track (new_connections(), removing or
+	// renaming wires, rewrite_sigspecs()) discard it.
+	const SigMap &sigmap();
+
+	// the SigMap returned by sigmap() if it currently exists, or nullptr
+	const SigMap *cached_sigmap() const { return sigmap_; }
+
+	// discard sigmap() and reload the cached ModIndex. code that modifies connections_
+	// of the module or its cells or renames wires or cells without using the methods
+	// below must call this afterwards.
+	void invalidate_caches();
+
 	std::vector<RTLIL::IdString> ports;
 	void fixup_ports();
 
 	template<typename T> void rewrite_sigspecs(T &functor);
 	void cloneInto(RTLIL::Module *new_mod) const;
 	virtual RTLIL::Module *clone() const;
+	// a new module of the same class, without name, attributes or contents. clone() and
+	// unshare() use it, AstModule copies its AST and options.
+	virtual RTLIL::Module *clone_empty() const;
 
 	bool has_memories() const;
 	bool has_processes() const;
@@ -1269,8 +1728,16 @@ struct RTLIL::Process : public RTLIL::AttrObject
 };
 
 
+inline void RTLIL::ModuleDict::load(RTLIL::Module *module) const {
+	if (RTLIL::Module::lazy_modules_count_ > 0 && module->lazy_loader_)
+		module->load_lazy();
+	if (RTLIL::Module::shared_modules_count_ > 0 && module->shared_refs_ > 0 && design->saved_)
+		check_shared(module);
+}
+
 inline RTLIL::SigBit::SigBit() : wire(NULL), data(RTLIL::State::S0) { }
 inline RTLIL::SigBit::SigBit(RTLIL::State bit) : wire(NULL), data(bit) { }
+inline RTLIL::SigBit::SigBit(const RTLIL::StateVector::reference &bit) : wire(NULL), data(bit) { }
 inline RTLIL::SigBit::SigBit(bool bit) : wire(NULL), data(bit ? RTLIL::S1 : RTLIL::S0) { }
 inline RTLIL::SigBit::SigBit(RTLIL::Wire *wire) : wire(wire), offset(0) { log_assert(wire && wire->width == 1); }
 inline RTLIL::SigBit::SigBit(RTLIL::Wire *wire, int offset) : wire(wire), offset(offset) { log_assert(wire != nullptr); }
@@ -1308,8 +1775,8 @@ inline const RTLIL::SigBit &RTLIL::SigSpecConstIterator::operator*() const {
 }
 
 inline RTLIL::SigBit::SigBit(const RTLIL::SigSpec &sig) {
-	log_assert(sig.size() == 1 && sig.chunks().size() == 1);
-	*this = SigBit(sig.chunks().front());
+	log_assert(sig.size() == 1);
+	*this = sig.as_bit();
 }
 
 template<typename T>
@@ -1323,6 +1790,7 @@ void RTLIL::Module::rewrite_sigspecs(T &functor)
 		functor(it.first);
 		functor(it.second);
 	}
+	invalidate_caches();
 }
 
 template<typename T>
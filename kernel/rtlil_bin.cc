@@ -0,0 +1,696 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/rtlil_bin.h"
+
+#include <errno.h>
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+	const char file_magic[8] = {'Y', 'S', 'R', 'T', 'L', 'B', 'I', 'N'};
+	const int file_version = 1;
+
+	// magic, version, flags, autoidx and offset and count of the three tables
+	const int header_size = 8 + 4 + 4 + 8 + 6 * 8;
+
+	enum { wire_input = 1, wire_output = 2, wire_upto = 4 };
+
+	void put_u32(std::string &out, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			out += char(value >> (8 * i));
+	}
+
+	void put_u64(std::string &out, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+			out += char(value >> (8 * i));
+	}
+
+	uint64_t get_u64(const unsigned char *p)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++)
+			value |= uint64_t(p[i]) << (8 * i);
+		return value;
+	}
+
+	// returns false if the varint does not end before `end'
+	bool get_varint(const unsigned char *&p, const unsigned char *end, uint64_t &value)
+	{
+		value = 0;
+		for (int shift = 0; p != end && shift < 64; shift += 7) {
+			unsigned char c = *(p++);
+			value |= uint64_t(c & 0x7f) << shift;
+			if ((c & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	// dict and pool iterate in the reverse order of insertion
+	template<typename T>
+	auto insertion_order(const T &container) -> std::vector<decltype(&*container.begin())>
+	{
+		std::vector<decltype(&*container.begin())> result;
+		for (auto &it : container)
+			result.push_back(&it);
+		std::reverse(result.begin(), result.end());
+		return result;
+	}
+}
+
+// ---------------------------------------------------------------------------------------
+
+void RtlilBinWriter::write_varint(uint64_t value)
+{
+	while (value >= 0x80) {
+		*out += char((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	*out += char(value);
+}
+
+void RtlilBinWriter::write_signed(int64_t value)
+{
+	write_varint((uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+void RtlilBinWriter::write_id(RTLIL::IdString id)
+{
+	write_varint(ids(id));
+}
+
+void RtlilBinWriter::write_const(const RTLIL::Const &value)
+{
+	write_varint(consts(value.bits));
+	write_varint(value.flags);
+}
+
+void RtlilBinWriter::write_sigspec(const RTLIL::SigSpec &sig)
+{
+	const std::vector<RTLIL::SigChunk> &chunks = sig.chunks();
+	write_varint(chunks.size());
+	for (auto &c : chunks) {
+		if (c.wire == nullptr) {
+			write_varint(0);
+			write_varint(consts(RTLIL::StateVector(c.data)));
+			continue;
+		}
+		auto it = wire_index.find(c.wire);
+		if (it == wire_index.end())
+			log_error("Signal %s refers to a wire that is not in the module.\n", log_signal(sig));
+		write_varint(it->second + 1);
+		write_varint(c.offset);
+		write_varint(c.width);
+	}
+}
+
+void RtlilBinWriter::write_sigsig(const RTLIL::SigSig &sigsig)
+{
+	write_sigspec(sigsig.first);
+	write_sigspec(sigsig.second);
+}
+
+void RtlilBinWriter::write_attributes(const RTLIL::AttrObject *object)
+{
+	write_varint(object->attributes.size());
+	for (auto it : insertion_order(object->attributes)) {
+		write_id(it->first);
+		write_const(it->second);
+	}
+}
+
+void RtlilBinWriter::write_case_rule(const RTLIL::CaseRule *cs)
+{
+	write_varint(cs->compare.size());
+	for (auto &sig : cs->compare)
+		write_sigspec(sig);
+
+	write_varint(cs->actions.size());
+	for (auto &action : cs->actions)
+		write_sigsig(action);
+
+	write_varint(cs->switches.size());
+	for (auto sw : cs->switches) {
+		write_attributes(sw);
+		write_sigspec(sw->signal);
+		write_varint(sw->cases.size());
+		for (auto c : sw->cases)
+			write_case_rule(c);
+	}
+}
+
+void RtlilBinWriter::write_module(RTLIL::Module *module)
+{
+	write_attributes(module);
+
+	write_varint(module->avail_parameters.size());
+	for (auto it : insertion_order(module->avail_parameters))
+		write_id(*it);
+
+	wire_index.clear();
+	write_varint(module->wires_.size());
+	for (auto it : insertion_order(module->wires_)) {
+		RTLIL::Wire *wire = it->second;
+		int index = GetSize(wire_index);
+		wire_index[wire] = index;
+		write_id(wire->name);
+		write_varint(wire->width);
+		write_signed(wire->start_offset);
+		write_varint(wire->port_id);
+		write_varint((wire->port_input ? wire_input : 0) | (wire->port_output ? wire_output : 0) | (wire->upto ? wire_upto : 0));
+		write_attributes(wire);
+	}
+
+	write_varint(module->memories.size());
+	for (auto it : insertion_order(module->memories)) {
+		RTLIL::Memory *memory = it->second;
+		write_id(memory->name);
+		write_signed(memory->width);
+		write_signed(memory->start_offset);
+		write_signed(memory->size);
+		write_attributes(memory);
+	}
+
+	write_varint(module->cells_.size());
+	for (auto it : insertion_order(module->cells_)) {
+		RTLIL::Cell *cell = it->second;
+		write_id(cell->name);
+		write_id(cell->type);
+		write_varint(cell->parameters.size());
+		for (auto param : insertion_order(cell->parameters)) {
+			write_id(param->first);
+			write_const(param->second);
+		}
+		write_varint(cell->connections_.size());
+		for (auto conn : insertion_order(cell->connections_)) {
+			write_id(conn->first);
+			write_sigspec(conn->second);
+		}
+		write_attributes(cell);
+	}
+
+	write_varint(module->processes.size());
+	for (auto it : insertion_order(module->processes)) {
+		RTLIL::Process *proc = it->second;
+		write_id(proc->name);
+		write_attributes(proc);
+		write_case_rule(&proc->root_case);
+		write_varint(proc->syncs.size());
+		for (auto sync : proc->syncs) {
+			write_varint(sync->type);
+			write_sigspec(sync->signal);
+			write_varint(sync->actions.size());
+			for (auto &action : sync->actions)
+				write_sigsig(action);
+		}
+	}
+
+	write_varint(module->connections_.size());
+	for (auto &conn : module->connections_)
+		write_sigsig(conn);
+}
+
+void RtlilBinWriter::write(std::ostream &f, RTLIL::Design *design)
+{
+	const RTLIL::ModuleDict &design_modules = design->modules_;
+	std::vector<RTLIL::Module*> modules;
+	for (auto &it : design_modules)
+		modules.push_back(it.second);
+	write(f, design, modules);
+}
+
+void RtlilBinWriter::write(std::ostream &f, RTLIL::Design*, const std::vector<RTLIL::Module*> &modules)
+{
+	write_file(f, modules, autoidx);
+}
+
+std::string RtlilBinWriter::image(RTLIL::Module *module)
+{
+	std::ostringstream f;
+	write_file(f, std::vector<RTLIL::Module*>{module}, 0);
+	return f.str();
+}
+
+void RtlilBinWriter::write_file(std::ostream &f, const std::vector<RTLIL::Module*> &modules, int file_autoidx)
+{
+	ids.clear();
+	consts.clear();
+
+	std::vector<std::string> sections;
+	std::vector<int> names;
+	for (auto it = modules.rbegin(); it != modules.rend(); ++it) {
+		sections.push_back(std::string());
+		out = &sections.back();
+		write_module(*it);
+		names.push_back(ids((*it)->name));
+	}
+
+	std::string id_table, const_table, directory;
+
+	out = &id_table;
+	for (int i = 0; i < GetSize(ids); i++) {
+		const char *str = ids[i].c_str();
+		size_t len = strlen(str);
+		write_varint(len);
+		id_table.append(str, len);
+	}
+
+	out = &const_table;
+	for (int i = 0; i < GetSize(consts); i++) {
+		const RTLIL::StateVector &bits = consts[i];
+		int planes = bits.has_special_plane() ? 3 : 2;
+		write_varint(bits.size());
+		write_varint(planes);
+		for (int k = 0; k < (GetSize(bits) + 63) / 64; k++)
+			for (int p = 0; p < planes; p++)
+				put_u64(const_table, bits.get_word(p, k));
+	}
+
+	out = &directory;
+	for (int i = 0; i < GetSize(sections); i++) {
+		write_varint(names[i]);
+		write_varint(sections[i].size());
+	}
+
+	std::string header(file_magic, sizeof(file_magic));
+	put_u32(header, file_version);
+	put_u32(header, 0);
+	put_u64(header, file_autoidx);
+	put_u64(header, header_size);
+	put_u64(header, GetSize(ids));
+	put_u64(header, header_size + id_table.size());
+	put_u64(header, GetSize(consts));
+	put_u64(header, header_size + id_table.size() + const_table.size());
+	put_u64(header, GetSize(sections));
+	log_assert(GetSize(header) == header_size);
+
+	f.write(header.data(), header.size());
+	f.write(id_table.data(), id_table.size());
+	f.write(const_table.data(), const_table.size());
+	f.write(directory.data(), directory.size());
+	for (auto &section : sections)
+		f.write(section.data(), section.size());
+
+	ids.clear();
+	consts.clear();
+	wire_index.clear();
+}
+
+// ---------------------------------------------------------------------------------------
+
+RtlilBinReader::RtlilBinReader() : file_autoidx(0), data(nullptr), size(0), ptr(nullptr), end(nullptr)
+{
+}
+
+void RtlilBinReader::open(const std::string &filename)
+{
+	this->filename = filename;
+
+	if (!file.map(filename)) {
+		std::ifstream f(filename.c_str(), std::ifstream::binary);
+		if (f.fail())
+			log_cmd_error("Can't open input file `%s' for reading: %s\n", filename.c_str(), strerror(errno));
+		file.read(f);
+	}
+
+	data = (const unsigned char*)file.data;
+	size = file.size;
+	parse_header();
+}
+
+void RtlilBinReader::open(std::istream &f, const std::string &filename)
+{
+	this->filename = filename;
+
+	file.read(f);
+	data = (const unsigned char*)file.data;
+	size = file.size;
+	parse_header();
+}
+
+void RtlilBinReader::open(std::shared_ptr<const std::string> image, const std::string &filename)
+{
+	this->filename = filename;
+	this->image = image;
+
+	data = (const unsigned char*)image->data();
+	size = image->size();
+	parse_header();
+}
+
+void RtlilBinReader::corrupt()
+{
+	log_error("File `%s' is truncated or corrupted.\n", filename.c_str());
+}
+
+void RtlilBinReader::parse_header()
+{
+	if (size < (size_t)header_size || memcmp(data, file_magic, sizeof(file_magic)) != 0)
+		log_error("File `%s' is not a rtlil_bin file.\n", filename.c_str());
+
+	int version = data[8] | (data[9] << 8) | (data[10] << 16) | (data[11] << 24);
+	if (version != file_version)
+		log_error("File `%s' has version %d of the rtlil_bin format, expected version %d.\n",
+				filename.c_str(), version, file_version);
+
+	file_autoidx = get_u64(data + 16);
+	uint64_t id_offset = get_u64(data + 24), id_count = get_u64(data + 32);
+	uint64_t const_offset = get_u64(data + 40), const_count = get_u64(data + 48);
+	uint64_t dir_offset = get_u64(data + 56), dir_count = get_u64(data + 64);
+
+	if (id_offset > size || const_offset > size || dir_offset > size)
+		corrupt();
+	end = data + size;
+
+	// only the offsets of the ids and consts are collected here, they are decoded by id_at()
+	// and const_at() when they are used
+
+	id_offsets.clear();
+	ptr = data + id_offset;
+	for (uint64_t i = 0; i < id_count; i++) {
+		id_offsets.push_back(ptr - data);
+		uint64_t len = read_varint();
+		if (len > uint64_t(end - ptr))
+			corrupt();
+		ptr += len;
+	}
+	id_cache.assign(id_count, RTLIL::IdString());
+	id_cached.assign(id_count, false);
+
+	const_offsets.clear();
+	ptr = data + const_offset;
+	for (uint64_t i = 0; i < const_count; i++) {
+		const_offsets.push_back(ptr - data);
+		uint64_t width = read_varint(), planes = read_varint();
+		if (width > INT_MAX || (planes != 2 && planes != 3) || (width + 63) / 64 * planes * 8 > uint64_t(end - ptr))
+			corrupt();
+		ptr += (width + 63) / 64 * planes * 8;
+	}
+	const_cache.assign(const_count, RTLIL::StateVector());
+	const_cached.assign(const_count, false);
+
+	modules.clear();
+	ptr = data + dir_offset;
+	for (uint64_t i = 0; i < dir_count; i++) {
+		module_entry_t entry;
+		entry.name = read_id();
+		entry.size = read_varint();
+		modules.push_back(entry);
+	}
+
+	size_t offset = ptr - data;
+	for (auto &entry : modules) {
+		if (entry.size > size - offset)
+			corrupt();
+		entry.offset = offset;
+		offset += entry.size;
+	}
+}
+
+uint64_t RtlilBinReader::read_varint()
+{
+	uint64_t value;
+	if (!get_varint(ptr, end, value))
+		corrupt();
+	return value;
+}
+
+int RtlilBinReader::read_int()
+{
+	uint64_t value = read_varint();
+	if (value > INT_MAX)
+		corrupt();
+	return value;
+}
+
+int64_t RtlilBinReader::read_signed()
+{
+	uint64_t value = read_varint();
+	int64_t result = int64_t(value >> 1) ^ -int64_t(value & 1);
+	if (result < INT_MIN || result > INT_MAX)
+		corrupt();
+	return result;
+}
+
+RTLIL::IdString RtlilBinReader::id_at(uint64_t index)
+{
+	if (index >= id_cache.size())
+		corrupt();
+
+	if (!id_cached[index]) {
+		const unsigned char *p = data + id_offsets[index];
+		uint64_t len;
+		get_varint(p, end, len);
+		std::string str((const char*)p, len);
+		if (!str.empty() && (GetSize(str) < 2 || (str[0] != '$' && str[0] != '\\') || strlen(str.c_str()) != str.size()))
+			corrupt();
+		id_cache[index] = str;
+		id_cached[index] = true;
+	}
+
+	return id_cache[index];
+}
+
+const RTLIL::StateVector &RtlilBinReader::const_at(uint64_t index)
+{
+	if (index >= const_cache.size())
+		corrupt();
+
+	if (!const_cached[index]) {
+		const unsigned char *p = data + const_offsets[index];
+		uint64_t width, planes;
+		get_varint(p, end, width);
+		get_varint(p, end, planes);
+		RTLIL::StateVector &bits = const_cache[index];
+		bits.resize(width);
+		for (int k = 0; k < int(width + 63) / 64; k++)
+			for (int i = 0; i < int(planes); i++, p += 8)
+				bits.set_word(i, k, get_u64(p));
+		const_cached[index] = true;
+	}
+
+	return const_cache[index];
+}
+
+RTLIL::IdString RtlilBinReader::read_id()
+{
+	return id_at(read_varint());
+}
+
+RTLIL::Const RtlilBinReader::read_const()
+{
+	RTLIL::Const value(const_at(read_varint()));
+	value.flags = read_int();
+	return value;
+}
+
+RTLIL::SigChunk RtlilBinReader::read_sigchunk()
+{
+	uint64_t index = read_varint();
+	if (index == 0)
+		return RTLIL::SigChunk(RTLIL::Const(const_at(read_varint())));
+
+	if (index > wires.size())
+		corrupt();
+	RTLIL::Wire *wire = wires[index - 1];
+	int offset = read_int(), width = read_int();
+	if (offset + int64_t(width) > wire->width)
+		corrupt();
+	return RTLIL::SigChunk(wire, offset, width);
+}
+
+RTLIL::SigSpec RtlilBinReader::read_sigspec()
+{
+	int num_chunks = read_int();
+	if (num_chunks == 1)
+		return read_sigchunk();
+
+	std::vector<RTLIL::SigChunk> chunks;
+	for (int i = 0; i < num_chunks; i++)
+		chunks.push_back(read_sigchunk());
+	return chunks;
+}
+
+RTLIL::SigSig RtlilBinReader::read_sigsig()
+{
+	RTLIL::SigSpec first = read_sigspec();
+	RTLIL::SigSpec second = read_sigspec();
+	return RTLIL::SigSig(first, second);
+}
+
+void RtlilBinReader::read_attributes(RTLIL::AttrObject *object)
+{
+	int count = read_int();
+	for (int i = 0; i < count; i++) {
+		RTLIL::IdString name = read_id();
+		object->attributes[name] = read_const();
+	}
+}
+
+void RtlilBinReader::read_case_rule(RTLIL::CaseRule *cs)
+{
+	int count = read_int();
+	for (int i = 0; i < count; i++)
+		cs->compare.push_back(read_sigspec());
+
+	count = read_int();
+	for (int i = 0; i < count; i++)
+		cs->actions.push_back(read_sigsig());
+
+	count = read_int();
+	for (int i = 0; i < count; i++) {
+		RTLIL::SwitchRule *sw = new RTLIL::SwitchRule;
+		cs->switches.push_back(sw);
+		read_attributes(sw);
+		sw->signal = read_sigspec();
+		int num_cases = read_int();
+		for (int k = 0; k < num_cases; k++) {
+			RTLIL::CaseRule *c = new RTLIL::CaseRule;
+			sw->cases.push_back(c);
+			read_case_rule(c);
+		}
+	}
+}
+
+RTLIL::Module *RtlilBinReader::load_module(int index)
+{
+	RTLIL::Module *module = new RTLIL::Module;
+	load_module(index, module);
+	return module;
+}
+
+void RtlilBinReader::load_module(int index, RTLIL::Module *module)
+{
+	load_module_header(index, module);
+	load_module_body(index, module);
+}
+
+void RtlilBinReader::load_module_header(int index, RTLIL::Module *module)
+{
+	const module_entry_t &entry = modules.at(index);
+	ptr = data + entry.offset;
+	end = ptr + entry.size;
+
+	module->name = entry.name;
+	read_attributes(module);
+
+	int count = read_int();
+	for (int i = 0; i < count; i++)
+		module->avail_parameters.insert(read_id());
+}
+
+void RtlilBinReader::load_module_body(int index, RTLIL::Module *module)
+{
+	const module_entry_t &entry = modules.at(index);
+	ptr = data + entry.offset;
+	end = ptr + entry.size;
+
+	// skip the header, it was decoded by load_module_header()
+	RTLIL::AttrObject attributes;
+	read_attributes(&attributes);
+	int count = read_int();
+	for (int i = 0; i < count; i++)
+		read_varint();
+
+	wires.clear();
+	count = read_int();
+	for (int i = 0; i < count; i++) {
+		RTLIL::IdString name = read_id();
+		if (module->wires_.count(name))
+			corrupt();
+		RTLIL::Wire *wire = module->addWire(name, read_int());
+		wire->start_offset = read_signed();
+		wire->port_id = read_int();
+		int flags = read_int();
+		wire->port_input = (flags & wire_input) != 0;
+		wire->port_output = (flags & wire_output) != 0;
+		wire->upto = (flags & wire_upto) != 0;
+		read_attributes(wire);
+		wires.push_back(wire);
+	}
+
+	count = read_int();
+	for (int i = 0; i < count; i++) {
+		RTLIL::Memory *memory = new RTLIL::Memory;
+		memory->name = read_id();
+		memory->width = read_signed();
+		memory->start_offset = read_signed();
+		memory->size = read_signed();
+		read_attributes(memory);
+		module->memories[memory->name] = memory;
+	}
+
+	count = read_int();
+	for (int i = 0; i < count; i++) {
+		RTLIL::IdString name = read_id();
+		if (module->cells_.count(name))
+			corrupt();
+		RTLIL::Cell *cell = module->addCell(name, read_id());
+		int num_params = read_int();
+		for (int k = 0; k < num_params; k++) {
+			RTLIL::IdString param = read_id();
+			cell->parameters[param] = read_const();
+		}
+		int num_conns = read_int();
+		for (int k = 0; k < num_conns; k++) {
+			RTLIL::IdString port = read_id();
+			cell->setPort(port, read_sigspec());
+		}
+		read_attributes(cell);
+	}
+
+	count = read_int();
+	for (int i = 0; i < count; i++) {
+		RTLIL::Process *proc = new RTLIL::Process;
+		proc->name = read_id();
+		module->processes[proc->name] = proc;
+		read_attributes(proc);
+		read_case_rule(&proc->root_case);
+		int num_syncs = read_int();
+		for (int k = 0; k < num_syncs; k++) {
+			RTLIL::SyncRule *sync = new RTLIL::SyncRule;
+			proc->syncs.push_back(sync);
+			int type = read_int();
+			if (type > RTLIL::STi)
+				corrupt();
+			sync->type = RTLIL::SyncType(type);
+			sync->signal = read_sigspec();
+			int num_actions = read_int();
+			for (int j = 0; j < num_actions; j++)
+				sync->actions.push_back(read_sigsig());
+		}
+	}
+
+	std::vector<RTLIL::SigSig> connections;
+	count = read_int();
+	for (int i = 0; i < count; i++)
+		connections.push_back(read_sigsig());
+	module->new_connections(connections);
+
+	if (ptr != end)
+		corrupt();
+
+	module->fixup_ports();
+	wires.clear();
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,151 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/mapfile.h"
+
+#ifndef RTLIL_BIN_H
+#define RTLIL_BIN_H
+
+YOSYS_NAMESPACE_BEGIN
+
+// A binary file format for RTLIL designs, used by write_rtlil_bin and read_rtlil_bin
+//
+// The file starts with a fixed header, followed by three tables and the module sections:
+//
+//   header        "YSRTLBIN", format version, autoidx, and offset and number of
+//                 entries of the id table, the const pool and the module directory
+//   id table      all IdStrings used in the file
+//   const pool    all distinct constant bit vectors (values of attributes and parameters,
+//                 and the constant parts of signals)
+//   directory     name, offset and size of each module section
+//   modules       one section per module, that only refers to the tables above
+//
+// All numbers after the header are LEB128 varints (signed numbers zigzag encoded). The
+// objects in a dict or pool are stored in the order they were inserted (the reverse of
+// the iteration order) and inserted in that order again when the file is read, so a
+// design read from the file iterates exactly like the design that was written.
+//
+// The reader maps the file into memory and decodes the tables and modules only when
+// they are needed, so a single module can be loaded from a large file without decoding
+// the others. read_rtlil_bin only decodes the header of each module and leaves the rest
+// to a lazy loader (see RTLIL::Module::lazy_loader_), which keeps the reader alive.
+
+struct RtlilBinWriter
+{
+	// write the given modules of the design (all modules by default) to the stream
+	void write(std::ostream &f, RTLIL::Design *design);
+	void write(std::ostream &f, RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules);
+
+	// a file with only the given module and without the autoidx of the session, so that
+	// it is the same for the same module contents (see RTLIL::Module::shared_image_)
+	std::string image(RTLIL::Module *module);
+
+private:
+	idict<RTLIL::IdString> ids;
+	idict<RTLIL::StateVector> consts;
+	dict<RTLIL::Wire*, int> wire_index;
+	std::string *out;
+
+	void write_varint(uint64_t value);
+	void write_signed(int64_t value);
+	void write_id(RTLIL::IdString id);
+	void write_const(const RTLIL::Const &value);
+	void write_sigspec(const RTLIL::SigSpec &sig);
+	void write_sigsig(const RTLIL::SigSig &sigsig);
+	void write_attributes(const RTLIL::AttrObject *object);
+	void write_case_rule(const RTLIL::CaseRule *cs);
+	void write_module(RTLIL::Module *module);
+	void write_file(std::ostream &f, const std::vector<RTLIL::Module*> &modules, int file_autoidx);
+};
+
+struct RtlilBinReader
+{
+	RtlilBinReader();
+
+	// map the file into memory, or read it where that is not possible
+	void open(const std::string &filename);
+
+	// read the whole stream into memory
+	void open(std::istream &f, const std::string &filename);
+
+	// decode a file that is already in memory, e.g. from RtlilBinWriter::image()
+	void open(std::shared_ptr<const std::string> image, const std::string &filename);
+
+	// the autoidx value of the session that wrote the file
+	int file_autoidx;
+
+	// the modules in the file, in the order they were added to the design
+	int num_modules() const { return GetSize(modules); }
+	RTLIL::IdString module_name(int index) const { return modules.at(index).name; }
+
+	// decode the module with the given index into a new module, that is not added to a design
+	RTLIL::Module *load_module(int index);
+
+	// decode the module with the given index into an empty module (e.g. an AstModule)
+	void load_module(int index, RTLIL::Module *module);
+
+	// the same in two steps: the name, attributes and parameter names of the module, and
+	// everything else. read_rtlil_bin runs the second step when the module is first used.
+	void load_module_header(int index, RTLIL::Module *module);
+	void load_module_body(int index, RTLIL::Module *module);
+
+private:
+	struct module_entry_t {
+		RTLIL::IdString name;
+		size_t offset, size;
+	};
+
+	std::string filename;
+	const unsigned char *data;
+	size_t size;
+	MappedFile file;
+	std::shared_ptr<const std::string> image;
+
+	std::vector<size_t> id_offsets, const_offsets;
+	std::vector<RTLIL::IdString> id_cache;
+	std::vector<RTLIL::StateVector> const_cache;
+	std::vector<bool> id_cached, const_cached;
+	std::vector<module_entry_t> modules;
+
+	// position in the data while decoding, and the wires of the module being decoded
+	const unsigned char *ptr, *end;
+	std::vector<RTLIL::Wire*> wires;
+
+	void parse_header();
+	void corrupt();
+
+	RTLIL::IdString id_at(uint64_t index);
+	const RTLIL::StateVector &const_at(uint64_t index);
+
+	uint64_t read_varint();
+	int read_int();
+	int64_t read_signed();
+	RTLIL::IdString read_id();
+	RTLIL::Const read_const();
+	RTLIL::SigChunk read_sigchunk();
+	RTLIL::SigSpec read_sigspec();
+	RTLIL::SigSig read_sigsig();
+	void read_attributes(RTLIL::AttrObject *object);
+	void read_case_rule(RTLIL::CaseRule *cs);
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
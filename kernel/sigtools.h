@@ -241,15 +241,23 @@ struct SigMap
 	}
 
 	void set(RTLIL::Module *module)
+	{
+		if (RTLIL::Module::use_sigmap_cache)
+			database = module->sigmap().database;
+		else
+			set(module->connections());
+	}
+
+	void set(const std::vector<RTLIL::SigSig> &connections)
 	{
 		int bitcount = 0;
-		for (auto &it : module->connections())
+		for (auto &it : connections)
 			bitcount += it.first.size();
 
 		database.clear();
 		database.reserve(bitcount);
 
-		for (auto &it : module->connections())
+		for (auto &it : connections)
 			add(it.first, it.second);
 	}
 
@@ -0,0 +1,281 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/structhash.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+	// the finalizer of splitmix64
+	uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 30;
+		h *= 0xbf58476d1ce4e5b9ULL;
+		h ^= h >> 27;
+		h *= 0x94d049bb133111ebULL;
+		h ^= h >> 31;
+		return h;
+	}
+
+	// for ordered sequences. unordered collections (the cells of a module, the ports of
+	// a cell, ...) add up mix() of the hashes of their elements instead.
+	uint64_t combine(uint64_t h, uint64_t v)
+	{
+		return mix(h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+	}
+
+	enum {
+		tag_const = 1, tag_sig, tag_public, tag_internal, tag_conn_lhs, tag_conn_rhs,
+		tag_memory, tag_process, tag_case, tag_switch, tag_sync
+	};
+
+	// The labels of internal wires are refined like in the Weisfeiler-Lehman test: each
+	// round, the label of a wire is combined with the signatures of the cells and module
+	// connections it is connected to, which include the labels of the neighbouring wires.
+	// This stops when a round does not split any group of wires with equal labels.
+	const int max_rounds = 16;
+
+	struct Hasher
+	{
+		RTLIL::Module *module;
+		dict<RTLIL::IdString, uint64_t> id_hashes;
+		dict<RTLIL::Wire*, uint64_t> labels;
+		dict<RTLIL::Cell*, uint64_t> cell_bases;
+
+		Hasher(RTLIL::Module *module) : module(module) { }
+
+		static bool is_internal(RTLIL::IdString name)
+		{
+			return name[0] == '$';
+		}
+
+		// the hash of the string, not of the index of the IdString
+		uint64_t id(RTLIL::IdString name)
+		{
+			auto it = id_hashes.find(name);
+			if (it != id_hashes.end())
+				return it->second;
+
+			uint64_t h = 0xcbf29ce484222325ULL;
+			for (const char *p = name.c_str(); *p; p++)
+				h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+			h = mix(h);
+			id_hashes[name] = h;
+			return h;
+		}
+
+		uint64_t constant(const RTLIL::Const &value)
+		{
+			uint64_t h = combine(combine(tag_const, value.flags), GetSize(value.bits));
+			for (int i = 0; i < GetSize(value.bits); i++)
+				h = combine(h, value.bits.get(i));
+			return h;
+		}
+
+		// all attributes except StructHash::excluded_attributes()
+		uint64_t attributes(const RTLIL::AttrObject *obj)
+		{
+			uint64_t h = 0;
+			for (auto &attr : obj->attributes)
+				if (StructHash::excluded_attributes().count(attr.first) == 0)
+					h += mix(combine(id(attr.first), constant(attr.second)));
+			return h;
+		}
+
+		uint64_t sig(const RTLIL::SigSpec &sig)
+		{
+			uint64_t h = combine(tag_sig, sig.size());
+			for (auto &c : sig.chunks()) {
+				if (c.wire == nullptr) {
+					for (auto state : c.data)
+						h = combine(h, combine(tag_const, state));
+				} else {
+					uint64_t label = labels.at(c.wire);
+					for (int i = 0; i < c.width; i++)
+						h = combine(h, combine(label, c.offset + i));
+				}
+			}
+			return h;
+		}
+
+		uint64_t cell(RTLIL::Cell *cell)
+		{
+			uint64_t ports = 0;
+			for (auto &conn : cell->connections())
+				ports += mix(combine(id(conn.first), sig(conn.second)));
+			return combine(cell_bases.at(cell), ports);
+		}
+
+		void add_occurrences(dict<RTLIL::Wire*, uint64_t> &acc, uint64_t h, const RTLIL::SigSpec &sig)
+		{
+			int index = 0;
+			for (auto &c : sig.chunks()) {
+				if (c.wire != nullptr && is_internal(c.wire->name)) {
+					uint64_t &a = acc[c.wire];
+					for (int i = 0; i < c.width; i++)
+						a += mix(combine(combine(h, index + i), c.offset + i));
+				}
+				index += c.width;
+			}
+		}
+
+		void refine()
+		{
+			int num_groups = 0;
+
+			for (int round = 0; round < max_rounds; round++)
+			{
+				dict<RTLIL::Wire*, uint64_t> acc;
+
+				for (auto &it : module->cells_) {
+					uint64_t h = cell(it.second);
+					for (auto &conn : it.second->connections())
+						add_occurrences(acc, combine(h, id(conn.first)), conn.second);
+				}
+
+				for (auto &conn : module->connections()) {
+					add_occurrences(acc, combine(tag_conn_lhs, sig(conn.second)), conn.first);
+					add_occurrences(acc, combine(tag_conn_rhs, sig(conn.first)), conn.second);
+				}
+
+				std::vector<uint64_t> groups;
+				for (auto &it : labels)
+					if (is_internal(it.first->name)) {
+						it.second = combine(it.second, acc.count(it.first) ? acc.at(it.first) : 0);
+						groups.push_back(it.second);
+					}
+
+				std::sort(groups.begin(), groups.end());
+				int new_num_groups = std::unique(groups.begin(), groups.end()) - groups.begin();
+				if (new_num_groups == num_groups)
+					break;
+				num_groups = new_num_groups;
+			}
+		}
+
+		uint64_t case_rule(const RTLIL::CaseRule *cs)
+		{
+			uint64_t h = tag_case;
+			for (auto &compare : cs->compare)
+				h = combine(h, sig(compare));
+			for (auto &action : cs->actions)
+				h = combine(h, combine(sig(action.first), sig(action.second)));
+			for (auto sw : cs->switches) {
+				h = combine(combine(combine(h, tag_switch), attributes(sw)), sig(sw->signal));
+				for (auto c : sw->cases)
+					h = combine(h, case_rule(c));
+			}
+			return h;
+		}
+
+		uint64_t process(const RTLIL::Process *proc)
+		{
+			uint64_t h = combine(combine(tag_process, attributes(proc)), case_rule(&proc->root_case));
+			for (auto sync : proc->syncs) {
+				h = combine(combine(combine(h, tag_sync), sync->type), sig(sync->signal));
+				for (auto &action : sync->actions)
+					h = combine(h, combine(sig(action.first), sig(action.second)));
+			}
+			return h;
+		}
+
+		uint64_t run()
+		{
+			uint64_t wires = 0, cells = 0, conns = 0, memories = 0, processes = 0, params = 0;
+
+			for (auto &it : module->wires_) {
+				RTLIL::Wire *wire = it.second;
+				uint64_t h = combine(attributes(wire), wire->width);
+				if (is_internal(wire->name))
+					labels[wire] = combine(tag_internal, h);
+				else
+					labels[wire] = combine(combine(tag_public, id(wire->name)), h);
+			}
+
+			for (auto &it : module->cells_) {
+				RTLIL::Cell *c = it.second;
+				uint64_t h = combine(id(c->type), is_internal(c->name) ? 0 : id(c->name));
+				uint64_t p = 0;
+				for (auto &param : c->parameters)
+					p += mix(combine(id(param.first), constant(param.second)));
+				cell_bases[c] = combine(combine(h, p), attributes(c));
+			}
+
+			refine();
+
+			for (auto &it : labels) {
+				RTLIL::Wire *wire = it.first;
+				uint64_t h = combine(combine(it.second, wire->start_offset), wire->upto);
+				h = combine(combine(combine(h, wire->port_id), wire->port_input), wire->port_output);
+				wires += mix(h);
+			}
+
+			for (auto &it : module->cells_)
+				cells += mix(cell(it.second));
+
+			for (auto &conn : module->connections())
+				conns += mix(combine(sig(conn.first), sig(conn.second)));
+
+			for (auto &it : module->memories) {
+				RTLIL::Memory *memory = it.second;
+				uint64_t h = combine(combine(tag_memory, is_internal(memory->name) ? 0 : id(memory->name)), attributes(memory));
+				memories += mix(combine(combine(combine(h, memory->width), memory->start_offset), memory->size));
+			}
+
+			for (auto &it : module->processes)
+				processes += mix(process(it.second));
+
+			for (auto name : module->avail_parameters)
+				params += mix(id(name));
+
+			uint64_t h = combine(wires, cells);
+			h = combine(combine(h, conns), memories);
+			h = combine(combine(h, processes), params);
+			return combine(h, attributes(module));
+		}
+	};
+}
+
+const pool<RTLIL::IdString> &StructHash::excluded_attributes()
+{
+	static const pool<RTLIL::IdString> attrs = { "\\src" };
+	return attrs;
+}
+
+uint64_t StructHash::compute(RTLIL::Module *module)
+{
+	return Hasher(module).run();
+}
+
+uint64_t StructHash::compute(RTLIL::Design *design)
+{
+	uint64_t h = 0;
+	Hasher hasher(nullptr);
+	const RTLIL::ModuleDict &modules = design->modules_;
+	for (auto &it : modules)
+		h += mix(combine(hasher.id(it.first), compute(it.second)));
+	return h;
+}
+
+std::string StructHash::hex(uint64_t value)
+{
+	return stringf("%016llx", (unsigned long long)value);
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,59 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#ifndef STRUCTHASH_H
+#define STRUCTHASH_H
+
+YOSYS_NAMESPACE_BEGIN
+
+// A 64 bit hash of the structure of a module: the ports and other public wires, the
+// cells with their types, parameters and connections, the module connections, memories
+// and processes. Internal ($-named) wires and cells are identified by what they are
+// connected to instead of by their names, so two modules that only differ in the names
+// of internal objects or in the order the objects were created get the same hash.
+// Attributes are part of the hash, except the ones in StructHash::excluded_attributes()
+// ("src", which only records where an object came from). The name of the module is not part
+// of the hash.
+//
+// The hash does not depend on the IdString indices of the session and is the same for
+// the same module in every run of yosys.
+
+struct StructHash
+{
+	// compute the hash of a module. the hash is not cached or maintained incrementally
+	// through Monitor callbacks: the monitors are not told about new, removed or renamed
+	// objects or changed parameters, so a cached hash could be stale. each call walks the
+	// whole module.
+	static uint64_t compute(RTLIL::Module *module);
+
+	// the hashes of all modules of the design, with the module names
+	static uint64_t compute(RTLIL::Design *design);
+
+	// attributes that are not part of the hash
+	static const pool<RTLIL::IdString> &excluded_attributes();
+
+	// e.g. "0123456789abcdef"
+	static std::string hex(uint64_t value);
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/threading.h"
+#include "kernel/modtools.h"
+#include "kernel/profiler.h"
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <thread>
+#  include <condition_variable>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+	thread_local bool thread_in_pool = false;
+
+#ifdef YOSYS_ENABLE_THREADS
+	struct ThreadPoolState
+	{
+		std::mutex mutex;
+		std::condition_variable start_cv, done_cv;
+		std::vector<std::thread> threads;
+		bool shutdown = false;
+
+		// the current batch of jobs
+		const std::function<void(int)> *worker = nullptr;
+		int num_jobs = 0, generation = 0, finished = 0;
+		std::atomic<int> next_job;
+
+		void run_jobs()
+		{
+			for (int i = next_job++; i < num_jobs; i = next_job++)
+				(*worker)(i);
+		}
+
+		// the generation is passed in by setup(), a thread that only read it here could miss
+		// a batch that was started before the thread got to run
+		void thread_main(int seen_generation)
+		{
+			thread_in_pool = true;
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while (1)
+			{
+				start_cv.wait(lock, [&]() { return shutdown || generation != seen_generation; });
+				if (shutdown)
+					break;
+
+				seen_generation = generation;
+				lock.unlock();
+				run_jobs();
+				lock.lock();
+
+				if (++finished == GetSize(threads))
+					done_cv.notify_one();
+			}
+		}
+	};
+
+	// never destroyed, joining threads from static destructors is not safe
+	ThreadPoolState *pool_state = new ThreadPoolState;
+#endif
+}
+
+void ThreadPool::setup(int num_threads)
+{
+	log_assert(!thread_in_pool);
+
+#ifdef YOSYS_ENABLE_THREADS
+	if (!pool_state->threads.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(pool_state->mutex);
+			pool_state->shutdown = true;
+		}
+		pool_state->start_cv.notify_all();
+		for (auto &t : pool_state->threads)
+			t.join();
+		pool_state->threads.clear();
+		pool_state->shutdown = false;
+	}
+
+	for (int i = 1; i < num_threads; i++)
+		pool_state->threads.push_back(std::thread(&ThreadPoolState::thread_main, pool_state, pool_state->generation));
+#else
+	if (num_threads > 1)
+		log_warning("Yosys was built without thread support, ignoring request for %d threads.\n", num_threads);
+#endif
+}
+
+int ThreadPool::size()
+{
+#ifdef YOSYS_ENABLE_THREADS
+	return GetSize(pool_state->threads) + 1;
+#else
+	return 1;
+#endif
+}
+
+void ThreadPool::run(int num_jobs, const std::function<void(int)> &worker)
+{
+#ifdef YOSYS_ENABLE_THREADS
+	if (!thread_in_pool && !pool_state->threads.empty() && num_jobs > 1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(pool_state->mutex);
+			pool_state->worker = &worker;
+			pool_state->num_jobs = num_jobs;
+			pool_state->next_job = 0;
+			pool_state->finished = 0;
+			pool_state->generation++;
+		}
+		pool_state->start_cv.notify_all();
+
+		thread_in_pool = true;
+		pool_state->run_jobs();
+		thread_in_pool = false;
+
+		std::unique_lock<std::mutex> lock(pool_state->mutex);
+		pool_state->done_cv.wait(lock, [&]() { return pool_state->finished == GetSize(pool_state->threads); });
+		pool_state->worker = nullptr;
+		return;
+	}
+#endif
+
+	for (int i = 0; i < num_jobs; i++)
+		worker(i);
+}
+
+namespace {
+	const char *placeholder_prefix = "$parallel$";
+
+	struct ParallelJob
+	{
+		int index;
+		RTLIL::Module *module;
+		LogCapture log;
+		std::vector<std::string> new_id_prefixes;
+		std::vector<RTLIL::IdString> new_names;
+		std::exception_ptr error;
+	};
+
+	thread_local ParallelJob *current_job = nullptr;
+
+	// replace the names of objects that have a placeholder name, preserving the order of the dict
+	template<typename T>
+	void rename_new_ids(dict<RTLIL::IdString, T*> &objects, const dict<RTLIL::IdString, RTLIL::IdString> &new_names)
+	{
+		bool found = false;
+		for (auto &it : objects)
+			if (new_names.count(it.first)) {
+				found = true;
+				break;
+			}
+
+		if (!found)
+			return;
+
+		// dicts iterate in reverse order of their entries
+		std::vector<std::pair<RTLIL::IdString, T*>> entries;
+		entries.reserve(objects.size());
+		for (auto &it : objects)
+			entries.push_back(it);
+
+		objects.clear();
+		for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+			if (new_names.count(it->first))
+				it->second->name = new_names.at(it->first);
+			objects[it->second->name] = it->second;
+		}
+	}
+
+	// replace the placeholders of the given job in a log message
+	std::string replace_placeholders(const ParallelJob &job, const std::string &text)
+	{
+		size_t pos = text.find(placeholder_prefix);
+		if (pos == std::string::npos)
+			return text;
+
+		std::string result;
+		size_t last = 0;
+
+		for (; pos != std::string::npos; pos = text.find(placeholder_prefix, pos + 1))
+		{
+			int job_index = -1, id_index = -1, length = 0;
+			if (sscanf(text.c_str() + pos + strlen(placeholder_prefix), "%d$%d%n", &job_index, &id_index, &length) < 2)
+				continue;
+			if (job_index != job.index || id_index < 0 || id_index >= GetSize(job.new_names))
+				continue;
+
+			result += text.substr(last, pos - last);
+			result += job.new_names[id_index].str();
+			last = pos + strlen(placeholder_prefix) + length;
+		}
+
+		return result + text.substr(last);
+	}
+}
+
+bool in_parallel_worker()
+{
+	return current_job != nullptr;
+}
+
+RTLIL::IdString parallel_new_id(const std::string &prefix)
+{
+	log_assert(current_job != nullptr);
+	std::string name = stringf("%s%d$%d", placeholder_prefix, current_job->index, GetSize(current_job->new_id_prefixes));
+	current_job->new_id_prefixes.push_back(prefix);
+	return name;
+}
+
+void parallel_for_modules(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules,
+		const std::function<void(RTLIL::Module*)> &worker)
+{
+	// with a single thread (or module) this is the plain loop of a serial pass, so "-j 1"
+	// gives exactly the results of the passes before they used parallel_for_modules().
+	// the cached ModIndex of a module is only updated by the worker of that module
+	bool serial = current_job != nullptr || ThreadPool::size() == 1 || GetSize(modules) <= 1 || !design->monitors.empty();
+	for (auto module : modules)
+		for (auto mon : module->monitors)
+			if (mon != module->modindex_)
+				serial = true;
+
+	if (serial) {
+		for (auto module : modules) {
+			int64_t begin_us = Profiler::active() ? Profiler::now_us() : 0;
+			worker(module);
+			Profiler::module_span(module, begin_us);
+		}
+		return;
+	}
+
+	// a worker may look up other modules, they must not be loaded concurrently
+	design->modules_.load_all();
+
+	std::vector<ParallelJob> jobs(modules.size());
+	for (int i = 0; i < GetSize(modules); i++) {
+		jobs[i].index = i;
+		jobs[i].module = modules[i];
+	}
+
+	RTLIL::IdString::set_defer_frees(true);
+
+	ThreadPool::run(GetSize(jobs), [&](int i) {
+		ParallelJob &job = jobs[i];
+		current_job = &job;
+		log_capture = &job.log;
+		int64_t begin_us = Profiler::active() ? Profiler::now_us() : 0;
+		try {
+			worker(job.module);
+		} catch (...) {
+			job.error = std::current_exception();
+		}
+		Profiler::module_span(job.module, begin_us);
+		log_capture = nullptr;
+		current_job = nullptr;
+	});
+
+	std::exception_ptr error;
+	for (auto &job : jobs)
+	{
+		dict<RTLIL::IdString, RTLIL::IdString> new_names;
+		for (int i = 0; i < GetSize(job.new_id_prefixes); i++) {
+			RTLIL::IdString placeholder = stringf("%s%d$%d", placeholder_prefix, job.index, i);
+			RTLIL::IdString name = stringf("%s%d", job.new_id_prefixes[i].c_str(), autoidx++);
+			job.new_names.push_back(name);
+			new_names[placeholder] = name;
+		}
+
+		if (!new_names.empty()) {
+			rename_new_ids(job.module->wires_, new_names);
+			rename_new_ids(job.module->cells_, new_names);
+			job.module->invalidate_caches();
+		}
+
+		if (error == nullptr) {
+			try {
+				job.log.replay([&](const std::string &text) { return replace_placeholders(job, text); });
+				if (job.error != nullptr)
+					std::rethrow_exception(job.error);
+			} catch (...) {
+				error = std::current_exception();
+			}
+		}
+
+		job.log = LogCapture();
+		job.new_names.clear();
+	}
+
+	RTLIL::IdString::set_defer_frees(false);
+
+	if (error != nullptr)
+		std::rethrow_exception(error);
+}
+
+YOSYS_NAMESPACE_END
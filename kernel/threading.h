@@ -0,0 +1,92 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#ifndef THREADING_H
+#define THREADING_H
+
+YOSYS_NAMESPACE_BEGIN
+
+// The global pool of worker threads. Its size is set with the -j option of the
+// yosys executable and defaults to 1 (no worker threads, everything runs in the
+// main thread).
+
+struct ThreadPool
+{
+	// (re)start the pool with the given number of threads, including the main thread
+	static void setup(int num_threads);
+
+	// number of threads, including the main thread
+	static int size();
+
+	// call worker(0) .. worker(num_jobs-1) on the threads of the pool and the calling
+	// thread and wait for all calls to return. worker must not throw. when called from
+	// a worker thread (or with a pool of size 1) all jobs are run in the calling thread.
+	static void run(int num_jobs, const std::function<void(int)> &worker);
+};
+
+// Log output of a thread, see log_capture in kernel/log.h
+
+struct LogCapture
+{
+	enum kind_t { Message, Spacer, Warning, Error, CmdError };
+
+	struct entry_t {
+		kind_t kind;
+		std::string prefix, text;
+	};
+
+	std::vector<entry_t> entries;
+	pool<RTLIL::IdString> id_cache;
+	std::vector<shared_str> string_buf;
+	int string_buf_index = -1;
+
+	// write the captured output to the log, passing the text of each entry through filter
+	void replay(const std::function<std::string(const std::string&)> &filter = nullptr) const;
+};
+
+// Call worker(module) for all modules, using the threads of the pool. The worker
+// may only modify the module it is called for and may only read the rest of the
+// design. The result is the same for any number of threads:
+//
+//  - the log output of each call is captured and replayed in the order of the modules
+//  - NEW_ID returns placeholder names in the workers. after all calls have returned
+//    the placeholders are replaced in module order with the names a serial run would
+//    have used, both in the wires and cells of the module and in the log output.
+//  - while the workers run, IdString frees are deferred (see IdString::set_defer_frees)
+//  - an error (or exception) in a worker is reported after the output of all previous
+//    modules has been replayed. later modules may have been processed already.
+//
+// The modules are processed serially in the calling thread, with none of the above, if
+// the pool has a single thread, if there is only one module, or if monitors are attached
+// to the design or one of the modules (other than the cached ModIndex of the module).
+
+void parallel_for_modules(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules,
+		const std::function<void(RTLIL::Module*)> &worker);
+
+// true while the calling thread runs a worker of parallel_for_modules()
+bool in_parallel_worker();
+
+// used by new_id() in workers: returns a placeholder for the name prefix+autoidx
+RTLIL::IdString parallel_new_id(const std::string &prefix);
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -19,6 +19,7 @@
 
 #include "kernel/yosys.h"
 #include "kernel/celltypes.h"
+#include "kernel/threading.h"
 
 #ifdef YOSYS_ENABLE_READLINE
 #  include <readline/readline.h>
@@ -479,6 +480,7 @@ void yosys_setup()
 	Pass::init_register();
 	yosys_design = new RTLIL::Design;
 	yosys_celltypes.setup();
+	IdString::make_immortal();
 	log_push();
 }
 
@@ -486,6 +488,9 @@ void yosys_shutdown()
 {
 	log_pop();
 
+	// stop the worker threads
+	ThreadPool::setup(1);
+
 	delete yosys_design;
 	yosys_design = NULL;
 
@@ -532,6 +537,9 @@ RTLIL::IdString new_id(std::string file, int line, std::string func)
 	if (pos != std::string::npos)
 		func = func.substr(pos+1);
 
+	if (in_parallel_worker())
+		return parallel_new_id(stringf("$auto$%s:%d:%s$", file.c_str(), line, func.c_str()));
+
 	return stringf("$auto$%s:%d:%s$%d", file.c_str(), line, func.c_str(), autoidx++);
 }
 
@@ -1015,18 +1023,19 @@ static char *readline_obj_generator(const char *text, int state)
 		obj_names.clear();
 
 		RTLIL::Design *design = yosys_get_design();
+		const RTLIL::ModuleDict &modules = design->modules_;
 		int len = strlen(text);
 
 		if (design->selected_active_module.empty())
 		{
-			for (auto &it : design->modules_)
+			for (auto &it : modules)
 				if (RTLIL::unescape_id(it.first).substr(0, len) == text)
 					obj_names.push_back(strdup(RTLIL::id2cstr(it.first)));
 		}
 		else
-		if (design->modules_.count(design->selected_active_module) > 0)
+		if (modules.count(design->selected_active_module) > 0)
 		{
-			RTLIL::Module *module = design->modules_.at(design->selected_active_module);
+			RTLIL::Module *module = modules.at(design->selected_active_module);
 
 			for (auto &it : module->wires_)
 				if (RTLIL::unescape_id(it.first).substr(0, len) == text)
@@ -51,6 +51,8 @@
 #include <initializer_list>
 #include <stdexcept>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <cmath>
 
 #include <sstream>
@@ -185,10 +187,18 @@ using hashlib::hash_ops;
 using hashlib::hash_cstr_ops;
 using hashlib::hash_ptr_ops;
 using hashlib::hash_obj_ops;
-using hashlib::dict;
 using hashlib::idict;
-using hashlib::pool;
 using hashlib::mfp;
+using hashlib::flat_dict;
+using hashlib::flat_pool;
+
+#ifdef YOSYS_FLAT_HASHLIB
+template<typename K, typename T, typename OPS = hash_ops<K>> using dict = hashlib::flat_dict<K, T, OPS>;
+template<typename K, typename OPS = hash_ops<K>> using pool = hashlib::flat_pool<K, OPS>;
+#else
+using hashlib::dict;
+using hashlib::pool;
+#endif
 
 namespace RTLIL {
 	struct IdString;
@@ -145,6 +145,8 @@ struct ConnwrappersWorker
 							RTLIL::id2cstr(conn.first), log_signal(old_sig), log_signal(conn.second));
 			}
 		}
+
+		module->invalidate_caches();
 	}
 };
 
@@ -25,6 +25,35 @@ YOSYS_NAMESPACE_BEGIN
 std::map<std::string, RTLIL::Design*> saved_designs;
 std::vector<RTLIL::Design*> pushed_designs;
 
+PRIVATE_NAMESPACE_BEGIN
+
+// The saved and pushed designs share module objects with the current design and with each
+// other (see RTLIL::Module::shared_refs_). The saved designs are never modified. When a module
+// of the current design is first modified, the saved designs get their own copy of it and the
+// current design keeps the original, so that pointers to it stay valid (see
+// RTLIL::Module::unshare()).
+
+void share_module(RTLIL::Design *design, RTLIL::IdString name, RTLIL::Module *module)
+{
+	design->modules_[name] = module;
+	module->add_shared_ref();
+}
+
+void release_module(RTLIL::Module *module)
+{
+	if (!module->remove_shared_ref())
+		delete module;
+}
+
+RTLIL::Design *new_saved_design()
+{
+	RTLIL::Design *saved_design = new RTLIL::Design;
+	saved_design->saved_ = true;
+	return saved_design;
+}
+
+PRIVATE_NAMESPACE_END
+
 struct DesignPass : public Pass {
 	DesignPass() : Pass("design", "save, restore and reset current design") { }
 	~DesignPass() YS_OVERRIDE {
@@ -93,6 +122,13 @@ struct DesignPass : public Pass {
 		log("The Verilog front-end remembers defined macros and top-level declarations\n");
 		log("between calls to 'read_verilog'. This command resets this memory.\n");
 		log("\n");
+		log("\n");
+		log("Saved and pushed designs share unmodified modules with the current design and\n");
+		log("with each other instead of holding a copy. The saved designs get their own copy\n");
+		log("of a module when it is first modified in the current design. A pass that only\n");
+		log("modifies some modules therefore only copies those. Modules copied with -as or\n");
+		log("imported with -import are always copied.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
 	{
@@ -106,6 +142,10 @@ struct DesignPass : public Pass {
 		std::string save_name, load_name, as_name;
 		std::vector<RTLIL::Module*> copy_src_modules;
 
+		// shared modules may have been modified without unsharing them. the saved designs
+		// must not see that, and a new saved design needs a new image.
+		RTLIL::Module::check_shared_modules(design);
+
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
 		{
@@ -159,7 +199,7 @@ struct DesignPass : public Pass {
 			if (!got_mode && args[argidx] == "-copy-to" && argidx+1 < args.size()) {
 				got_mode = true;
 				if (saved_designs.count(args[++argidx]) == 0)
-					saved_designs[args[argidx]] = new RTLIL::Design;
+					saved_designs[args[argidx]] = new_saved_design();
 				copy_to_design = saved_designs.at(args[argidx]);
 				copy_from_design = design;
 				continue;
@@ -231,7 +271,7 @@ struct DesignPass : public Pass {
 			dict<IdString, IdString> done;
 
 			if (copy_to_design->modules_.count(prefix))
-				delete copy_to_design->modules_.at(prefix);
+				release_module(copy_to_design->modules_.at(prefix));
 
 			if (GetSize(copy_src_modules) != 1)
 				log_cmd_error("No top module found in source design.\n");
@@ -269,7 +309,7 @@ struct DesignPass : public Pass {
 						log("Importing %s as %s.\n", log_id(fmod), log_id(trg_name));
 
 						if (copy_to_design->modules_.count(trg_name))
-							delete copy_to_design->modules_.at(trg_name);
+							release_module(copy_to_design->modules_.at(trg_name));
 
 						copy_to_design->modules_[trg_name] = fmod->clone();
 						copy_to_design->modules_[trg_name]->name = trg_name;
@@ -295,7 +335,14 @@ struct DesignPass : public Pass {
 				std::string trg_name = as_name.empty() ? mod->name.str() : RTLIL::escape_id(as_name);
 
 				if (copy_to_design->modules_.count(trg_name))
-					delete copy_to_design->modules_.at(trg_name);
+					release_module(copy_to_design->modules_.at(trg_name));
+
+				if (trg_name == mod->name.str()) {
+					share_module(copy_to_design, trg_name, mod);
+					if (copy_to_design == design)
+						mod->design = design;
+					continue;
+				}
 
 				copy_to_design->modules_[trg_name] = mod->clone();
 				copy_to_design->modules_[trg_name]->name = trg_name;
@@ -305,10 +352,12 @@ struct DesignPass : public Pass {
 
 		if (!save_name.empty() || push_mode)
 		{
-			RTLIL::Design *design_copy = new RTLIL::Design;
+			RTLIL::Design *design_copy = new_saved_design();
+			const RTLIL::ModuleDict::base &modules = design->modules_;
 
-			for (auto &it : design->modules_)
-				design_copy->add(it.second->clone());
+			// lazy modules are shared without loading them
+			for (auto &it : modules)
+				share_module(design_copy, it.first, it.second);
 
 			design_copy->selection_stack = design->selection_stack;
 			design_copy->selection_vars = design->selection_vars;
@@ -325,8 +374,9 @@ struct DesignPass : public Pass {
 
 		if (reset_mode || !load_name.empty() || push_mode || pop_mode)
 		{
-			for (auto &it : design->modules_)
-				delete it.second;
+			const RTLIL::ModuleDict::base &modules = design->modules_;
+			for (auto &it : modules)
+				release_module(it.second);
 			design->modules_.clear();
 
 			design->selection_stack.clear();
@@ -353,8 +403,11 @@ struct DesignPass : public Pass {
 		{
 			RTLIL::Design *saved_design = pop_mode ? pushed_designs.back() : saved_designs.at(load_name);
 
-			for (auto &it : saved_design->modules_)
-				design->add(it.second->clone());
+			const RTLIL::ModuleDict::base &modules = saved_design->modules_;
+			for (auto &it : modules) {
+				design->add(it.second);
+				it.second->add_shared_ref();
+			}
 
 			design->selection_stack = saved_design->selection_stack;
 			design->selection_vars = saved_design->selection_vars;
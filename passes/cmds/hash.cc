@@ -0,0 +1,130 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/structhash.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct HashPass : public Pass {
+	HashPass() : Pass("hash", "print structural hashes of modules") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    hash [options] [selection]\n");
+		log("\n");
+		log("Print a hash of the structure of each selected module: the ports and other\n");
+		log("public wires, the cells with their types, parameters and connections, the\n");
+		log("module connections, memories and processes. Internal ($-named) wires and cells\n");
+		log("are identified by what they are connected to, so modules that only differ in\n");
+		log("the names of internal objects or in the order of the objects get the same\n");
+		log("hash. Attributes are part of the hash, except the \"src\" attribute. The module\n");
+		log("names are not part of the hash. When the whole design is selected, a hash of\n");
+		log("all modules and their names is printed as well.\n");
+		log("\n");
+		log("    -dups\n");
+		log("        also list the groups of selected modules that have the same hash.\n");
+		log("\n");
+		log("    -assert-same\n");
+		log("        produce an error if the selected modules do not all have the same\n");
+		log("        hash.\n");
+		log("\n");
+		log("    -assert-different\n");
+		log("        produce an error if two of the selected modules have the same hash.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		bool dups = false;
+		bool assert_same = false;
+		bool assert_different = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-dups") {
+				dups = true;
+				continue;
+			}
+			if (args[argidx] == "-assert-same") {
+				assert_same = true;
+				continue;
+			}
+			if (args[argidx] == "-assert-different") {
+				assert_different = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		log_header(design, "Executing HASH pass.\n");
+
+		std::vector<std::pair<std::string, uint64_t>> hashes;
+		for (auto module : design->selected_modules())
+			hashes.push_back(std::make_pair(module->name.str(), StructHash::compute(module)));
+		std::sort(hashes.begin(), hashes.end());
+
+		for (auto &it : hashes)
+			log("  %s  %s\n", StructHash::hex(it.second).c_str(), log_id(it.first));
+
+		if (design->full_selection())
+			log("  %s  (design)\n", StructHash::hex(StructHash::compute(design)).c_str());
+
+		if (dups)
+		{
+			std::map<uint64_t, std::vector<std::string>> groups;
+			for (auto &it : hashes)
+				groups[it.second].push_back(it.first);
+
+			bool found = false;
+			for (auto &it : groups) {
+				if (GetSize(it.second) < 2)
+					continue;
+				if (!found)
+					log("\nModules with the same hash:\n");
+				found = true;
+				std::string names;
+				for (auto &name : it.second)
+					names += stringf(" %s", log_id(name));
+				log("  %s %s\n", StructHash::hex(it.first).c_str(), names.c_str());
+			}
+			if (!found)
+				log("\nNo modules with the same hash.\n");
+		}
+
+		if (assert_same)
+			for (auto &it : hashes)
+				if (it.second != hashes.front().second)
+					log_error("Modules %s and %s have different hashes.\n", log_id(hashes.front().first), log_id(it.first));
+
+		if (assert_different) {
+			std::map<uint64_t, std::string> seen;
+			for (auto &it : hashes) {
+				if (seen.count(it.second))
+					log_error("Modules %s and %s have the same hash.\n", log_id(seen.at(it.second)), log_id(it.first));
+				seen[it.second] = it.first;
+			}
+		}
+	}
+} HashPass;
+
+PRIVATE_NAMESPACE_END
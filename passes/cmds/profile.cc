@@ -0,0 +1,101 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/profiler.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct ProfilePass : public Pass {
+	ProfilePass() : Pass("profile", "write a trace of the executed commands") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    profile -o tracefile [cmd]\n");
+		log("\n");
+		log("Write a trace of the following commands to the specified file, in the Chrome\n");
+		log("trace event format that can be viewed in chrome://tracing or in Perfetto. This\n");
+		log("replaces the trace that was started before by this command or 'yosys -P'.\n");
+		log("\n");
+		log("When a command is given, only that command is traced to the file. A trace that\n");
+		log("was started before stays open and also gets the events of the command.\n");
+		log("\n");
+		log("Each command is a span that contains the spans of the commands it calls, with\n");
+		log("the number of modules and cells in the design before and after the command and\n");
+		log("the peak resident set size of the process after the command. Passes that work\n");
+		log("on the modules in parallel (see 'yosys -j') add a span per module on the thread\n");
+		log("that processed it.\n");
+		log("\n");
+		log("    profile -stop\n");
+		log("\n");
+		log("Stop tracing and close the trace file. This is done automatically when yosys\n");
+		log("exits. See also 'yosys -P tracefile'.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		std::string filename;
+		bool stop = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-o" && argidx+1 < args.size()) {
+				filename = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-stop") {
+				stop = true;
+				continue;
+			}
+			break;
+		}
+
+		if (stop) {
+			extra_args(args, argidx, design, false);
+			Profiler::stop();
+			return;
+		}
+
+		if (filename.empty())
+			log_cmd_error("Missing -o option.\n");
+
+		if (argidx == args.size()) {
+			Profiler::start(filename);
+			log("Writing trace to `%s'.\n", filename.c_str());
+			return;
+		}
+
+		Profiler::push_trace(filename);
+		log("Writing trace of the command to `%s'.\n", filename.c_str());
+
+		std::vector<std::string> new_args(args.begin() + argidx, args.end());
+		try {
+			Pass::call(design, new_args);
+		} catch (...) {
+			Profiler::pop_trace();
+			throw;
+		}
+		Profiler::pop_trace();
+	}
+} ProfilePass;
+
+PRIVATE_NAMESPACE_END
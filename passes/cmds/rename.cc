@@ -202,6 +202,7 @@ struct RenamePass : public Pass {
 				}
 				module->wires_.swap(new_wires);
 				module->fixup_ports();
+				module->invalidate_caches();
 
 				dict<RTLIL::IdString, RTLIL::Cell*> new_cells;
 				for (auto &it : module->cells_) {
@@ -254,6 +255,7 @@ struct RenamePass : public Pass {
 				}
 				module->wires_.swap(new_wires);
 				module->fixup_ports();
+				module->invalidate_caches();
 
 				dict<RTLIL::IdString, RTLIL::Cell*> new_cells;
 				for (auto &it : module->cells_) {
@@ -285,6 +287,7 @@ struct RenamePass : public Pass {
 				}
 				module->wires_.swap(new_wires);
 				module->fixup_ports();
+				module->invalidate_caches();
 
 				dict<RTLIL::IdString, RTLIL::Cell*> new_cells;
 				for (auto &it : module->cells_) {
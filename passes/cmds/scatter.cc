@@ -66,6 +66,8 @@ struct ScatterPass : public Pass {
 
 				p.second = wire;
 			}
+
+			mod_it.second->invalidate_caches();
 		}
 	}
 } ScatterPass;
@@ -0,0 +1,120 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#include <sys/stat.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#  include <direct.h>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct ScriptCachePass : public Pass {
+	ScriptCachePass() : Pass("script_cache", "cache the results of synthesis script labels") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    script_cache -dir <directory>\n");
+		log("\n");
+		log("Cache the results of the labels of script passes such as 'synth', 'prep' and\n");
+		log("the synth_* commands in the specified directory. The directory is created if\n");
+		log("it does not exist.\n");
+		log("\n");
+		log("Before the commands of a label are executed, a key is computed from the yosys\n");
+		log("version, the commands of the label, the contents of the files named in their\n");
+		log("arguments, and the design. If the cache has an entry for the key, the design\n");
+		log("is restored from it and the commands are skipped. Otherwise the commands are\n");
+		log("executed and the resulting design is written to a new entry (in the format of\n");
+		log("'write_rtlil_bin'). The key of a label that follows a cached label is computed\n");
+		log("from the key of that label instead of the design, so a run of labels that are\n");
+		log("all in the cache only restores the design once, after the last of them.\n");
+		log("\n");
+		log("Labels that contain commands with effects outside the design (e.g. 'write_*',\n");
+		log("'design' or 'tee') are never cached. Nothing is cached when only a part of the\n");
+		log("design is selected. Note that the log output of a label that is restored from\n");
+		log("the cache is not repeated.\n");
+		log("\n");
+		log("The directory is also used to cache the RTLIL of the modules that 'hierarchy'\n");
+		log("derives from parametric Verilog modules. The key of these entries covers the\n");
+		log("yosys version, the options the module was read with and its AST with the\n");
+		log("parameters set, so a label that is not in the cache (e.g. after a change to\n");
+		log("some of the sources) still reuses the unchanged derived modules. Modules with\n");
+		log("interfaces or $readmemh/$readmemb are not cached. The modules are derived one\n");
+		log("after the other, also when yosys runs with more than one thread.\n");
+		log("\n");
+		log("The liberty files read by 'read_liberty', 'dfflibmap' and 'stat -liberty' are\n");
+		log("stored there in parsed form as well, keyed by the path, size and modification\n");
+		log("time of the file.\n");
+		log("\n");
+		log("    script_cache -off\n");
+		log("\n");
+		log("Stop using the cache. The entries in the directory are kept.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
+	{
+		std::string dir;
+		bool off = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-dir" && argidx+1 < args.size()) {
+				dir = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-off") {
+				off = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design, false);
+
+		if (off) {
+			ScriptPass::cache_dir.clear();
+			log("Script cache disabled.\n");
+			return;
+		}
+
+		if (dir.empty())
+			log_cmd_error("Missing -dir or -off option.\n");
+
+		while (GetSize(dir) > 1 && dir.back() == '/')
+			dir.pop_back();
+
+#ifdef _WIN32
+		int ret = _mkdir(dir.c_str());
+#else
+		int ret = mkdir(dir.c_str(), 0777);
+#endif
+		if (ret != 0 && errno != EEXIST)
+			log_cmd_error("Can't create cache directory `%s': %s\n", dir.c_str(), strerror(errno));
+
+		ScriptPass::cache_dir = dir;
+		log("Caching script labels in `%s'.\n", dir.c_str());
+	}
+} ScriptCachePass;
+
+PRIVATE_NAMESPACE_END
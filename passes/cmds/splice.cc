@@ -207,6 +207,7 @@ struct SpliceWorker
 					conn.second = get_spliced_signal(sig);
 				}
 		}
+		module->invalidate_caches();
 
 		std::vector<std::pair<RTLIL::Wire*, RTLIL::SigSpec>> rework_wires;
 		std::vector<Wire*> mod_wires = module->wires();
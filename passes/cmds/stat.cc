@@ -19,6 +19,7 @@
 
 #include "kernel/register.h"
 #include "kernel/celltypes.h"
+#include "kernel/profiler.h"
 #include "passes/techmap/libparse.h"
 
 #include "kernel/log.h"
@@ -188,15 +189,10 @@ statdata_t hierarchy_worker(std::map<RTLIL::IdString, statdata_t> &mod_stat, RTL
 
 void read_liberty_cellarea(dict<IdString, double> &cell_area, string liberty_file)
 {
-	std::ifstream f;
-	f.open(liberty_file.c_str());
-	yosys_input_files.insert(liberty_file);
-	if (f.fail())
-		log_cmd_error("Can't open liberty file `%s': %s\n", liberty_file.c_str(), strerror(errno));
-	LibertyParser libparser(f);
-	f.close();
-
-	for (auto cell : libparser.ast->children)
+	static const std::set<std::string> liberty_filter = { "/library/cell", "/library/cell/area" };
+	std::shared_ptr<LibertyAst> ast = LibertyStore::load(liberty_file, liberty_filter);
+
+	for (auto cell : ast->children)
 	{
 		if (cell->id != "cell" || cell->args.size() != 1)
 			continue;
@@ -207,6 +203,19 @@ void read_liberty_cellarea(dict<IdString, double> &cell_area, string liberty_fil
 	}
 }
 
+void log_mem_usage(const MemoryUsage &usage)
+{
+	log("   Estimated memory:            %9.1f kB\n", usage.total() / 1024.0);
+	log("     wires                      %9.1f kB\n", usage.wires / 1024.0);
+	log("     cells                      %9.1f kB\n", usage.cells / 1024.0);
+	log("     connections                %9.1f kB\n", usage.connections / 1024.0);
+	log("     attributes                 %9.1f kB\n", usage.attributes / 1024.0);
+	log("     const values               %9.1f kB\n", usage.consts / 1024.0);
+	if (usage.idstrings != 0)
+		log("     id strings                 %9.1f kB\n", usage.idstrings / 1024.0);
+	log("     SigMap/ModIndex caches     %9.1f kB\n", usage.caches / 1024.0);
+}
+
 struct StatPass : public Pass {
 	StatPass() : Pass("stat", "print some statistics") { }
 	void help() YS_OVERRIDE
@@ -230,12 +239,20 @@ struct StatPass : public Pass {
 		log("        annotate internal cell types with their word width.\n");
 		log("        e.g. $add_8 for an 8 bit wide $add cell.\n");
 		log("\n");
+		log("    -mem\n");
+		log("        also print an estimate of the memory used by the wires, cells,\n");
+		log("        connections, attributes, const values (of attributes and parameters)\n");
+		log("        and cached SigMaps and ModIndexes of each module, and the memory used\n");
+		log("        by the id strings and the resident set size of the process.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
 	{
 		log_header(design, "Printing statistics.\n");
 
 		bool width_mode = false;
+		bool mem_mode = false;
+		MemoryUsage total_usage;
 		RTLIL::Module *top_mod = NULL;
 		std::map<RTLIL::IdString, statdata_t> mod_stat;
 		dict<IdString, double> cell_area;
@@ -247,6 +264,10 @@ struct StatPass : public Pass {
 				width_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-mem") {
+				mem_mode = true;
+				continue;
+			}
 			if (args[argidx] == "-liberty" && argidx+1 < args.size()) {
 				string liberty_file = args[++argidx];
 				rewrite_filename(liberty_file);
@@ -276,6 +297,14 @@ struct StatPass : public Pass {
 			log("=== %s%s ===\n", RTLIL::id2cstr(mod->name), design->selected_whole_module(mod->name) ? "" : " (partially selected)");
 			log("\n");
 			data.log_data(mod->name, false);
+
+			if (mem_mode) {
+				MemoryUsage usage;
+				usage.add_module(mod);
+				total_usage.add_module(mod);
+				log("\n");
+				log_mem_usage(usage);
+			}
 		}
 
 		if (top_mod != NULL && GetSize(mod_stat) > 1)
@@ -291,6 +320,19 @@ struct StatPass : public Pass {
 			data.log_data(top_mod->name, true);
 		}
 
+		if (mem_mode)
+		{
+			log("\n");
+			log("=== memory ===\n");
+			log("\n");
+
+			total_usage.idstrings = RTLIL::IdString::mem_usage();
+			log_mem_usage(total_usage);
+			log("\n");
+			log("   Resident set size:           %9.1f kB\n", double(Profiler::current_rss_kb()));
+			log("   Peak resident set size:      %9.1f kB\n", double(Profiler::peak_rss_kb()));
+		}
+
 		log("\n");
 	}
 } StatPass;
@@ -385,6 +385,7 @@ static void extract_fsm(RTLIL::Wire *wire)
 	wire->attributes.erase("\\fsm_encoding");
 	wire->name = stringf("$fsm$oldstate%s", wire->name.c_str());
 	module->wires_[wire->name] = wire;
+	module->invalidate_caches();
 
 	// unconnect control outputs from old drivers
 
@@ -397,6 +398,7 @@ static void extract_fsm(RTLIL::Wire *wire)
 		RTLIL::Wire *unconn_wire = module->addWire(stringf("$fsm_unconnect$%s$%d", log_signal(unconn_sig), autoidx++), unconn_sig.size());
 		port_sig.replace(unconn_sig, RTLIL::SigSpec(unconn_wire), &cell->connections_[cellport.second]);
 	}
+	module->invalidate_caches();
 }
 
 struct FsmExtractPass : public Pass {
@@ -57,7 +57,7 @@ static void implement_pattern_cache(RTLIL::Module *module, std::map<RTLIL::Const
 		for (size_t j = 0; j < pattern.bits.size(); j++)
 			if (pattern.bits[j] == RTLIL::State::S0 || pattern.bits[j] == RTLIL::State::S1) {
 				eq_sig_a.append(ctrl_in.extract(j, 1));
-				eq_sig_b.append(RTLIL::SigSpec(pattern.bits[j]));
+				eq_sig_b.append(RTLIL::SigBit(pattern.bits[j]));
 			}
 
 		for (int in_state : it.second)
@@ -176,9 +176,10 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 		state_dff->type = "$adff";
 		state_dff->parameters["\\ARST_POLARITY"] = fsm_cell->parameters["\\ARST_POLARITY"];
 		state_dff->parameters["\\ARST_VALUE"] = fsm_data.state_table[fsm_data.reset_state];
-		for (auto &bit : state_dff->parameters["\\ARST_VALUE"].bits)
-			if (bit != RTLIL::State::S1)
-				bit = RTLIL::State::S0;
+		RTLIL::Const &arst_value = state_dff->parameters["\\ARST_VALUE"];
+		for (int i = 0; i < GetSize(arst_value); i++)
+			if (arst_value.bits[i] != RTLIL::State::S1)
+				arst_value.bits[i] = RTLIL::State::S0;
 		state_dff->setPort("\\ARST", fsm_cell->getPort("\\ARST"));
 	}
 	state_dff->parameters["\\WIDTH"] = RTLIL::Const(fsm_data.state_bits);
@@ -201,7 +202,7 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 		for (size_t j = 0; j < state.bits.size(); j++)
 			if (state.bits[j] == RTLIL::State::S0 || state.bits[j] == RTLIL::State::S1) {
 				sig_a.append(RTLIL::SigSpec(state_wire, j));
-				sig_b.append(RTLIL::SigSpec(state.bits[j]));
+				sig_b.append(RTLIL::SigBit(state.bits[j]));
 			}
 
 		if (sig_b == RTLIL::SigSpec(RTLIL::State::S1))
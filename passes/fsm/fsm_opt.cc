@@ -105,7 +105,7 @@ struct FsmOpt
 			for (int i = 0; i < ctrl_in.size(); i++) {
 				RTLIL::SigSpec ctrl_bit = ctrl_in.extract(i, 1);
 				if (ctrl_bit.is_fully_const()) {
-					if (tr.ctrl_in.bits[i] <= RTLIL::State::S1 && RTLIL::SigSpec(tr.ctrl_in.bits[i]) != ctrl_bit)
+					if (tr.ctrl_in.bits[i] <= RTLIL::State::S1 && RTLIL::SigSpec(RTLIL::SigBit(tr.ctrl_in.bits[i])) != ctrl_bit)
 						goto delete_this_transition;
 					continue;
 				}
@@ -168,8 +168,8 @@ struct FsmOpt
 
 				for (auto tr : fsm_data.transition_table)
 				{
-					RTLIL::State &si = tr.ctrl_in.bits[i];
-					RTLIL::State &sj = tr.ctrl_in.bits[j];
+					RTLIL::StateVector::reference si = tr.ctrl_in.bits[i];
+					RTLIL::StateVector::reference sj = tr.ctrl_in.bits[j];
 
 					if (si > RTLIL::State::S1)
 						si = sj;
@@ -206,8 +206,8 @@ struct FsmOpt
 
 				for (auto tr : fsm_data.transition_table)
 				{
-					RTLIL::State &si = tr.ctrl_in.bits[i];
-					RTLIL::State &sj = tr.ctrl_out.bits[j];
+					RTLIL::State si = tr.ctrl_in.bits[i];
+					RTLIL::State sj = tr.ctrl_out.bits[j];
 
 					if (si > RTLIL::State::S1 || si == sj) {
 						RTLIL::SigSpec tmp(tr.ctrl_in);
@@ -309,6 +309,7 @@ struct FsmOpt
 		opt_const_and_unused_inputs();
 
 		fsm_data.copy_to_cell(cell);
+		module->invalidate_caches();
 	}
 };
 
@@ -48,8 +48,8 @@ struct FsmData
 		cell->parameters["\\STATE_TABLE"] = RTLIL::Const();
 
 		for (int i = 0; i < int(state_table.size()); i++) {
-			std::vector<RTLIL::State> &bits_table = cell->parameters["\\STATE_TABLE"].bits;
-			std::vector<RTLIL::State> &bits_state = state_table[i].bits;
+			RTLIL::StateVector &bits_table = cell->parameters["\\STATE_TABLE"].bits;
+			RTLIL::StateVector &bits_state = state_table[i].bits;
 			bits_table.insert(bits_table.end(), bits_state.begin(), bits_state.end());
 		}
 
@@ -57,16 +57,16 @@ struct FsmData
 		cell->parameters["\\TRANS_TABLE"] = RTLIL::Const();
 		for (int i = 0; i < int(transition_table.size()); i++)
 		{
-			std::vector<RTLIL::State> &bits_table = cell->parameters["\\TRANS_TABLE"].bits;
+			RTLIL::StateVector &bits_table = cell->parameters["\\TRANS_TABLE"].bits;
 			transition_t &tr = transition_table[i];
 
 			RTLIL::Const const_state_in = RTLIL::Const(tr.state_in, state_num_log2);
 			RTLIL::Const const_state_out = RTLIL::Const(tr.state_out, state_num_log2);
-			std::vector<RTLIL::State> &bits_state_in = const_state_in.bits;
-			std::vector<RTLIL::State> &bits_state_out = const_state_out.bits;
+			RTLIL::StateVector &bits_state_in = const_state_in.bits;
+			RTLIL::StateVector &bits_state_out = const_state_out.bits;
 
-			std::vector<RTLIL::State> &bits_ctrl_in = tr.ctrl_in.bits;
-			std::vector<RTLIL::State> &bits_ctrl_out = tr.ctrl_out.bits;
+			RTLIL::StateVector &bits_ctrl_in = tr.ctrl_in.bits;
+			RTLIL::StateVector &bits_ctrl_out = tr.ctrl_out.bits;
 
 			// append lsb first
 			bits_table.insert(bits_table.end(), bits_ctrl_out.begin(), bits_ctrl_out.end());
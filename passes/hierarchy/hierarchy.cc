@@ -386,6 +386,7 @@ bool expand_module(RTLIL::Design *design, RTLIL::Module *module, bool flag_check
 	// If any interface instances or interface ports were found in the module, we need to rederive it completely:
 	if ((interfaces_in_module.size() > 0 || has_interface_ports) && !module->get_bool_attribute("\\interfaces_replaced_in_module")) {
 		module->reprocess_module(design, interfaces_in_module);
+		module->invalidate_caches();
 		return did_something;
 	}
 
@@ -422,6 +423,7 @@ bool expand_module(RTLIL::Design *design, RTLIL::Module *module, bool flag_check
 		}
 	}
 
+	module->invalidate_caches();
 	return did_something;
 }
 
@@ -870,6 +872,7 @@ struct HierarchyPass : public Pass {
 					} else
 						new_connections[conn.first] = conn.second;
 				cell->connections_ = new_connections;
+				module->invalidate_caches();
 			}
 		}
 
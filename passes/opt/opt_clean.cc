@@ -21,6 +21,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/celltypes.h"
+#include "kernel/threading.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <set>
@@ -39,6 +40,11 @@ struct keep_cache_t
 	{
 		this->design = design;
 		cache.clear();
+
+		// fill the cache for all modules, so that queries from parallel workers don't modify it
+		if (design != nullptr)
+			for (auto module : design->modules())
+				query(module);
 	}
 
 	bool query(Module *module)
@@ -79,7 +85,8 @@ struct keep_cache_t
 
 keep_cache_t keep_cache;
 CellTypes ct_reg, ct_all;
-int count_rm_cells, count_rm_wires;
+std::atomic<int> count_rm_cells, count_rm_wires;
+std::atomic<bool> rm_did_something;
 
 void rmunused_module_cells(Module *module, bool verbose)
 {
@@ -138,7 +145,7 @@ void rmunused_module_cells(Module *module, bool verbose)
 	for (auto cell : unused) {
 		if (verbose)
 			log("  removing unused `%s' cell `%s'.\n", cell->type.c_str(), cell->name.c_str());
-		module->design->scratchpad_set_bool("opt.did_something", true);
+		rm_did_something = true;
 		module->remove(cell);
 		count_rm_cells++;
 	}
@@ -243,6 +250,7 @@ void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 	}
 
 	module->connections_.clear();
+	module->invalidate_caches();
 
 	SigPool used_signals;
 	SigPool used_signals_nodrivers;
@@ -431,7 +439,7 @@ void rmunused_module(RTLIL::Module *module, bool purge_mode, bool verbose, bool
 		module->remove(cell);
 	}
 	if (!delcells.empty())
-		module->design->scratchpad_set_bool("opt.did_something", true);
+		rm_did_something = true;
 
 	rmunused_module_cells(module, verbose);
 	rmunused_module_signals(module, purge_mode, verbose);
@@ -483,14 +491,18 @@ struct OptCleanPass : public Pass {
 
 		ct_all.setup(design);
 
-		for (auto module : design->selected_whole_modules_warn()) {
-			if (module->has_processes_warn())
-				continue;
-			rmunused_module(module, purge_mode, true, true);
-		}
+		rm_did_something = false;
+
+		parallel_for_modules(design, design->selected_whole_modules_warn(), [&](RTLIL::Module *module) {
+			if (!module->has_processes_warn())
+				rmunused_module(module, purge_mode, true, true);
+		});
+
+		if (rm_did_something)
+			design->scratchpad_set_bool("opt.did_something", true);
 
 		if (count_rm_cells > 0 || count_rm_wires > 0)
-			log("Removed %d unused cells and %d unused wires.\n", count_rm_cells, count_rm_wires);
+			log("Removed %d unused cells and %d unused wires.\n", int(count_rm_cells), int(count_rm_wires));
 
 		design->optimize();
 		design->sort();
@@ -544,15 +556,18 @@ struct CleanPass : public Pass {
 
 		count_rm_cells = 0;
 		count_rm_wires = 0;
+		rm_did_something = false;
 
-		for (auto module : design->selected_whole_modules()) {
-			if (module->has_processes())
-				continue;
-			rmunused_module(module, purge_mode, false, false);
-		}
+		parallel_for_modules(design, design->selected_whole_modules(), [&](RTLIL::Module *module) {
+			if (!module->has_processes())
+				rmunused_module(module, purge_mode, false, false);
+		});
+
+		if (rm_did_something)
+			design->scratchpad_set_bool("opt.did_something", true);
 
 		if (count_rm_cells > 0 || count_rm_wires > 0)
-			log("Removed %d unused cells and %d unused wires.\n", count_rm_cells, count_rm_wires);
+			log("Removed %d unused cells and %d unused wires.\n", int(count_rm_cells), int(count_rm_wires));
 
 		design->optimize();
 		design->sort();
@@ -21,6 +21,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/celltypes.h"
 #include "kernel/utils.h"
+#include "kernel/threading.h"
 #include "kernel/log.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -29,11 +30,10 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-bool did_something;
+thread_local bool did_something;
 
-void replace_undriven(RTLIL::Design *design, RTLIL::Module *module)
+void replace_undriven(RTLIL::Module *module, CellTypes &ct)
 {
-	CellTypes ct(design);
 	SigMap sigmap(module);
 	SigPool driven_signals;
 	SigPool used_signals;
@@ -1590,21 +1590,30 @@ struct OptExprPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		for (auto module : design->selected_modules())
+		CellTypes ct;
+		if (undriven)
+			ct.setup(design);
+
+		std::atomic<bool> opt_did_something(false);
+
+		parallel_for_modules(design, design->selected_modules(), [&](RTLIL::Module *module)
 		{
 			if (undriven)
-				replace_undriven(design, module);
+				replace_undriven(module, ct);
 
 			do {
 				do {
 					did_something = false;
 					replace_const_cells(design, module, false, mux_undef, mux_bool, do_fine, keepdc, clkinv);
 					if (did_something)
-						design->scratchpad_set_bool("opt.did_something", true);
+						opt_did_something = true;
 				} while (did_something);
 				replace_const_cells(design, module, true, mux_undef, mux_bool, do_fine, keepdc, clkinv);
 			} while (did_something);
-		}
+		});
+
+		if (opt_did_something)
+			design->scratchpad_set_bool("opt.did_something", true);
 
 		log_pop();
 	}
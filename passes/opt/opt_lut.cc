@@ -28,7 +28,7 @@ struct OptLutWorker
 {
 	dict<IdString, dict<int, IdString>> &dlogic;
 	RTLIL::Module *module;
-	ModIndex index;
+	ModIndex &index;
 	SigMap sigmap;
 
 	pool<RTLIL::Cell*> luts;
@@ -94,7 +94,7 @@ struct OptLutWorker
 	}
 
 	OptLutWorker(dict<IdString, dict<int, IdString>> &dlogic, RTLIL::Module *module, int limit) :
-		dlogic(dlogic), module(module), index(module), sigmap(module)
+		dlogic(dlogic), module(module), index(ModIndex::cached(module)), sigmap(module)
 	{
 		log("Discovering LUTs.\n");
 		for (auto cell : module->selected_cells())
@@ -442,7 +442,7 @@ struct OptRmdffPass : public Pass {
 					Const initval = wire->attributes.at("\\init");
 					for (int i = 0; i < GetSize(initval) && i < GetSize(wire); i++)
 						if (initval[i] == State::S0 || initval[i] == State::S1)
-							dff_init_map.add(SigBit(wire, i), initval[i]);
+							dff_init_map.add(SigBit(wire, i), SigBit(initval[i]));
 					for (int i = 0; i < GetSize(wire); i++) {
 						SigBit wire_bit(wire, i), mapped_bit = assign_map(wire_bit);
 						if (mapped_bit.wire) {
@@ -49,7 +49,7 @@ struct ShareWorker
 
 	CellTypes fwd_ct, cone_ct;
 	ModWalker modwalker;
-	ModIndex mi;
+	ModIndex &mi;
 
 	pool<RTLIL::Cell*> cells_to_remove;
 	pool<RTLIL::Cell*> recursion_state;
@@ -1118,7 +1118,7 @@ struct ShareWorker
 	}
 
 	ShareWorker(ShareWorkerConfig config, RTLIL::Design *design, RTLIL::Module *module) :
-			config(config), design(design), module(module), mi(module)
+			config(config), design(design), module(module), mi(ModIndex::cached(module))
 	{
 	#ifndef NDEBUG
 		bool before_scc = module_has_scc();
@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "kernel/sigtools.h"
 #include "kernel/modtools.h"
+#include "kernel/threading.h"
 
 USING_YOSYS_NAMESPACE
 using namespace RTLIL;
@@ -47,14 +48,14 @@ struct WreduceWorker
 {
 	WreduceConfig *config;
 	Module *module;
-	ModIndex mi;
+	ModIndex &mi;
 
 	std::set<Cell*, IdString::compare_ptr_by_name<Cell>> work_queue_cells;
 	std::set<SigBit> work_queue_bits;
 	pool<SigBit> keep_bits;
 
 	WreduceWorker(WreduceConfig *config, Module *module) :
-			config(config), module(module), mi(module) { }
+			config(config), module(module), mi(ModIndex::cached(module)) { }
 
 	void run_cell_mux(Cell *cell)
 	{
@@ -325,6 +326,8 @@ struct WreduceWorker
 		for (auto w : module->wires())
 			complete_wires.insert(mi.sigmap(w));
 
+		bool renamed_wires = false;
+
 		for (auto w : module->selected_wires())
 		{
 			int unused_top_bits = 0;
@@ -349,8 +352,18 @@ struct WreduceWorker
 			log("Removed top %d bits (of %d) from wire %s.%s.\n", unused_top_bits, GetSize(w), log_id(module), log_id(w));
 			Wire *nw = module->addWire(NEW_ID, GetSize(w) - unused_top_bits);
 			module->connect(nw, SigSpec(w).extract(0, GetSize(nw)));
+
+			// renaming wires makes the index reload itself on the next query. keep using it
+			// as it is for the remaining wires and reload it for the next user of the cached
+			// index after the loop.
+			bool auto_reload_module = mi.auto_reload_module;
 			module->swap_names(w, nw);
+			mi.auto_reload_module = auto_reload_module;
+			renamed_wires = true;
 		}
+
+		if (renamed_wires)
+			module->invalidate_caches();
 	}
 };
 
@@ -393,10 +406,10 @@ struct WreducePass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		for (auto module : design->selected_modules())
+		parallel_for_modules(design, design->selected_modules(), [&](Module *module)
 		{
 			if (module->has_processes_warn())
-				continue;
+				return;
 
 			for (auto c : module->selected_cells())
 			{
@@ -431,7 +444,7 @@ struct WreducePass : public Pass {
 
 			WreduceWorker worker(&config, module);
 			worker.run();
-		}
+		});
 	}
 } WreducePass;
 
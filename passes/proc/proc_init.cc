@@ -76,10 +76,10 @@ void proc_init(RTLIL::Module *mod, RTLIL::Process *proc)
 							wireinit.bits.push_back(State::Sx);
 
 						for (int i = 0; i < lhs_c.width; i++) {
-							auto &initbit = wireinit.bits[i + lhs_c.offset];
+							State initbit = wireinit.bits[i + lhs_c.offset];
 							if (initbit != State::Sx && initbit != value[i])
 								log_cmd_error("Conflicting initialization values for %s.\n", log_signal(lhs_c));
-							initbit = value[i];
+							wireinit.bits[i + lhs_c.offset] = value[i];
 						}
 
 						log("  Set init value: %s = %s\n", log_signal(lhs_c.wire), log_signal(wireinit));
@@ -347,11 +347,12 @@ struct VlogHammerReporter
 				log_error("Pattern %s is to short!\n", pattern.c_str());
 			patterns.push_back(sig.as_const());
 			if (invert_pattern) {
-				for (auto &bit : patterns.back().bits)
-					if (bit == RTLIL::State::S0)
-						bit = RTLIL::State::S1;
-					else if (bit == RTLIL::State::S1)
-						bit = RTLIL::State::S0;
+				RTLIL::Const &pattern = patterns.back();
+				for (int i = 0; i < GetSize(pattern); i++)
+					if (pattern.bits[i] == RTLIL::State::S0)
+						pattern.bits[i] = RTLIL::State::S1;
+					else if (pattern.bits[i] == RTLIL::State::S1)
+						pattern.bits[i] = RTLIL::State::S0;
 			}
 			log("Using pattern %s.\n", patterns.back().as_string().c_str());
 		}
@@ -509,6 +509,7 @@ struct ExposePass : public Pass {
 
 				for (auto &conn : module->connections_)
 					conn.first = out_to_in_map(sigmap(conn.first));
+				module->invalidate_caches();
 			}
 
 			if (flag_cut)
@@ -523,6 +524,7 @@ struct ExposePass : public Pass {
 
 				for (auto &conn : module->connections_)
 					conn.second = out_to_in_map(sigmap(conn.second));
+				module->invalidate_caches();
 			}
 
 			std::set<RTLIL::SigBit> set_q_bits;
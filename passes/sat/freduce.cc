@@ -724,6 +724,7 @@ struct FreduceWorker
 				for (auto &port : drv->connections_)
 					if (ct.cell_output(drv->type, port.first))
 						sigmap(port.second).replace(grp[i].bit, dummy_wire, &port.second);
+				module->invalidate_caches();
 
 				if (grp[i].inverted)
 				{
@@ -33,16 +33,11 @@ struct SimShared
 	int rstlen = 1;
 };
 
-void zinit(State &v)
-{
-	if (v != State::S1)
-		v = State::S0;
-}
-
 void zinit(Const &v)
 {
-	for (auto &bit : v.bits)
-		zinit(bit);
+	for (int i = 0; i < GetSize(v); i++)
+		if (v.bits[i] != State::S1)
+			v.bits[i] = State::S0;
 }
 
 struct SimInstance
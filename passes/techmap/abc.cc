@@ -46,6 +46,7 @@
 #include "kernel/celltypes.h"
 #include "kernel/cost.h"
 #include "kernel/log.h"
+#include "kernel/mapfile.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -976,11 +977,14 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 		if (ifs.fail())
 			log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
 
+		MappedFile blif_file;
+		blif_file.open(&ifs, buffer);
+		ifs.close();
+
 		bool builtin_lib = liberty_file.empty();
 		RTLIL::Design *mapped_design = new RTLIL::Design;
-		parse_blif(mapped_design, ifs, builtin_lib ? "\\DFF" : "\\_dff_", false, sop_mode);
-
-		ifs.close();
+		parse_blif(mapped_design, blif_file.data, blif_file.size, builtin_lib ? "\\DFF" : "\\_dff_", false, sop_mode);
+		blif_file.close();
 
 		log_header(design, "Re-integrating ABC results.\n");
 		RTLIL::Module *mapped_mod = mapped_design->modules_["\\netlist"];
@@ -32,6 +32,12 @@ struct cell_mapping {
 };
 static std::map<RTLIL::IdString, cell_mapping> cell_mappings;
 
+// the parts of the liberty file that are used by this pass
+static const std::set<std::string> liberty_filter = {
+	"/library/cell", "/library/cell/area", "/library/cell/dont_use", "/library/cell/ff", "/library/cell/ff/*",
+	"/library/cell/pin", "/library/cell/pin/direction", "/library/cell/pin/function"
+};
+
 static void logmap(std::string dff)
 {
 	if (cell_mappings.count(dff) == 0) {
@@ -592,33 +598,28 @@ struct DfflibmapPass : public Pass {
 		if (liberty_file.empty())
 			log_cmd_error("Missing `-liberty liberty_file' option!\n");
 
-		std::ifstream f;
-		f.open(liberty_file.c_str());
-		if (f.fail())
-			log_cmd_error("Can't open liberty file `%s': %s\n", liberty_file.c_str(), strerror(errno));
-		LibertyParser libparser(f);
-		f.close();
-
-		find_cell(libparser.ast, "$_DFF_N_", false, false, false, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_P_", true, false, false, false, prepare_mode);
-
-		find_cell(libparser.ast, "$_DFF_NN0_", false, true, false, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_NN1_", false, true, false, true, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_NP0_", false, true, true, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_NP1_", false, true, true, true, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PN0_", true, true, false, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PN1_", true, true, false, true, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PP0_", true, true, true, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PP1_", true, true, true, true, prepare_mode);
-
-		find_cell_sr(libparser.ast, "$_DFFSR_NNN_", false, false, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_NNP_", false, false, true, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_NPN_", false, true, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_NPP_", false, true, true, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PNN_", true, false, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PNP_", true, false, true, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PPN_", true, true, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PPP_", true, true, true, prepare_mode);
+		std::shared_ptr<LibertyAst> ast = LibertyStore::load(liberty_file, liberty_filter);
+
+		find_cell(ast.get(), "$_DFF_N_", false, false, false, false, prepare_mode);
+		find_cell(ast.get(), "$_DFF_P_", true, false, false, false, prepare_mode);
+
+		find_cell(ast.get(), "$_DFF_NN0_", false, true, false, false, prepare_mode);
+		find_cell(ast.get(), "$_DFF_NN1_", false, true, false, true, prepare_mode);
+		find_cell(ast.get(), "$_DFF_NP0_", false, true, true, false, prepare_mode);
+		find_cell(ast.get(), "$_DFF_NP1_", false, true, true, true, prepare_mode);
+		find_cell(ast.get(), "$_DFF_PN0_", true, true, false, false, prepare_mode);
+		find_cell(ast.get(), "$_DFF_PN1_", true, true, false, true, prepare_mode);
+		find_cell(ast.get(), "$_DFF_PP0_", true, true, true, false, prepare_mode);
+		find_cell(ast.get(), "$_DFF_PP1_", true, true, true, true, prepare_mode);
+
+		find_cell_sr(ast.get(), "$_DFFSR_NNN_", false, false, false, prepare_mode);
+		find_cell_sr(ast.get(), "$_DFFSR_NNP_", false, false, true, prepare_mode);
+		find_cell_sr(ast.get(), "$_DFFSR_NPN_", false, true, false, prepare_mode);
+		find_cell_sr(ast.get(), "$_DFFSR_NPP_", false, true, true, prepare_mode);
+		find_cell_sr(ast.get(), "$_DFFSR_PNN_", true, false, false, prepare_mode);
+		find_cell_sr(ast.get(), "$_DFFSR_PNP_", true, false, true, prepare_mode);
+		find_cell_sr(ast.get(), "$_DFFSR_PPN_", true, true, false, prepare_mode);
+		find_cell_sr(ast.get(), "$_DFFSR_PPP_", true, true, true, prepare_mode);
 
 		// try to implement as many cells as possible just by inverting
 		// the SET and RESET pins. If necessary, implement cell types
@@ -24,9 +24,18 @@
 #include <istream>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <algorithm>
 
 #ifndef FILTERLIB
-#include "kernel/log.h"
+#include "kernel/yosys.h"
+#include "kernel/mapfile.h"
+#include "libs/sha1/sha1.h"
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+#include <sys/stat.h>
+#include <errno.h>
 #endif
 
 using namespace Yosys;
@@ -82,24 +91,39 @@ void LibertyAst::dump(FILE *f, std::string indent, std::string path, bool path_o
 		fprintf(f, " ;\n");
 }
 
+LibertyParser::LibertyParser(std::istream &f, const std::set<std::string> *filter) : line(1), filter(filter)
+{
+	buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	data = buffer.data();
+	size = buffer.size();
+	pos = 0;
+	ast = parse();
+}
+
+LibertyParser::LibertyParser(const char *data, size_t size, const std::set<std::string> *filter) :
+		data(data), size(size), pos(0), line(1), filter(filter)
+{
+	ast = parse();
+}
+
 int LibertyParser::lexer(std::string &str)
 {
 	int c;
 
 	do {
-		c = f.get();
+		c = get();
 	} while (c == ' ' || c == '\t' || c == '\r');
 
 	if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.' || c == '[' || c == ']') {
 		str = c;
 		while (1) {
-			c = f.get();
+			c = get();
 			if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.' || c == '[' || c == ']')
 				str += c;
 			else
 				break;
 		}
-		f.unget();
+		unget();
 		if (str == "+" || str == "-") {
 			/* Single operator is not an identifier */
 			// fprintf(stderr, "LEX: char >>%s<<\n", str.c_str());
@@ -114,10 +138,10 @@ int LibertyParser::lexer(std::string &str)
 	if (c == '"') {
 		str = "";
 		while (1) {
-			c = f.get();
+			c = get();
 			if (c == '\n')
 				line++;
-			if (c == '"')
+			if (c == '"' || c == EOF)
 				break;
 			str += c;
 		}
@@ -126,34 +150,34 @@ int LibertyParser::lexer(std::string &str)
 	}
 
 	if (c == '/') {
-		c = f.get();
+		c = get();
 		if (c == '*') {
 			int last_c = 0;
 			while (c > 0 && (last_c != '*' || c != '/')) {
 				last_c = c;
-				c = f.get();
+				c = get();
 				if (c == '\n')
 					line++;
 			}
 			return lexer(str);
 		} else if (c == '/') {
 			while (c > 0 && c != '\n')
-				c = f.get();
+				c = get();
 			line++;
 			return lexer(str);
 		}
-		f.unget();
+		unget();
 		// fprintf(stderr, "LEX: char >>/<<\n");
 		return '/';
 	}
 
 	if (c == '\\') {
-		c = f.get();
+		c = get();
 		if (c == '\r')
-			c = f.get();
+			c = get();
 		if (c == '\n')
 			return lexer(str);
-		f.unget();
+		unget();
 		return '\\';
 	}
 
@@ -169,20 +193,79 @@ int LibertyParser::lexer(std::string &str)
 	return c;
 }
 
-LibertyAst *LibertyParser::parse()
+void LibertyParser::skip_statement()
 {
-	std::string str;
+	// skip to the end of a simple or complex attribute or of a group, without tokenizing
+	int depth = 0;
+
+	while (pos < size)
+	{
+		char c = data[pos++];
+
+		if (c == '\n') {
+			line++;
+		} else
+		if (c == '"') {
+			while (pos < size && data[pos] != '"')
+				if (data[pos++] == '\n')
+					line++;
+			pos++;
+		} else
+		if (c == '/' && pos < size && data[pos] == '*') {
+			pos++;
+			while (pos < size && !(data[pos] == '/' && data[pos-1] == '*'))
+				if (data[pos++] == '\n')
+					line++;
+			pos++;
+		} else
+		if (c == '/' && pos < size && data[pos] == '/') {
+			while (pos < size && data[pos] != '\n')
+				pos++;
+		} else
+		if (c == '{') {
+			depth++;
+		} else
+		if (c == '}') {
+			// a statement without ';' at the end of the enclosing group
+			if (depth == 0) {
+				pos--;
+				return;
+			}
+			if (--depth == 0)
+				return;
+		} else
+		if (c == ';' && depth == 0)
+			return;
+	}
+}
 
-	int tok = lexer(str);
+LibertyAst *LibertyParser::parse(const std::string &parent_path, bool path_ok)
+{
+	std::string str, path;
+	int tok;
 
-	while (tok == 'n')
+	while (1)
+	{
 		tok = lexer(str);
 
-	if (tok == '}' || tok < 0)
-		return NULL;
+		while (tok == 'n')
+			tok = lexer(str);
+
+		if (tok == '}' || tok < 0)
+			return NULL;
 
-	if (tok != 'v')
-		error();
+		if (tok != 'v')
+			error();
+
+		if (filter == nullptr)
+			break;
+
+		path = parent_path + "/" + str;
+		if (parent_path.empty() || path_ok || filter->count(path))
+			break;
+
+		skip_statement();
+	}
 
 	LibertyAst *ast = new LibertyAst;
 	ast->id = str;
@@ -233,8 +316,9 @@ LibertyAst *LibertyParser::parse()
 		}
 
 		if (tok == '{') {
+			bool child_path_ok = path_ok || (filter != nullptr && filter->count(path + "/*"));
 			while (1) {
-				LibertyAst *child = parse();
+				LibertyAst *child = parse(path, child_path_ok);
 				if (child == NULL)
 					break;
 				ast->children.push_back(child);
@@ -255,6 +339,219 @@ void LibertyParser::error()
 	log_error("Syntax error in liberty file on line %d.\n", line);
 }
 
+namespace {
+	const char liberty_cache_magic[] = "YSLIBERTY1\n";
+
+	void liberty_put_varint(std::string &buf, uint64_t value)
+	{
+		while (value >= 0x80) {
+			buf += char(0x80 | (value & 0x7f));
+			value >>= 7;
+		}
+		buf += char(value);
+	}
+
+	void liberty_put_string(std::string &buf, const std::string &str)
+	{
+		liberty_put_varint(buf, str.size());
+		buf += str;
+	}
+
+	void liberty_encode(std::string &buf, const LibertyAst *node)
+	{
+		liberty_put_string(buf, node->id);
+		liberty_put_string(buf, node->value);
+		liberty_put_varint(buf, node->args.size());
+		for (auto &arg : node->args)
+			liberty_put_string(buf, arg);
+		liberty_put_varint(buf, node->children.size());
+		for (auto child : node->children)
+			liberty_encode(buf, child);
+	}
+
+	struct LibertyDecoder
+	{
+		const char *ptr, *end;
+
+		bool get_varint(uint64_t &value)
+		{
+			value = 0;
+			for (int shift = 0; ptr != end && shift < 64; shift += 7) {
+				unsigned char c = *ptr++;
+				value |= uint64_t(c & 0x7f) << shift;
+				if ((c & 0x80) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		bool get_string(std::string &str)
+		{
+			uint64_t len;
+			if (!get_varint(len) || len > uint64_t(end - ptr))
+				return false;
+			str.assign(ptr, len);
+			ptr += len;
+			return true;
+		}
+
+		// returns null if the data is truncated or corrupt
+		LibertyAst *decode()
+		{
+			LibertyAst *node = new LibertyAst;
+			uint64_t count;
+
+			if (!get_string(node->id) || !get_string(node->value) || !get_varint(count) || count > uint64_t(end - ptr))
+				goto corrupt;
+
+			node->args.resize(count);
+			for (auto &arg : node->args)
+				if (!get_string(arg))
+					goto corrupt;
+
+			if (!get_varint(count) || count > uint64_t(end - ptr))
+				goto corrupt;
+
+			for (uint64_t i = 0; i < count; i++) {
+				LibertyAst *child = decode();
+				if (child == nullptr)
+					goto corrupt;
+				node->children.push_back(child);
+			}
+			return node;
+
+		corrupt:
+			delete node;
+			return nullptr;
+		}
+	};
+
+	// a library rewritten within the same second must not match the old entry, so the
+	// times have nanosecond resolution where the platform provides it. the ctime also
+	// changes when a tool restores the mtime of a modified file (cp -p, touch -r).
+	struct file_stamp_t {
+		long long size, mtime, ctime;
+
+		file_stamp_t(const struct stat &st) : size(st.st_size)
+		{
+#if defined(__APPLE__)
+			mtime = (long long)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+			ctime = (long long)st.st_ctimespec.tv_sec * 1000000000 + st.st_ctimespec.tv_nsec;
+#elif defined(_WIN32)
+			mtime = (long long)st.st_mtime * 1000000000;
+			ctime = (long long)st.st_ctime * 1000000000;
+#else
+			mtime = (long long)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+			ctime = (long long)st.st_ctim.tv_sec * 1000000000 + st.st_ctim.tv_nsec;
+#endif
+		}
+
+		bool operator==(const file_stamp_t &other) const {
+			return size == other.size && mtime == other.mtime && ctime == other.ctime;
+		}
+	};
+
+	struct liberty_entry_t {
+		file_stamp_t stamp;
+		std::set<std::string> filter;
+		std::shared_ptr<LibertyAst> ast;
+	};
+
+	dict<std::string, std::vector<liberty_entry_t>> liberty_entries;
+}
+
+std::shared_ptr<LibertyAst> LibertyStore::load(const std::string &filename, const std::set<std::string> &filter)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0)
+		log_cmd_error("Can't open liberty file `%s': %s\n", filename.c_str(), strerror(errno));
+	yosys_input_files.insert(filename);
+	file_stamp_t stamp(st);
+
+	auto &entries = liberty_entries[filename];
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (!(it->stamp == stamp)) {
+			it = entries.erase(it);
+			continue;
+		}
+		if (it->filter.empty() || (!filter.empty() && std::includes(it->filter.begin(), it->filter.end(), filter.begin(), filter.end()))) {
+			log("Using liberty file `%s' parsed by an earlier command.\n", filename.c_str());
+			return it->ast;
+		}
+		++it;
+	}
+
+	std::string cache_filename;
+	if (!ScriptPass::cache_dir.empty()) {
+		// hashing the contents of a large library takes about as long as parsing it,
+		// so entries are identified by the absolute path, size, mtime and ctime of the file
+		std::string abs_filename = filename;
+		char pwd[PATH_MAX];
+		if (!is_absolute_path(abs_filename) && getcwd(pwd, sizeof(pwd)))
+			abs_filename = std::string(pwd) + "/" + abs_filename;
+		std::string key = stringf("%s\n%s\n%lld %lld %lld\n", yosys_version_str, abs_filename.c_str(),
+				stamp.size, stamp.mtime, stamp.ctime);
+		for (auto &path : filter)
+			key += path + "\n";
+		cache_filename = stringf("%s/liberty_%s.bin", ScriptPass::cache_dir.c_str(), sha1(key).c_str());
+	}
+
+	std::shared_ptr<LibertyAst> ast;
+
+	if (!cache_filename.empty() && check_file_exists(cache_filename))
+	{
+		MappedFile file;
+		size_t magic_size = strlen(liberty_cache_magic);
+		if (file.map(cache_filename) && file.size > magic_size && !memcmp(file.data, liberty_cache_magic, magic_size)) {
+			LibertyDecoder decoder;
+			decoder.ptr = file.data + magic_size;
+			decoder.end = file.data + file.size;
+			ast.reset(decoder.decode());
+		}
+		if (ast)
+			log("Loading parsed liberty file `%s' from cache `%s'.\n", filename.c_str(), cache_filename.c_str());
+		else
+			log_warning("Ignoring corrupt liberty cache entry `%s'.\n", cache_filename.c_str());
+	}
+
+	if (!ast)
+	{
+		MappedFile file;
+		if (!file.map(filename)) {
+			std::ifstream f(filename.c_str());
+			if (f.fail())
+				log_cmd_error("Can't open liberty file `%s': %s\n", filename.c_str(), strerror(errno));
+			file.read(f);
+		}
+
+		LibertyParser parser(file.data, file.size, filter.empty() ? nullptr : &filter);
+		ast.reset(parser.ast);
+		parser.ast = nullptr;
+
+		if (ast && !cache_filename.empty())
+		{
+			// write to a temporary file first, so other processes never see partial entries
+			std::string buf = liberty_cache_magic;
+			liberty_encode(buf, ast.get());
+
+			std::string temp_filename = make_temp_file(ScriptPass::cache_dir + "/.yosys_XXXXXX");
+			std::ofstream f(temp_filename.c_str(), std::ofstream::trunc | std::ofstream::binary);
+			f.write(buf.data(), buf.size());
+			f.close();
+
+			if (f.fail() || rename(temp_filename.c_str(), cache_filename.c_str()) != 0) {
+				log_warning("Can't write liberty cache entry `%s': %s\n", cache_filename.c_str(), strerror(errno));
+				remove(temp_filename.c_str());
+			}
+		}
+	}
+
+	liberty_entry_t entry = { stamp, filter, ast };
+	entries.push_back(entry);
+	return ast;
+}
+
 #else
 
 void LibertyParser::error()
@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <memory>
 
 namespace Yosys
 {
@@ -41,15 +42,41 @@ namespace Yosys
 
 	struct LibertyParser
 	{
-		std::istream &f;
+		std::string buffer;
+		const char *data;
+		size_t size, pos;
 		int line;
+
+		// the paths of the groups and attributes to parse (e.g. "/library/cell/pin"), with
+		// "<path>/*" for all the children of a group. all other statements are skipped without
+		// creating nodes for them. everything is parsed if this is null.
+		const std::set<std::string> *filter;
+
 		LibertyAst *ast;
-		LibertyParser(std::istream &f) : f(f), line(1), ast(parse()) {}
+		LibertyParser(std::istream &f, const std::set<std::string> *filter = nullptr);
+		LibertyParser(const char *data, size_t size, const std::set<std::string> *filter = nullptr);
 		~LibertyParser() { if (ast) delete ast; }
+		int get() { return pos < size ? (unsigned char)data[pos++] : (pos++, EOF); }
+		void unget() { pos--; }
 		int lexer(std::string &str);
-		LibertyAst *parse();
+		LibertyAst *parse(const std::string &parent_path = std::string(), bool path_ok = false);
+		void skip_statement();
 		void error();
 	};
+
+#ifndef FILTERLIB
+	// The liberty files parsed in this session, for passes that read the same library.
+	// An entry is used again as long as the size and the modification and status change times
+	// (in nanoseconds where available) of the file have not changed and its filter (see
+	// LibertyParser) includes all paths of the new filter. When a script cache directory is set
+	// (see "help script_cache"), the parsed libraries are also stored there, keyed by the path,
+	// size and times of the file and the filter.
+	struct LibertyStore
+	{
+		static std::shared_ptr<LibertyAst> load(const std::string &filename,
+				const std::set<std::string> &filter = std::set<std::string>());
+	};
+#endif
 }
 
 #endif
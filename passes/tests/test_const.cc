@@ -0,0 +1,508 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#  include <malloc.h>
+#  define HAVE_MALLINFO2
+#elif defined(__linux__)
+#  include <unistd.h>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static uint32_t xorshift32_state = 123456789;
+
+static uint32_t xorshift32(uint32_t limit) {
+	xorshift32_state ^= xorshift32_state << 13;
+	xorshift32_state ^= xorshift32_state >> 17;
+	xorshift32_state ^= xorshift32_state << 5;
+	return xorshift32_state % limit;
+}
+
+static RTLIL::State random_state(bool all_states)
+{
+	static const RTLIL::State states[] = { RTLIL::S0, RTLIL::S1, RTLIL::S0, RTLIL::S1, RTLIL::Sx, RTLIL::Sz, RTLIL::Sa, RTLIL::Sm };
+	return states[xorshift32(all_states ? 8 : 5)];
+}
+
+static RTLIL::Const random_const(int width, bool all_states)
+{
+	std::vector<RTLIL::State> bits;
+	for (int i = 0; i < width; i++)
+		bits.push_back(random_state(all_states));
+	return RTLIL::Const(bits);
+}
+
+static RTLIL::Const random_defined_const(int width)
+{
+	std::vector<RTLIL::State> bits;
+	for (int i = 0; i < width; i++)
+		bits.push_back(xorshift32(2) ? RTLIL::S1 : RTLIL::S0);
+	return RTLIL::Const(bits);
+}
+
+// Reference bit-by-bit implementations of the bitwise and reduce operations
+
+static RTLIL::State ref_and(RTLIL::State a, RTLIL::State b)
+{
+	if (a == RTLIL::S0 || b == RTLIL::S0) return RTLIL::S0;
+	if (a != RTLIL::S1 || b != RTLIL::S1) return RTLIL::Sx;
+	return RTLIL::S1;
+}
+
+static RTLIL::State ref_or(RTLIL::State a, RTLIL::State b)
+{
+	if (a == RTLIL::S1 || b == RTLIL::S1) return RTLIL::S1;
+	if (a != RTLIL::S0 || b != RTLIL::S0) return RTLIL::Sx;
+	return RTLIL::S0;
+}
+
+static RTLIL::State ref_xor(RTLIL::State a, RTLIL::State b)
+{
+	if (a > RTLIL::S1 || b > RTLIL::S1) return RTLIL::Sx;
+	return a != b ? RTLIL::S1 : RTLIL::S0;
+}
+
+static RTLIL::State ref_xnor(RTLIL::State a, RTLIL::State b)
+{
+	if (a > RTLIL::S1 || b > RTLIL::S1) return RTLIL::Sx;
+	return a == b ? RTLIL::S1 : RTLIL::S0;
+}
+
+static RTLIL::State ref_not(RTLIL::State a, RTLIL::State)
+{
+	if (a > RTLIL::S1) return RTLIL::Sx;
+	return a == RTLIL::S0 ? RTLIL::S1 : RTLIL::S0;
+}
+
+static std::vector<RTLIL::State> ref_extend(const RTLIL::Const &arg, int width, bool is_signed)
+{
+	std::vector<RTLIL::State> bits = arg.bits;
+	RTLIL::State padding = is_signed && !bits.empty() ? bits.back() : RTLIL::S0;
+	bits.resize(width, padding);
+	return bits;
+}
+
+static RTLIL::Const ref_bitwise(RTLIL::State(*func)(RTLIL::State, RTLIL::State), const RTLIL::Const &a, const RTLIL::Const &b,
+		bool signed_a, bool signed_b, int width)
+{
+	std::vector<RTLIL::State> ext_a = ref_extend(a, width, signed_a);
+	std::vector<RTLIL::State> ext_b = ref_extend(b, width, signed_b);
+	std::vector<RTLIL::State> result;
+	for (int i = 0; i < width; i++)
+		result.push_back(func(ext_a[i], ext_b[i]));
+	return result;
+}
+
+static RTLIL::Const ref_reduce(RTLIL::State initial, RTLIL::State(*func)(RTLIL::State, RTLIL::State), const RTLIL::Const &a, int width)
+{
+	RTLIL::State temp = initial;
+	for (int i = 0; i < GetSize(a); i++)
+		temp = func(temp, a.bits[i]);
+	std::vector<RTLIL::State> result(1, temp);
+	while (GetSize(result) < width)
+		result.push_back(RTLIL::S0);
+	return result;
+}
+
+static void check_result(const char *name, const RTLIL::Const &a, const RTLIL::Const &b, const RTLIL::Const &result, const RTLIL::Const &expected)
+{
+	if (result == expected)
+		return;
+	log_error("%s(%s, %s) returned %s, expected %s.\n", name, a.as_string().c_str(), b.as_string().c_str(),
+			result.as_string().c_str(), expected.as_string().c_str());
+}
+
+static void test_container(int width)
+{
+	RTLIL::Const c = random_const(width, true);
+	std::vector<RTLIL::State> ref = c.bits;
+
+	for (int k = 0; k < 20; k++)
+	{
+		int pos = xorshift32(GetSize(ref) + 1);
+		int len = xorshift32(100);
+		RTLIL::State state = random_state(xorshift32(4) == 0);
+
+		switch (xorshift32(7))
+		{
+		case 0:
+			c.bits.insert(c.bits.begin() + pos, len, state);
+			ref.insert(ref.begin() + pos, len, state);
+			break;
+		case 1:
+			len = std::min(len, GetSize(ref) - pos);
+			c.bits.erase(c.bits.begin() + pos, c.bits.begin() + pos + len);
+			ref.erase(ref.begin() + pos, ref.begin() + pos + len);
+			break;
+		case 2:
+			c.bits.resize(pos + len, state);
+			ref.resize(pos + len, state);
+			break;
+		case 3:
+			c.bits.push_back(state);
+			ref.push_back(state);
+			break;
+		case 4:
+			if (!ref.empty()) {
+				c.bits.pop_back();
+				ref.pop_back();
+			}
+			break;
+		case 5:
+			if (pos < GetSize(ref)) {
+				c.bits[pos] = state;
+				ref[pos] = state;
+			}
+			break;
+		case 6:
+			std::reverse(c.bits.begin(), c.bits.end());
+			std::reverse(ref.begin(), ref.end());
+			break;
+		}
+
+		RTLIL::Const c2(ref);
+		if (c.bits != c2.bits || c.hash() != c2.hash() || c < c2 || c2 < c || c.bits != RTLIL::StateVector(ref))
+			log_error("Packed container mismatch: %s vs %s.\n", c.as_string().c_str(), c2.as_string().c_str());
+
+		for (int i = 0; i < GetSize(ref); i++)
+			if (c.bits[i] != ref[i])
+				log_error("Packed container mismatch at bit %d: %s vs %s.\n", i, c.as_string().c_str(), c2.as_string().c_str());
+	}
+}
+
+static void test_ops(int width_a, int width_b, int width_y)
+{
+	RTLIL::Const a = random_const(width_a, true);
+	RTLIL::Const b = random_const(width_b, true);
+	bool signed_a = xorshift32(2), signed_b = xorshift32(2);
+
+	check_result("const_and", a, b, RTLIL::const_and(a, b, signed_a, signed_b, width_y), ref_bitwise(ref_and, a, b, signed_a, signed_b, width_y));
+	check_result("const_or", a, b, RTLIL::const_or(a, b, signed_a, signed_b, width_y), ref_bitwise(ref_or, a, b, signed_a, signed_b, width_y));
+	check_result("const_xor", a, b, RTLIL::const_xor(a, b, signed_a, signed_b, width_y), ref_bitwise(ref_xor, a, b, signed_a, signed_b, width_y));
+	check_result("const_xnor", a, b, RTLIL::const_xnor(a, b, signed_a, signed_b, width_y), ref_bitwise(ref_xnor, a, b, signed_a, signed_b, width_y));
+	check_result("const_not", a, b, RTLIL::const_not(a, b, signed_a, signed_b, width_y), ref_bitwise(ref_not, a, b, signed_a, signed_b, width_y));
+
+	// make all-0 and all-1 inputs more likely for the reduce operators
+	if (xorshift32(2)) {
+		RTLIL::State fill = xorshift32(2) ? RTLIL::S1 : RTLIL::S0;
+		for (int i = 0; i < width_a; i++)
+			if (xorshift32(16))
+				a.bits[i] = fill;
+	}
+
+	check_result("const_reduce_and", a, b, RTLIL::const_reduce_and(a, b, false, false, width_y), ref_reduce(RTLIL::S1, ref_and, a, width_y));
+	check_result("const_reduce_or", a, b, RTLIL::const_reduce_or(a, b, false, false, width_y), ref_reduce(RTLIL::S0, ref_or, a, width_y));
+	check_result("const_reduce_xor", a, b, RTLIL::const_reduce_xor(a, b, false, false, width_y), ref_reduce(RTLIL::S0, ref_xor, a, width_y));
+
+	RTLIL::Const expected_xnor = ref_reduce(RTLIL::S0, ref_xor, a, width_y);
+	expected_xnor.bits[0] = ref_not(expected_xnor.bits[0], RTLIL::S0);
+	check_result("const_reduce_xnor", a, b, RTLIL::const_reduce_xnor(a, b, false, false, width_y), expected_xnor);
+
+	bool fully_def = true, fully_undef = true, fully_zero = true;
+	for (int i = 0; i < width_a; i++) {
+		fully_def = fully_def && a.bits[i] <= RTLIL::S1;
+		fully_undef = fully_undef && (a.bits[i] == RTLIL::Sx || a.bits[i] == RTLIL::Sz);
+		fully_zero = fully_zero && a.bits[i] == RTLIL::S0;
+	}
+	if (a.is_fully_def() != fully_def || a.is_fully_undef() != fully_undef || a.is_fully_zero() != fully_zero)
+		log_error("is_fully_* mismatch for %s.\n", a.as_string().c_str());
+}
+
+// Differential test of the native 64 bit fast path of the arithmetic, shift and compare functions.
+// Extending an operand to more than 64 bits does not change its value but disables the fast path,
+// so calling the same function with the extended operands gives the result of the BigInteger code.
+
+static RTLIL::Const widen(const RTLIL::Const &arg, bool is_signed)
+{
+	return ref_extend(arg, 65, is_signed);
+}
+
+static const struct arith_op_t {
+	const char *name;
+	RTLIL::Const (*func)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int);
+	int shift;		// 0 = not a shift, 1 = unsigned shift amount, 2 = signed shift amount
+	bool single_bit;	// result does not depend on operand widths (result_len = -1 is tested)
+} arith_ops[] = {
+	{ "const_logic_not", RTLIL::const_logic_not, 0, true },
+	{ "const_logic_and", RTLIL::const_logic_and, 0, true },
+	{ "const_logic_or", RTLIL::const_logic_or, 0, true },
+	{ "const_shl", RTLIL::const_shl, 1, false },
+	{ "const_shr", RTLIL::const_shr, 1, false },
+	{ "const_sshl", RTLIL::const_sshl, 1, false },
+	{ "const_sshr", RTLIL::const_sshr, 1, false },
+	{ "const_shift", RTLIL::const_shift, 2, false },
+	{ "const_shiftx", RTLIL::const_shiftx, 2, false },
+	{ "const_lt", RTLIL::const_lt, 0, true },
+	{ "const_le", RTLIL::const_le, 0, true },
+	{ "const_ge", RTLIL::const_ge, 0, true },
+	{ "const_gt", RTLIL::const_gt, 0, true },
+	{ "const_add", RTLIL::const_add, 0, false },
+	{ "const_sub", RTLIL::const_sub, 0, false },
+	{ "const_mul", RTLIL::const_mul, 0, false },
+	{ "const_div", RTLIL::const_div, 0, false },
+	{ "const_mod", RTLIL::const_mod, 0, false },
+	{ "const_pow", RTLIL::const_pow, 0, false },
+	{ "const_neg", RTLIL::const_neg, 0, false },
+};
+
+static void test_arith_op(const arith_op_t &op, const RTLIL::Const &a, const RTLIL::Const &b, bool signed_a, bool signed_b, int width_y)
+{
+	if (width_y < 0 && !op.single_bit)
+		return;
+
+	RTLIL::Const wide_a = op.shift ? a : widen(a, signed_a);
+	RTLIL::Const wide_b = widen(b, op.shift == 1 ? false : signed_b);
+
+	RTLIL::Const result = op.func(a, b, signed_a, signed_b, width_y);
+	RTLIL::Const expected = op.func(wide_a, wide_b, signed_a, signed_b, width_y);
+
+	if (result != expected)
+		log_error("%s(%s%s, %s%s, %d) returned %s, expected %s.\n", op.name, a.as_string().c_str(), signed_a ? " signed" : "",
+				b.as_string().c_str(), signed_b ? " signed" : "", width_y, result.as_string().c_str(), expected.as_string().c_str());
+}
+
+static void test_arith_exhaustive(int max_width)
+{
+	std::vector<RTLIL::Const> values;
+	for (int width = 0; width <= max_width; width++)
+		for (int value = 0; value < (1 << width); value++)
+			values.push_back(RTLIL::Const(value, width));
+
+	for (auto &op : arith_ops)
+		for (auto &a : values)
+		for (auto &b : values)
+		for (int signed_mode = 0; signed_mode < 4; signed_mode++)
+		for (int width_y = -1; width_y <= max_width + 2; width_y++)
+			test_arith_op(op, a, b, signed_mode & 1, signed_mode & 2, width_y);
+}
+
+static void test_arith_random(int width_a, int width_b, int width_y)
+{
+	RTLIL::Const a = xorshift32(8) ? random_defined_const(width_a) : random_const(width_a, false);
+	RTLIL::Const b = xorshift32(8) ? random_defined_const(width_b) : random_const(width_b, false);
+	bool signed_a = xorshift32(2), signed_b = xorshift32(2);
+
+	// make small divisors, exponents and shift amounts more likely
+	if (xorshift32(2))
+		for (int i = 8; i < width_b; i++)
+			b.bits[i] = (signed_b && xorshift32(2)) ? RTLIL::S1 : RTLIL::S0;
+
+	for (auto &op : arith_ops)
+		test_arith_op(op, a, b, signed_a, signed_b, width_y);
+}
+
+// bytes of heap memory in use (or the resident set size as fallback)
+static int64_t current_mem_usage()
+{
+#if defined(HAVE_MALLINFO2)
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#elif defined(__linux__)
+	long pages = 0, rss_pages = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f == nullptr || fscanf(f, "%ld %ld", &pages, &rss_pages) != 2)
+		rss_pages = 0;
+	if (f != nullptr)
+		fclose(f);
+	return int64_t(rss_pages) * sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+static void bench_memory(int count, int width)
+{
+	int64_t mem_before = current_mem_usage();
+	std::vector<RTLIL::Const> consts(count);
+
+	for (int i = 0; i < count; i++) {
+		consts[i] = RTLIL::Const(0, width);
+		for (int j = 0; j < width; j += 7)
+			consts[i].bits[j] = (j & 8) ? RTLIL::S1 : RTLIL::Sx;
+	}
+
+	int64_t delta = current_mem_usage() - mem_before;
+	log("  %8d x %7d bits: %10.2f MB, %6.3f bytes per bit\n", count, width,
+			delta / 1e6, double(delta) / (double(count) * width));
+}
+
+static void bench_ops(int width, int64_t total_bits)
+{
+	RTLIL::Const a = random_const(width, false);
+	RTLIL::Const b = random_const(width, false);
+	int iter = std::max(int64_t(1), total_bits / width);
+
+	struct bench_op_t {
+		const char *name;
+		RTLIL::Const (*func)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int);
+	} bench_ops[] = {
+		{ "and", RTLIL::const_and }, { "or", RTLIL::const_or }, { "xor", RTLIL::const_xor }, { "not", RTLIL::const_not },
+		{ "reduce_and", RTLIL::const_reduce_and }, { "reduce_or", RTLIL::const_reduce_or }, { "reduce_xor", RTLIL::const_reduce_xor }
+	};
+
+	log("  %7d bits:", width);
+	for (auto &op : bench_ops) {
+		PerformanceTimer timer;
+		timer.begin();
+		int checksum = 0;
+		for (int i = 0; i < iter; i++)
+			checksum += GetSize(op.func(a, b, false, false, width));
+		timer.end();
+		log_assert(checksum != 0);
+		log(" %s=%.0f", op.name, double(iter) * width / 1e6 / std::max(double(timer.sec()), 1e-9));
+	}
+	log(" Mbit/s\n");
+}
+
+static void bench_arith(int width, int iter)
+{
+	std::vector<RTLIL::Const> values;
+	for (int i = 0; i < 256; i++) {
+		values.push_back(random_defined_const(width));
+		values.back().bits[0] = RTLIL::S1;
+	}
+
+	struct bench_op_t {
+		const char *name;
+		RTLIL::Const (*func)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int);
+	} bench_ops[] = {
+		{ "add", RTLIL::const_add }, { "sub", RTLIL::const_sub }, { "mul", RTLIL::const_mul }, { "div", RTLIL::const_div },
+		{ "lt", RTLIL::const_lt }, { "shl", RTLIL::const_shl }, { "logic_and", RTLIL::const_logic_and }
+	};
+
+	log("  %7d bits:", width);
+	for (auto &op : bench_ops) {
+		PerformanceTimer timer;
+		timer.begin();
+		int checksum = 0;
+		for (int i = 0; i < iter; i++)
+			checksum += GetSize(op.func(values[i % 256], values[(i / 256 + i) % 256], i % 2, i % 2, width));
+		timer.end();
+		log_assert(checksum != 0);
+		log(" %s=%.2f", op.name, double(iter) / 1e6 / std::max(double(timer.sec()), 1e-9));
+	}
+	log(" Mops/s\n");
+}
+
+struct TestConstPass : public Pass {
+	TestConstPass() : Pass("test_const", "test and benchmark RTLIL::Const and the const_* functions") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_const [options]\n");
+		log("\n");
+		log("Tests the packed storage of RTLIL::Const and the bitwise and reduce functions\n");
+		log("from kernel/calc.cc by comparing them against simple bit-by-bit reference\n");
+		log("implementations on random constants.\n");
+		log("\n");
+		log("The native 64 bit implementations of the arithmetic, shift and compare functions\n");
+		log("are compared against the BigInteger implementations, exhaustively for operands of\n");
+		log("up to 4 bits and on random constants of up to 64 bits.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        number of random test cases (default = 1000).\n");
+		log("\n");
+		log("    -s {positive_integer}\n");
+		log("        use this value as rng seed value (default = unix time).\n");
+		log("\n");
+		log("    -bench\n");
+		log("        don't run the tests. instead measure the memory footprint of\n");
+		log("        RTLIL::Const and the throughput of the const_* functions.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) YS_OVERRIDE
+	{
+		int num_iter = 1000;
+		bool bench = false;
+		xorshift32_state = 0;
+
+		int argidx;
+		for (argidx = 1; argidx < GetSize(args); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < GetSize(args)) {
+				num_iter = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-s" && argidx+1 < GetSize(args)) {
+				xorshift32_state = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-bench") {
+				bench = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, nullptr);
+
+		if (xorshift32_state == 0) {
+			xorshift32_state = time(NULL) & 0x7fffffff;
+			log("Rng seed value: %d\n", int(xorshift32_state));
+		}
+
+		if (bench)
+		{
+			log("Memory footprint of RTLIL::Const:\n");
+			bench_memory(1000000, 32);
+			bench_memory(1000, 65536);
+			bench_memory(1, 64*1024*1024);
+
+			log("Throughput of const_* functions:\n");
+			for (int width : {8, 64, 1024, 65536})
+				bench_ops(width, 64*1024*1024);
+
+			log("Throughput of arithmetic const_* functions:\n");
+			for (int width : {8, 32, 64})
+				bench_arith(width, 1000000);
+			return;
+		}
+
+		if (RTLIL::Const(RTLIL::S1, -1).size() != 0)
+			log_error("Const with a negative width is not empty.\n");
+
+		log("Running exhaustive tests for arithmetic functions.\n");
+		test_arith_exhaustive(4);
+
+		log("Running %d random test cases.\n", num_iter);
+
+		for (int i = 0; i < num_iter; i++)
+		{
+			int width_a = xorshift32(2) ? xorshift32(16) : xorshift32(300);
+			int width_b = xorshift32(2) ? xorshift32(16) : xorshift32(300);
+			int width_y = xorshift32(4) ? std::max(width_a, width_b) : xorshift32(300);
+
+			test_container(width_a);
+			test_ops(width_a, width_b, width_y);
+
+			width_a = xorshift32(66);
+			width_b = xorshift32(66);
+			width_y = xorshift32(8) ? std::max(width_a, width_b) : xorshift32(70);
+			test_arith_random(width_a, width_b, width_y);
+		}
+
+		log("All tests passed.\n");
+	}
+} TestConstPass;
+
+PRIVATE_NAMESPACE_END
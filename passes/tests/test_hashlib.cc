@@ -0,0 +1,355 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static uint32_t xorshift32_state = 123456789;
+
+static uint32_t xorshift32(uint32_t limit) {
+	xorshift32_state ^= xorshift32_state << 13;
+	xorshift32_state ^= xorshift32_state >> 17;
+	xorshift32_state ^= xorshift32_state << 5;
+	return xorshift32_state % limit;
+}
+
+template<typename T>
+static void shuffle(std::vector<T> &v)
+{
+	for (int i = GetSize(v)-1; i > 0; i--)
+		std::swap(v[i], v[xorshift32(i+1)]);
+}
+
+// Random operations on dict and flat_dict (and pool and flat_pool) must leave both
+// containers with the same entries in the same order.
+
+template<typename A, typename B>
+static void check_same(const A &a, const B &b, const char *what, int step, bool full)
+{
+	if (!full && a.size() == b.size())
+		return;
+
+	bool same = a.size() == b.size();
+	auto ia = a.begin();
+	auto ib = b.begin();
+	for (; same && ia != a.end() && ib != b.end(); ++ia, ++ib)
+		if (!(*ia == *ib))
+			same = false;
+	if (!same)
+		log_error("Contents of %s differ after step %d.\n", what, step);
+}
+
+static void test_dict(int num_steps, int key_range)
+{
+	hashlib::dict<int, int> ref;
+	hashlib::flat_dict<int, int> uut;
+
+	for (int step = 0; step < num_steps; step++)
+	{
+		int key = xorshift32(key_range);
+		int value = xorshift32(1000);
+
+		switch (xorshift32(10))
+		{
+		case 0:
+		case 1:
+		case 2:
+			ref[key] = value, uut[key] = value;
+			break;
+		case 3:
+			if (ref.insert(std::make_pair(key, value)).second != uut.insert(std::make_pair(key, value)).second)
+				log_error("flat_dict::insert() returned the wrong result in step %d.\n", step);
+			break;
+		case 4:
+		case 5:
+			if (ref.erase(key) != uut.erase(key))
+				log_error("flat_dict::erase() returned the wrong result in step %d.\n", step);
+			break;
+		case 6:
+			if (ref.count(key) != uut.count(key) || ref.at(key, -1) != uut.at(key, -1))
+				log_error("flat_dict lookup of %d returned the wrong result in step %d.\n", key, step);
+			break;
+		case 7:
+			for (auto it = ref.begin(); it != ref.end();)
+				if (it->second % 7 == value % 7)
+					it = ref.erase(it);
+				else
+					++it;
+			for (auto it = uut.begin(); it != uut.end();)
+				if (it->second % 7 == value % 7)
+					it = uut.erase(it);
+				else
+					++it;
+			break;
+		case 8:
+			if (xorshift32(100) == 0) {
+				ref.sort(), uut.sort();
+			} else if (xorshift32(100) == 0) {
+				ref.clear(), uut.clear();
+			} else {
+				hashlib::flat_dict<int, int> copy(uut);
+				uut = std::move(copy);
+			}
+			break;
+		default:
+			for (int i = 0; i < key_range / 8; i++) {
+				int k = xorshift32(key_range);
+				if (ref.count(k) != uut.count(k))
+					log_error("flat_dict::count(%d) returned the wrong result in step %d.\n", k, step);
+			}
+			break;
+		}
+
+		check_same(ref, uut, "dict and flat_dict", step, GetSize(ref) < 100 || step % 1000 == 0);
+	}
+}
+
+static void test_pool(int num_steps, int key_range)
+{
+	hashlib::pool<int> ref;
+	hashlib::flat_pool<int> uut;
+
+	for (int step = 0; step < num_steps; step++)
+	{
+		int key = xorshift32(key_range);
+
+		switch (xorshift32(8))
+		{
+		case 0:
+		case 1:
+		case 2:
+			if (ref.insert(key).second != uut.insert(key).second)
+				log_error("flat_pool::insert() returned the wrong result in step %d.\n", step);
+			break;
+		case 3:
+		case 4:
+			if (ref.erase(key) != uut.erase(key))
+				log_error("flat_pool::erase() returned the wrong result in step %d.\n", step);
+			break;
+		case 5:
+			if (!ref.empty() && ref.pop() != uut.pop())
+				log_error("flat_pool::pop() returned the wrong result in step %d.\n", step);
+			break;
+		case 6:
+			if (xorshift32(100) == 0)
+				ref.sort(), uut.sort();
+			else if (xorshift32(100) == 0)
+				ref.clear(), uut.clear();
+			break;
+		default:
+			if (ref.count(key) != uut.count(key))
+				log_error("flat_pool::count(%d) returned the wrong result in step %d.\n", key, step);
+			break;
+		}
+
+		check_same(ref, uut, "pool and flat_pool", step, GetSize(ref) < 100 || step % 1000 == 0);
+	}
+}
+
+static int touch(const RTLIL::SigBit &bit) { return bit.offset; }
+static int touch(const RTLIL::IdString &id) { return id.index_; }
+static int touch(const RTLIL::Cell *cell) { return cell != nullptr; }
+
+// Benchmarks, each with the keys inserted in one order and looked up and erased in another
+
+static volatile int bench_sink;
+
+template<typename T>
+static double bench_op(const T &worker)
+{
+	PerformanceTimer timer;
+	timer.begin();
+	worker();
+	timer.end();
+	return std::max(double(timer.sec()), 1e-9);
+}
+
+template<typename D, typename K>
+static void bench_dict(const char *name, const std::vector<K> &keys, const std::vector<K> &lookup_keys)
+{
+	int n = GetSize(keys);
+	D d;
+	int sum = 0;
+
+	double t_insert = bench_op([&]() {
+		for (int i = 0; i < n; i++)
+			d[keys[i]] = i;
+	});
+	double t_lookup = bench_op([&]() {
+		for (auto &key : lookup_keys)
+			sum += d.at(key, 0);
+	});
+	double t_iterate = bench_op([&]() {
+		for (int round = 0; round < 10; round++)
+			for (auto &it : d)
+				sum += it.second;
+	});
+	double t_erase = bench_op([&]() {
+		for (auto &key : lookup_keys)
+			sum += d.erase(key);
+	});
+
+	bench_sink = sum;
+	log("  %-12s %10.2f %10.2f %10.2f %10.2f\n", name, n / t_insert / 1e6, GetSize(lookup_keys) / t_lookup / 1e6,
+			n / t_erase / 1e6, 10 * n / t_iterate / 1e6);
+}
+
+template<typename P, typename K>
+static void bench_pool(const char *name, const std::vector<K> &keys, const std::vector<K> &lookup_keys)
+{
+	int n = GetSize(keys);
+	P p;
+	int sum = 0;
+
+	double t_insert = bench_op([&]() {
+		for (auto &key : keys)
+			p.insert(key);
+	});
+	double t_lookup = bench_op([&]() {
+		for (auto &key : lookup_keys)
+			sum += p.count(key);
+	});
+	double t_iterate = bench_op([&]() {
+		for (int round = 0; round < 10; round++)
+			for (auto &it : p)
+				sum += touch(it);
+	});
+	double t_erase = bench_op([&]() {
+		for (auto &key : lookup_keys)
+			sum += p.erase(key);
+	});
+
+	bench_sink = sum;
+	log("  %-12s %10.2f %10.2f %10.2f %10.2f\n", name, n / t_insert / 1e6, GetSize(lookup_keys) / t_lookup / 1e6,
+			n / t_erase / 1e6, 10 * n / t_iterate / 1e6);
+}
+
+template<typename K>
+static void bench_keys(const char *key_name, std::vector<K> keys)
+{
+	shuffle(keys);
+	std::vector<K> lookup_keys = keys;
+	shuffle(lookup_keys);
+
+	log("\n%d %s keys, Mops/s:\n", GetSize(keys), key_name);
+	log("  %-12s %10s %10s %10s %10s\n", "", "insert", "lookup", "erase", "iterate");
+	bench_dict<hashlib::dict<K, int>>("dict", keys, lookup_keys);
+	bench_dict<hashlib::flat_dict<K, int>>("flat_dict", keys, lookup_keys);
+	bench_pool<hashlib::pool<K>>("pool", keys, lookup_keys);
+	bench_pool<hashlib::flat_pool<K>>("flat_pool", keys, lookup_keys);
+}
+
+static void bench(int num_keys)
+{
+	RTLIL::Module *module = new RTLIL::Module;
+	module->name = "\\test_hashlib";
+
+	std::vector<RTLIL::SigBit> bits;
+	for (int i = 0; GetSize(bits) < num_keys; i++) {
+		RTLIL::Wire *wire = module->addWire(stringf("\\w%d", i), 32);
+		for (int k = 0; k < wire->width; k++)
+			bits.push_back(RTLIL::SigBit(wire, k));
+	}
+	bits.resize(num_keys);
+	bench_keys("SigBit", bits);
+	bits.clear();
+
+	std::vector<RTLIL::IdString> ids;
+	for (int i = 0; i < num_keys; i++)
+		ids.push_back(stringf("\\id%d", i));
+	bench_keys("IdString", ids);
+	ids.clear();
+
+	std::vector<RTLIL::Cell*> cells;
+	for (int i = 0; i < num_keys; i++)
+		cells.push_back(module->addCell(stringf("\\c%d", i), "$and"));
+	bench_keys("Cell*", cells);
+	cells.clear();
+
+	delete module;
+}
+
+struct TestHashlibPass : public Pass {
+	TestHashlibPass() : Pass("test_hashlib", "test and benchmark the hashlib containers") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_hashlib [options]\n");
+		log("\n");
+		log("Runs the same random operations on dict and flat_dict, and on pool and\n");
+		log("flat_pool, and checks that they end up with the same entries in the same\n");
+		log("order after each operation.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        number of operations (default = 100000).\n");
+		log("\n");
+		log("    -s {positive_integer}\n");
+		log("        use this value as random seed.\n");
+		log("\n");
+		log("    -bench\n");
+		log("        don't run the test. instead measure insert, lookup, erase and iterate\n");
+		log("        throughput of the containers with SigBit, IdString and Cell* keys,\n");
+		log("        using the number of keys given with -n (default = 1000000).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) YS_OVERRIDE
+	{
+		int num = -1;
+		bool run_bench = false;
+
+		int argidx;
+		for (argidx = 1; argidx < GetSize(args); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < GetSize(args)) {
+				num = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-s" && argidx+1 < GetSize(args)) {
+				xorshift32_state = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-bench") {
+				run_bench = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, nullptr);
+
+		if (run_bench) {
+			bench(num < 0 ? 1000000 : num);
+			return;
+		}
+
+		if (num < 0)
+			num = 100000;
+
+		log("Running %d operations on dicts and pools.\n", num);
+		for (int key_range : {16, 1000, 100000}) {
+			test_dict(num, key_range);
+			test_pool(num, key_range);
+		}
+		log("All tests passed.\n");
+	}
+} TestHashlibPass;
+
+PRIVATE_NAMESPACE_END
@@ -0,0 +1,229 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <thread>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static std::atomic<int> stress_errors;
+
+static void run_threads(int num_threads, std::function<void(int)> worker)
+{
+#ifdef YOSYS_ENABLE_THREADS
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; i++)
+		threads.push_back(std::thread(worker, i));
+	for (auto &t : threads)
+		t.join();
+#else
+	for (int i = 0; i < num_threads; i++)
+		worker(i);
+#endif
+}
+
+static std::string stress_name(const char *prefix, int thread, int i)
+{
+	return stringf("\\%s_%d_%d", prefix, thread, i);
+}
+
+// Each thread interns names that are shared with all other threads (half of them are kept
+// alive by the main thread, the other half is created and freed concurrently) and names
+// that are private to the thread, checks the strings and ids, and then releases them again.
+static void stress_worker(int thread, int num_names, int rounds, const std::vector<RTLIL::IdString> &persistent)
+{
+	for (int round = 0; round < rounds; round++)
+	{
+		std::vector<RTLIL::IdString> ids;
+		ids.reserve(2 * num_names);
+
+		for (int i = 0; i < num_names; i++) {
+			std::string shared = stress_name("shared", 0, (i + thread * 7919) % num_names);
+			std::string priv = stress_name("private", thread, i);
+			ids.push_back(shared);
+			ids.push_back(priv);
+			if (ids[2*i] != shared || ids[2*i+1] != priv)
+				stress_errors++;
+		}
+
+		for (int i = 0; i < num_names; i++) {
+			int k = (i + thread * 7919) % num_names;
+			if (k < GetSize(persistent) && ids[2*i] != persistent[k])
+				stress_errors++;
+			RTLIL::IdString copy = ids[2*i+1];
+			if (copy != ids[2*i+1] || RTLIL::IdString(copy.str()) != copy)
+				stress_errors++;
+			if (RTLIL::IdString("$and") == copy || RTLIL::IdString("\\A").index_ >= RTLIL::IdString::global_immortal_ids_)
+				stress_errors++;
+		}
+	}
+}
+
+static double bench_threads(int num_threads, std::function<void(int)> worker)
+{
+	PerformanceTimer timer;
+	timer.begin();
+	run_threads(num_threads, worker);
+	timer.end();
+	return std::max(double(timer.sec()), 1e-9);
+}
+
+static void bench(int num_threads, int num_names)
+{
+	std::vector<std::string> existing_names, fresh_names;
+	std::vector<RTLIL::IdString> existing;
+	for (int i = 0; i < num_names; i++) {
+		existing_names.push_back(stress_name("bench", 0, i));
+		fresh_names.push_back(stress_name("fresh", 0, i));
+		existing.push_back(existing_names.back());
+	}
+
+	int per_thread = num_names / num_threads;
+	double sec;
+
+	sec = bench_threads(num_threads, [&](int thread) {
+		for (int i = thread * per_thread; i < (thread + 1) * per_thread; i++)
+			RTLIL::IdString id(existing_names[i]);
+	});
+	log("  lookup of existing ids:   %8.2f Mops/s\n", num_threads * per_thread / sec / 1e6);
+
+	sec = bench_threads(num_threads, [&](int thread) {
+		for (int i = thread * per_thread; i < (thread + 1) * per_thread; i++)
+			RTLIL::IdString id(fresh_names[i]);
+	});
+	log("  create and free new ids:  %8.2f Mops/s\n", num_threads * per_thread / sec / 1e6);
+
+	sec = bench_threads(num_threads, [&](int thread) {
+		for (int i = thread * per_thread; i < (thread + 1) * per_thread; i++)
+			RTLIL::IdString copy(existing[i]);
+	});
+	log("  copies of mortal ids:     %8.2f Mops/s\n", num_threads * per_thread / sec / 1e6);
+
+	RTLIL::IdString immortal("$and");
+	sec = bench_threads(num_threads, [&](int) {
+		for (int i = 0; i < per_thread; i++)
+			RTLIL::IdString copy(immortal);
+	});
+	log("  copies of immortal ids:   %8.2f Mops/s\n", num_threads * per_thread / sec / 1e6);
+}
+
+struct TestIdStringPass : public Pass {
+	TestIdStringPass() : Pass("test_idstring", "stress test and benchmark the IdString cache") { }
+	void help() YS_OVERRIDE
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_idstring [options]\n");
+		log("\n");
+		log("Interns, copies and releases many generated names from several threads at once\n");
+		log("and checks that all threads agree on the ids and strings.\n");
+		log("\n");
+		log("    -j {integer}\n");
+		log("        number of threads (default = 4).\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        number of names per thread and round (default = 100000).\n");
+		log("\n");
+		log("    -rounds {integer}\n");
+		log("        number of rounds (default = 4).\n");
+		log("\n");
+		log("    -bench\n");
+		log("        don't run the stress test. instead measure the throughput of interning\n");
+		log("        and copying ids for 1 thread and the given number of threads, using\n");
+		log("        the total number of names given with -n (default = 1000000).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) YS_OVERRIDE
+	{
+		int num_threads = 4, num_names = -1, rounds = 4;
+		bool run_bench = false;
+
+		int argidx;
+		for (argidx = 1; argidx < GetSize(args); argidx++)
+		{
+			if (args[argidx] == "-j" && argidx+1 < GetSize(args)) {
+				num_threads = max(atoi(args[++argidx].c_str()), 1);
+				continue;
+			}
+			if (args[argidx] == "-n" && argidx+1 < GetSize(args)) {
+				num_names = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-rounds" && argidx+1 < GetSize(args)) {
+				rounds = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-bench") {
+				run_bench = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, nullptr);
+
+#ifndef YOSYS_ENABLE_THREADS
+		log_warning("Yosys was built without thread support, running all workers sequentially.\n");
+#endif
+
+		if (run_bench)
+		{
+			if (num_names < 0)
+				num_names = 1000000;
+			for (int n : {1, num_threads}) {
+				log("Throughput with %d thread(s):\n", n);
+				bench(n, num_names);
+				if (num_threads == 1)
+					break;
+			}
+			return;
+		}
+
+		if (num_names < 0)
+			num_names = 100000;
+
+		log("Running %d threads with %d names each for %d rounds.\n", num_threads, num_names, rounds);
+
+		int ids_before = RTLIL::IdString::count_ids();
+		std::vector<RTLIL::IdString> persistent;
+		for (int i = 0; i < num_names / 2; i++)
+			persistent.push_back(stress_name("shared", 0, i));
+
+		stress_errors = 0;
+		run_threads(num_threads, [&](int thread) {
+			stress_worker(thread, num_names, rounds, persistent);
+		});
+
+		for (int i = 0; i < GetSize(persistent); i++)
+			if (persistent[i] != stress_name("shared", 0, i))
+				stress_errors++;
+		persistent.clear();
+
+		if (stress_errors != 0)
+			log_error("Found %d inconsistencies in the IdString cache.\n", int(stress_errors));
+
+		log("Number of ids before and after the test: %d %d\n", ids_before, RTLIL::IdString::count_ids());
+		log("All tests passed.\n");
+	}
+} TestIdStringPass;
+
+PRIVATE_NAMESPACE_END
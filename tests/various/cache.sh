@@ -0,0 +1,35 @@
+#!/bin/bash
+set -e
+
+# check_cache <name> <commands> <message> [<count>]
+# runs the commands with an empty cache in <name>.tmp and again with the filled cache. both
+# runs must give the same design, and the second one must log the message (<count> times).
+check_cache() {
+	rm -rf $1.tmp
+	../../yosys -q -p "$2; write_ilang $1_1.il"
+	../../yosys -q -l $1_2.log -p "$2; write_ilang $1_2.il"
+	cmp $1_1.il $1_2.il
+	if [ -n "$4" ]; then
+		test $(grep -c "$3" $1_2.log) = $4
+	else
+		grep -q "$3" $1_2.log
+	fi
+}
+
+check_cache script_cache "script parallel.ys; script_cache -dir script_cache.tmp; synth -top top" "from script cache"
+check_cache derive_cache "script_cache -dir derive_cache.tmp; script derive_cache.ys" "from derive cache"
+check_cache liberty_cache "script_cache -dir liberty_cache.tmp; script liberty_cache.ys" "Loading parsed liberty file"
+check_cache incremental "read_verilog -incremental incremental.tmp parallel_read_*.v; proc" "from incremental cache" 3
+
+# WIDTH is 8 in parallel_read_3.v without parallel_read_2.v, so it must be read again
+../../yosys -q -l incremental_3.log -p "read_verilog -incremental incremental.tmp parallel_read_1.v parallel_read_3.v; proc; write_ilang incremental_3.il"
+../../yosys -q -p "read_verilog parallel_read_1.v parallel_read_3.v; proc; write_ilang incremental_4.il"
+cmp incremental_3.il incremental_4.il
+test $(grep -c "from incremental cache" incremental_3.log) = 1
+
+# only the module without parameters is loaded from the cache, inc_param is parsed again
+# (the names of internal objects differ, as the cached module was processed before inc_param)
+../../yosys -q -l incremental_5.log -p "read_verilog -incremental incremental.tmp incremental_param.v; hierarchy -top inc_plain; proc; hash"
+../../yosys -q -l incremental_6.log -p "read_verilog -incremental incremental.tmp incremental_param.v; hierarchy -top inc_plain; proc; hash"
+cmp <(grep "(design)" incremental_5.log) <(grep "(design)" incremental_6.log)
+test $(grep -c "from incremental cache" incremental_6.log) = 1
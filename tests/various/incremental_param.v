@@ -0,0 +1,7 @@
+module inc_param #(parameter W = 2) (input [W-1:0] a, output [W-1:0] y);
+  assign y = ~a;
+endmodule
+module inc_plain(input [3:0] a, output [3:0] y);
+  inc_param #(.W(4)) u (.a(a), .y(y));
+endmodule
+`default_nettype none
@@ -0,0 +1,6 @@
+#!/bin/bash
+set -e
+
+../../yosys -q -p "read_verilog noreprocess.v; hierarchy -top nr_top; proc; write_ilang noreprocess_1.il"
+../../yosys -q -p "read_verilog -noreprocess noreprocess.v; hierarchy -top nr_top; proc; write_ilang noreprocess_2.il"
+cmp noreprocess_1.il noreprocess_2.il
@@ -0,0 +1,11 @@
+module nr_sub #(parameter W = 4) (input [W-1:0] a, output [W-1:0] y);
+  assign y = ~a;
+endmodule
+module nr_leaf(input clk, input [7:0] d, output reg [7:0] q);
+  always @(posedge clk) q <= d + 1;
+endmodule
+module nr_top(input clk, input [7:0] a, output [7:0] y, z, output [3:0] w);
+  nr_sub #(.W(8)) u0 (.a(a), .y(y));
+  nr_sub u1 (.a(a[3:0]), .y(w));
+  nr_leaf u2 (.clk(clk), .d(a), .q(z));
+endmodule
@@ -0,0 +1,16 @@
+#!/bin/bash
+set -e
+
+# -j 1 runs the passes serially, as before they used parallel_for_modules()
+for j in 1 2 4; do
+	../../yosys -q -j $j -p "tee -q -o parallel_j$j.log script parallel.ys; write_ilang parallel_j$j.il"
+done
+cmp parallel_j1.il parallel_j2.il
+cmp parallel_j1.il parallel_j4.il
+cmp parallel_j1.log parallel_j2.log
+cmp parallel_j1.log parallel_j4.log
+
+# read_verilog pre-processes the files on the thread pool
+../../yosys -q -j 1 -p "read_verilog parallel_read_*.v; proc; write_ilang parallel_read_j1.il"
+../../yosys -q -j 4 -p "read_verilog parallel_read_*.v; proc; write_ilang parallel_read_j4.il"
+cmp parallel_read_j1.il parallel_read_j4.il
@@ -0,0 +1,5 @@
+`define WIDTH 8
+`define SUM(a, b) ((a) + (b))
+module pr_add(input [`WIDTH-1:0] a, b, output [`WIDTH-1:0] y);
+  assign y = `SUM(a, b);
+endmodule
@@ -0,0 +1,10 @@
+`undef WIDTH
+`define WIDTH 4
+module pr_sub(input [`WIDTH-1:0] a, b, output [`WIDTH-1:0] y);
+  assign y = a - b;
+endmodule
+`ifdef PR_EXTRA
+module pr_extra(input a, output y);
+  assign y = ~a;
+endmodule
+`endif
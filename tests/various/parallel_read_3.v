@@ -0,0 +1,8 @@
+`define PR_INNER 1
+module pr_top(input [7:0] a, b, output [7:0] y, z);
+  // WIDTH is 4 here, from parallel_read_2.v
+  wire [`WIDTH-1:0] t;
+  pr_add u0 (.a(a), .b(b), .y(y));
+  pr_sub u1 (.a(a[3:0]), .b(b[3:0]), .y(t));
+  assign z = `SUM(t, `PR_INNER);
+endmodule
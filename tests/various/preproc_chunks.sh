@@ -0,0 +1,6 @@
+#!/bin/bash
+set -e
+
+# about 1.5 MB after pre-processing, the chunks are 1 MB
+awk '{ print } END { for (i = 1; i <= 6000; i++) { while ((getline line < FILENAME) > 0) { gsub(/pp_chunk/, "pp_chunk_" i, line); print line } close(FILENAME) } }' preproc_chunks.v > preproc_chunks_big.v
+../../yosys -q -p "read_verilog preproc_chunks_big.v; select -assert-count 6001 w:good; select -assert-none w:bad w:bad2; proc; hash -assert-same pp_chunk pp_chunk_6000"
@@ -0,0 +1,15 @@
+`define PP_W 8
+`define PP_ADD(a, b) ((a) + (b))
+module pp_chunk(input [`PP_W-1:0] a, b, output [`PP_W-1:0] y, output [15:0] s); // `PP_W in a "comment"
+/* a block comment with a ` backtick // and a line comment */
+`ifdef PP_UNDEFINED
+  wire bad;
+`else
+  wire good;
+`endif
+`ifndef PP_W
+  wire bad2;
+`endif
+  assign y = `PP_ADD(a, b) ^ {`PP_W{1'b1}};
+  assign s = "/`";
+endmodule
@@ -0,0 +1,9 @@
+#!/bin/bash
+set -e
+
+../../yosys -q -P profile_main.json -p "script parallel.ys; profile -o profile_cmd.json opt; stat"
+# the main trace stays open while the command is traced
+grep -q '"name":"opt","cat":"pass"' profile_main.json
+grep -q '"name":"stat","cat":"pass"' profile_main.json
+grep -q '"name":"opt","cat":"pass"' profile_cmd.json
+test $(grep -c '"name":"stat","cat":"pass"' profile_cmd.json) = 0
@@ -0,0 +1,6 @@
+#!/bin/bash
+set -e
+
+# read_json.ys writes the design before and after a round trip through read_json
+../../yosys -q read_json.ys
+cmp read_json.json read_json_2.json
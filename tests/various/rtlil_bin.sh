@@ -0,0 +1,12 @@
+#!/bin/bash
+set -e
+
+../../yosys -q -p "script rtlil_bin.ys; write_ilang rtlil_bin_1.il; write_rtlil_bin rtlil_bin.bin; design -reset; read_rtlil_bin rtlil_bin.bin; write_ilang rtlil_bin_2.il"
+cmp rtlil_bin_1.il rtlil_bin_2.il
+../../yosys -q -p "read_ilang rtlil_bin_1.il; write_rtlil_bin rtlil_bin.bin; design -reset; read_rtlil_bin rtlil_bin.bin; write_ilang rtlil_bin_3.il"
+cmp rtlil_bin_1.il rtlil_bin_3.il
+# modules that were not decoded yet are shared by "design -save" and must survive overwriting the file
+../../yosys -q -p "read_rtlil_bin rtlil_bin.bin; design -save lazy; write_rtlil_bin rtlil_bin.bin; design -reset; design -load lazy; write_ilang rtlil_bin_4.il"
+cmp rtlil_bin_1.il rtlil_bin_4.il
+../../yosys -q -p "read_rtlil_bin -nolazy rtlil_bin.bin; write_ilang rtlil_bin_5.il"
+cmp rtlil_bin_1.il rtlil_bin_5.il